@@ -1,47 +1,45 @@
-#include <functional>
+#include <glog/logging.h>
 #include <iterator>
 #include <map>
 #include <string>
-#include <tuple>
 #include <utility>
 
 #include "animation_frames.hpp"
-#include "maptools.hpp"
-#include "prettyprint.hpp"
-#include "texture_atlas.hpp"
+#include "tile_registry.hpp"
 
 AnimationFrames::AnimationFrames(std::string animation_frames_root):
     animation_frames_root(animation_frames_root) {
         VLOG(1) << "Frames rooted at " << animation_frames_root;
 }
-std::pair<int, std::string> AnimationFrames::get_frame(std::string section, float completion) {
-    std::map<std::string, std::string> names_to_tilesets(TextureAtlas::names_to_tilesets());
-    auto begin(maptools::start_of(names_to_tilesets, animation_frames_root +"/"+ section));
-    auto end  (maptools::end_of  (names_to_tilesets, animation_frames_root +"/"+ section));
 
-    auto length(std::distance(begin, end));
+AnimationFrames::Frame AnimationFrames::get_frame(std::string section, float completion) {
+    TileRegistry &registry(TileRegistry::get_instance());
+
+    auto clip_it(clips.find(section));
+    if (clip_it == std::end(clips)) {
+        clip_it = clips.emplace(section, registry.find_directory(animation_frames_root +"/"+ section)).first;
+        VLOG(2) << "Found " << clip_it->second.second - clip_it->second.first << " frames for "
+                << animation_frames_root +"/"+ section;
+    }
+    Clip const &clip(clip_it->second);
+
+    auto length(int(clip.second - clip.first));
     CHECK_NE(length, 0) << ": there are no DIRECTORIES matching the input " << "(" << animation_frames_root +"/"+ section << ").";
 
     auto animation_number(int(completion * float(length) * 2));
     animation_number -= 2 * length == animation_number;
-    animation_number %= int(length);
-
-    // Advance the iterator to the wanted texture
-    for (int i=0; i < animation_number; ++i) { ++begin; }
+    animation_number %= length;
 
-    std::string tile_name, tileset_name;
-    std::tie   (tile_name, tileset_name) = *begin;
-    tile_name = animation_frames_root +"/"+ section +"/"+ tile_name;
-
-    auto index(TextureAtlas::get_shared(tileset_name)->get_name_index(tile_name));
-    return std::make_pair(index, tileset_name);
+    return registry.resolve(clip.first + animation_number);
 }
 
-std::pair<int, std::string> AnimationFrames::get_frame(std::string section) {
-    std::map<std::string, std::string> names_to_tilesets(TextureAtlas::names_to_tilesets());
+AnimationFrames::Frame AnimationFrames::get_frame(std::string section) {
+    TileRegistry &registry(TileRegistry::get_instance());
+
+    auto frame_it(single_frames.find(section));
+    if (frame_it == std::end(single_frames)) {
+        frame_it = single_frames.emplace(section, registry.get_handle(animation_frames_root + "/" + section)).first;
+    }
 
-    std::string tile_name(animation_frames_root + "/" + section);
-    std::string tileset_name(names_to_tilesets.at(tile_name));
-    auto index(TextureAtlas::get_shared(tileset_name)->get_name_index(tile_name));
-    return std::make_pair(index, tileset_name);
+    return registry.resolve(frame_it->second);
 }
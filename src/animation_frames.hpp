@@ -1,18 +1,58 @@
 #ifndef ANIMATION_FRAMES_H
 #define ANIMATION_FRAMES_H
 
+#include <map>
 #include <string>
 #include <utility>
 
+#include "tile_registry.hpp"
+
+///
+/// The frames of an object's animations, found from the tile names
+/// under a root, such as "sprites/croc". Each section under it, such as
+/// "north/walking", is a clip of frames.
+///
+/// The tiles in a section are found in the tile registry the first
+/// time it is asked for. As its handles are in name order, a clip is
+/// kept as just the range of handles, and picking a frame as an
+/// animation plays is an index into the registry.
+///
 class AnimationFrames {
     public:
+        ///
+        /// A frame: the atlas holding it, its index in that atlas and its
+        /// texture coordinates
+        ///
+        using Frame = TileRegistry::Tile;
+
         AnimationFrames(std::string animation_frames_root);
 
-        std::pair<int, std::string> get_frame(std::string section, float completion);
-        std::pair<int, std::string> get_frame(std::string section);
+        ///
+        /// Get the frame a fraction of the way through a section's clip.
+        /// The clip is played twice over the course of completion.
+        ///
+        Frame get_frame(std::string section, float completion);
+
+        ///
+        /// Get the frame named by a section.
+        ///
+        Frame get_frame(std::string section);
 
     private:
+        ///
+        /// The first handle of a clip and one past its last
+        ///
+        using Clip = std::pair<TileRegistry::Handle, TileRegistry::Handle>;
+
         std::string animation_frames_root;
+
+        ///
+        /// Clips already found, by section. The handles of single frames,
+        /// by name rather than by directory, are kept apart as they
+        /// could share a name with a directory.
+        ///
+        std::map<std::string, Clip> clips;
+        std::map<std::string, TileRegistry::Handle> single_frames;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,123 @@
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "atlas_cache.hpp"
+#include "binary_cache.hpp"
+#include "image.hpp"
+
+namespace {
+    const std::string magic("PYLATLAS");
+
+    ///
+    /// Get the modification time and size of a file, or -1s if it
+    /// can't be found
+    ///
+    void stat_file(const std::string &path, int64_t &mtime, int64_t &size) {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            mtime = -1;
+            size  = -1;
+            return;
+        }
+
+        mtime = int64_t(info.st_mtime);
+        size  = int64_t(info.st_size);
+    }
+}
+
+AtlasCache::AtlasCache(const std::vector<Source> &sources, int unit_w, int unit_h, int max_size) {
+    std::stringstream key_stream;
+    key_stream << version << ";" << unit_w << "x" << unit_h << ";" << max_size;
+
+    for (const Source &source : sources) {
+        // Atlases load their names from the .fml file beside the image
+        std::string names_path(source.path.substr(0, source.path.find_last_of('.')) + ".fml");
+
+        int64_t image_mtime, image_size, names_mtime, names_size;
+        stat_file(source.path, image_mtime, image_size);
+        stat_file(names_path,  names_mtime, names_size);
+
+        key_stream << ";" << source.path << ":" << source.count
+                   << ":" << image_mtime << ":" << image_size
+                   << ":" << names_mtime << ":" << names_size;
+    }
+
+    key = key_stream.str();
+}
+
+
+std::string AtlasCache::get_path() const {
+    return BinaryCache::get_path("atlas", key, ".patlas");
+}
+
+
+AtlasCache::Contents AtlasCache::load() const {
+    std::string path(get_path());
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw LoadException("No cached atlas " + path);
+    }
+
+    BinaryCache::read_header(file, magic, version, key);
+
+    Contents contents;
+    contents.columns = BinaryCache::read<int32_t>(file);
+    contents.rows    = BinaryCache::read<int32_t>(file);
+    int width       (BinaryCache::read<int32_t>(file));
+    int height      (BinaryCache::read<int32_t>(file));
+    int store_width (BinaryCache::read<int32_t>(file));
+    int store_height(BinaryCache::read<int32_t>(file));
+
+    if (contents.columns < 0 || contents.rows < 0 || width < 0 || height < 0) {
+        throw LoadException("Cached atlas has a negative size");
+    }
+
+    uint32_t num_names(BinaryCache::read<uint32_t>(file));
+    if (num_names != uint32_t(contents.columns) * uint32_t(contents.rows)) {
+        throw LoadException("Cached atlas has the wrong number of names");
+    }
+    contents.names.reserve(num_names);
+    for (uint32_t i = 0; i < num_names; ++i) {
+        contents.names.push_back(BinaryCache::read_string(file));
+    }
+
+    contents.image = Image(width, height, true);
+    if (contents.image.store_width != store_width || contents.image.store_height != store_height) {
+        throw LoadException("Cached atlas was stored at another size");
+    }
+
+    std::streamsize pixel_bytes(std::streamsize(store_width) * store_height * std::streamsize(sizeof(Image::Pixel)));
+    if (!file.read(reinterpret_cast<char *>(contents.image.pixels), pixel_bytes)) {
+        throw LoadException("Cached atlas is truncated");
+    }
+
+    return contents;
+}
+
+
+void AtlasCache::save(const Contents &contents) const {
+    BinaryCache::save(get_path(), magic, version, key, [&] (std::ostream &file) {
+        BinaryCache::write(file, int32_t(contents.columns));
+        BinaryCache::write(file, int32_t(contents.rows));
+        BinaryCache::write(file, int32_t(contents.image.width));
+        BinaryCache::write(file, int32_t(contents.image.height));
+        BinaryCache::write(file, int32_t(contents.image.store_width));
+        BinaryCache::write(file, int32_t(contents.image.store_height));
+
+        BinaryCache::write(file, uint32_t(contents.names.size()));
+        for (const std::string &name : contents.names) {
+            BinaryCache::write_string(file, name);
+        }
+
+        file.write(reinterpret_cast<const char *>(contents.image.pixels),
+                   std::streamsize(contents.image.store_width) * contents.image.store_height
+                   * std::streamsize(sizeof(Image::Pixel)));
+    });
+}
@@ -0,0 +1,96 @@
+#ifndef ATLAS_CACHE_H
+#define ATLAS_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "binary_cache.hpp"
+#include "image.hpp"
+
+///
+/// A disk cache of merged texture atlases.
+///
+/// Merging atlases lays out the units of all of them in one image. The
+/// result, along with the names of its units, is written to the cache
+/// so that later runs merging the same atlases can load it instead.
+///
+/// Each merge is cached in its own BinaryCache file, keyed by the
+/// atlases merged, the size and modification time of their images and
+/// name files, the unit size and the largest texture size.
+///
+class AtlasCache {
+public:
+    ///
+    /// The version of the cache format. Files of other versions are
+    /// rejected when loading.
+    ///
+    static const uint32_t version = 1;
+
+    ///
+    /// An atlas being merged
+    ///
+    struct Source {
+        ///
+        /// The path of the atlas's image
+        ///
+        std::string path;
+        ///
+        /// The number of units in the atlas
+        ///
+        int count;
+    };
+
+    ///
+    /// A merged atlas
+    ///
+    struct Contents {
+        int columns;
+        int rows;
+        Image image;
+        ///
+        /// The name of each unit, or "" for unnamed units
+        ///
+        std::vector<std::string> names;
+    };
+
+    ///
+    /// Represents a failure to load a merged atlas, because it isn't in
+    /// the cache or can't be read.
+    ///
+    using LoadException = BinaryCache::LoadException;
+
+private:
+    ///
+    /// Everything the merged atlas depends on
+    ///
+    std::string key;
+
+public:
+    ///
+    /// @param sources the atlases merged, in the order they are merged
+    /// @param unit_w the width of a unit in pixels
+    /// @param unit_h the height of a unit in pixels
+    /// @param max_size the largest texture size GL can make
+    ///
+    AtlasCache(const std::vector<Source> &sources, int unit_w, int unit_h, int max_size);
+
+    ///
+    /// Get the path of the cache file for the merged atlas
+    ///
+    std::string get_path() const;
+
+    ///
+    /// Load the merged atlas.
+    /// Throws LoadException if it isn't cached.
+    ///
+    Contents load() const;
+
+    ///
+    /// Save the merged atlas, creating the cache directory if needed.
+    /// Throws LoadException if it can't be written.
+    ///
+    void save(const Contents &contents) const;
+};
+
+#endif
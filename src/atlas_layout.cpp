@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <glog/logging.h>
+
+#include "atlas_layout.hpp"
+#include "image.hpp"
+
+
+
+int AtlasLayout::next_power_of_two(int size) {
+    int power(1);
+    while (power < size) {
+        power <<= 1;
+    }
+    return power;
+}
+
+
+int64_t AtlasLayout::texture_bytes() const {
+    return int64_t(next_power_of_two(width)) * int64_t(next_power_of_two(height)) * 4;
+}
+
+
+AtlasLayout AtlasLayout::pack(int count, int unit_w, int unit_h, int max_size) {
+    if (count <= 0) {
+        return AtlasLayout{0, 0, 0, 0};
+    }
+
+    int max_columns(std::max(1, max_size / unit_w));
+
+    // As many columns as fit, as a last resort
+    int fallback_columns(std::min(count, max_columns));
+    int fallback_rows((count + fallback_columns - 1) / fallback_columns);
+    AtlasLayout best{fallback_columns, fallback_rows, fallback_columns * unit_w, fallback_rows * unit_h};
+    bool found(false);
+
+    int64_t best_area(0);
+    int64_t best_used(0);
+    int best_skew(0);
+
+    for (int columns = 1, end = std::min(count, max_columns); columns <= end; ++columns) {
+        int rows((count + columns - 1) / columns);
+        int width (columns * unit_w);
+        int height(rows    * unit_h);
+        if (height > max_size) {
+            continue;
+        }
+
+        int64_t area(int64_t(next_power_of_two(width)) * int64_t(next_power_of_two(height)));
+        int64_t used(int64_t(width) * int64_t(height));
+        int skew(std::abs(width - height));
+
+        if (!found
+            || area < best_area
+            || (area == best_area && (used < best_used
+                                      || (used == best_used && skew < best_skew)))) {
+            best = AtlasLayout{columns, rows, width, height};
+            best_area = area;
+            best_used = used;
+            best_skew = skew;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        LOG(WARNING) << count << " units of (" << unit_w << ", " << unit_h << ") "
+                     << "don't fit in a texture of " << max_size;
+    }
+
+    return best;
+}
+
+
+void AtlasLayout::blit(Image &destination, int x, int y,
+                       Image &source, int source_x, int source_y,
+                       int width, int height) {
+    size_t row_bytes(size_t(width) * sizeof(Image::Pixel));
+    for (int row = 0; row < height; ++row) {
+        std::memcpy(&destination.flipped_pixels[y + row][x],
+                    &source.flipped_pixels[source_y + row][source_x],
+                    row_bytes);
+    }
+}
+
+
+void AtlasLayout::blit_units(Image &destination, int destination_columns, int destination_index,
+                             Image &source, int source_columns,
+                             int count, int unit_w, int unit_h) {
+    int i(0);
+    while (i < count) {
+        int source_column(i % source_columns);
+        int source_row   (i / source_columns);
+        int destination_column((destination_index + i) % destination_columns);
+        int destination_row   ((destination_index + i) / destination_columns);
+
+        // Until either grid wraps on to its next row
+        int run(std::min(count - i, std::min(source_columns - source_column,
+                                             destination_columns - destination_column)));
+
+        VLOG(2) << "Moving: " << i << " (" << run << "): ("
+                << source_column << ", " << source_row << ") -> ("
+                << destination_column << ", " << destination_row << ")";
+
+        blit(destination, destination_column * unit_w, destination_row * unit_h,
+             source, source_column * unit_w, source_row * unit_h,
+             run * unit_w, unit_h);
+
+        i += run;
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef ATLAS_LAYOUT_H
+#define ATLAS_LAYOUT_H
+
+#include <cstdint>
+
+#include "image.hpp"
+
+///
+/// The arrangement of a texture atlas's units into a grid.
+///
+/// Every unit in an atlas is the same size and is addressed by its
+/// index in row-major order, so packing units into an atlas comes down
+/// to choosing how many columns the grid has. GL drivers commonly round
+/// textures up to powers of two, so the grid is chosen to make that
+/// rounded area as small as possible, rather than the area of the image.
+///
+struct AtlasLayout {
+    ///
+    /// The number of columns of units
+    ///
+    int columns;
+
+    ///
+    /// The number of rows of units
+    ///
+    int rows;
+
+    ///
+    /// The size of the grid in pixels
+    ///
+    int width;
+    int height;
+
+    ///
+    /// Round a size up to a power of two
+    ///
+    static int next_power_of_two(int size);
+
+    ///
+    /// Get the size of the grid once rounded up to powers of two, in
+    /// RGBA bytes
+    ///
+    int64_t texture_bytes() const;
+
+    ///
+    /// Choose a layout for some units which fits within the largest
+    /// texture GL can make, with the least area once rounded up to
+    /// powers of two. Ties are broken on the area of the grid, then on
+    /// how square it is.
+    ///
+    /// If no layout fits, as many columns as fit are used and the grid
+    /// is left too tall.
+    ///
+    /// @param count the number of units
+    /// @param unit_w the width of a unit in pixels
+    /// @param unit_h the height of a unit in pixels
+    /// @param max_size the largest texture size GL can make
+    ///
+    static AtlasLayout pack(int count, int unit_w, int unit_h, int max_size);
+
+    ///
+    /// Copy a rectangle of pixels between images, a row at a time.
+    ///
+    /// Coordinates are from the bottom left, as with flipped_pixels.
+    ///
+    static void blit(Image &destination, int x, int y,
+                     Image &source, int source_x, int source_y,
+                     int width, int height);
+
+    ///
+    /// Copy units from one grid of units to another, a run of units
+    /// at a time. Units keep their indexes, so any units which are next
+    /// to each other in both grids are copied together.
+    ///
+    /// @param destination the image to copy into
+    /// @param destination_columns the columns of units in destination
+    /// @param destination_index the index in destination of the first
+    ///                          unit copied
+    /// @param source the image to copy from
+    /// @param source_columns the columns of units in source
+    /// @param count the number of units to copy
+    /// @param unit_w the width of a unit in pixels
+    /// @param unit_h the height of a unit in pixels
+    ///
+    static void blit_units(Image &destination, int destination_columns, int destination_index,
+                           Image &source, int source_columns,
+                           int count, int unit_w, int unit_h);
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "binary_cache.hpp"
+
+std::string BinaryCache::directory("../resources/cache");
+
+BinaryCache::LoadException::LoadException(const std::string &message): std::runtime_error(message) {}
+
+uint64_t BinaryCache::hash(const std::string &value) {
+    uint64_t result(14695981039346656037ull);
+    for (char c : value) {
+        result ^= uint64_t(uint8_t(c));
+        result *= 1099511628211ull;
+    }
+    return result;
+}
+
+std::string BinaryCache::get_path(const std::string &prefix, const std::string &name, const std::string &extension) {
+    std::stringstream path;
+    path << directory << "/" << prefix << "-"
+         << std::hex << std::setw(16) << std::setfill('0') << hash(name) << extension;
+    return path.str();
+}
+
+
+void BinaryCache::read_header(std::istream &file, const std::string &magic, uint32_t version, const std::string &key) {
+    std::string file_magic(magic.size(), '\0');
+    if (!file.read(&file_magic[0], std::streamsize(magic.size())) || file_magic != magic) {
+        throw LoadException("Not a " + magic + " cache file");
+    }
+
+    if (read<uint32_t>(file) != version) {
+        throw LoadException("Cache file is of another version");
+    }
+
+    if (read_string(file) != key) {
+        throw LoadException("Cache file is stale");
+    }
+}
+
+void BinaryCache::save(const std::string &path, const std::string &magic, uint32_t version, const std::string &key,
+                       const std::function<void (std::ostream &)> &write_contents) {
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw LoadException("Couldn't make cache directory " + directory);
+    }
+
+    std::string partial_path(path + ".partial");
+    {
+        std::ofstream file(partial_path, std::ios::binary | std::ios::trunc);
+
+        file.write(magic.data(), std::streamsize(magic.size()));
+        write(file, version);
+        write_string(file, key);
+        write_contents(file);
+
+        if (!file) {
+            std::remove(partial_path.c_str());
+            throw LoadException("Couldn't write cache file " + path);
+        }
+    }
+
+    if (std::rename(partial_path.c_str(), path.c_str()) != 0) {
+        std::remove(partial_path.c_str());
+        throw LoadException("Couldn't write cache file " + path);
+    }
+}
+
+
+void BinaryCache::write_string(std::ostream &file, const std::string &value) {
+    write(file, uint32_t(value.size()));
+    file.write(value.data(), std::streamsize(value.size()));
+}
+
+std::string BinaryCache::read_string(std::istream &file) {
+    uint32_t length(read<uint32_t>(file));
+    std::string value(length, '\0');
+    if (length > 0 && !file.read(&value[0], std::streamsize(length))) {
+        throw LoadException("Cache file is truncated");
+    }
+    return value;
+}
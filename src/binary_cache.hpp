@@ -0,0 +1,107 @@
+#ifndef BINARY_CACHE_H
+#define BINARY_CACHE_H
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+///
+/// The parts shared by the disk caches of slow to build data, such as
+/// merged atlases and tile names.
+///
+/// Each cache file starts with the magic bytes of its kind of cache,
+/// the version of its format and the whole key it was built from, so a
+/// stale or colliding file is never used. Files are named after a hash
+/// of the key and written in the byte order of the machine.
+///
+class BinaryCache {
+public:
+    ///
+    /// Represents a failure to load from a cache, because the file
+    /// isn't there, is stale or can't be read.
+    ///
+    class LoadException: public std::runtime_error {
+    public:
+        LoadException(const std::string &message);
+    };
+
+private:
+    ///
+    /// The directory cache files are kept in
+    ///
+    static std::string directory;
+
+public:
+    static const std::string &get_directory() { return directory; }
+    static void set_directory(const std::string &directory) { BinaryCache::directory = directory; }
+
+    ///
+    /// A 64 bit FNV-1a hash, which unlike std::hash is the same from
+    /// build to build
+    ///
+    static uint64_t hash(const std::string &value);
+
+    ///
+    /// Get the path of a cache file in the cache directory.
+    /// @param prefix the start of the file name, naming the kind of cache
+    /// @param name what the file is named after, which is hashed
+    /// @param extension the file's extension, with its dot
+    ///
+    static std::string get_path(const std::string &prefix, const std::string &name, const std::string &extension);
+
+    ///
+    /// Check the header of a cache file.
+    /// Throws LoadException if the file is of another kind or version,
+    /// or was built from another key.
+    /// @param file the file, at its start
+    /// @param magic the magic bytes of the kind of cache
+    /// @param version the version of the cache's format
+    /// @param key everything the cached data depends on
+    ///
+    static void read_header(std::istream &file, const std::string &magic, uint32_t version, const std::string &key);
+
+    ///
+    /// Save a cache file, creating the cache directory if needed. The
+    /// file is written aside and moved into place, so a partly written
+    /// file is never loaded.
+    /// Throws LoadException if it can't be written.
+    /// @param path the path of the file
+    /// @param magic the magic bytes of the kind of cache
+    /// @param version the version of the cache's format
+    /// @param key everything the cached data depends on
+    /// @param write_contents writes what follows the header
+    ///
+    static void save(const std::string &path, const std::string &magic, uint32_t version, const std::string &key,
+                     const std::function<void (std::ostream &)> &write_contents);
+
+    template <typename T>
+    static void write(std::ostream &file, T value) {
+        file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    static void write_string(std::ostream &file, const std::string &value);
+
+    ///
+    /// Read a value.
+    /// Throws LoadException if the file ends first.
+    ///
+    template <typename T>
+    static T read(std::istream &file) {
+        T value;
+        if (!file.read(reinterpret_cast<char *>(&value), sizeof(T))) {
+            throw LoadException("Cache file is truncated");
+        }
+        return value;
+    }
+
+    ///
+    /// Read a string.
+    /// Throws LoadException if the file ends first.
+    ///
+    static std::string read_string(std::istream &file);
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glog/logging.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#include "bloom.hpp"
+
+const int Bloom::max_radius;
+
+
+Bloom::Bloom(int radius, const uint8_t rgba[4], const uint8_t glow_rgba[4]):
+    radius(radius)
+{
+    CHECK_GT(radius, 0);
+    CHECK_LE(radius, max_radius);
+
+    std::copy(glow_rgba, glow_rgba + 4, this->glow_rgba);
+
+    // The strength of the glow falls off with the square of the distance
+    // to the edge of the radius, from 0 to 255. Further away there is
+    // none, so only squared distances below radius² need a value.
+    glow_alpha.resize(size_t(radius * radius));
+    for (int distance_squared = 0; distance_squared < radius * radius; ++distance_squared) {
+        int score(int((float(radius) - sqrt(float(distance_squared))) * 255.0f / float(radius)));
+        int strength((score > 0) ? score * score / 255 : 0);
+        glow_alpha[size_t(distance_squared)] = uint8_t(int(glow_rgba[3]) * strength / 255);
+    }
+
+    for (int a = 0; a < 256; ++a) {
+        for (int channel = 0; channel < 4; ++channel) {
+            merge_rgba[channel][a] = uint8_t(((255 - a) * glow_rgba[channel] + a * rgba[channel]) / 255);
+        }
+    }
+}
+
+
+void Bloom::vertical_pass(const uint8_t *pixels, int width, int height, int stride) {
+    distances.resize(size_t(width * height));
+    const uint8_t cap = uint8_t(radius);
+
+    // Nothing is covered above the image
+    std::vector<uint8_t> uncovered(size_t(width), cap);
+
+    // Downwards, each pixel gets the distance to the nearest covered
+    // pixel above it or at it
+    for (int y = 0; y < height; ++y) {
+        const uint8_t *source(&pixels[size_t(y * stride) * 4]);
+        const uint8_t *above(y > 0 ? &distances[size_t((y - 1) * width)] : uncovered.data());
+        uint8_t *row(&distances[size_t(y * width)]);
+
+        int x(0);
+#if defined(__SSE2__)
+        const __m128i zero(_mm_setzero_si128());
+        const __m128i one(_mm_set1_epi8(1));
+        const __m128i caps(_mm_set1_epi8(char(cap)));
+        for (; x + 16 <= width; x += 16) {
+            // Gather the alpha of 16 pixels
+            const __m128i *block(reinterpret_cast<const __m128i *>(&source[x * 4]));
+            __m128i alpha_0(_mm_srli_epi32(_mm_loadu_si128(block + 0), 24));
+            __m128i alpha_1(_mm_srli_epi32(_mm_loadu_si128(block + 1), 24));
+            __m128i alpha_2(_mm_srli_epi32(_mm_loadu_si128(block + 2), 24));
+            __m128i alpha_3(_mm_srli_epi32(_mm_loadu_si128(block + 3), 24));
+            __m128i alpha(_mm_packus_epi16(_mm_packs_epi32(alpha_0, alpha_1),
+                                           _mm_packs_epi32(alpha_2, alpha_3)));
+
+            __m128i previous(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&above[x])));
+            __m128i distance(_mm_min_epu8(_mm_adds_epu8(previous, one), caps));
+            distance = _mm_and_si128(distance, _mm_cmpeq_epi8(alpha, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(&row[x]), distance);
+        }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        const uint8x16_t zero(vdupq_n_u8(0));
+        const uint8x16_t one(vdupq_n_u8(1));
+        const uint8x16_t caps(vdupq_n_u8(cap));
+        for (; x + 16 <= width; x += 16) {
+            uint8x16_t alpha(vld4q_u8(&source[x * 4]).val[3]);
+
+            uint8x16_t distance(vminq_u8(vqaddq_u8(vld1q_u8(&above[x]), one), caps));
+            distance = vandq_u8(distance, vceqq_u8(alpha, zero));
+            vst1q_u8(&row[x], distance);
+        }
+#endif
+        for (; x < width; ++x) {
+            row[x] = (source[x * 4 + 3] == 0) ? uint8_t(std::min(above[x] + 1, int(cap))) : uint8_t(0);
+        }
+    }
+
+    // Upwards, take the nearer of that and the distance to the nearest
+    // covered pixel below
+    for (int y = height - 2; y >= 0; --y) {
+        const uint8_t *below(&distances[size_t((y + 1) * width)]);
+        uint8_t *row(&distances[size_t(y * width)]);
+
+        int x(0);
+#if defined(__SSE2__)
+        const __m128i one(_mm_set1_epi8(1));
+        const __m128i caps(_mm_set1_epi8(char(cap)));
+        for (; x + 16 <= width; x += 16) {
+            __m128i next(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&below[x])));
+            __m128i distance(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&row[x])));
+            distance = _mm_min_epu8(distance, _mm_min_epu8(_mm_adds_epu8(next, one), caps));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(&row[x]), distance);
+        }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        const uint8x16_t one(vdupq_n_u8(1));
+        const uint8x16_t caps(vdupq_n_u8(cap));
+        for (; x + 16 <= width; x += 16) {
+            uint8x16_t next(vminq_u8(vqaddq_u8(vld1q_u8(&below[x]), one), caps));
+            vst1q_u8(&row[x], vminq_u8(vld1q_u8(&row[x]), next));
+        }
+#endif
+        for (; x < width; ++x) {
+            row[x] = std::min(row[x], uint8_t(std::min(below[x] + 1, int(cap))));
+        }
+    }
+}
+
+
+void Bloom::horizontal_pass(const uint8_t *row, int width) {
+    // Each pixel of the row is the vertex of a parabola,
+    // (x - q)² + distance(q)², and the squared distance of a pixel is
+    // the lowest of them. Find the lower envelope of the parabolas from
+    // left to right, then read it off. Pixels at the radius are left
+    // out, as nothing they reach glows.
+    row_distances.resize(size_t(width));
+    envelope_vertices.resize(size_t(width));
+    envelope_heights.resize(size_t(width));
+    envelope_bounds.resize(size_t(width));
+
+    int *vertices(envelope_vertices.data());
+    int *heights(envelope_heights.data());
+    int64_t *bounds(envelope_bounds.data());
+
+    const uint8_t cap = uint8_t(radius);
+    int size(0);
+    for (int q = 0; q < width; ++q) {
+        if (row[q] >= cap) {
+            continue;
+        }
+
+        // Parabola q is below parabola p from
+        // (height(q) - height(p)) / 2 (q - p), where height(q) is
+        // distance(q)² + q². That is compared with where p is below the
+        // one before it by cross-multiplying.
+        int height(int(row[q]) * int(row[q]) + q * q);
+        while (size > 1) {
+            int p(vertices[size - 1]);
+            int64_t crossing(height - heights[size - 1]);
+            if (crossing * (p - vertices[size - 2]) > bounds[size - 1] * (q - p)) {
+                break;
+            }
+            // The new parabola hides this one
+            --size;
+        }
+
+        if (size > 0) {
+            bounds[size] = height - heights[size - 1];
+        }
+        vertices[size] = q;
+        heights[size] = height;
+        ++size;
+    }
+
+    const int limit(radius * radius);
+    if (size == 0) {
+        std::fill(row_distances.begin(), row_distances.end(), limit);
+        return;
+    }
+
+    int k(0);
+    for (int q = 0; q < width; ++q) {
+        // Move on while the next parabola is below from before q
+        while (k + 1 < size && bounds[k + 1] < int64_t(2 * q) * (vertices[k + 1] - vertices[k])) {
+            ++k;
+        }
+
+        int p(vertices[k]);
+        row_distances[size_t(q)] = std::min((q - p) * (q - p) + heights[k] - p * p, limit);
+    }
+}
+
+
+void Bloom::apply(uint8_t *pixels, int width, int height, int stride) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    vertical_pass(pixels, width, height, stride);
+
+    const int limit(radius * radius);
+    const uint8_t cap = uint8_t(radius);
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t *row(&distances[size_t(y * width)]);
+        uint8_t *pixel_row(&pixels[size_t(y * stride) * 4]);
+
+        // Rows with nothing in reach don't glow
+        bool reached(std::any_of(row, row + width, [cap] (uint8_t distance) { return distance < cap; }));
+        if (reached) {
+            horizontal_pass(row, width);
+        }
+
+        for (int x = 0; x < width; ++x) {
+            uint8_t *pixel(&pixel_row[x * 4]);
+
+            if (pixel[3] == 0) {
+                int distance_squared(reached ? row_distances[size_t(x)] : limit);
+                pixel[0] = glow_rgba[0];
+                pixel[1] = glow_rgba[1];
+                pixel[2] = glow_rgba[2];
+                pixel[3] = (distance_squared < limit) ? glow_alpha[size_t(distance_squared)] : uint8_t(0);
+            }
+            else {
+                uint8_t coverage(pixel[3]);
+                pixel[0] = merge_rgba[0][coverage];
+                pixel[1] = merge_rgba[1][coverage];
+                pixel[2] = merge_rgba[2][coverage];
+                pixel[3] = merge_rgba[3][coverage];
+            }
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <cstdint>
+#include <vector>
+
+
+///
+/// The glow drawn around text, spreading out from every covered pixel
+/// and fading with the distance from it.
+///
+/// The glow of a transparent pixel comes from its distance to the
+/// nearest covered pixel, which is found with a separable distance
+/// transform: a vertical pass giving each pixel its distance to the
+/// nearest covered pixel in its column, then a horizontal lower envelope
+/// of parabolas over each row. Both passes take time linear in the
+/// number of pixels, whatever the radius.
+///
+/// Covered pixels are blended from the glow colour to the text colour
+/// by their coverage.
+///
+class Bloom {
+public:
+    ///
+    /// The largest radius, so that distances fit in a byte
+    ///
+    static const int max_radius = 255;
+
+private:
+    ///
+    /// The radius of the glow, in pixels
+    ///
+    int radius;
+
+    ///
+    /// The colour of the glow
+    ///
+    uint8_t glow_rgba[4];
+
+    ///
+    /// The alpha of the glow at each squared distance below radius²
+    ///
+    std::vector<uint8_t> glow_alpha;
+
+    ///
+    /// The colour of a covered pixel for each coverage
+    ///
+    uint8_t merge_rgba[4][256];
+
+    ///
+    /// The vertical distances of the image being bloomed, capped at the
+    /// radius, row by row
+    ///
+    std::vector<uint8_t> distances;
+
+    ///
+    /// Scratch space for the horizontal pass: the squared distances of
+    /// a row, and the vertices and heights of the parabolas in its lower
+    /// envelope with where each crosses the one before, scaled by twice
+    /// the distance between their vertices
+    ///
+    std::vector<int> row_distances;
+    std::vector<int> envelope_vertices;
+    std::vector<int> envelope_heights;
+    std::vector<int64_t> envelope_bounds;
+
+    ///
+    /// Find the vertical distances of an image
+    ///
+    void vertical_pass(const uint8_t *pixels, int width, int height, int stride);
+
+    ///
+    /// Find the squared distances of a row from its vertical distances
+    ///
+    void horizontal_pass(const uint8_t *row, int width);
+
+public:
+    ///
+    /// Prepare to bloom text
+    /// @param radius the radius of the glow, from 1 to max_radius
+    /// @param rgba the colour of the text
+    /// @param glow_rgba the colour of the glow
+    ///
+    Bloom(int radius, const uint8_t rgba[4], const uint8_t glow_rgba[4]);
+
+    ///
+    /// Bloom an image of text in place. The text's coverage is taken
+    /// from the alpha channel.
+    /// @param pixels the image's RGBA pixels, row by row
+    /// @param width the width of the image, in pixels
+    /// @param height the height of the image, in pixels
+    /// @param stride the distance between the starts of rows, in pixels
+    ///
+    void apply(uint8_t *pixels, int width, int height, int stride);
+};
+
+#endif
@@ -150,15 +150,12 @@ FinalChallenge::FinalChallenge(ChallengeData *challenge_data): Challenge(challen
                            "the jungle to gather the fruit.\n" 
     );
 
-    EventManager::get_instance().add_timed_event(GameTime::duration(5.0), [this] (float completion) {
-            if(completion == 1.0) {
-                Engine::print_dialogue("Villager",
-                                       "You can repair the bridge with vines. \n"
-                                       "Maybe you could use your friend Milo to help you? \n"
-                                       "Try using the cut(direction) API call."
-                                       );
-            }
-            return true;
+    EventManager::get_instance().add_timer(GameTime::duration(5.0), [] () {
+            Engine::print_dialogue("Villager",
+                                   "You can repair the bridge with vines. \n"
+                                   "Maybe you could use your friend Milo to help you? \n"
+                                   "Try using the cut(direction) API call."
+                                   );
     });
 
     ChallengeHelper::make_interaction("fixbridge/1", [bridge_id] (int){
@@ -176,20 +173,17 @@ FinalChallenge::FinalChallenge(ChallengeData *challenge_data): Challenge(challen
             );
 
 
-            EventManager::get_instance().add_timed_event(GameTime::duration(5.0), [] (float completion) {
-                    if(completion == 1.0) {
-                        Engine::print_dialogue("Villager",
-                                               "It can be quite a tedious process as the fruit is a "
-                                               "long way into the jungle.\n We normally work in pairs "
-                                               "when we gather the fruit.\n There's a drop off point "
-                                               "on the map where we exchange fruits with each other.\n"
-                                               "Why not get Milo to pick up items from that point "
-                                               "and run them back to the fruit crates by me?\n"
-                                               "That way, you're free to gather more fruit whilst "
-                                               "he does that!"
-                        );
-                    }
-                    return true;
+            EventManager::get_instance().add_timer(GameTime::duration(5.0), [] () {
+                    Engine::print_dialogue("Villager",
+                                           "It can be quite a tedious process as the fruit is a "
+                                           "long way into the jungle.\n We normally work in pairs "
+                                           "when we gather the fruit.\n There's a drop off point "
+                                           "on the map where we exchange fruits with each other.\n"
+                                           "Why not get Milo to pick up items from that point "
+                                           "and run them back to the fruit crates by me?\n"
+                                           "That way, you're free to gather more fruit whilst "
+                                           "he does that!"
+                    );
                 });
             
             return false;
@@ -221,11 +215,8 @@ FinalChallenge::FinalChallenge(ChallengeData *challenge_data): Challenge(challen
                                                 "Nooooo! That crocodile got you!"
                                                 );
 
-                        EventManager::get_instance().add_timed_event(GameTime::duration(1.0), [this] (float completion) {
-                                if(completion == 1.0) {
-                                    event_finish.trigger(0);
-                                }
-                                return true;
+                        EventManager::get_instance().add_timer(GameTime::duration(1.0), [this] () {
+                                event_finish.trigger(0);
                             });
                     }
                 }
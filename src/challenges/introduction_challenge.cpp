@@ -62,7 +62,7 @@ IntroductionChallenge::IntroductionChallenge(ChallengeData *challenge_data): Cha
                 [this] (KeyboardInputEvent) {
                     auto pathblocker(ObjectManager::get_instance().get_object<MapObject>(pathblocker_top));
 
-                    pathblocker->set_tile(TextureAtlas::from_name("test/blank"));
+                    pathblocker->set_tile("test/blank");
                     pathblocker->set_walkability(Walkability::WALKABLE);
                 }
             ));
@@ -297,7 +297,7 @@ IntroductionChallenge::IntroductionChallenge(ChallengeData *challenge_data): Cha
                 for (auto pathblocker_bottom : pathblockers_bottom) {
                     auto pathblocker(ObjectManager::get_instance().get_object<MapObject>(pathblocker_bottom));
 
-                    pathblocker->set_tile(TextureAtlas::from_name("test/blank"));
+                    pathblocker->set_tile("test/blank");
                     pathblocker->set_walkability(Walkability::WALKABLE);
                 }
 
@@ -423,11 +423,8 @@ IntroductionChallenge::IntroductionChallenge(ChallengeData *challenge_data): Cha
 
             ChallengeHelper::set_completed_level(1);
 
-            EventManager::get_instance().add_timed_event(GameTime::duration(10.0), [this] (float completion) {
-                if (completion == 1.0) {
-                    finish();
-                }
-                return true;
+            EventManager::get_instance().add_timer(GameTime::duration(10.0), [this] () {
+                finish();
             });
 
             return false;
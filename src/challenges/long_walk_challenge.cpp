@@ -106,7 +106,7 @@ LongWalkChallenge::LongWalkChallenge(ChallengeData *challenge_data): Challenge(c
                 for (auto wall_object_id : wall_path_medium_objects) {
                     auto wall_object(ObjectManager::get_instance().get_object<MapObject>(wall_object_id));
 
-                    wall_object->set_tile(TextureAtlas::from_name("test/blank"));
+                    wall_object->set_tile("test/blank");
                     wall_object->set_walkability(Walkability::WALKABLE);
                 }
             }
@@ -125,7 +125,7 @@ LongWalkChallenge::LongWalkChallenge(ChallengeData *challenge_data): Challenge(c
         for (auto wall_object_id : wall_path_long_objects) {
             auto wall_object(ObjectManager::get_instance().get_object<MapObject>(wall_object_id));
 
-            wall_object->set_tile(TextureAtlas::from_name("test/blank"));
+            wall_object->set_tile("test/blank");
             wall_object->set_walkability(Walkability::WALKABLE);
         }
         return false;
@@ -0,0 +1,278 @@
+#define GLM_FORCE_RADIANS
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <glog/logging.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "chunk_cache.hpp"
+#include "gl_state.hpp"
+#include "packed_vertex.hpp"
+#include "renderable_component.hpp"
+#include "shader.hpp"
+#include "texture_format.hpp"
+#include "texture_memory.hpp"
+
+#ifdef USE_GL
+#define GL_GLEXT_PROTOTYPES
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+
+
+
+const size_t ChunkCache::max_bytes;
+
+
+ChunkCache::Entry::~Entry() {
+    if (texture != 0) {
+        GLState::delete_texture(texture);
+    }
+}
+
+
+ChunkCache::ChunkCache() {
+}
+
+ChunkCache::~ChunkCache() {
+    clear();
+
+    if (framebuffer != 0) {
+        glDeleteFramebuffers(1, &framebuffer);
+    }
+}
+
+
+void ChunkCache::clear() {
+    entries.clear();
+    bytes = 0;
+}
+
+
+void ChunkCache::begin_frame(float tile_pixels, const std::vector<int> &layer_ids, int window_width, int window_height) {
+    ++frame;
+
+    this->window_width  = window_width;
+    this->window_height = window_height;
+
+    if (tile_pixels != this->tile_pixels) {
+        this->tile_pixels = tile_pixels;
+        tile_pixels_frame = frame;
+        clear();
+    }
+
+    if (layer_ids != this->layer_ids) {
+        this->layer_ids = layer_ids;
+        clear();
+    }
+}
+
+
+bool ChunkCache::draw(int chunk_x, int chunk_y, int width_tiles, int height_tiles, unsigned int version,
+                      const glm::mat4 &projection_matrix, const glm::mat4 &model, const DrawFunction &draw) {
+    // Nothing is cached while zooming, as it would all be thrown away
+    // the next frame
+    if (unsupported || tile_pixels_frame == frame) {
+        return false;
+    }
+
+    std::unique_ptr<Entry> &entry(entries[std::make_pair(chunk_x, chunk_y)]);
+    if (!entry) {
+        entry.reset(new Entry());
+        entry->version = version;
+        entry->changed_frame = frame;
+    }
+
+    entry->used_frame = frame;
+
+    if (entry->version != version) {
+        entry->version = version;
+        entry->valid = false;
+        entry->changed_frame = frame;
+    }
+
+    if (!entry->valid) {
+        // Wait for the chunk to stop changing
+        if (entry->changed_frame == frame) {
+            return false;
+        }
+
+        if (!composite(*entry, width_tiles, height_tiles, draw)) {
+            return false;
+        }
+    }
+
+    if (!shader) {
+        shader = Shader::get_shared("tile_shader");
+    }
+
+    GLState &gl_state(GLState::get_current());
+    entry->quad.set_shader(shader);
+    entry->quad.bind_shader();
+
+    // The quad's positions are fixed point, relative to the chunk
+    glm::mat4 quad_model(glm::scale(model, glm::vec3(1.0f / float(PackedVertex::tile_units))));
+    shader->set_uniform("mat_projection", projection_matrix);
+    shader->set_uniform("mat_modelview", quad_model);
+
+    gl_state.active_texture(GL_TEXTURE0);
+    gl_state.bind_texture_2d(entry->texture);
+
+    // The texture is premultiplied
+    gl_state.count_calls(2);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    entry->quad.bind_vbos();
+    entry->quad.draw();
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    return true;
+}
+
+
+bool ChunkCache::composite(Entry &entry, int width_tiles, int height_tiles, const DrawFunction &draw) {
+    GLState &gl_state(GLState::get_current());
+
+    if (max_texture_size == 0) {
+        gl_state.count_calls();
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    }
+
+    // The texture covers the chunk at the size it is drawn
+    float width_pixels (float(width_tiles)  * tile_pixels);
+    float height_pixels(float(height_tiles) * tile_pixels);
+    int texture_width (int(std::ceil(width_pixels)));
+    int texture_height(int(std::ceil(height_pixels)));
+
+    if (texture_width <= 0 || texture_height <= 0
+        || texture_width > max_texture_size || texture_height > max_texture_size) {
+        return false;
+    }
+
+    if (entry.texture == 0 || entry.texture_width != texture_width || entry.texture_height != texture_height) {
+        size_t needed(size_t(texture_width) * size_t(texture_height) * 4u);
+
+        if (entry.texture != 0) {
+            GLState::delete_texture(entry.texture);
+            entry.texture = 0;
+            bytes -= size_t(entry.texture_width) * size_t(entry.texture_height) * 4u;
+        }
+
+        if (!make_room(needed)) {
+            return false;
+        }
+
+        gl_state.count_calls();
+        glGenTextures(1, &entry.texture);
+        gl_state.active_texture(GL_TEXTURE0);
+        gl_state.bind_texture_2d(entry.texture);
+
+        gl_state.count_calls(5);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture_width, texture_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        entry.texture_width  = texture_width;
+        entry.texture_height = texture_height;
+        bytes += needed;
+        TextureMemory::record(entry.texture, "chunk cache", texture_width, texture_height, TextureFormat::Format::RGBA8888);
+
+        // The quad covers the chunk, and the part of the texture the
+        // chunk was drawn into
+        PackedQuad *quad_data(new PackedQuad[1]);
+        quad_data[0].set_position(0, 0,
+                                  GLshort(width_tiles  * PackedVertex::tile_units),
+                                  GLshort(height_tiles * PackedVertex::tile_units));
+        quad_data[0].set_tex_coords(std::make_tuple(0.0f, width_pixels  / float(texture_width),
+                                                    0.0f, height_pixels / float(texture_height)));
+        entry.quad.set_quad_data(quad_data, 1, false);
+    }
+
+    if (framebuffer == 0) {
+        gl_state.count_calls();
+        glGenFramebuffers(1, &framebuffer);
+    }
+
+    gl_state.count_calls(3);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, entry.texture, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        LOG(WARNING) << "Cannot composite map chunks into textures; drawing them directly";
+        unsupported = true;
+
+        gl_state.count_calls();
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        clear();
+        return false;
+    }
+
+    // Composite over nothing, with premultiplied alpha. The window
+    // leaves alpha alone, so it is turned back on for this.
+    gl_state.count_calls(6);
+    glViewport(0, 0, texture_width, texture_height);
+    glScissor(0, 0, texture_width, texture_height);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    glm::mat4 projection_matrix(glm::ortho(0.0f, float(texture_width), 0.0f, float(texture_height), 0.0f, 1.0f));
+    glm::mat4 model(glm::scale(glm::mat4(1.0f), glm::vec3(tile_pixels)));
+    draw(projection_matrix, model);
+
+    // Back to drawing the window
+    gl_state.count_calls(6);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, window_width, window_height);
+    glScissor(0, 0, window_width, window_height);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    entry.valid = true;
+    return true;
+}
+
+
+bool ChunkCache::make_room(size_t needed) {
+    while (bytes + needed > max_bytes) {
+        // The least recently drawn entry with a texture
+        auto oldest(std::end(entries));
+        unsigned int oldest_frame(std::numeric_limits<unsigned int>::max());
+        for (auto it = std::begin(entries); it != std::end(entries); ++it) {
+            if (it->second->texture != 0 && it->second->used_frame < oldest_frame) {
+                oldest = it;
+                oldest_frame = it->second->used_frame;
+            }
+        }
+
+        // Everything left is in view
+        if (oldest == std::end(entries) || oldest_frame == frame) {
+            return false;
+        }
+
+        Entry &evicted(*oldest->second);
+        bytes -= size_t(evicted.texture_width) * size_t(evicted.texture_height) * 4u;
+        entries.erase(oldest);
+    }
+
+    return true;
+}
@@ -0,0 +1,215 @@
+#ifndef CHUNK_CACHE_H
+#define CHUNK_CACHE_H
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/mat4x4.hpp>
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+
+#if defined(USE_GL)
+#define GL_GLEXT_PROTOTYPES
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+#include "renderable_component.hpp"
+
+class Shader;
+
+///
+/// Keeps the map's layers composited into one texture for each chunk,
+/// so that a chunk in view is drawn as a single textured quad rather
+/// than a quad for every tile of every layer, blended over each other.
+///
+/// Chunks are composited by drawing their layers into a framebuffer
+/// object, at the size they are drawn on screen. The textures hold
+/// premultiplied alpha, so drawing one over the background gives the
+/// same result as drawing the layers over it one by one.
+///
+/// A chunk is composited again when its version, which the map bumps
+/// whenever one of its tiles changes, no longer matches. To avoid
+/// compositing a chunk every frame while it keeps changing, a changed
+/// chunk is only composited once a frame has passed without it changing
+/// again; until then it is drawn directly. Everything is dropped when
+/// the scale or the layers drawn change, and while the scale keeps
+/// changing nothing is cached.
+///
+class ChunkCache {
+public:
+    ///
+    /// Draws the layers of a chunk
+    /// @param projection_matrix the projection to draw with
+    /// @param model the modelview from tiles, relative to the chunk
+    ///
+    using DrawFunction = std::function<void (const glm::mat4 &projection_matrix, const glm::mat4 &model)>;
+
+    ///
+    /// The most texture memory the cache uses, in bytes. Chunks which
+    /// don't fit are drawn directly.
+    ///
+    static const size_t max_bytes = 32 * 1024 * 1024;
+
+private:
+    ///
+    /// A chunk's composited layers
+    ///
+    struct Entry {
+        ///
+        /// The texture the layers are composited into, or 0 if it hasn't
+        /// been made
+        ///
+        GLuint texture = 0;
+        int texture_width = 0;
+        int texture_height = 0;
+
+        ///
+        /// The quad covering the chunk, relative to it
+        ///
+        RenderableComponent quad;
+
+        ///
+        /// The chunk's version when it was composited or last seen
+        ///
+        unsigned int version = 0;
+
+        ///
+        /// Whether the texture holds the chunk at that version
+        ///
+        bool valid = false;
+
+        ///
+        /// The frames in which the chunk last changed and was last drawn
+        ///
+        unsigned int changed_frame = 0;
+        unsigned int used_frame = 0;
+
+        ~Entry();
+    };
+
+    ///
+    /// The cached chunks, by their x and y index
+    ///
+    std::map<std::pair<int, int>, std::unique_ptr<Entry>> entries;
+
+    ///
+    /// The framebuffer object chunks are composited with, made when
+    /// first needed
+    ///
+    GLuint framebuffer = 0;
+
+    ///
+    /// The shader drawing the composited chunks
+    ///
+    std::shared_ptr<Shader> shader;
+
+    ///
+    /// The texture memory of the entries, in bytes
+    ///
+    size_t bytes = 0;
+
+    ///
+    /// The frame being drawn, counting up from 1
+    ///
+    unsigned int frame = 0;
+
+    ///
+    /// The size tiles are drawn at, in pixels, and the frame it last
+    /// changed in
+    ///
+    float tile_pixels = 0.0f;
+    unsigned int tile_pixels_frame = 0;
+
+    ///
+    /// The layers composited into the chunks
+    ///
+    std::vector<int> layer_ids;
+
+    ///
+    /// The size of the window, to restore the viewport to
+    ///
+    int window_width = 0;
+    int window_height = 0;
+
+    ///
+    /// The largest texture GL can make, looked up when first needed
+    ///
+    GLint max_texture_size = 0;
+
+    ///
+    /// Set when the framebuffer can't be used, after which everything
+    /// is drawn directly
+    ///
+    bool unsupported = false;
+
+    ///
+    /// Composite a chunk's layers into its entry's texture
+    /// @return false if it couldn't be
+    ///
+    bool composite(Entry &entry, int width_tiles, int height_tiles, const DrawFunction &draw);
+
+    ///
+    /// Free the textures of the least recently drawn entries, other than
+    /// those drawn this frame, until there is room for more
+    /// @param needed the bytes needed
+    /// @return false if there isn't room
+    ///
+    bool make_room(size_t needed);
+
+    ChunkCache(const ChunkCache &) = delete;
+    ChunkCache &operator=(const ChunkCache &) = delete;
+
+public:
+    ChunkCache();
+    ~ChunkCache();
+
+    ///
+    /// Drop every cached chunk
+    ///
+    void clear();
+
+    ///
+    /// Start a frame, dropping every cached chunk if what they hold is
+    /// no longer what would be drawn.
+    /// @param tile_pixels the size tiles are drawn at, in pixels
+    /// @param layer_ids the layers composited into the chunks, in order
+    /// @param window_width the width of the window, in pixels
+    /// @param window_height the height of the window, in pixels
+    ///
+    void begin_frame(float tile_pixels, const std::vector<int> &layer_ids, int window_width, int window_height);
+
+    ///
+    /// Draw a chunk from its cached texture, compositing it first if
+    /// needed.
+    /// @param chunk_x the chunk's x index
+    /// @param chunk_y the chunk's y index
+    /// @param width_tiles the chunk's width, in tiles
+    /// @param height_tiles the chunk's height, in tiles
+    /// @param version the chunk's version, which changes with its tiles
+    /// @param projection_matrix the map's projection
+    /// @param model the modelview from tiles, relative to the chunk
+    /// @param draw draws the chunk's layers, for compositing them
+    /// @return false if the chunk isn't cached, so needs drawing
+    ///         directly
+    ///
+    bool draw(int chunk_x, int chunk_y, int width_tiles, int height_tiles, unsigned int version,
+              const glm::mat4 &projection_matrix, const glm::mat4 &model, const DrawFunction &draw);
+
+    ///
+    /// Get the texture memory used, in bytes
+    ///
+    size_t get_bytes() const { return bytes; }
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include <algorithm>
+#include <vector>
+
+#include "chunk_slots.hpp"
+
+ChunkSlots::ChunkSlots(int num_tiles):
+    tile_slots(size_t(num_tiles), -1),
+    free_slots(),
+    capacity(0) {
+}
+
+void ChunkSlots::reset(int new_capacity) {
+    std::fill(tile_slots.begin(), tile_slots.end(), -1);
+    capacity = new_capacity;
+
+    // Hand out the lowest slots first, so the used slots stay packed
+    free_slots.clear();
+    for (int slot = capacity - 1; slot >= 0; --slot) {
+        free_slots.push_back(slot);
+    }
+}
+
+int ChunkSlots::acquire(int tile) {
+    int &slot(tile_slots.at(size_t(tile)));
+
+    if (slot == -1 && !free_slots.empty()) {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    }
+
+    return slot;
+}
+
+int ChunkSlots::release(int tile) {
+    int &slot(tile_slots.at(size_t(tile)));
+    int freed(slot);
+
+    if (slot != -1) {
+        free_slots.push_back(slot);
+        slot = -1;
+    }
+
+    return freed;
+}
+
+int ChunkSlots::capacity_for(int num_used, int num_tiles) {
+    // Empty chunks are skipped when rendering, so keep them empty
+    if (num_used == 0) {
+        return 0;
+    }
+
+    // Grow by half again, so that filling a chunk tile by tile only
+    // rebuilds it a logarithmic number of times
+    return std::min(num_tiles, num_used + std::max(4, num_used / 2));
+}
@@ -0,0 +1,86 @@
+#ifndef CHUNK_SLOTS_H
+#define CHUNK_SLOTS_H
+
+#include <vector>
+
+
+///
+/// Bookkeeping for the quads of a sparse layer chunk.
+///
+/// A sparse chunk's buffers hold a fixed number of quad slots, more
+/// than the tiles it currently has. Each tile in the chunk owns at most
+/// one slot, and unused slots are kept in a free list and drawn as
+/// degenerate quads. Adding or clearing a tile is then a constant-time
+/// change of one slot rather than a rebuild of the chunk's buffers.
+///
+class ChunkSlots {
+    ///
+    /// For each tile in the chunk, the slot holding its quad, or -1
+    ///
+    std::vector<int> tile_slots;
+
+    ///
+    /// The slots which are not holding any tile's quad
+    ///
+    std::vector<int> free_slots;
+
+    ///
+    /// The number of slots in the chunk's buffers
+    ///
+    int capacity;
+
+public:
+    ///
+    /// Construct the slots for a chunk with no tiles and no capacity
+    /// @param num_tiles the number of tiles in the chunk
+    ///
+    ChunkSlots(int num_tiles = 0);
+
+    ///
+    /// Clear all tiles and set a new number of slots, all free
+    /// @param new_capacity the number of slots in the chunk's buffers
+    ///
+    void reset(int new_capacity);
+
+    ///
+    /// Get the number of slots in the chunk's buffers
+    ///
+    int get_capacity() const { return capacity; }
+
+    ///
+    /// Get the number of slots holding a tile's quad
+    ///
+    int get_num_used() const { return capacity - int(free_slots.size()); }
+
+    ///
+    /// Get the slot holding a tile's quad
+    /// @param tile the tile's index within the chunk
+    /// @return the slot, or -1 if the tile has no quad
+    ///
+    int get_slot(int tile) const { return tile_slots.at(size_t(tile)); }
+
+    ///
+    /// Give a tile a slot, if it doesn't already have one
+    /// @param tile the tile's index within the chunk
+    /// @return the tile's slot, or -1 if there are no free slots left
+    ///
+    int acquire(int tile);
+
+    ///
+    /// Free the slot held by a tile
+    /// @param tile the tile's index within the chunk
+    /// @return the freed slot, or -1 if the tile had no slot
+    ///
+    int release(int tile);
+
+    ///
+    /// Get the capacity to give a chunk holding a number of tiles, with
+    /// enough slack that it only rarely has to be rebuilt to grow
+    /// @param num_used the number of tiles which need slots
+    /// @param num_tiles the number of tiles in the chunk
+    /// @return the number of slots to allocate
+    ///
+    static int capacity_for(int num_used, int num_tiles);
+};
+
+#endif
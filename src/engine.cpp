@@ -9,6 +9,7 @@
 #include <stdexcept>
 #include <thread>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include "dispatcher.hpp"
@@ -21,9 +22,11 @@
 #include "map_viewer.hpp"
 #include "notification_bar.hpp"
 #include "object_manager.hpp"
+#include "snapshot_buffer.hpp"
 #include "gil_safe_future.hpp"
 #include "sprite.hpp"
 #include "text.hpp"
+#include "world_snapshot.hpp"
 
 
 ///Static variables
@@ -33,6 +36,14 @@ GameWindow* Engine::game_window(nullptr);
 Challenge* Engine::challenge(nullptr);
 int Engine::tile_size(64);
 float Engine::global_scale(1.0f);
+bool Engine::gpu_tilemap(false);
+bool Engine::chunk_cache(true);
+// The Raspberry Pi's GPU has little memory to spare
+#ifdef USE_GLES
+bool Engine::reduced_texture_precision(true);
+#else
+bool Engine::reduced_texture_precision(false);
+#endif
 
 
 
@@ -152,24 +163,10 @@ void Engine::move_object(int id, glm::ivec2 move_by, GilSafeFuture<bool> walk_su
 }
 
 bool Engine::walkable(glm::ivec2 location) {
-    int map_width = map_viewer->get_map()->get_width();
-    int map_height = map_viewer->get_map()->get_height();
-
-    // Check bounds
-    if(!(0 <= location.x && location.x < map_width) || !(0 <= location.y && location.y < map_height)) {
-        VLOG(2) << "Cannot move to requested tile due to map bounds";
-        return false;
-    }
-
-    // Check against collidable layer
-    if(!Engine::map_viewer->get_map()->is_walkable(location.x, location.y)) {
-        VLOG(2) << "Cannot move to requested tile due to collidable objects";
-        return false;
-    }
-
-    //check for tile blockers
-    if (get_map_viewer()->get_map()->blocker.at(location.x).at(location.y) != 0) {
-        VLOG(2) << "Cannot move to requested tile due to tile blocker";
+    // Map bounds, the collidable layer and tile blockers are all
+    // folded into the map's walkability grid
+    if (!map_viewer->get_map()->is_walkable(location.x, location.y)) {
+        VLOG(2) << "Cannot move to requested tile due to map bounds, collidable objects or a tile blocker";
         return false;
     }
 
@@ -180,33 +177,74 @@ void Engine::change_tile(glm::ivec2 tile, std::string layer_name, std::string ti
     map_viewer->get_map()->update_tile(tile.x, tile.y, layer_name, tile_name);
 }
 
+void Engine::change_tiles(std::string layer_name, const std::vector<std::pair<glm::ivec2, std::string>> &tiles) {
+    map_viewer->get_map()->update_tiles(layer_name, tiles);
+}
+
 
 glm::vec2 Engine::find_object(int id) {
     Map *map = CHECK_NOTNULL(CHECK_NOTNULL(map_viewer)->get_map());
 
-    //Check the object is on the map
-    auto map_objects = map->get_map_objects();
-    auto sprites = map->get_sprites();
-    for(auto object_id : map_objects) {
-        if(object_id == id) {
-            //Object is on the map so now get its location
-            auto object = ObjectManager::get_instance().get_object<MapObject>(id);
-            return object->get_position();
-        }
+    //Check the object is on the map, and if so get its location
+    if (map->get_map_object_index().contains(id)) {
+        return map->get_map_object_index().get_position(id);
     }
 
-    for(auto object_id : sprites) {
-        if(object_id == id) {
-            //Object is on the map so now get its location
-            auto object = ObjectManager::get_instance().get_object<Sprite>(id);
-            return object->get_position();
-        }
+    if (map->get_sprite_index().contains(id)) {
+        return map->get_sprite_index().get_position(id);
     }
 
     //Not on the map
     throw std::runtime_error("Object is not in the map");
 }
 
+void Engine::publish_snapshot() {
+    SnapshotBuffer::get_instance().publish([] (WorldSnapshot &snapshot) {
+        Map *map(map_viewer ? map_viewer->get_map() : nullptr);
+        if (!map) {
+            snapshot.clear();
+            return;
+        }
+
+        snapshot.set_map(map->get_walkability_grid());
+        ObjectManager &object_manager(ObjectManager::get_instance());
+
+        for (int id : map->get_map_objects()) {
+            auto object(object_manager.get_object<MapObject>(id));
+            if (!object || !map->get_map_object_index().contains(id)) {
+                continue;
+            }
+
+            WorldSnapshot::Object &object_snapshot(snapshot.add_object(id));
+            object_snapshot.name     = object->get_name();
+            object_snapshot.position = object->get_position();
+            object_snapshot.sprite   = false;
+            object_snapshot.findable = object->is_findable();
+            object_snapshot.instructions.clear();
+            object_snapshot.positions.clear();
+        }
+
+        for (int id : map->get_sprites()) {
+            auto sprite(object_manager.get_object<Sprite>(id));
+            if (!sprite || !map->get_sprite_index().contains(id)) {
+                continue;
+            }
+
+            WorldSnapshot::Object &sprite_snapshot(snapshot.add_object(id));
+            sprite_snapshot.name         = sprite->get_name();
+            sprite_snapshot.position     = sprite->get_position();
+            sprite_snapshot.sprite       = true;
+            sprite_snapshot.findable     = true;
+            sprite_snapshot.instructions = sprite->get_instructions();
+
+            auto &positions(sprite->get_positions().get<insertion_order>());
+            sprite_snapshot.positions.assign(std::begin(positions), std::end(positions));
+        }
+
+        snapshot.finish();
+    });
+}
+
 void Engine::open_editor(std::string filename) {
     LOG(INFO) << "Opening editor";
 
@@ -217,26 +255,13 @@ void Engine::open_editor(std::string filename) {
     std::thread([command] () { system(command.c_str()); }).detach();
 }
 
-static std::vector<int> location_filter_objects(glm::vec2 location, std::vector<int> objects) {
-    auto &object_manager(ObjectManager::get_instance());
-
-    std::vector<int> results;
-    std::copy_if(std::begin(objects), std::end(objects), std::back_inserter(results),
-        [&] (int object_id) {
-            auto object(object_manager.get_object<MapObject>(object_id));
-            return object && object->get_position() == location;
-        }
-    );
-    return results;
-}
-
 std::vector<int> Engine::get_objects_at(glm::vec2 location) {
-    return location_filter_objects(location, map_viewer->get_map()->get_map_objects());
+    return map_viewer->get_map()->get_map_object_index().query_point(location);
 }
 
 // TODO: Also return MapObjects
 std::vector<int> Engine::get_sprites_at(glm::vec2 location) {
-    return location_filter_objects(location, map_viewer->get_map()->get_sprites());
+    return map_viewer->get_map()->get_sprite_index().query_point(location);
 }
 // TODO: Consider whether finding the object and checking its position is saner
 bool Engine::is_object_at(glm::ivec2 location, int object_id) {
@@ -278,53 +303,34 @@ std::vector<std::tuple<std::string, int, int>> Engine::look(int id, int search_r
     std::vector<std::tuple<std::string, int, int>> objects;
 
     Map *map = CHECK_NOTNULL(CHECK_NOTNULL(map_viewer)->get_map());
-    //Check the object is on the map
-    auto map_objects = map->get_map_objects();
-    auto sprites = map->get_sprites();
-    for(auto object_id : map_objects) {
-        if(object_id != 0) {
-            //Object is on the map so now get its location
-            auto object = ObjectManager::get_instance().get_object<MapObject>(object_id);
-            if(!object)
-                continue;
+    std::shared_ptr<Sprite> sprite = ObjectManager::get_instance().get_object<Sprite>(id);
+    glm::vec2 centre(sprite->get_position());
 
-            if(!object->is_findable())
-                continue;
-            std::string name = object->get_name();
-            //TODO, maybe we should give python the floats - what if the object is moving?
-            //in this case, the position is truncated
-            glm::ivec2 object_pos = object->get_position();
-
-            //Check if in range
-            std::shared_ptr<Sprite> sprite = ObjectManager::get_instance().get_object<Sprite>(id);
-            std::cout << object->get_name() << std::endl;
-            //Circle bounds
-            if(glm::length(sprite->get_position() - object->get_position()) > (double)search_range)
-                continue;
+    //Circle bounds
+    auto map_objects(map->get_map_object_index().query_radius(centre, float(search_range)));
+    auto sprites(map->get_sprite_index().query_radius(centre, float(search_range)));
+
+    for(auto object_id : map_objects) {
+        auto object = ObjectManager::get_instance().get_object<MapObject>(object_id);
+        if(!object)
+            continue;
 
+        if(!object->is_findable())
+            continue;
 
-            objects.push_back(std::make_tuple(name, object_pos.x, object_pos.y));
-        }
+        //TODO, maybe we should give python the floats - what if the object is moving?
+        //in this case, the position is truncated
+        glm::ivec2 object_pos = object->get_position();
+        objects.push_back(std::make_tuple(object->get_name(), object_pos.x, object_pos.y));
     }
 
     for(auto object_id : sprites) {
-        if(object_id != 0) {
-            //Object is on the map so now get its location
-            auto object = ObjectManager::get_instance().get_object<MapObject>(object_id);
-            std::string name = object->get_name();
-            //TODO, maybe we should give python the floats - what if the object is moving?
-            //in this case, the position is truncated
-            glm::ivec2 object_pos = object->get_position();
-                        std::cout << object->get_name() << std::endl;
-            //Check if in range
-            std::shared_ptr<Sprite> sprite = ObjectManager::get_instance().get_object<Sprite>(id);
-
-            //Circle bounds
-            if(glm::length(sprite->get_position() - object->get_position()) > (double)search_range)
-                continue;
+        auto object = ObjectManager::get_instance().get_object<MapObject>(object_id);
+        if(!object)
+            continue;
 
-            objects.push_back(std::make_tuple(name, object_pos.x, object_pos.y));
-        }
+        glm::ivec2 object_pos = object->get_position();
+        objects.push_back(std::make_tuple(object->get_name(), object_pos.x, object_pos.y));
     }
     return objects;
 }
@@ -343,18 +349,17 @@ bool Engine::cut(int id, glm::ivec2 location) {
        location.y < 0 || location.y >= map->get_height()) {
         return false;
     }
-    auto map_objects = map->get_map_objects();
+    // Objects part way between tiles are truncated onto the tile they
+    // are leaving, so look in the square up to the next tile
+    auto &map_object_index(map->get_map_object_index());
+    auto map_objects(map_object_index.query_rect(glm::vec2(location), glm::vec2(location + 1)));
     for(auto object_id : map_objects) {
-        if(object_id != 0) {
-            //Object is on the map so now get its location
-            auto object = ObjectManager::get_instance().get_object<MapObject>(object_id);
-            glm::ivec2 object_pos = object->get_position();
-            if(object_pos == location) {
-                // Remove the object
-                map->remove_map_object(object_id);
-                ObjectManager::get_instance().remove_object(object_id);
-                return true;
-            }
+        glm::ivec2 object_pos(map_object_index.get_position(object_id));
+        if(object_pos == location) {
+            // Remove the object
+            map->remove_map_object(object_id);
+            ObjectManager::get_instance().remove_object(object_id);
+            return true;
         }
     }
 
@@ -7,9 +7,11 @@
 
 #include <glm/vec2.hpp>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "challenge.hpp"
+#include "frame_damage.hpp"
 #include "game_window.hpp"
 #include "gil_safe_future.hpp"
 #include "text_font.hpp"
@@ -49,6 +51,24 @@ private:
     ///
     static float global_scale;
 
+    ///
+    /// Whether map layers are drawn from tile index textures by the
+    /// tilemap shader, rather than from per-tile geometry
+    ///
+    static bool gpu_tilemap;
+
+    ///
+    /// Whether the map's layers are drawn from textures of each chunk
+    /// with its layers composited, rather than layer by layer
+    ///
+    static bool chunk_cache;
+
+    ///
+    /// Whether textures can be uploaded in 16 bit formats, losing
+    /// precision, to save GPU memory
+    ///
+    static bool reduced_texture_precision;
+
 public:
     ///
     /// Get the global scale
@@ -60,7 +80,54 @@ public:
     /// Set the global scaling factor
     /// @param _global_scale the scaling factor
     ///
-    static void set_global_scale(float global_scale) { Engine::global_scale = global_scale; }
+    static void set_global_scale(float global_scale) {
+        Engine::global_scale = global_scale;
+        FrameDamage::mark_dirty();
+    }
+
+    ///
+    /// Get whether map layers are drawn by the tilemap shader
+    ///
+    static bool get_gpu_tilemap() { return gpu_tilemap; }
+
+    ///
+    /// Set whether map layers are drawn by the tilemap shader. The map
+    /// switches over the next time it is drawn.
+    /// @param gpu_tilemap true to draw from tile index textures
+    ///
+    static void set_gpu_tilemap(bool gpu_tilemap) {
+        Engine::gpu_tilemap = gpu_tilemap;
+        FrameDamage::mark_dirty();
+    }
+
+    ///
+    /// Get whether the map's layers are drawn from composited chunks
+    ///
+    static bool get_chunk_cache() { return chunk_cache; }
+
+    ///
+    /// Set whether the map's layers are drawn from composited chunks.
+    /// This has no effect while the tilemap shader is drawing them.
+    /// @param chunk_cache true to composite the layers of each chunk
+    ///
+    static void set_chunk_cache(bool chunk_cache) {
+        Engine::chunk_cache = chunk_cache;
+        FrameDamage::mark_dirty();
+    }
+
+    ///
+    /// Get whether textures can be uploaded in 16 bit formats
+    ///
+    static bool get_reduced_texture_precision() { return reduced_texture_precision; }
+
+    ///
+    /// Set whether textures can be uploaded in 16 bit formats. This
+    /// affects textures uploaded afterwards.
+    /// @param reduced_texture_precision true to allow 16 bit formats
+    ///
+    static void set_reduced_texture_precision(bool reduced_texture_precision) {
+        Engine::reduced_texture_precision = reduced_texture_precision;
+    }
 
     ///
     /// Set the tile size to be used by the engine
@@ -144,6 +211,14 @@ public:
     ///
     static void change_tile(glm::ivec2 tile, std::string layer_name, std::string tile_name);
 
+    ///
+    /// Change many tiles in the given layer of the map at once
+    /// @param layer_name the layer of the tiles to change
+    /// @param tiles the x,y position of each tile and the global name
+    ///        of its new tile
+    ///
+    static void change_tiles(std::string layer_name, const std::vector<std::pair<glm::ivec2, std::string>> &tiles);
+
     ///
     /// Get the location of the map object or sprite in the map, throws exception if
     /// there is the object is not on the map
@@ -152,6 +227,13 @@ public:
     ///
     static glm::vec2 find_object(int id);
 
+    ///
+    /// Publish a snapshot of the map to SnapshotBuffer, for threads to
+    /// query without waiting for the main thread. Called after each
+    /// batch of events, on the main thread.
+    ///
+    static void publish_snapshot();
+
     ///
     /// Open a text editor for the user to edit a file
     /// @param filename name of file in scripts directory
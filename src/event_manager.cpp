@@ -1,26 +1,28 @@
-#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <glog/logging.h>
-#include <list>
 #include <mutex>
 #include <ostream>
 #include <ratio>
+#include <utility>
 
 #include "event_manager.hpp"
+#include "event_queue.hpp"
+#include "event_task.hpp"
 #include "game_time.hpp"
+#include "timer_scheduler.hpp"
 
 
-EventManager::EventManager(): enabled(true) {
-    // Allocate on the heap so that we can swap the curr_frame and next_frame
-    curr_frame_queue = new std::list<std::function<void ()>>();
-    next_frame_queue = new std::list<std::function<void ()>>();
+EventManager::EventManager():
+    new_events(false),
+    waiting(false),
+    enabled(true),
+    last_timer_handle(0) {
 }
 
 EventManager::~EventManager() {
-    // Free these
-    delete curr_frame_queue;
-    delete next_frame_queue;
 }
 
 EventManager &EventManager::get_instance() {
@@ -32,125 +34,167 @@ EventManager &EventManager::get_instance() {
 
 void EventManager::flush_and_disable() {
     //
-    // This will clear both lists out. Now, if another thread tries
-    // to add something but blocks before getting a lock (but is stil
-    // in an add_event function), then, once this method completes,
-    // that event would still be added to the queue.
+    // This will clear both queues out. Now, if another thread tries
+    // to add something but is preempted after checking enabled (but
+    // is stil in an add_event function), then, once this method
+    // completes, that event would still be added to the queue.
     //
     // The intention of this function is to be used once all the
     // threads that are putting data onto the event queues are finished.
     // Essentially, it is run after maps are unloaded and we are
     // preparing for a new map.
     //
-
-    // The lock_guard is exception safe and releases the mutex when
-    // it goes out of scope. So we introduce scope here to release
-    // the mutex
-    {
-        //Lock the lists
-        std::lock_guard<std::mutex> lock(queue_mutex);
-
-        enabled = false;
-
-        //Clear both lists
-        curr_frame_queue->clear();
-        next_frame_queue->clear();
-
-    }
-    // Lock released
+    enabled = false;
+
+    // Dropping events can run destructors which add events, but
+    // they're ignored now
+    running.clear();
+    carried.clear();
+    timers.clear();
+    curr_frame_queue.take_all().clear();
+    next_frame_queue.take_all().clear();
+    new_events = false;
 }
 
-void EventManager::process_events() {
+int EventManager::process_events() {
     // We need to process all the events in the queue
     // Problem is that, when events are being processed, they can add
-    // further events. If we have the lock on the lock_guard in the
-    // process loop when this happens, then we cannot add the new event
-    // and so the thread blocks and the lock is never released
+    // further events, which should also run this frame.
     //
-    // So, we need to extract an event from the queue, lock the queue
-    // to do this. We then release the lock and process the event.
-    // We then repeat the process until the entire queue is finished
+    // So, we take everything added so far as a batch and run it, with
+    // nothing locked, and repeat until a batch comes back empty. Events
+    // carried over from the last frame go first, as they were added
+    // before anything in this frame's queue.
     //
+    // Timed events go first, as they did when they queued themselves
+    // for every frame
+    int num_events(timers.tick(time.time()));
+
+    if (running.empty()) {
+        running = std::move(carried);
+    }
+
     while (true) {
-        //The callback function we need to process
-        std::function<void ()> func;
-
-        //The lock_guard is exception safe and releases the mutex when
-        //it goes out of scope. So we introduce scope here to release
-        //the mutex once we've pulled the event from it.
-        {
-            //Lock the list
-            std::lock_guard<std::mutex> lock(queue_mutex);
-
-            //If the queue is empty, exit this processing
-            if(curr_frame_queue->empty()) {
-                //This is safe as we have the lock
-                std::swap(curr_frame_queue, next_frame_queue);
-                break;
+        while (!running.empty()) {
+            //The callback function we need to process
+            EventTask func(running.pop());
+
+            //Dispatch the callback
+            if (func) {
+                func();
+                ++num_events;
             }
+            else {
+                LOG(ERROR) << "ERROR in event_manager.cpp in processing, no function";
+            }
+        }
 
-            //Get the first element in the list
-            //We've locked the queue so it will definitely have an item
-            func = curr_frame_queue->front();
-            curr_frame_queue->pop_front();
-        } // Lock released
+        // Cleared before looking, so an event added after the batch is
+        // taken sets it again
+        new_events = false;
 
-        //Dispatch the callback
-        if(func) {
-            func();
-        }
-        else {
-            LOG(ERROR) << "ERROR in event_manager.cpp in processing, no function";
+        running = curr_frame_queue.take_all();
+        if (running.empty()) {
+            break;
         }
     }
+
+    // The next frame becomes the current frame
+    carried = next_frame_queue.take_all();
+
+    return num_events;
+}
+
+bool EventManager::wait_for_event(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(wait_mutex);
+
+    // Either add_event sees this and notifies under the lock, or
+    // the wait sees new_events and doesn't sleep
+    waiting = true;
+    bool woken(event_added.wait_until(lock, deadline, [this] () { return bool(new_events); }));
+    waiting = false;
+
+    return woken;
+}
+
+bool EventManager::is_idle() {
+    return running.empty() && carried.empty()
+        && curr_frame_queue.empty() && next_frame_queue.empty()
+        && !timers.has_tweens();
 }
-void EventManager::add_event(std::function<void ()> func) {
-    // Manages locking in an exception-safe manner
-    // Lock released when this lock_guard goes out of scope
-    std::lock_guard<std::mutex> lock(queue_mutex);
 
+void EventManager::add_event(EventTask func) {
     if (!enabled) { return; }
 
     //Add it to the queue
-    curr_frame_queue->push_back(func);
-}
+    curr_frame_queue.push(std::move(func));
 
-void EventManager::add_event_next_frame(std::function<void ()> func) {
-    // Manages locking in an exception-safe manner
-    // Lock released when this lock_guard goes out of scope
-    std::lock_guard<std::mutex> lock(queue_mutex);
+    //Wake the main thread if it is waiting for something to do. Only the
+    //first event since the queue was emptied needs to.
+    if (!new_events.exchange(true) && waiting) {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        event_added.notify_one();
+    }
+}
 
+void EventManager::add_event_next_frame(EventTask func) {
     if (!enabled) { return; }
 
     //Add it to the queue
-    next_frame_queue->push_back(func);
+    next_frame_queue.push(std::move(func));
 }
 
 void EventManager::reenable() { enabled = true; }
 
-void EventManager::add_timed_event(GameTime::duration duration, std::function<bool (float)> func) {
+TimerScheduler::Handle EventManager::add_timed_event(GameTime::duration duration, std::function<bool (float)> func) {
+    TimerScheduler::Handle handle(++last_timer_handle);
+
     // This needs to be thread-safe, so wrap it in an event.
-    // Also, this holds the initialisation, so as to keep it static
-    // between all of the events.
-    add_event([this, duration, func] () {
-        auto start_time = time.time();
+    // Also, this holds the initialisation, so that the start time is
+    // taken on the main thread.
+    add_event([this, handle, duration, func] () mutable {
+        timers.add_tween(handle, time.time(), duration, std::move(func));
+    });
 
-        // Convert a timed callback to a void lambda by creating a wrapper
-        // that keeps track of the completion and deals with re-registering.
-        static std::function<void (GameTime::duration,          std::function<bool (float)>,      GameTime::time_point)> callback =
-               [&]                (GameTime::duration duration, std::function<bool (float)> func, GameTime::time_point start_time) {
+    return handle;
+}
 
-            auto completion = time.time() - start_time;
+TimerScheduler::Handle EventManager::add_timer(GameTime::duration duration, EventTask func) {
+    TimerScheduler::Handle handle(++last_timer_handle);
 
-            // Don't allow finite polling speed to allow > 100% completion.
-            float fraction_complete(float(std::min(completion / duration, 1.0)));
+    // Tasks can't be copied, so bind moves it in for the lambda
+    add_event(std::bind([this, handle, duration] (EventTask &func) {
+        timers.add_timer(handle, time.time() + duration, std::move(func));
+    }, std::move(func)));
 
-            if (func(fraction_complete) && fraction_complete < 1.0) {
-                // Repeat if the callback wishes and the event isn't complete.
-                add_event_next_frame(std::bind(callback, duration, func, start_time));
-            }
-        };
+    return handle;
+}
 
-        add_event(std::bind(callback, duration, func, start_time));
-    });
+void EventManager::cancel_timer(TimerScheduler::Handle handle) {
+    add_event([this, handle] () { timers.cancel(handle); });
+}
+
+std::chrono::steady_clock::time_point EventManager::get_next_timer_wake() {
+    if (!timers.has_timers()) {
+        return std::chrono::steady_clock::time_point::max();
+    }
+
+    auto now(std::chrono::steady_clock::now());
+    double game_seconds_per_real_second(time.get_game_seconds_per_real_second());
+    double game_seconds(std::chrono::duration<double>(timers.get_next_due() - time.time()).count());
+
+    if (game_seconds <= 0.0) {
+        return now;
+    }
+
+    // Time may be stopped or crawling; checking again in a minute is
+    // soon enough, and doesn't overflow
+    double real_seconds(60.0);
+    if (game_seconds < real_seconds * game_seconds_per_real_second) {
+        real_seconds = game_seconds / game_seconds_per_real_second;
+    }
+
+    return now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(real_seconds)
+    );
 }
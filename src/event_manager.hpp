@@ -1,51 +1,97 @@
 #ifndef EVENT_MANAGER_H
 #define EVENT_MANAGER_H
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
-#include <list>
 #include <mutex>
 
+#include "event_queue.hpp"
+#include "event_task.hpp"
 #include "game_time.hpp"
+#include "timer_scheduler.hpp"
 
 ///
 /// The event manager class. This is a thread-safe
 /// implementation.which uses the singleton pattern.
 ///
+/// Any thread can add events, without locking. Only the main thread
+/// may process, wait for, check or flush them.
+///
 class EventManager {
 
     EventManager();
     ~EventManager();
 
     ///
-    /// The mutex to control access to the queues
+    /// Held only while waiting for events, so a wake-up can't be lost
+    /// between checking for events and going to sleep
     ///
-    std::mutex queue_mutex;
+    std::mutex wait_mutex;
 
     ///
-    ///The queue for lambdas to be dealt with in this frame
-    /// We use a list as the iterator remains valid if we add and
-    /// remove items from this list
+    /// Signalled when an event is added to the current frame's queue,
+    /// so that the main thread can sleep until there is work to do.
+    ///
+    std::condition_variable event_added;
+
     ///
-    /// We use pointers for the queue so that we can perform a swap at
-    /// the end of processing the curr frame queue in the current
-    /// frame.
-    /// That is, we swap the curr_frame_queue and next_frame_queue
-    /// pointers so that the next frame becomes the curr frame. Like
-    /// double-buffering in graphics.
+    /// Whether events have been added with add_event since the current
+    /// frame's queue was last emptied. Events carried over from the last
+    /// frame don't count, so waiting doesn't wake up for them.
     ///
-    std::list<std::function<void ()>>* curr_frame_queue;
+    std::atomic<bool> new_events;
 
     ///
-    ///The queue for lambdas to be dealt with in the next frame. Read
-    ///curr_frame_queue's comment.
+    /// Whether the main thread is waiting in wait_for_event. Adding an
+    /// event only takes wait_mutex to notify when it is.
     ///
-    std::list<std::function<void()>>* next_frame_queue;
+    std::atomic<bool> waiting;
+
+    ///
+    /// The queue for lambdas to be dealt with in this frame. Any thread
+    /// can add to it without locking; process_events takes everything in
+    /// it in batches until it is empty, so events added while processing
+    /// are also run in this frame.
+    ///
+    EventQueue curr_frame_queue;
+
+    ///
+    /// The queue for lambdas to be dealt with in the next frame. At the
+    /// end of processing, it is emptied into carried, like swapping
+    /// buffers in graphics.
+    ///
+    EventQueue next_frame_queue;
+
+    ///
+    /// Events from next_frame_queue, to run first when process_events is
+    /// next called
+    ///
+    EventQueue::Batch carried;
+
+    ///
+    /// The batch process_events is running, kept here so that
+    /// flush_and_disable can drop what is left of it
+    ///
+    EventQueue::Batch running;
 
     ///
     /// Whether events added to the queue are listened to.
     /// When false, they are silently ignored.
     ///
-    bool enabled;
+    std::atomic<bool> enabled;
+
+    ///
+    /// The tweens and timers, ticked at the start of processing. Only
+    /// changed by events, so any thread can add or cancel them.
+    ///
+    TimerScheduler timers;
+
+    ///
+    /// The last handle given out for a tween or timer
+    ///
+    std::atomic<TimerScheduler::Handle> last_timer_handle;
 
 public:
     ///
@@ -90,11 +136,12 @@ public:
     ///
     /// @param func
     ///     A callback with no arguments and no return, to be
-    ///     run on the current or upcomming frame.
+    ///     run on the current or upcomming frame. Small callbacks are
+    ///     queued without allocating.
     ///
     /// @see add_event_next_frame
     ///
-    void add_event(std::function<void ()> func);
+    void add_event(EventTask func);
 
     ///
     /// Add an event to the event manager to be called after this event
@@ -113,7 +160,7 @@ public:
     ///
     /// @see add_event
     ///
-    void add_event_next_frame(std::function<void ()> func);
+    void add_event_next_frame(EventTask func);
 
     ///
     /// Add an event with a time duration to run for. e.g. a timer
@@ -127,12 +174,76 @@ public:
     /// completion. 0.0 is 0% and 1.0 is 100%. This is calculated
     /// based on the duration, the current time and the time the event was added to the
     /// queue
-    void add_timed_event(GameTime::duration duration, std::function<bool (float)> func);
+    ///
+    /// The callback is kept in the timer scheduler and called in place
+    /// at the start of each frame's events, in game time, so changing
+    /// the speed of game time speeds it up or slows it down.
+    ///
+    /// @return a handle to cancel it with
+    ///
+    /// @see add_timer
+    ///
+    TimerScheduler::Handle add_timed_event(GameTime::duration duration, std::function<bool (float)> func);
+
+    ///
+    /// Add an event to run once, after some game time has passed. Unlike
+    /// add_timed_event, nothing is called until then, so prefer this when
+    /// only the end matters.
+    ///
+    /// The callback will be silently ignored if the event manager is disabled.
+    ///
+    /// @param duration the game time to wait
+    /// @param func the callback to run
+    /// @return a handle to cancel it with
+    ///
+    TimerScheduler::Handle add_timer(GameTime::duration duration, EventTask func);
+
+    ///
+    /// Cancel a timed event or timer before it is next called. This is
+    /// queued like an event, so it takes effect after anything added
+    /// before it.
+    ///
+    /// @param handle the handle from add_timed_event or add_timer
+    ///
+    void cancel_timer(TimerScheduler::Handle handle);
+
+    ///
+    /// Get when the next timer is due, in real time at the current speed
+    /// of game time, so that the main thread can wake up for it.
+    ///
+    /// @return the time, or the latest time_point if there are no timers
+    ///
+    std::chrono::steady_clock::time_point get_next_timer_wake();
 
     ///
     /// Processes all events in the current frame queue
     ///
-    void process_events();
+    /// @return the number of events run
+    ///
+    int process_events();
+
+    ///
+    /// Wait until an event is added with add_event, or until a time.
+    ///
+    /// Returns at once if events have been added since the last call to
+    /// process_events emptied the queue. Events for the next frame don't
+    /// end the wait, as they aren't due until process_events is next
+    /// called anyway.
+    ///
+    /// @param deadline when to stop waiting
+    /// @return true if there are new events to process
+    ///
+    bool wait_for_event(std::chrono::steady_clock::time_point deadline);
+
+    ///
+    /// Check whether there are no events waiting, for this frame or the
+    /// next, and no timed events running. Animations queue themselves
+    /// for every frame, so nothing is animating when this is true.
+    ///
+    /// Timers added with add_timer don't count, as nothing happens until
+    /// they're due.
+    ///
+    bool is_idle();
 
 };
 
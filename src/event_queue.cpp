@@ -0,0 +1,193 @@
+#include <atomic>
+#include <cstdint>
+#include <glog/logging.h>
+#include <mutex>
+#include <utility>
+
+#include "event_queue.hpp"
+#include "event_task.hpp"
+
+
+const uint32_t EventQueue::segment_bits;
+const uint32_t EventQueue::segment_size;
+const uint32_t EventQueue::max_segments;
+
+
+EventQueue::EventQueue():
+    segment_count(0),
+    pending_head(0),
+    free_head(0) {
+
+    for (auto &segment : segments) {
+        segment.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+EventQueue::~EventQueue() {
+    // Destroy anything never taken
+    take_all().clear();
+
+    for (uint32_t i = 0; i < segment_count.load(); ++i) {
+        delete[] segments[i].load();
+    }
+}
+
+uint32_t EventQueue::allocate() {
+    uint64_t head(free_head.load(std::memory_order_acquire));
+
+    while (true) {
+        uint32_t handle(static_cast<uint32_t>(head));
+        if (handle == 0) {
+            return grow();
+        }
+
+        // If another thread takes this node first, next may be stale,
+        // but the tag will have changed and the swap will fail
+        uint32_t next(node(handle).next.load(std::memory_order_relaxed));
+        uint64_t tag((head >> 32) + 1);
+
+        if (free_head.compare_exchange_weak(head, tag << 32 | next,
+                                            std::memory_order_acquire,
+                                            std::memory_order_acquire)) {
+            return handle;
+        }
+    }
+}
+
+uint32_t EventQueue::grow() {
+    std::lock_guard<std::mutex> lock(grow_mutex);
+
+    uint32_t segment(segment_count.load());
+    CHECK_LT(segment, max_segments) << "Too many events queued at once";
+
+    segments[segment].store(new Node[segment_size], std::memory_order_release);
+    segment_count.store(segment + 1);
+
+    VLOG(2) << "Event queue grown to " << (segment + 1) * segment_size << " nodes";
+
+    // Keep the first node and chain the rest to free
+    uint32_t first(segment * segment_size + 1);
+    for (uint32_t handle = first + 1; handle < first + segment_size - 1; ++handle) {
+        node(handle).next.store(handle + 1, std::memory_order_relaxed);
+    }
+    release(first + 1, first + segment_size - 1);
+
+    return first;
+}
+
+void EventQueue::release(uint32_t first, uint32_t last) {
+    uint64_t head(free_head.load(std::memory_order_relaxed));
+    Node &last_node(node(last));
+
+    while (true) {
+        last_node.next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        uint64_t tag((head >> 32) + 1);
+
+        if (free_head.compare_exchange_weak(head, tag << 32 | first,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+void EventQueue::push(EventTask task) {
+    uint32_t handle(allocate());
+    Node &pushed(node(handle));
+    pushed.task = std::move(task);
+
+    uint32_t head(pending_head.load(std::memory_order_relaxed));
+    do {
+        pushed.next.store(head, std::memory_order_relaxed);
+    } while (!pending_head.compare_exchange_weak(head, handle,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed));
+}
+
+EventQueue::Batch EventQueue::take_all() {
+    uint32_t handle(pending_head.exchange(0, std::memory_order_acquire));
+    if (handle == 0) {
+        return Batch();
+    }
+
+    // The stack has the newest first, so reverse it
+    uint32_t last(handle);
+    uint32_t reversed(0);
+    while (handle != 0) {
+        Node &taken(node(handle));
+        uint32_t next(taken.next.load(std::memory_order_relaxed));
+        taken.next.store(reversed, std::memory_order_relaxed);
+        reversed = handle;
+        handle = next;
+    }
+
+    return Batch(this, reversed, last);
+}
+
+bool EventQueue::empty() const {
+    return pending_head.load(std::memory_order_acquire) == 0;
+}
+
+uint32_t EventQueue::get_capacity() const {
+    return segment_count.load() * segment_size;
+}
+
+
+EventQueue::Batch::Batch():
+    queue(nullptr), first(0), front(0), last(0) {
+}
+
+EventQueue::Batch::Batch(EventQueue *queue, uint32_t first, uint32_t last):
+    queue(queue), first(first), front(first), last(last) {
+}
+
+EventQueue::Batch::Batch(Batch &&other):
+    queue(other.queue), first(other.first), front(other.front), last(other.last) {
+
+    other.first = other.front = other.last = 0;
+}
+
+EventQueue::Batch &EventQueue::Batch::operator=(Batch &&other) {
+    if (this != &other) {
+        clear();
+
+        queue = other.queue;
+        first = other.first;
+        front = other.front;
+        last  = other.last;
+        other.first = other.front = other.last = 0;
+    }
+
+    return *this;
+}
+
+EventQueue::Batch::~Batch() {
+    clear();
+}
+
+EventTask EventQueue::Batch::pop() {
+    Node &popped(queue->node(front));
+    EventTask task(std::move(popped.task));
+
+    if (front == last) {
+        queue->release(first, last);
+        first = front = last = 0;
+    }
+    else {
+        front = popped.next.load(std::memory_order_relaxed);
+    }
+
+    return task;
+}
+
+void EventQueue::Batch::clear() {
+    if (first == 0) { return; }
+
+    // Nodes before front have already been popped
+    for (uint32_t handle = front; handle != 0; handle = queue->node(handle).next.load(std::memory_order_relaxed)) {
+        queue->node(handle).task.reset();
+    }
+
+    queue->release(first, last);
+    first = front = last = 0;
+}
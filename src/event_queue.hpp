@@ -0,0 +1,175 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "event_task.hpp"
+
+///
+/// A lock-free queue of tasks, which any number of threads can push
+/// to and one thread takes from.
+///
+/// Pushing is a compare-and-swap onto a stack of pending nodes. The
+/// consumer takes the whole stack with one exchange and reverses it, so
+/// tasks come out in batches, in the order they were pushed.
+///
+/// Nodes are kept in a pool and reused, so once the pool has grown to
+/// the most tasks ever pending, pushing doesn't allocate. The free list
+/// is a stack whose head carries a tag, changed on every update, so a
+/// node taken and returned while another thread looks at it can't be
+/// mistaken for the old head.
+///
+class EventQueue {
+private:
+    struct Node {
+        EventTask task;
+
+        ///
+        /// The handle of the next node on the pending or free stack, or
+        /// in a batch, or 0 for none
+        ///
+        std::atomic<uint32_t> next;
+
+        Node(): next(0) {}
+    };
+
+    ///
+    /// Nodes are allocated in segments of 2^segment_bits, which never
+    /// move, so nodes can be found from a handle without locking.
+    ///
+    static const uint32_t segment_bits = 8;
+    static const uint32_t segment_size = 1 << segment_bits;
+    static const uint32_t max_segments = 4096;
+
+    std::atomic<Node *> segments[max_segments];
+    std::atomic<uint32_t> segment_count;
+
+    ///
+    /// Held while adding a segment, which only happens when the free
+    /// list runs out
+    ///
+    std::mutex grow_mutex;
+
+    ///
+    /// The handle of the most recently pushed node, or 0 when empty
+    ///
+    std::atomic<uint32_t> pending_head;
+
+    ///
+    /// The handle of the first free node in the low 32 bits, and a
+    /// tag in the high 32 bits
+    ///
+    std::atomic<uint64_t> free_head;
+
+    ///
+    /// Get a node from its handle, which is one more than its index
+    /// in the pool.
+    ///
+    Node &node(uint32_t handle) {
+        uint32_t index(handle - 1);
+        return segments[index >> segment_bits].load(std::memory_order_acquire)[index & (segment_size - 1)];
+    }
+
+    ///
+    /// Take a node from the free list, growing the pool if it's empty.
+    /// @return the node's handle
+    ///
+    uint32_t allocate();
+
+    ///
+    /// Add a segment to the pool, putting all but one of its nodes on the
+    /// free list.
+    /// @return the handle of the node kept back
+    ///
+    uint32_t grow();
+
+    ///
+    /// Put a chain of nodes, linked by next, back on the free list.
+    /// @param first the handle of the first node
+    /// @param last the handle of the last node
+    ///
+    void release(uint32_t first, uint32_t last);
+
+public:
+    ///
+    /// Tasks taken from the queue together, in the order they were
+    /// pushed. Only the consumer thread may use a batch, and it must be
+    /// destroyed before its queue.
+    ///
+    class Batch {
+    private:
+        friend class EventQueue;
+
+        EventQueue *queue;
+
+        ///
+        /// The first node in the batch, which all nodes are released
+        /// from once the batch is done
+        ///
+        uint32_t first;
+
+        ///
+        /// The next node to pop
+        ///
+        uint32_t front;
+
+        uint32_t last;
+
+        Batch(EventQueue *queue, uint32_t first, uint32_t last);
+
+    public:
+        Batch();
+        Batch(Batch &&other);
+        Batch &operator=(Batch &&other);
+        ~Batch();
+
+        Batch(const Batch &) = delete;
+        Batch &operator=(const Batch &) = delete;
+
+        bool empty() const { return front == 0; }
+
+        ///
+        /// Take the next task out of the batch. Once the last is taken,
+        /// the batch's nodes go back to the pool.
+        /// @return the task
+        ///
+        EventTask pop();
+
+        ///
+        /// Destroy the tasks left and return the nodes to the pool.
+        ///
+        void clear();
+    };
+
+    EventQueue();
+    ~EventQueue();
+
+    EventQueue(const EventQueue &) = delete;
+    EventQueue &operator=(const EventQueue &) = delete;
+
+    ///
+    /// Add a task to the queue. Safe to call from any thread.
+    ///
+    void push(EventTask task);
+
+    ///
+    /// Take every task pushed so far. Only one thread may take from the
+    /// queue.
+    ///
+    Batch take_all();
+
+    ///
+    /// Whether nothing is waiting to be taken. Other threads may push
+    /// at any time, so this is only a snapshot.
+    ///
+    bool empty() const;
+
+    ///
+    /// Get the number of nodes in the pool, for benchmarking
+    ///
+    uint32_t get_capacity() const;
+};
+
+#endif
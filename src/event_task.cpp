@@ -0,0 +1,61 @@
+#include <cstddef>
+#include <functional>
+
+#include "event_task.hpp"
+
+
+const std::size_t EventTask::inline_size;
+
+
+EventTask::EventTask():
+    operations(nullptr) {
+}
+
+EventTask::EventTask(std::nullptr_t):
+    operations(nullptr) {
+}
+
+EventTask::EventTask(EventTask &&other) noexcept:
+    operations(other.operations) {
+
+    if (operations) {
+        operations->move(other.storage, storage);
+        other.operations = nullptr;
+    }
+}
+
+EventTask &EventTask::operator=(EventTask &&other) noexcept {
+    if (this != &other) {
+        reset();
+
+        operations = other.operations;
+        if (operations) {
+            operations->move(other.storage, storage);
+            other.operations = nullptr;
+        }
+    }
+
+    return *this;
+}
+
+EventTask::~EventTask() {
+    reset();
+}
+
+void EventTask::operator()() {
+    if (!operations) {
+        throw std::bad_function_call();
+    }
+
+    operations->call(storage);
+}
+
+void EventTask::reset() {
+    if (operations) {
+        // Clear first, so a callable whose destructor queues events
+        // doesn't see itself as still stored
+        const Operations *stored(operations);
+        operations = nullptr;
+        stored->destroy(storage);
+    }
+}
@@ -0,0 +1,128 @@
+#ifndef EVENT_TASK_H
+#define EVENT_TASK_H
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+
+///
+/// A callback with no arguments and no return, to be run by the event
+/// manager.
+///
+/// Like std::function<void ()>, but move-only, and callables up to
+/// inline_size bytes are stored inside the task rather than on the
+/// heap. Lambdas capturing a few values, a std::function or a
+/// GilSafeFuture all fit, so queueing them doesn't allocate.
+///
+class EventTask {
+public:
+    ///
+    /// The largest callable stored without allocating
+    ///
+    static const std::size_t inline_size = 64;
+
+private:
+    ///
+    /// How to run, move and destroy the stored callable, one table for
+    /// each type stored
+    ///
+    struct Operations {
+        void (*call)(void *storage);
+        void (*move)(void *from, void *to);
+        void (*destroy)(void *storage);
+        bool is_inline;
+    };
+
+    template <typename F>
+    struct InlineOperations {
+        static void call(void *storage);
+        static void move(void *from, void *to);
+        static void destroy(void *storage);
+        static const Operations operations;
+    };
+
+    template <typename F>
+    struct HeapOperations {
+        static void call(void *storage);
+        static void move(void *from, void *to);
+        static void destroy(void *storage);
+        static const Operations operations;
+    };
+
+    template <typename F>
+    using fits_inline = std::integral_constant<bool,
+        sizeof(F) <= inline_size
+        && alignof(F) <= alignof(std::max_align_t)
+        && std::is_nothrow_move_constructible<F>::value
+    >;
+
+    template <typename F>
+    void store(F &&func, std::true_type);
+
+    template <typename F>
+    void store(F &&func, std::false_type);
+
+    ///
+    /// Whether a callable is empty, so the task should be too
+    ///
+    template <typename F>
+    static bool is_null(const F &) { return false; }
+    template <typename Signature>
+    static bool is_null(const std::function<Signature> &func) { return !func; }
+    template <typename F>
+    static bool is_null(F *func) { return func == nullptr; }
+
+    ///
+    /// The callable, or a pointer to it if it doesn't fit
+    ///
+    alignas(std::max_align_t) unsigned char storage[inline_size];
+
+    ///
+    /// The operations for the stored type, or nullptr when empty
+    ///
+    const Operations *operations;
+
+public:
+    EventTask();
+    EventTask(std::nullptr_t);
+
+    ///
+    /// Store a callable, moving it in if possible.
+    ///
+    template <typename F,
+              typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, EventTask>::value>::type>
+    EventTask(F &&func);
+
+    EventTask(EventTask &&other) noexcept;
+    EventTask &operator=(EventTask &&other) noexcept;
+
+    EventTask(const EventTask &) = delete;
+    EventTask &operator=(const EventTask &) = delete;
+
+    ~EventTask();
+
+    ///
+    /// Run the callable.
+    ///
+    void operator()();
+
+    ///
+    /// Whether there is a callable to run
+    ///
+    explicit operator bool() const { return operations != nullptr; }
+
+    ///
+    /// Whether the callable is stored without a heap allocation. Empty
+    /// tasks count as inline.
+    ///
+    bool is_inline() const { return !operations || operations->is_inline; }
+
+    ///
+    /// Destroy the callable, leaving the task empty.
+    ///
+    void reset();
+};
+
+#include "event_task.hxx"
+
+#endif
@@ -0,0 +1,82 @@
+// File included by event_task.hpp
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+template <typename F>
+void EventTask::InlineOperations<F>::call(void *storage) {
+    (*static_cast<F *>(storage))();
+}
+
+template <typename F>
+void EventTask::InlineOperations<F>::move(void *from, void *to) {
+    new (to) F(std::move(*static_cast<F *>(from)));
+    static_cast<F *>(from)->~F();
+}
+
+template <typename F>
+void EventTask::InlineOperations<F>::destroy(void *storage) {
+    static_cast<F *>(storage)->~F();
+}
+
+template <typename F>
+const EventTask::Operations EventTask::InlineOperations<F>::operations = {
+    &EventTask::InlineOperations<F>::call,
+    &EventTask::InlineOperations<F>::move,
+    &EventTask::InlineOperations<F>::destroy,
+    true
+};
+
+
+template <typename F>
+void EventTask::HeapOperations<F>::call(void *storage) {
+    (**static_cast<F **>(storage))();
+}
+
+template <typename F>
+void EventTask::HeapOperations<F>::move(void *from, void *to) {
+    // Only the pointer moves
+    *static_cast<F **>(to) = *static_cast<F **>(from);
+}
+
+template <typename F>
+void EventTask::HeapOperations<F>::destroy(void *storage) {
+    delete *static_cast<F **>(storage);
+}
+
+template <typename F>
+const EventTask::Operations EventTask::HeapOperations<F>::operations = {
+    &EventTask::HeapOperations<F>::call,
+    &EventTask::HeapOperations<F>::move,
+    &EventTask::HeapOperations<F>::destroy,
+    false
+};
+
+
+template <typename F>
+void EventTask::store(F &&func, std::true_type) {
+    using Stored = typename std::decay<F>::type;
+
+    new (storage) Stored(std::forward<F>(func));
+    operations = &InlineOperations<Stored>::operations;
+}
+
+template <typename F>
+void EventTask::store(F &&func, std::false_type) {
+    using Stored = typename std::decay<F>::type;
+
+    *reinterpret_cast<Stored **>(storage) = new Stored(std::forward<F>(func));
+    operations = &HeapOperations<Stored>::operations;
+}
+
+
+template <typename F, typename>
+EventTask::EventTask(F &&func):
+    operations(nullptr) {
+
+    if (is_null(func)) { return; }
+
+    store(std::forward<F>(func), fits_inline<typename std::decay<F>::type>());
+}
@@ -0,0 +1,10 @@
+#include <atomic>
+
+#include "frame_damage.hpp"
+
+
+
+// The first frame always needs drawing
+std::atomic<bool> FrameDamage::dirty(true);
+
+bool FrameDamage::tracking(true);
@@ -0,0 +1,60 @@
+#ifndef FRAME_DAMAGE_H
+#define FRAME_DAMAGE_H
+
+#include <atomic>
+
+///
+/// Tracks whether anything on screen has changed since the last frame
+/// was drawn, so that frames where nothing has can skip drawing and
+/// swapping buffers, leaving the last frame on screen.
+///
+/// Anything which changes what is drawn marks the frame as dirty: map
+/// objects moving or changing tile, map tiles changing, the camera
+/// moving, the GUI or text changing, the cursor moving and the window
+/// being resized or exposed.
+///
+/// Marking is safe from any thread.
+///
+class FrameDamage {
+private:
+    ///
+    /// Whether something has changed since the last frame was drawn
+    ///
+    static std::atomic<bool> dirty;
+
+    ///
+    /// Whether damage is tracked at all. When false, every frame is
+    /// drawn.
+    ///
+    static bool tracking;
+
+public:
+    ///
+    /// Note that something on screen has changed, so the next frame
+    /// needs drawing.
+    ///
+    static void mark_dirty() { dirty = true; }
+
+    ///
+    /// Check whether something on screen has changed since the last
+    /// frame was drawn.
+    ///
+    static bool is_dirty() { return !tracking || dirty; }
+
+    ///
+    /// Check whether a frame needs drawing, and start tracking changes
+    /// for the next one. Changes marked while the frame is drawn will
+    /// be drawn in the next frame.
+    ///
+    /// @return true if the frame needs drawing
+    ///
+    static bool take() { return dirty.exchange(false) || !tracking; }
+
+    ///
+    /// Set whether damage is tracked, or every frame is drawn.
+    ///
+    static void set_tracking(bool tracking) { FrameDamage::tracking = tracking; }
+    static bool get_tracking() { return tracking; }
+};
+
+#endif
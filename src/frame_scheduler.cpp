@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <functional>
+
+#include <glog/logging.h>
+
+extern "C" {
+#include <time.h>
+}
+
+#include "event_manager.hpp"
+#include "frame_scheduler.hpp"
+
+
+
+FrameScheduler::FrameScheduler(int target_fps):
+    target_fps(target_fps),
+    idle_fps(10),
+    adaptive(true),
+    idle_delay(std::chrono::seconds(1)),
+    frame_start(clock::now()),
+    last_activity(frame_start),
+    frame_start_cpu(get_thread_cpu_time()),
+    frame_cpu_time(0.0),
+    frame_time(0.0),
+    logged_frames(0),
+    logged_cpu_time(0.0),
+    logged_since(frame_start)
+{
+    CHECK_GT(target_fps, 0);
+}
+
+
+double FrameScheduler::get_thread_cpu_time() {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec time;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) == 0) {
+        return double(time.tv_sec) + double(time.tv_nsec) / 1000000000.0;
+    }
+#endif
+    // This counts every thread, so is only a rough guide
+    return double(std::clock()) / double(CLOCKS_PER_SEC);
+}
+
+FrameScheduler::clock::duration FrameScheduler::period(int fps) {
+    return std::chrono::duration_cast<clock::duration>(std::chrono::nanoseconds(1000000000 / fps));
+}
+
+
+void FrameScheduler::set_target_fps(int target_fps) {
+    CHECK_GT(target_fps, 0);
+    this->target_fps = target_fps;
+}
+
+void FrameScheduler::set_idle_fps(int idle_fps) {
+    CHECK_GT(idle_fps, 0);
+    this->idle_fps = idle_fps;
+}
+
+
+bool FrameScheduler::is_idle() const {
+    return adaptive && clock::now() - last_activity >= idle_delay;
+}
+
+
+void FrameScheduler::begin_frame() {
+    frame_start = clock::now();
+    frame_start_cpu = get_thread_cpu_time();
+}
+
+
+void FrameScheduler::run_events() {
+    EventManager &event_manager(EventManager::get_instance());
+
+    if (event_manager.process_events() > 0) {
+        last_activity = clock::now();
+    }
+    if (after_events) {
+        after_events();
+    }
+
+    for (;;) {
+        clock::time_point now(clock::now());
+
+        // Animations queue themselves for the next frame
+        if (!event_manager.is_idle()) {
+            last_activity = now;
+        }
+
+        bool idle(is_idle());
+        clock::time_point deadline(frame_start + period(idle ? idle_fps : target_fps));
+
+        // Timers only run when events are processed, so end idle frames
+        // early for them rather than running them late
+        if (idle) {
+            deadline = std::min(deadline, event_manager.get_next_timer_wake());
+        }
+        if (now >= deadline) {
+            break;
+        }
+
+        // Input isn't signalled, so look for it at the full rate while
+        // sleeping through idle frames
+        clock::time_point wake(deadline);
+        if (idle && input_waiting) {
+            wake = std::min(deadline, now + period(target_fps));
+        }
+
+        if (event_manager.wait_for_event(wake)) {
+            event_manager.process_events();
+            last_activity = clock::now();
+
+            if (after_events) {
+                after_events();
+            }
+        }
+        else if (idle && input_waiting && input_waiting()) {
+            last_activity = clock::now();
+        }
+    }
+}
+
+
+void FrameScheduler::end_frame() {
+    clock::time_point now(clock::now());
+    frame_cpu_time = get_thread_cpu_time() - frame_start_cpu;
+    frame_time = std::chrono::duration<double>(now - frame_start).count();
+
+    ++logged_frames;
+    logged_cpu_time += frame_cpu_time;
+
+    if (now - logged_since >= std::chrono::seconds(5)) {
+        double seconds(std::chrono::duration<double>(now - logged_since).count());
+        VLOG(1) << "Frames: " << double(logged_frames) / seconds << " fps, "
+                << logged_cpu_time / double(logged_frames) * 1000.0 << " ms of CPU per frame"
+                << (is_idle() ? " (idle)" : "");
+
+        logged_frames = 0;
+        logged_cpu_time = 0.0;
+        logged_since = now;
+    }
+}
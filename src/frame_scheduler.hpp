@@ -0,0 +1,163 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <chrono>
+#include <functional>
+
+///
+/// Paces the main loop, running events between frames and sleeping
+/// until there are more, rather than polling for them.
+///
+/// Each frame has a deadline a frame period after it began. Until then,
+/// events are run as EventManager::add_event queues them, and the main
+/// thread sleeps otherwise.
+///
+/// When adaptive, frames drop to a low rate once nothing has happened
+/// for a while: no events were run, none are queued for coming frames
+/// (which animations always are) and there was no input. Anything
+/// happening brings the full rate straight back.
+///
+class FrameScheduler {
+public:
+    using clock = std::chrono::steady_clock;
+
+private:
+    ///
+    /// The frame rates when busy and when idle
+    ///
+    int target_fps;
+    int idle_fps;
+
+    ///
+    /// Whether to drop to the idle frame rate
+    ///
+    bool adaptive;
+
+    ///
+    /// How long nothing has to happen before dropping to the idle rate
+    ///
+    clock::duration idle_delay;
+
+    ///
+    /// Checks for input waiting to be handled, which isn't signalled
+    /// like events are, so is polled while idle
+    ///
+    std::function<bool ()> input_waiting;
+
+    ///
+    /// Called after each batch of events is run
+    ///
+    std::function<void ()> after_events;
+
+    ///
+    /// When the frame began, and when something last happened
+    ///
+    clock::time_point frame_start;
+    clock::time_point last_activity;
+
+    ///
+    /// The CPU time of the main thread when the frame began, in seconds
+    ///
+    double frame_start_cpu;
+
+    ///
+    /// The CPU time and wall time of the last frame, in seconds
+    ///
+    double frame_cpu_time;
+    double frame_time;
+
+    ///
+    /// Totals for the frames since the timings were last logged
+    ///
+    int logged_frames;
+    double logged_cpu_time;
+    clock::time_point logged_since;
+
+    ///
+    /// Get the CPU time used by the calling thread, in seconds
+    ///
+    static double get_thread_cpu_time();
+
+    ///
+    /// Get the length of a frame at a frame rate
+    ///
+    static clock::duration period(int fps);
+
+public:
+    ///
+    /// Create a scheduler
+    /// @param target_fps the frame rate to run at
+    ///
+    FrameScheduler(int target_fps = 60);
+
+    ///
+    /// Set the frame rate to run at when anything is happening
+    ///
+    void set_target_fps(int target_fps);
+    int get_target_fps() const { return target_fps; }
+
+    ///
+    /// Set the frame rate to drop to when nothing is happening
+    ///
+    void set_idle_fps(int idle_fps);
+    int get_idle_fps() const { return idle_fps; }
+
+    ///
+    /// Set whether to drop to the idle rate when nothing is happening
+    ///
+    void set_adaptive(bool adaptive) { this->adaptive = adaptive; }
+    bool is_adaptive() const { return adaptive; }
+
+    ///
+    /// Set how long nothing has to happen for before dropping to the
+    /// idle frame rate
+    ///
+    void set_idle_delay(clock::duration idle_delay) { this->idle_delay = idle_delay; }
+
+    ///
+    /// Set how to check for input, so that it ends idle waits. This is
+    /// called on the thread running the scheduler.
+    ///
+    void set_input_check(std::function<bool ()> input_waiting) { this->input_waiting = input_waiting; }
+
+    ///
+    /// Set what to call after each batch of events is run, such as to
+    /// publish what they changed. This is called on the thread running
+    /// the scheduler.
+    ///
+    void set_after_events(std::function<void ()> after_events) { this->after_events = after_events; }
+
+    ///
+    /// Check whether frames are at the idle rate
+    ///
+    bool is_idle() const;
+
+    ///
+    /// Start a frame
+    ///
+    void begin_frame();
+
+    ///
+    /// Run the events of the frame, sleeping until each is added, until
+    /// the frame is due to be drawn
+    ///
+    void run_events();
+
+    ///
+    /// Finish a frame, after it has been drawn, recording its timings
+    ///
+    void end_frame();
+
+    ///
+    /// Get the CPU time the main thread used in the last frame, including
+    /// the time spent running events, in seconds
+    ///
+    double get_frame_cpu_time() const { return frame_cpu_time; }
+
+    ///
+    /// Get how long the last frame took, in seconds
+    ///
+    double get_frame_time() const { return frame_time; }
+};
+
+#endif
@@ -44,6 +44,7 @@ extern "C" {
 
 #include "callback.hpp"
 #include "callback_registry.hpp"
+#include "frame_damage.hpp"
 #include "lifeline.hpp"
 #include "lifeline_controller.hpp"
 #include "graphics_context.hpp"
@@ -565,6 +566,10 @@ void GameWindow::update() {
                 window->change_surface = InitAction::DO_INIT;
                 focused_window = window;
                 break;
+            case SDL_WINDOWEVENT_EXPOSED:
+                // What was drawn last needs drawing again
+                FrameDamage::mark_dirty();
+                break;
             case SDL_WINDOWEVENT_MOVED:
                 VLOG(2) << "Need surface reinit (moved)";
                 window->change_surface = InitAction::DO_INIT;
@@ -625,6 +630,7 @@ void GameWindow::update() {
 
         switch (window->change_surface) {
         case InitAction::DO_INIT:
+            FrameDamage::mark_dirty();
             try {
                 window->init_surface();
             }
@@ -707,6 +713,9 @@ void GameWindow::disable_context() {
 
 
 void GameWindow::swap_buffers() {
+    // Anything still batched belongs to this frame
+    graphics_context.get_text_batch().flush();
+
 #ifdef USE_GLES
     if (visible) {
         if (foreground) {
@@ -742,6 +751,8 @@ void GameWindow::swap_buffers() {
 #ifdef USE_GL
     SDL_GL_SwapWindow(window);
 #endif
+
+    graphics_context.get_gl_state().end_frame();
 }
 
 
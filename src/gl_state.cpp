@@ -0,0 +1,178 @@
+#include <cstddef>
+#include <glog/logging.h>
+#include <iterator>
+#include <map>
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+
+#if defined(USE_GL)
+#define GL_GLEXT_PROTOTYPES
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+#include "gl_state.hpp"
+#include "graphics_context.hpp"
+#include "texture_memory.hpp"
+
+GLState &GLState::get_current() {
+    return CHECK_NOTNULL(GraphicsContext::get_current())->get_gl_state();
+}
+
+bool GLState::change(bool needed) {
+    if (needed) {
+        ++frame_counters.calls;
+    }
+    else {
+        ++frame_counters.skipped;
+    }
+
+    return needed;
+}
+
+void GLState::use_program(GLuint program) {
+    if (change(this->program != program)) {
+        glUseProgram(program);
+        this->program = program;
+    }
+}
+
+void GLState::bind_array_buffer(GLuint buffer) {
+    if (change(array_buffer != buffer)) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        array_buffer = buffer;
+    }
+}
+
+void GLState::bind_element_array_buffer(GLuint buffer) {
+    if (change(element_array_buffer != buffer)) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+        element_array_buffer = buffer;
+    }
+}
+
+void GLState::active_texture(GLenum unit) {
+    if (change(active_texture_unit != unit)) {
+        glActiveTexture(unit);
+        active_texture_unit = unit;
+    }
+}
+
+void GLState::bind_texture_2d(GLuint texture) {
+    GLuint unit(active_texture_unit - GL_TEXTURE0);
+
+    // Untracked units are always bound
+    if (unit >= num_texture_units) {
+        ++frame_counters.calls;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        return;
+    }
+
+    if (change(textures_2d[unit] != texture)) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        textures_2d[unit] = texture;
+    }
+}
+
+void GLState::enable_vertex_attrib_array(GLuint index) {
+    if (index >= num_vertex_attrib_arrays) {
+        ++frame_counters.calls;
+        glEnableVertexAttribArray(index);
+        return;
+    }
+
+    if (change(!vertex_attrib_arrays[index])) {
+        glEnableVertexAttribArray(index);
+        vertex_attrib_arrays[index] = true;
+    }
+}
+
+void GLState::disable_vertex_attrib_array(GLuint index) {
+    if (index >= num_vertex_attrib_arrays) {
+        ++frame_counters.calls;
+        glDisableVertexAttribArray(index);
+        return;
+    }
+
+    if (change(vertex_attrib_arrays[index])) {
+        glDisableVertexAttribArray(index);
+        vertex_attrib_arrays[index] = false;
+    }
+}
+
+void GLState::enable(GLenum capability) {
+    auto state(capabilities.find(capability));
+    if (change(state == std::end(capabilities) || !state->second)) {
+        glEnable(capability);
+        capabilities[capability] = true;
+    }
+}
+
+void GLState::disable(GLenum capability) {
+    auto state(capabilities.find(capability));
+    if (change(state == std::end(capabilities) || state->second)) {
+        glDisable(capability);
+        capabilities[capability] = false;
+    }
+}
+
+void GLState::delete_buffer(GLuint buffer) {
+    glDeleteBuffers(1, &buffer);
+
+    // GL unbinds deleted objects, and may reuse their names
+    if (GraphicsContext::get_current() == nullptr) {
+        return;
+    }
+
+    GLState &gl_state(get_current());
+    ++gl_state.frame_counters.calls;
+    if (gl_state.array_buffer == buffer) {
+        gl_state.array_buffer = 0;
+    }
+    if (gl_state.element_array_buffer == buffer) {
+        gl_state.element_array_buffer = 0;
+    }
+}
+
+void GLState::delete_texture(GLuint texture) {
+    glDeleteTextures(1, &texture);
+    TextureMemory::forget(texture);
+
+    if (GraphicsContext::get_current() == nullptr) {
+        return;
+    }
+
+    GLState &gl_state(get_current());
+    ++gl_state.frame_counters.calls;
+    for (GLuint &bound : gl_state.textures_2d) {
+        if (bound == texture) {
+            bound = 0;
+        }
+    }
+}
+
+void GLState::draw_arrays(GLenum mode, GLint first, GLsizei count) {
+    ++frame_counters.calls;
+    ++frame_counters.draws;
+    glDrawArrays(mode, first, count);
+}
+
+void GLState::draw_elements(GLenum mode, GLsizei count, GLenum type, size_t offset) {
+    ++frame_counters.calls;
+    ++frame_counters.draws;
+    glDrawElements(mode, count, type, reinterpret_cast<const GLvoid *>(offset));
+}
+
+void GLState::end_frame() {
+    last_frame_counters = frame_counters;
+    frame_counters = Counters();
+
+    VLOG(1) << "GL calls this frame: " << last_frame_counters.calls
+            << " (" << last_frame_counters.draws << " draws), "
+            << last_frame_counters.skipped << " redundant state changes skipped";
+}
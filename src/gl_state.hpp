@@ -0,0 +1,194 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <cstddef>
+#include <map>
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+
+#if defined(USE_GL)
+#define GL_GLEXT_PROTOTYPES
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+///
+/// Tracks the GL state of a GraphicsContext, so that changes to state
+/// which is already set can be skipped without asking GL.
+///
+/// The tracked state is only right as long as all changes to it go
+/// through this class: the bound program, array buffers and textures,
+/// the active texture unit, the enabled vertex attribute arrays and
+/// the enabled capabilities. Buffers and textures must also be deleted
+/// through it, as GL unbinds objects when they are deleted.
+///
+/// It also counts the GL calls made each frame, both those made and
+/// those skipped as redundant.
+///
+class GLState {
+public:
+    ///
+    /// The number of texture units tracked
+    ///
+    static const int num_texture_units = 8;
+
+    ///
+    /// The number of vertex attribute arrays tracked
+    ///
+    static const int num_vertex_attrib_arrays = 8;
+
+    ///
+    /// Counts of GL calls over a frame
+    ///
+    struct Counters {
+        ///
+        /// The calls which were made
+        ///
+        unsigned int calls = 0;
+
+        ///
+        /// The state changes which were skipped, as the state was
+        /// already set. Without the tracking, these would be made too.
+        ///
+        unsigned int skipped = 0;
+
+        ///
+        /// The draw calls, which are included in calls
+        ///
+        unsigned int draws = 0;
+    };
+
+private:
+    GLuint program = 0;
+    GLuint array_buffer = 0;
+    GLuint element_array_buffer = 0;
+    GLenum active_texture_unit = GL_TEXTURE0;
+    GLuint textures_2d[num_texture_units] = {};
+    bool vertex_attrib_arrays[num_vertex_attrib_arrays] = {};
+
+    ///
+    /// The capabilities we've set. Those missing have their GL
+    /// defaults, or were set outside of the tracker.
+    ///
+    std::map<GLenum, bool> capabilities;
+
+    ///
+    /// The counts for the frame in progress
+    ///
+    Counters frame_counters;
+
+    ///
+    /// The counts for the last complete frame
+    ///
+    Counters last_frame_counters;
+
+    ///
+    /// Count a state change, made or skipped
+    /// @return whether the change needs making
+    ///
+    bool change(bool needed);
+
+public:
+    ///
+    /// Get the state of the current graphics context
+    ///
+    static GLState &get_current();
+
+    ///
+    /// Wrapper around glUseProgram
+    ///
+    void use_program(GLuint program);
+
+    ///
+    /// Get the program in use, without asking GL
+    ///
+    GLuint get_program() { return program; }
+
+    ///
+    /// Wrapper around glBindBuffer for GL_ARRAY_BUFFER
+    ///
+    void bind_array_buffer(GLuint buffer);
+
+    ///
+    /// Wrapper around glBindBuffer for GL_ELEMENT_ARRAY_BUFFER
+    ///
+    void bind_element_array_buffer(GLuint buffer);
+
+    ///
+    /// Wrapper around glActiveTexture
+    ///
+    void active_texture(GLenum unit);
+
+    ///
+    /// Wrapper around glBindTexture for GL_TEXTURE_2D, binding to the
+    /// active texture unit
+    ///
+    void bind_texture_2d(GLuint texture);
+
+    ///
+    /// Wrapper around glEnableVertexAttribArray
+    ///
+    void enable_vertex_attrib_array(GLuint index);
+
+    ///
+    /// Wrapper around glDisableVertexAttribArray
+    ///
+    void disable_vertex_attrib_array(GLuint index);
+
+    ///
+    /// Wrapper around glEnable
+    ///
+    void enable(GLenum capability);
+
+    ///
+    /// Wrapper around glDisable
+    ///
+    void disable(GLenum capability);
+
+    ///
+    /// Wrapper around glDeleteBuffers for a single buffer. Forgets the
+    /// binding in the current context, if there is one.
+    ///
+    static void delete_buffer(GLuint buffer);
+
+    ///
+    /// Wrapper around glDeleteTextures for a single texture. Forgets
+    /// the bindings in the current context, if there is one.
+    ///
+    static void delete_texture(GLuint texture);
+
+    ///
+    /// Wrapper around glDrawArrays
+    ///
+    void draw_arrays(GLenum mode, GLint first, GLsizei count);
+
+    ///
+    /// Wrapper around glDrawElements, with the indices in the bound
+    /// element array buffer
+    ///
+    void draw_elements(GLenum mode, GLsizei count, GLenum type, size_t offset);
+
+    ///
+    /// Count GL calls made directly, such as setting uniforms or
+    /// uploading data
+    /// @param calls the number of calls made
+    ///
+    void count_calls(unsigned int calls = 1) { frame_counters.calls += calls; }
+
+    ///
+    /// End the frame, keeping its counts and starting new ones
+    ///
+    void end_frame();
+
+    ///
+    /// Get the counts for the last complete frame
+    ///
+    const Counters &get_last_frame_counters() { return last_frame_counters; }
+};
+
+#endif
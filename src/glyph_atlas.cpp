@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glog/logging.h>
+
+extern "C" {
+#include <SDL2/SDL_ttf.h>
+
+#if defined(USE_GL)
+#define GL_GLEXT_PROTOTYPES
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+}
+
+#include "gl_state.hpp"
+#include "glyph_atlas.hpp"
+#include "text_font.hpp"
+#include "texture_format.hpp"
+#include "texture_memory.hpp"
+
+const int GlyphAtlas::width;
+const int GlyphAtlas::max_height;
+const uint32_t GlyphAtlas::replacement;
+
+// Need to inherit constructors manually.
+// NOTE: This will, and are required to, copy the message.
+GlyphAtlas::RenderException::RenderException(const char *message): std::runtime_error(message) {}
+GlyphAtlas::RenderException::RenderException(const std::string &message): std::runtime_error(message) {}
+
+
+GlyphAtlas::GlyphAtlas(TextFont font, bool smooth):
+    font(font),
+    smooth(smooth),
+    height(256),
+    line_height(TTF_FontHeight(font.font))
+{
+    while (height < line_height && height < max_height) {
+        height *= 2;
+    }
+
+    coverage.assign(size_t(width * height), GLubyte(0));
+}
+
+GlyphAtlas::~GlyphAtlas() {
+    if (texture != 0) {
+        GLState::delete_texture(texture);
+    }
+}
+
+
+uint32_t GlyphAtlas::next_code_point(const std::string &text, size_t &index) {
+    // The smallest code point which needs each length of sequence,
+    // for rejecting overlong encodings
+    static const uint32_t minimum[5] = {0, 0, 0x80, 0x800, 0x10000};
+
+    uint8_t lead(uint8_t(text[index]));
+    size_t length;
+    uint32_t code_point;
+
+    if (lead < 0x80) {
+        ++index;
+        return lead;
+    }
+    else if ((lead & 0xe0) == 0xc0) {
+        length = 2;
+        code_point = lead & 0x1fu;
+    }
+    else if ((lead & 0xf0) == 0xe0) {
+        length = 3;
+        code_point = lead & 0x0fu;
+    }
+    else if ((lead & 0xf8) == 0xf0) {
+        length = 4;
+        code_point = lead & 0x07u;
+    }
+    else {
+        ++index;
+        return replacement;
+    }
+
+    if (index + length > text.size()) {
+        ++index;
+        return replacement;
+    }
+
+    for (size_t i = 1; i < length; ++i) {
+        uint8_t continuation(uint8_t(text[index + i]));
+        if ((continuation & 0xc0) != 0x80) {
+            ++index;
+            return replacement;
+        }
+        code_point = (code_point << 6) | (continuation & 0x3fu);
+    }
+
+    if (code_point < minimum[length] || code_point > 0x10ffff) {
+        ++index;
+        return replacement;
+    }
+
+    index += length;
+    return code_point;
+}
+
+
+const GlyphAtlas::Glyph &GlyphAtlas::get_glyph(uint32_t code_point) {
+    auto glyph(glyphs.find(code_point));
+    if (glyph != std::end(glyphs)) {
+        return glyph->second;
+    }
+
+    return glyphs.insert(std::make_pair(code_point, rasterize(code_point))).first->second;
+}
+
+
+GlyphAtlas::Glyph GlyphAtlas::rasterize(uint32_t code_point) {
+    // SDL_ttf only renders the basic multilingual plane
+    Uint16 character = Uint16(code_point);
+    if (code_point > 0xffff || !TTF_GlyphIsProvided(font.font, character)) {
+        if (code_point == replacement) {
+            throw GlyphAtlas::RenderException("The font has no replacement character");
+        }
+        return get_glyph(replacement);
+    }
+
+    int min_x, max_x, min_y, max_y, advance;
+    int space_advance;
+    if (TTF_GlyphMetrics(font.font, character, &min_x, &max_x, &min_y, &max_y, &advance) != 0
+     || TTF_GlyphMetrics(font.font, ' ', nullptr, nullptr, nullptr, nullptr, &space_advance) != 0) {
+        LOG(WARNING) << "Cannot get glyph metrics: " << TTF_GetError();
+        throw GlyphAtlas::RenderException("Cannot get glyph metrics");
+    }
+
+    // SDL_ttf clips the left of glyphs which reach back over the
+    // previous one when they start the text, so render the glyph after
+    // a space and cut the space off.
+    Uint16 text[3] = {' ', character, 0};
+
+    SDL_Color colour;
+    colour.r = colour.g = colour.b = colour.a = 255;
+    SDL_Color blank;
+    blank.r = blank.g = blank.b = blank.a = 0;
+
+    SDL_Surface *surface(smooth ? TTF_RenderUNICODE_Shaded(font.font, text, colour, blank)
+                                : TTF_RenderUNICODE_Solid (font.font, text, colour));
+
+    if (surface == nullptr) {
+        LOG(WARNING) << "Cannot render glyph " << code_point << ": " << TTF_GetError();
+        throw GlyphAtlas::RenderException("Cannot render glyph");
+    }
+
+    int offset_x(std::min(min_x, 0));
+    int crop(std::max(0, space_advance + offset_x));
+    int cell_width(std::max(0, surface->w - crop));
+    int cell_height(std::min(surface->h, line_height));
+
+    // The surface is 8 bit, with the palette index of each pixel being
+    // its coverage when smooth, and non-zero for covered when solid
+    SDL_LockSurface(surface);
+    const Uint8 *pixels(static_cast<const Uint8 *>(surface->pixels));
+
+    // Glyphs with nothing to draw, like spaces, take no room
+    bool empty(true);
+    for (int y = 0; y < cell_height && empty; ++y) {
+        const Uint8 *source(&pixels[y * surface->pitch + crop]);
+        empty = std::all_of(source, source + cell_width, [] (Uint8 pixel) { return pixel == 0; });
+    }
+
+    if (empty) {
+        SDL_UnlockSurface(surface);
+        SDL_FreeSurface(surface);
+
+        Glyph glyph;
+        glyph.x = glyph.y = glyph.width = glyph.height = 0;
+        glyph.offset_x = 0;
+        glyph.advance  = advance;
+        return glyph;
+    }
+
+    // Start a new shelf when this one is full, and grow when there
+    // are no shelves left
+    if (shelf_x + cell_width > width) {
+        shelf_y += line_height;
+        shelf_x = 0;
+    }
+
+    while (shelf_y + line_height > height) {
+        if (height >= max_height) {
+            SDL_UnlockSurface(surface);
+            SDL_FreeSurface(surface);
+            LOG(WARNING) << "Glyph atlas is full";
+            throw GlyphAtlas::RenderException("Glyph atlas is full");
+        }
+
+        height *= 2;
+        VLOG(1) << "Growing glyph atlas to " << width << "x" << height;
+        coverage.resize(size_t(width * height), GLubyte(0));
+    }
+
+    for (int y = 0; y < cell_height; ++y) {
+        const Uint8 *source(&pixels[y * surface->pitch + crop]);
+        GLubyte *destination(&coverage[size_t((shelf_y + y) * width + shelf_x)]);
+
+        for (int x = 0; x < cell_width; ++x) {
+            destination[x] = smooth ? GLubyte(source[x]) : GLubyte(source[x] ? 255 : 0);
+        }
+    }
+
+    SDL_UnlockSurface(surface);
+    SDL_FreeSurface(surface);
+
+    Glyph glyph;
+    glyph.x        = shelf_x;
+    glyph.y        = shelf_y;
+    glyph.width    = cell_width;
+    glyph.height   = cell_height;
+    glyph.offset_x = offset_x;
+    glyph.advance  = advance;
+
+    // Leave a gap, so that no glyph picks up its neighbour's edge
+    shelf_x += cell_width + 1;
+
+    if (dirty_end > dirty_begin) {
+        dirty_begin = std::min(dirty_begin, shelf_y);
+        dirty_end   = std::max(dirty_end,   shelf_y + cell_height);
+    }
+    else {
+        dirty_begin = shelf_y;
+        dirty_end   = shelf_y + cell_height;
+    }
+
+    return glyph;
+}
+
+
+void GlyphAtlas::bind() {
+    GLState &gl_state(GLState::get_current());
+
+    if (texture == 0) {
+        glGenTextures(1, &texture);
+        gl_state.count_calls();
+
+        if (texture == 0) {
+            LOG(ERROR) << "Error rendering text: Unable to generate GL texture.";
+            throw GlyphAtlas::RenderException("Unable to generate GL texture");
+        }
+    }
+
+    gl_state.bind_texture_2d(texture);
+
+    // Upload everything when the atlas has grown, or just the rows
+    // with new glyphs
+    bool resized(texture_height != height);
+    int begin(resized ? 0      : dirty_begin);
+    int end  (resized ? height : dirty_end);
+
+    if (end <= begin) {
+        return;
+    }
+
+    // The text shader only reads alpha, so the coverage is uploaded as
+    // is
+    const GLubyte *rows(coverage.data() + size_t(begin * width));
+
+    if (resized) {
+        TextureFormat::upload_converted(TextureFormat::Format::ALPHA, width, height, rows);
+        gl_state.count_calls(2);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        texture_height = height;
+
+        TextureMemory::record(texture, "glyphs", width, height, TextureFormat::Format::ALPHA);
+    }
+    else {
+        TextureFormat::update_converted(TextureFormat::Format::ALPHA, begin, width, end - begin, rows);
+    }
+
+    dirty_begin = dirty_end = 0;
+}
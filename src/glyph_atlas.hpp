@@ -0,0 +1,199 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+#if defined(USE_GL)
+#define GL_GLEXT_PROTOTYPES
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+}
+
+#include "text_font.hpp"
+
+///
+/// A texture holding the glyphs of one font, each rasterized the first
+/// time it is used, so that text can be drawn as a quad per glyph
+/// rather than being rasterized whenever it changes.
+///
+/// The glyphs are packed into shelves. When the atlas is full it grows
+/// downwards, which keeps the glyphs already in it where they are.
+///
+/// There is one for each font and rendering mode in each GL context;
+/// get them from TextBatch.
+///
+class GlyphAtlas {
+public:
+    ///
+    /// Where a glyph is in the atlas and how to place it. Sizes are in
+    /// pixels, and positions in the atlas are from its top left.
+    ///
+    struct Glyph {
+        ///
+        /// The glyph's cell in the atlas. It is as tall as the font's
+        /// lines, with the top of the line at the top of the cell.
+        ///
+        int x;
+        int y;
+        int width;
+        int height;
+
+        ///
+        /// Where the cell starts relative to the pen position, which is
+        /// negative for glyphs that reach back over the previous one
+        ///
+        int offset_x;
+
+        ///
+        /// How far to move the pen after the glyph
+        ///
+        int advance;
+    };
+
+    ///
+    /// The width of the atlas, in pixels
+    ///
+    static const int width = 512;
+
+    ///
+    /// The largest the atlas can grow to, in pixels
+    ///
+    static const int max_height = 2048;
+
+    ///
+    /// The code point drawn in place of those the font can't render
+    ///
+    static const uint32_t replacement = '?';
+
+private:
+    ///
+    /// The font the glyphs come from. Keeping a copy keeps it open.
+    ///
+    TextFont font;
+
+    ///
+    /// If true, glyphs are anti-aliased
+    ///
+    bool smooth;
+
+    ///
+    /// The glyphs rasterized so far, by code point
+    ///
+    std::unordered_map<uint32_t, Glyph> glyphs;
+
+    ///
+    /// The coverage of each pixel, row by row from the top left
+    ///
+    std::vector<GLubyte> coverage;
+
+    ///
+    /// The height of the atlas, in pixels
+    ///
+    int height;
+
+    ///
+    /// The shelf glyphs are being added to: the top of it, and where
+    /// the next glyph goes along it
+    ///
+    int shelf_y = 0;
+    int shelf_x = 0;
+
+    ///
+    /// The height of a line of the font, which is also the height of
+    /// every shelf
+    ///
+    int line_height;
+
+    ///
+    /// The rows added to since the texture was last uploaded
+    ///
+    int dirty_begin = 0;
+    int dirty_end   = 0;
+
+    ///
+    /// The GL texture, made when first bound
+    ///
+    GLuint texture = 0;
+
+    ///
+    /// The height of the texture last uploaded, or 0 for none
+    ///
+    int texture_height = 0;
+
+    ///
+    /// Rasterize a glyph and add it to the atlas
+    ///
+    Glyph rasterize(uint32_t code_point);
+
+    GlyphAtlas(const GlyphAtlas &) = delete;
+    GlyphAtlas &operator=(const GlyphAtlas &) = delete;
+
+public:
+    ///
+    /// Represents a failure to rasterize a glyph or make the texture.
+    ///
+    class RenderException: public std::runtime_error {
+    public:
+        RenderException(const char  *message);
+        RenderException(const std::string &message);
+    };
+
+    GlyphAtlas(TextFont font, bool smooth);
+    ~GlyphAtlas();
+
+    ///
+    /// Read the code point starting at a position of a UTF-8 string.
+    ///
+    /// Malformed and overlong sequences read as one replacement
+    /// character per byte.
+    ///
+    /// @param text The string.
+    /// @param index The position to start at, which is moved past the
+    ///              code point.
+    /// @return The code point.
+    ///
+    static uint32_t next_code_point(const std::string &text, size_t &index);
+
+    ///
+    /// Get a glyph, rasterizing it if it is new.
+    ///
+    /// The reference is valid for the lifetime of the atlas.
+    ///
+    const Glyph &get_glyph(uint32_t code_point);
+
+    ///
+    /// Get the coverage of a pixel of the atlas, from 0 to 255.
+    ///
+    GLubyte get_coverage(int x, int y) const { return coverage[size_t(y * width + x)]; }
+
+    ///
+    /// Get the height of a line of the font, in pixels.
+    ///
+    int get_line_height() const { return line_height; }
+
+    ///
+    /// Get the height of the atlas, in pixels.
+    ///
+    int get_height() const { return height; }
+
+    ///
+    /// Bind the texture to the active unit, first uploading the glyphs
+    /// added since the last time.
+    ///
+    void bind();
+};
+
+#endif
@@ -13,7 +13,8 @@ GraphicsContext* GraphicsContext::current = nullptr;
 
 
 GraphicsContext::GraphicsContext(GameWindow* window):
-    window(window) {
+    window(window),
+    text_batch(window) {
 }
 
 
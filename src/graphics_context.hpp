@@ -12,6 +12,9 @@ extern "C" {
 
 #include "callback.hpp"
 #include "callback_registry.hpp"
+#include "gl_state.hpp"
+#include "quad_index_buffer.hpp"
+#include "text_batch.hpp"
 
 
 
@@ -57,6 +60,21 @@ private:
     /// is destroyed.
     ///
     CallbackRegistry<void> resource_releasers;
+
+    ///
+    /// The tracked state of the GL context.
+    ///
+    GLState gl_state;
+
+    ///
+    /// The index buffer for drawing quads in this context.
+    ///
+    QuadIndexBuffer quad_index_buffer;
+
+    ///
+    /// The batch of text drawn in this context, with its glyph atlases.
+    ///
+    TextBatch text_batch;
 public:
     ///
     /// Return true if the contexts use the same GL context.
@@ -84,6 +102,23 @@ public:
     /// @return The active context or nullptr when no context is active.
     ///
     static GraphicsContext* get_current();
+
+    ///
+    /// Get the tracked state of this context.
+    ///
+    /// All changes to the state it tracks must go through it.
+    ///
+    GLState &get_gl_state() { return gl_state; }
+
+    ///
+    /// Get the index buffer for drawing quads in this context.
+    ///
+    QuadIndexBuffer &get_quad_index_buffer() { return quad_index_buffer; }
+
+    ///
+    /// Get the batch of text drawn in this context.
+    ///
+    TextBatch &get_text_batch() { return text_batch; }
 };
 
 
@@ -10,10 +10,13 @@
 #include "cacheable_resource.hpp"
 #include "component.hpp"
 #include "component_group.hpp"
+#include "frame_damage.hpp"
 #include "gui_manager.hpp"
 #include "mouse_input_event.hpp"
 #include "mouse_state.hpp"
+#include "packed_vertex.hpp"
 #include "shader.hpp"
+#include "text_batch.hpp"
 #include "texture_atlas.hpp"
 
 #if defined(USE_GL)
@@ -45,6 +48,8 @@ void GUIManager::parse_components() {
 
     generate_text_data();
     init_shaders();
+
+    FrameDamage::mark_dirty();
 }
 
 void GUIManager::regenerate_offsets(std::shared_ptr<Component> parent) {
@@ -161,75 +166,56 @@ void GUIManager::generate_texture_data() {
     //generate the texture data data
     std::vector<std::pair<GLfloat*, int>> components_data = root->generate_texture_data();
 
-    //calculate data size
-    long num_floats = 0;
-    for(auto component_texture_data : components_data) {
-        num_floats += component_texture_data.second;
-    }
-
-    GLfloat* gui_tex_data = nullptr;
-    //Create a buffer for the data
-    try {
-        gui_tex_data  = new GLfloat[sizeof(GLfloat)*num_floats];
-    }
-    catch(std::bad_alloc& ba) {
-        LOG(ERROR) << "ERROR: bad_alloc caught in GUIManager::generate_tex_data()" << ba.what();
-        return;
-    }
-
-
-    int gui_tex_data_offset = 0;
-
-    //Extract the data
+    //Extract the data, keeping it until the vertex data is generated
+    gui_tex_data.clear();
     for(auto component_texture_data : components_data) {
         GLfloat* texture_coords = component_texture_data.first;
         size_t texture_coords_size = size_t(component_texture_data.second);
 
         //copy data into buffer
-        std::copy(texture_coords, &texture_coords[texture_coords_size], &gui_tex_data[gui_tex_data_offset]);
-
-        gui_tex_data_offset += component_texture_data.second;
+        gui_tex_data.insert(gui_tex_data.end(), texture_coords, &texture_coords[texture_coords_size]);
     }
-
-    //Generate the data
-    renderable_component.set_texture_coords_data(gui_tex_data, sizeof(GLfloat)*num_floats, false);
 }
 
 void GUIManager::generate_vertex_data() {
     //generate the vertex data
     std::vector<std::pair<GLfloat*, int>> components_data = root->generate_vertex_data();
 
-    //calculate data size
-    int num_dimensions = 2;
-    long num_floats = 0;
+    std::vector<GLfloat> gui_data;
+    //Extract the data
     for(auto component_vertex_data : components_data) {
-        num_floats += component_vertex_data.second;
+        GLfloat* vertices = component_vertex_data.first;
+        size_t vertices_size = size_t(component_vertex_data.second);
+
+        //copy data into buffer
+        gui_data.insert(gui_data.end(), vertices, &vertices[vertices_size]);
     }
 
+    if (gui_data.size() != gui_tex_data.size()) {
+        LOG(ERROR) << "GUI vertex and texture data differ in size in GUIManager::generate_vertex_data()";
+        return;
+    }
+
+    //The components give each quad as two triangles of 12 floats
+    int num_floats_per_quad = 12;
+    int num_quads = int(gui_data.size()) / num_floats_per_quad;
+
     //Create a buffer for the data
-    GLfloat* gui_data = nullptr;
+    PackedQuad* gui_quads = nullptr;
     try {
-        gui_data  = new GLfloat[sizeof(GLfloat)*num_floats];
+        gui_quads = new PackedQuad[num_quads];
     }
     catch(std::bad_alloc& ba) {
         LOG(ERROR) << "bad_alloc caught in GUIManager::generate_vertex_data()" << ba.what();
         return;
     }
 
-    int gui_data_offset = 0;
-    //Extract the data
-    for(auto component_vertex_data : components_data) {
-        GLfloat* vertices = component_vertex_data.first;
-        size_t vertices_size = size_t(component_vertex_data.second);
-
-        //copy data into buffer
-        std::copy(vertices, &vertices[vertices_size], &gui_data[gui_data_offset]);
-
-        gui_data_offset += component_vertex_data.second;
+    for(int quad = 0; quad < num_quads; ++quad) {
+        size_t offset = size_t(quad * num_floats_per_quad);
+        gui_quads[quad].set_from_triangles(&gui_data[offset], &gui_tex_data[offset], PackedVertex::pixel_units);
     }
 
-    renderable_component.set_vertex_data(gui_data,sizeof(GLfloat)*num_floats, false);
-    renderable_component.set_num_vertices_render(GLsizei(num_floats/num_dimensions));//GL_TRIANGLES being used
+    renderable_component.set_quad_data(gui_quads, num_quads, false);
 }
 
 void GUIManager::generate_text_data() {
@@ -252,6 +238,9 @@ void GUIManager::render_text() {
 
         text_data->get_text()->display();
    }
+
+   // Draw the text over the GUI before anything else is drawn
+   TextBatch::get_current().flush();
 }
 
 void GUIManager::load_textures() {
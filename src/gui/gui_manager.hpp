@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <iostream>
+#include <vector>
 #include "object.hpp"
 #include "gui_text.hpp"
 class Component;
@@ -31,6 +32,12 @@ class GUIManager : public Object {
     ///
     std::vector<std::shared_ptr<GUIText>> components_text;
 
+    ///
+    /// The texture coordinates of the components, kept from
+    /// generate_texture_data to be packed with the vertex data
+    ///
+    std::vector<GLfloat> gui_tex_data;
+
     ///
     /// Generate the texture data for this component and its sub components
     ///
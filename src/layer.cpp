@@ -1,36 +1,132 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "chunk_slots.hpp"
 #include "layer.hpp"
+#include "renderable_component.hpp"
 #include "tileset.hpp"
 
-Layer::Layer(int width_tiles, int height_tiles, std::string name) :
+Layer::Layer(int width_tiles, int height_tiles, std::string name,
+             std::shared_ptr<std::vector<std::shared_ptr<TileSet>>> tilesets) :
     width_tiles(width_tiles),
     height_tiles(height_tiles),
     name(name),
-    layer(std::make_shared<std::vector<std::pair<std::shared_ptr<TileSet>, int>>>()),
+    tilesets(tilesets),
+    tileset_indices(),
+    tile_ids(),
     packing(Packing::DENSE),
-    location_texture_vbo_offset_map() {
+    chunks(),
+    chunk_slots() {
+
+    tileset_indices.reserve(size_t(width_tiles * height_tiles));
+    tile_ids.reserve(size_t(width_tiles * height_tiles));
+
+    for (int chunk_y = 0; chunk_y < get_num_chunks_y(); ++chunk_y) {
+        for (int chunk_x = 0; chunk_x < get_num_chunks_x(); ++chunk_x) {
+            // Chunks on the top and right edges may be cut short
+            int chunk_width (std::min(chunk_size, width_tiles  - chunk_x * chunk_size));
+            int chunk_height(std::min(chunk_size, height_tiles - chunk_y * chunk_size));
+
+            chunks.push_back(std::unique_ptr<RenderableComponent>(new RenderableComponent()));
+            chunk_slots.push_back(ChunkSlots(chunk_width * chunk_height));
+        }
+    }
 }
 
-void Layer::add_tile(std::shared_ptr<TileSet> tileset, int tile_id) {
+void Layer::add_tile(int tileset_index, int tile_id) {
+    LayerInvalidException layer_invalid_exception;
+    if (tileset_index < -1 || tileset_index >= int(tilesets->size()) || tileset_index >= UINT8_MAX
+        || tile_id < 0 || tile_id > UINT16_MAX)
+        throw layer_invalid_exception;
 
-    //Add to the layer the tileset and tile id pair
-    layer->push_back(std::make_pair(tileset, tile_id));
+    //Add to the layer the tileset index and tile id
+    tileset_indices.push_back(uint8_t(tileset_index + 1));
+    tile_ids.push_back(uint16_t(tile_id));
     // Temporary single-tileset hack.
-    if (tileset) {
-        renderable_component.set_texture(tileset->get_atlas());
+    if (tileset_index != -1) {
+        renderable_component.set_texture((*tilesets)[size_t(tileset_index)]->get_atlas());
+    }
+}
+
+void Layer::set_tiles(const uint8_t *new_tileset_indices, const uint16_t *new_tile_ids, size_t num_tiles) {
+    LayerInvalidException layer_invalid_exception;
+    if (num_tiles != size_t(width_tiles * height_tiles))
+        throw layer_invalid_exception;
+
+    tileset_indices.assign(new_tileset_indices, new_tileset_indices + num_tiles);
+    tile_ids.assign(new_tile_ids, new_tile_ids + num_tiles);
+
+    uint8_t max_index(num_tiles == 0 ? 0 : *std::max_element(tileset_indices.begin(), tileset_indices.end()));
+    if (max_index > tilesets->size())
+        throw layer_invalid_exception;
+
+    // Temporary single-tileset hack.
+    auto first_tile(std::find_if(tileset_indices.begin(), tileset_indices.end(), [] (uint8_t index) { return index != 0; }));
+    if (first_tile != tileset_indices.end()) {
+        renderable_component.set_texture(get_tileset(*first_tile)->get_atlas());
     }
 }
 
 std::pair<std::shared_ptr<TileSet>, int> Layer::get_tile(int x_pos, int y_pos) {
     //Fetch the tile at the required position
-    return layer->at(x_pos + y_pos * width_tiles);
+    size_t index(size_t(x_pos + y_pos * width_tiles));
+    return std::make_pair(get_tileset(tileset_indices.at(index)), int(tile_ids.at(index)));
 }
 
 void Layer::update_tile(int x_pos, int y_pos, int tile_id, std::shared_ptr<TileSet> tileset) {
     LayerInvalidException layer_invalid_exception;
     if(x_pos < 0 || x_pos >= width_tiles || y_pos < 0 || y_pos >= height_tiles)
         throw layer_invalid_exception;
-    //Make the pair
+    if(tile_id < 0 || tile_id > UINT16_MAX)
+        throw layer_invalid_exception;
 
     //Set the new tile
-    (*layer)[y_pos*width_tiles + x_pos] = std::make_pair(tileset, tile_id);;
+    size_t index(size_t(y_pos*width_tiles + x_pos));
+    tileset_indices[index] = find_tileset_index(tileset);
+    tile_ids[index] = uint16_t(tile_id);
+}
+
+uint8_t Layer::find_tileset_index(std::shared_ptr<TileSet> tileset) {
+    if (!tileset) {
+        return 0;
+    }
+
+    auto found(std::find(tilesets->begin(), tilesets->end(), tileset));
+    if (found == tilesets->end()) {
+        throw LayerInvalidException();
+    }
+
+    return uint8_t(found - tilesets->begin() + 1);
+}
+
+std::pair<std::shared_ptr<TileSet>, int> Layer::TileView::operator[](size_t index) const {
+    return std::make_pair(layer->get_tileset(layer->tileset_indices[index]), int(layer->tile_ids[index]));
+}
+
+RenderableComponent* Layer::get_chunk_renderable_component(int chunk_x, int chunk_y) {
+    return chunks.at(size_t(chunk_y * get_num_chunks_x() + chunk_x)).get();
+}
+
+ChunkSlots& Layer::get_chunk_slots(int chunk_x, int chunk_y) {
+    return chunk_slots.at(size_t(chunk_y * get_num_chunks_x() + chunk_x));
+}
+
+int Layer::get_chunk_tile_index(int x_pos, int y_pos) {
+    int chunk_x(x_pos / chunk_size);
+    int chunk_width(std::min(chunk_size, width_tiles - chunk_x * chunk_size));
+    return (y_pos % chunk_size) * chunk_width + (x_pos % chunk_size);
+}
+
+int Layer::get_tile_quad(int x_pos, int y_pos) {
+    int local_index(get_chunk_tile_index(x_pos, y_pos));
+
+    // Dense chunks hold every tile, in order
+    if (packing == Packing::DENSE) {
+        return local_index;
+    }
+
+    return get_chunk_slots(x_pos / chunk_size, y_pos / chunk_size).get_slot(local_index);
 }
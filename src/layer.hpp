@@ -1,6 +1,7 @@
 #ifndef LAYER_H
 #define LAYER_H
 
+#include <cstdint>
 #include <exception>
 #include <memory>
 #include <map>
@@ -8,7 +9,10 @@
 #include <utility>
 #include <vector>
 
+#include "chunk_slots.hpp"
 #include "object.hpp"
+#include "renderable_component.hpp"
+#include "tile_index_texture.hpp"
 
 class TileSet;
 
@@ -49,9 +53,28 @@ private:
     std::string name;
 
     ///
-    /// The layer data stored as tilesetname, tile id pair
+    /// The table of tilesets used by the layer's tiles, shared with the
+    /// Map and its other layers
     ///
-    std::shared_ptr<std::vector<std::pair<std::shared_ptr<TileSet>, int>>> layer;
+    std::shared_ptr<std::vector<std::shared_ptr<TileSet>>> tilesets;
+
+    ///
+    /// For each tile, row by row from the bottom left, the tile's index
+    /// in the tileset table plus one, or 0 for a blank tile
+    ///
+    std::vector<uint8_t> tileset_indices;
+
+    ///
+    /// For each tile, row by row from the bottom left, the tile's id in
+    /// its tileset
+    ///
+    std::vector<uint16_t> tile_ids;
+
+    ///
+    /// Get the index of a tileset in the tileset table plus one, or 0
+    /// for no tileset
+    ///
+    uint8_t find_tileset_index(std::shared_ptr<TileSet> tileset);
 
     ///
     /// The packing of the layer
@@ -59,20 +82,79 @@ private:
     Layer::Packing packing;
 
     ///
-    /// The map of tile locations to tile offset
+    /// The renderable components holding each chunk's geometry. These
+    /// are stored row by row, starting from the bottom left chunk.
     ///
-    std::map<int, int> location_texture_vbo_offset_map;
+    std::vector<std::unique_ptr<RenderableComponent>> chunks;
+
+    ///
+    /// For each chunk of a sparse layer, the slots of the chunk's
+    /// buffers used by each of its tiles.
+    ///
+    std::vector<ChunkSlots> chunk_slots;
+
+    ///
+    /// The layer's tile index texture, when it is drawn by the tilemap
+    /// shader
+    ///
+    std::unique_ptr<TileIndexTexture> tile_index_texture;
+
 public:
+    ///
+    /// The width and height of a chunk in tiles. The layer's geometry is
+    /// split into chunks of this size so that only the chunks in view
+    /// are drawn and a tile update only touches the chunk that owns it.
+    ///
+    static const int chunk_size = 16;
+
+    ///
+    /// A read-only view of the layer's tiles as tileset and tile id
+    /// pairs, row by row from the bottom left
+    ///
+    class TileView {
+        Layer *layer;
+    public:
+        TileView(Layer *layer): layer(layer) {}
+
+        ///
+        /// Get the number of tiles in the layer
+        ///
+        size_t size() const { return layer->tile_ids.size(); }
+
+        ///
+        /// Get the tileset and id of a tile
+        ///
+        std::pair<std::shared_ptr<TileSet>, int> operator[](size_t index) const;
+    };
+
     ///
     /// Construct the new Layer
+    /// @param width_tiles the width of the layer in tiles
+    /// @param height_tiles the height of the layer in tiles
+    /// @param name the name of the layer
+    /// @param tilesets the table of tilesets the layer's tiles use
     ///
-    Layer(int width_tiles, int height_tiles, std::string name);
+    Layer(int width_tiles, int height_tiles, std::string name,
+          std::shared_ptr<std::vector<std::shared_ptr<TileSet>>> tilesets);
 
     ///
     /// Add a tile to the layer. This adds the tile to the end of the tile list.
     /// Note: this does NOT add the tile to the geometry. It adds it to the list of tiles on this layer.
+    /// @param tileset_index the index of the tile's tileset in the tileset table, or -1 for a blank tile
+    /// @param tile_id the identifier of the tile
+    /// Throws, LayerInvalidException if the tileset index or tile id can't be stored
     ///
-    void add_tile(std::shared_ptr<TileSet> tileset, int tile_id);
+    void add_tile(int tileset_index, int tile_id);
+
+    ///
+    /// Set all of the layer's tiles at once, as stored by get_tileset_indices and get_tile_ids.
+    /// Note: this does NOT add the tiles to the geometry.
+    /// @param new_tileset_indices each tile's index in the tileset table plus one, or 0 for a blank tile
+    /// @param new_tile_ids each tile's identifier
+    /// @param num_tiles the number of tiles, which must fill the layer
+    /// Throws, LayerInvalidException if the number of tiles or a tileset index is invalid
+    ///
+    void set_tiles(const uint8_t *new_tileset_indices, const uint16_t *new_tile_ids, size_t num_tiles);
 
     ///
     /// Update a tile. This  function is used to put a new tile on the layer or to update an
@@ -80,7 +162,7 @@ public:
     /// @param x_pos the x position
     /// @param y_pos the y position
     /// @param tile_id the identifier of the tile
-    /// @param tileset the name of the tileset for this tile
+    /// @param tileset the tileset for this tile, which must be in the tileset table, or nullptr
     /// Throws, LayerInvalidException if the x and y position is out of bounds
     ///
     void update_tile(int x_pos, int y_pos, int tile_id, std::shared_ptr<TileSet> tileset);
@@ -94,10 +176,61 @@ public:
     std::pair<std::shared_ptr<TileSet>, int> get_tile(int x_pos, int y_pos);
 
     ///
-    /// Get a tile's texture offset in the VBO
-    /// @return the texture offset in the VBo
+    /// Get a tile's quad in its chunk's VBO
+    /// @param x_pos the layer x offset
+    /// @param y_pos the layer y offset
+    /// @return the index of the quad in the chunk's VBO, or -1 if the
+    /// tile has no geometry
+    ///
+    int get_tile_quad(int x_pos, int y_pos);
+
+    ///
+    /// Get the number of chunks across the layer
+    ///
+    int get_num_chunks_x() { return (width_tiles + chunk_size - 1) / chunk_size; }
+
+    ///
+    /// Get the number of chunks up the layer
+    ///
+    int get_num_chunks_y() { return (height_tiles + chunk_size - 1) / chunk_size; }
+
+    ///
+    /// Get the renderable component of a chunk
+    /// @param chunk_x the chunk's x index
+    /// @param chunk_y the chunk's y index
+    /// @return the chunk's renderable component
+    ///
+    RenderableComponent* get_chunk_renderable_component(int chunk_x, int chunk_y);
+
+    ///
+    /// Get the slots used by the tiles of a chunk. Only used for sparse
+    /// layers.
+    /// @param chunk_x the chunk's x index
+    /// @param chunk_y the chunk's y index
+    /// @return the chunk's slots
+    ///
+    ChunkSlots& get_chunk_slots(int chunk_x, int chunk_y);
+
+    ///
+    /// Get a tile's index within the chunk holding it
+    /// @param x_pos the layer x offset
+    /// @param y_pos the layer y offset
+    /// @return the tile's index, counted row by row within the chunk
+    ///
+    int get_chunk_tile_index(int x_pos, int y_pos);
+
+    ///
+    /// Get the layer's tile index texture
+    /// @return the texture, or nullptr if the layer is drawn from its
+    /// chunks' geometry
     ///
-    int get_tile_texture_vbo_offset();
+    TileIndexTexture* get_tile_index_texture() { return tile_index_texture.get(); }
+
+    ///
+    /// Set the layer's tile index texture
+    /// @param texture the texture, or nullptr to draw from the chunks
+    ///
+    void set_tile_index_texture(std::unique_ptr<TileIndexTexture> texture) { tile_index_texture = std::move(texture); }
 
     ///
     /// Gets the packing of the layer. This indicates how the data has been packed into
@@ -129,9 +262,29 @@ public:
     int get_height_tiles() { return height_tiles; }
 
     ///
-    /// Get the layer's data as a shared_ptr
+    /// Get a view of the layer's data as tileset and tile id pairs
+    ///
+    TileView get_layer_data() { return TileView(this); }
+
     ///
-    std::shared_ptr<std::vector<std::pair<std::shared_ptr<TileSet>, int>>> get_layer_data() { return layer; }
+    /// Get each tile's index in the tileset table plus one, or 0 for a
+    /// blank tile, row by row from the bottom left
+    ///
+    const std::vector<uint8_t>& get_tileset_indices() { return tileset_indices; }
+
+    ///
+    /// Get each tile's id in its tileset, row by row from the bottom left
+    ///
+    const std::vector<uint16_t>& get_tile_ids() { return tile_ids; }
+
+    ///
+    /// Get a tileset from its index in the tileset table plus one
+    /// @param tileset_index the index plus one, as in get_tileset_indices
+    /// @return the tileset, or nullptr for 0
+    ///
+    std::shared_ptr<TileSet> get_tileset(uint8_t tileset_index) {
+        return tileset_index == 0 ? nullptr : tilesets->at(tileset_index - 1u);
+    }
 };
 
 ///
@@ -23,6 +23,8 @@
 #include "event_manager.hpp"
 #include "filters.hpp"
 #include "final_challenge.hpp"
+#include "frame_damage.hpp"
+#include "frame_scheduler.hpp"
 #include "game_window.hpp"
 #include "gui_manager.hpp"
 #include "gui_window.hpp"
@@ -31,6 +33,7 @@
 #include "introduction_challenge.hpp"
 #include "keyboard_input_event.hpp"
 #include "lifeline.hpp"
+#include "map_preloader.hpp"
 #include "map_viewer.hpp"
 #include "mouse_cursor.hpp"
 #include "mouse_input_event.hpp"
@@ -38,6 +41,8 @@
 #include "notification_bar.hpp"
 #include "sprite.hpp"
 #include "start_screen.hpp"
+#include "text_batch.hpp"
+#include "texture_memory.hpp"
 
 #ifdef USE_GLES
 #include "typeface.hpp"
@@ -51,6 +56,7 @@ using namespace std;
 
 static std::mt19937 random_generator;
 Challenge* pick_challenge(ChallengeData* challenge_data);
+std::string challenge_map(int challenge);
 int main(int argc, const char *argv[]) {
     std::string map_path("../maps/start_screen.tmx");
 
@@ -283,6 +289,26 @@ int main(int argc, const char *argv[]) {
         [&] (KeyboardInputEvent) { Engine::set_global_scale(1.0f); }
     ));
 
+    // Switch between drawing the map from tile geometry and with the
+    // tilemap shader, for comparing the two
+    Lifeline gpu_tilemap_callback = input_manager->register_keyboard_handler(filter(
+        {KEY_PRESS, MODIFIER({"Left Ctrl", "Right Ctrl"}), KEY("T")},
+        [&] (KeyboardInputEvent) { Engine::set_gpu_tilemap(!Engine::get_gpu_tilemap()); }
+    ));
+
+    // Switch between drawing the map from composited chunks and layer
+    // by layer
+    Lifeline chunk_cache_callback = input_manager->register_keyboard_handler(filter(
+        {KEY_PRESS, MODIFIER({"Left Ctrl", "Right Ctrl"}), KEY("L")},
+        [&] (KeyboardInputEvent) { Engine::set_chunk_cache(!Engine::get_chunk_cache()); }
+    ));
+
+    // Log the GPU memory taken by textures
+    Lifeline texture_memory_callback = input_manager->register_keyboard_handler(filter(
+        {KEY_PRESS, MODIFIER({"Left Ctrl", "Right Ctrl"}), KEY("G")},
+        [&] (KeyboardInputEvent) { TextureMemory::report(); }
+    ));
+
 
     Lifeline help_callback = input_manager->register_keyboard_handler(filter(
         {KEY_PRESS, MODIFIER({"Left Shift", "Right Shift"}), KEY("/")},
@@ -367,36 +393,43 @@ int main(int argc, const char *argv[]) {
     MouseCursor cursor(&window);
     //Run the challenge - returns after challenge completes
 
+    // Sleep between events rather than polling for them, and drop the
+    // frame rate when nothing is moving
+    FrameScheduler frame_scheduler(60);
+    frame_scheduler.set_input_check([] () {
+        SDL_PumpEvents();
+        return SDL_HasEvents(SDL_FIRSTEVENT, SDL_LASTEVENT) == SDL_TRUE;
+    });
+    // Let Python query what the events changed without waiting a frame
+    frame_scheduler.set_after_events(&Engine::publish_snapshot);
+
     while(!window.check_close() && run_game) {
         challenge_data->run_challenge = true;
         Challenge* challenge = pick_challenge(challenge_data);
         Engine::set_challenge(challenge);
         challenge->start();
 
-        auto last_clock(std::chrono::steady_clock::now());
+        // Challenges usually finish by going on to the next one, so
+        // get its map ready in the background
+        std::string next_map(challenge_map(challenge_data->next_challenge + 1));
+        if (!next_map.empty()) {
+            MapPreloader::get_instance().preload(next_map);
+        }
 
         //Run the challenge - returns after challenge completes
         VLOG(3) << "{";
         while (!challenge_data->game_window->check_close() && challenge_data->run_challenge) {
-            last_clock = std::chrono::steady_clock::now();
+            frame_scheduler.begin_frame();
 
             VLOG(3) << "} SB | IM {";
             GameWindow::update();
 
-            VLOG(3) << "} IM | EM {";
+            VLOG(3) << "} IM | PL {";
+            MapPreloader::get_instance().update();
 
-            do {
-                EventManager::get_instance().process_events();
-            } while (
-                  std::chrono::steady_clock::now() - last_clock
-                < std::chrono::nanoseconds(1000000000 / 60)
-            );
+            VLOG(3) << "} PL | EM {";
 
-            VLOG(3) << "} EM | RM {";
-            Engine::get_map_viewer()->render();
-            VLOG(3) << "} RM | TD {";
-            Engine::text_displayer();
-            challenge_data->notification_bar->text_displayer();
+            frame_scheduler.run_events();
 
             // This is not an input event, because the map can move with
             // the mouse staying still.
@@ -411,12 +444,29 @@ int main(int argc, const char *argv[]) {
                     tile_identifier_text.set_text(position.str());
                 }
             }
+
+            // Leave the last frame on screen if nothing has changed
+            if (!FrameDamage::take()) {
+                frame_scheduler.end_frame();
+                continue;
+            }
+
+            VLOG(3) << "} EM | RM {";
+            Engine::get_map_viewer()->render();
+            VLOG(3) << "} RM | TD {";
+            Engine::text_displayer();
+            challenge_data->notification_bar->text_displayer();
+
             tile_identifier_text.display();
 
+            // Draw the text batched this frame, before the cursor
+            TextBatch::get_current().flush();
+
             cursor.display();
 
             VLOG(3) << "} TD | SB {";
             challenge_data->game_window->swap_buffers();
+            frame_scheduler.end_frame();
         }
 
         VLOG(3) << "}";
@@ -431,29 +481,36 @@ int main(int argc, const char *argv[]) {
     return 0;
 }
 
+std::string challenge_map(int challenge) {
+    switch(challenge) {
+        case 0:
+            return "../maps/start_screen.tmx";
+        case 1:
+            return "../maps/introduction.tmx";
+        case 2:
+            return "../maps/cutting_challenge.tmx";
+        case 3:
+            return "../maps/final_challenge.tmx";
+        default:
+            return "";
+    }
+}
+
 Challenge* pick_challenge(ChallengeData* challenge_data) {
     int next_challenge(challenge_data->next_challenge);
     Challenge *challenge(nullptr);
-    std::string map_name = "";
+    challenge_data->map_name = challenge_map(next_challenge);
     switch(next_challenge) {
         case 0:
-            map_name ="../maps/start_screen.tmx";
-            challenge_data->map_name = map_name;
             challenge = new StartScreen(challenge_data);
             break;
         case 1:
-            map_name = "../maps/introduction.tmx";
-            challenge_data->map_name = map_name;
             challenge = new IntroductionChallenge(challenge_data);
             break;
         case 2:
-            map_name = "../maps/cutting_challenge.tmx";
-            challenge_data->map_name = map_name;
             challenge = new CuttingChallenge(challenge_data);
             break;
         case 3:
-            map_name = "../maps/final_challenge.tmx";
-            challenge_data->map_name = map_name;
             challenge = new FinalChallenge(challenge_data);
             break;
         default:
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cstdint>
 #include <exception>
 #include <fstream>
 #include <glm/vec2.hpp>
@@ -6,9 +7,12 @@
 #include <iterator>
 #include <memory>
 #include <new>
+#include <stdexcept>
 #include <string>
 #include <tuple>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #ifdef USE_GLES
 #include <GLES2/gl2.h>
@@ -24,61 +28,91 @@
 #endif
 
 #include "cacheable_resource.hpp"
+#include "chunk_slots.hpp"
 #include "dispatcher.hpp"
 #include "engine.hpp"
 #include "fml.hpp"
+#include "frame_damage.hpp"
 #include "layer.hpp"
 #include "map.hpp"
 #include "map_loader.hpp"
 #include "map_object.hpp"
+#include "map_preloader.hpp"
 #include "object_manager.hpp"
+#include "packed_vertex.hpp"
 #include "renderable_component.hpp"
 #include "shader.hpp"
+#include "spatial_index.hpp"
 #include "texture_atlas.hpp"
+#include "tile_index_texture.hpp"
 #include "tileset.hpp"
+#include "walkability_grid.hpp"
 
 
 Map::Map(const std::string map_src):
     event_step_on(glm::ivec2(0, 0)),
     event_step_off(glm::ivec2(0, 0))
     {
-        //Load the map
-        MapLoader map_loader;
-        bool result = map_loader.load_map(map_src);
-        if(!result)  {
+        //Load the map, reading it now if it wasn't preloaded
+        std::unique_ptr<MapLoader> map_loader(MapPreloader::get_instance().take(map_src));
+        if (!map_loader) {
+            map_loader.reset(new MapLoader());
 
-            LOG(ERROR) << "Couldn't load map";
-            return;
+            if (!map_loader->read_map(map_src)) {
+                LOG(ERROR) << "Couldn't load map";
+                return;
+            }
         }
 
-        locations = map_loader.get_object_mapping();
+        map_loader->build_map();
+
+        locations = map_loader->get_object_mapping();
 
         //Get the loaded map data
-        map_width = map_loader.get_map_width();
-        map_height = map_loader.get_map_height();
+        map_width = map_loader->get_map_width();
+        map_height = map_loader->get_map_height();
 
         // hack to construct postion dispatcher as we need map diametions
         event_step_on  = PositionDispatcher<int>(glm::ivec2(map_width, map_height));
         event_step_off = PositionDispatcher<int>(glm::ivec2(map_width, map_height));
 
+        map_object_index = SpatialIndex(map_width, map_height);
+        sprite_index     = SpatialIndex(map_width, map_height);
+
+        chunk_versions.assign(size_t(get_num_chunks_x() * get_num_chunks_y()), 0u);
+
         LOG(INFO) << "Map width: " << map_width << " Map height: " << map_height;
-        std::vector<std::shared_ptr<Layer>> layers = map_loader.get_layers();
+        std::vector<std::shared_ptr<Layer>> layers = map_loader->get_layers();
         for(auto layer : layers) {
             layer_ids.push_back(layer->get_id());
+            layer_ids_by_name.insert(std::make_pair(layer->get_name(), layer->get_id()));
             ObjectManager::get_instance().add_object(layer);
         }
 
-        tilesets = map_loader.get_tilesets();
+        tilesets = map_loader->get_tilesets();
+        generate_tile_names();
 
         //Get the tilesets
         //TODO: We'll only support one tileset at the moment
-        //Get an object list
-        blocker = std::vector<std::vector<int>>(map_width, std::vector<int>(map_height, 0));
+        //Build the walkability grid from the collisions layer
+        walkability_grid = WalkabilityGrid(map_width, map_height);
+        for (auto layer : layers) {
+            // Block only in the case where we're on the collisions layer and the tile is set
+            if (layer->get_name() != "Collisions") {
+                continue;
+            }
+
+            const std::vector<uint16_t> &tile_ids(layer->get_tile_ids());
+            for (size_t i = 0; i < tile_ids.size(); ++i) {
+                if (tile_ids[i] != 0) {
+                    walkability_grid.set_collision(int(i) % map_width, int(i) / map_width, true);
+                }
+            }
+        }
 
         //Generate the geometry needed for this map
         init_shaders();
         init_textures();
-        // generate_tileset_coords(texture_atlases[0]);
         generate_data();
 }
 
@@ -91,22 +125,23 @@ Map::~Map() {
     LOG(INFO) << "Map destructed";
 }
 
-bool Map::is_walkable(int x_pos, int y_pos) {
-    return std::all_of(std::begin(layer_ids), std::end(layer_ids), [&] (int layer_id) {
-            std::shared_ptr<Layer> layer = ObjectManager::get_instance().get_object<Layer>(layer_id);
-        // Block only in the case where we're on the collisions layer and the tile is set
-            return !(layer->get_name() == "Collisions" && layer->get_tile(x_pos, y_pos).second);
-    });
-}
-
-
 void Map::add_map_object(int map_object_id) {
-    if(ObjectManager::is_valid_object_id(map_object_id))
+    if(ObjectManager::is_valid_object_id(map_object_id)) {
         map_object_ids.push_back(map_object_id);
+        FrameDamage::mark_dirty();
+
+        auto map_object(ObjectManager::get_instance().get_object<MapObject>(map_object_id));
+        if (map_object) {
+            map_object_index.insert(map_object_id, map_object->get_position());
+        }
+    }
 }
 
 void Map::remove_map_object(int map_object_id) {
     if(ObjectManager::is_valid_object_id(map_object_id)){
+        map_object_index.remove(map_object_id);
+        FrameDamage::mark_dirty();
+
         for(auto it = map_object_ids.begin(); it != map_object_ids.end(); ++it) {
             //If a valid object
             if(*it != 0) {
@@ -124,11 +159,20 @@ void Map::add_sprite(int sprite_id) {
     if (ObjectManager::is_valid_object_id(sprite_id)) {
         event_sprite_add.trigger(sprite_id);
         sprite_ids.push_back(sprite_id);
+        FrameDamage::mark_dirty();
+
+        auto sprite(ObjectManager::get_instance().get_object<MapObject>(sprite_id));
+        if (sprite) {
+            sprite_index.insert(sprite_id, sprite->get_position());
+        }
     }
 }
 
 void Map::remove_sprite(int sprite_id) {
     if(ObjectManager::is_valid_object_id(sprite_id)){
+        sprite_index.remove(sprite_id);
+        FrameDamage::mark_dirty();
+
         for(auto it = sprite_ids.begin(); it != sprite_ids.end(); ++it) {
             //If a valid object
             if(*it != 0) {
@@ -142,89 +186,39 @@ void Map::remove_sprite(int sprite_id) {
     }
 }
 
-/**
- * The function used to generate the cache of tile texture coordinates.
- */
-void Map::generate_tileset_coords(std::shared_ptr<TextureAtlas> atlas) {
-    int texture_count = atlas->get_texture_count();
-
-    LOG(INFO) << "Generating tileset texture coords";
-
-    if(Engine::get_tile_size() == 0) {
-        LOG(ERROR) << "Tile size is 0 in Map::generate_tileset_coords";
-        return;
-    }
-
-    LOG(INFO) << "Tileset texture count: " << texture_count;
-
-    //Each tile needs 8 floats to describe its position in the image
-    try {
-        tileset_tex_coords = new GLfloat[sizeof(GLfloat)* texture_count * 4 * 2];
-    }
-    catch (std::bad_alloc& ba) {
-        LOG(ERROR) << "Out of Memory in Map::generate_tileset_coords";
-        return;
-    }
-
-    int data_i = 0;
-    for (int i = 0; i < texture_count; ++i) {
-        std::tuple<float,float,float,float> bounds = atlas->index_to_coords(i);
-
-        // bottom left
-        tileset_tex_coords[data_i++] = std::get<0>(bounds);
-        tileset_tex_coords[data_i++] = std::get<2>(bounds);
-
-        // top left
-        tileset_tex_coords[data_i++] = std::get<0>(bounds);
-        tileset_tex_coords[data_i++] = std::get<3>(bounds);
-
-        // bottom right
-        tileset_tex_coords[data_i++] = std::get<1>(bounds);
-        tileset_tex_coords[data_i++] = std::get<2>(bounds);
-
-        // top right
-        tileset_tex_coords[data_i++] = std::get<1>(bounds);
-        tileset_tex_coords[data_i++] = std::get<3>(bounds);
-    }
+void Map::update_object_position(int object_id, glm::vec2 position) {
+    map_object_index.move(object_id, position);
+    sprite_index.move(object_id, position);
 }
 
 void Map::generate_data() {
     LOG(INFO) << "Generating map data";
 
     // Get each layer of the map
-    // Start at layer 0
-    int layer_num = 0;
     for (int layer_id : layer_ids) {
         std::shared_ptr<Layer> layer = ObjectManager::get_instance().get_object<Layer>(layer_id);
 
-        auto layer_data = layer->get_layer_data();
-
-
-        // Build the mapping from (x, y) to offsets in the vertex and texture buffers
-        auto buffer_map = std::make_shared<std::map<int, int>>();
-        layer_mappings[layer_num] = buffer_map;
-
-
         // Don't generate data for the collisions layer
-        // TODO: handle this not being in layer_mappings
         if (layer->get_name() == "Collisions") {
-            layer_num++;
             continue;
         }
 
+        if (gpu_tilemap) {
+            generate_tile_index_texture(layer);
+            continue;
+        }
 
-        // Work out if we need a dense or a sparse buffer
-        int total_tiles = 0;
-        int num_blank_tiles = 0;
-
-        // Get all the tiles in the layer, moving from left to right and down
-        for (auto &tile_data : *layer_data) {
-            std::shared_ptr<TileSet> tileset = tile_data.first;
-            if (!tileset) { num_blank_tiles++; }
-
-            total_tiles++;
+        // Back from the tilemap shader, the layer's quad is not needed
+        if (layer->get_tile_index_texture()) {
+            layer->set_tile_index_texture(nullptr);
+            layer->get_renderable_component()->set_quad_data(nullptr, 0, false);
         }
 
+        // Work out if we need a dense or a sparse buffer
+        const std::vector<uint8_t> &tileset_indices(layer->get_tileset_indices());
+        int total_tiles(int(tileset_indices.size()));
+        int num_blank_tiles(int(std::count(tileset_indices.begin(), tileset_indices.end(), uint8_t(0))));
+
         // Spare packing by default
         auto layer_packing(Layer::Packing::SPARSE);
 
@@ -235,239 +229,166 @@ void Map::generate_data() {
 
         layer->set_packing(layer_packing);
 
-        // Create the buffer for the layer
-        int num_tiles(layer_packing == Layer::Packing::DENSE ? total_tiles
-                                                             : total_tiles - num_blank_tiles);
-
-        // The number of bytes needed - *6 for the GLTRIANGLES
-        // WTF: num_tile_vertices??
-        size_t tex_data_size (sizeof(GLfloat) * num_tiles * num_tile_vertices * num_tile_dimensions);
-        size_t vert_data_size(sizeof(GLfloat) * num_tiles * num_tile_vertices * num_tile_dimensions);
-        GLfloat* layer_tex_coords(nullptr);
-        GLfloat* layer_vert_coords(nullptr);
-
-        try {
-            layer_tex_coords = new GLfloat[tex_data_size];
-            layer_vert_coords = new GLfloat[vert_data_size];
-        }
-        catch(std::bad_alloc& ba) {
-            LOG(ERROR) << "Out of memory in Map::generate_data";
-            return;
-        }
-
-        // Build the layer data based on the
-        if (layer_packing == Layer::Packing::DENSE) {
-            generate_dense_layer_tex_coords(layer_tex_coords, layer);
-            generate_dense_layer_vert_coords(layer_vert_coords, layer);
-        }
-        else {
-            generate_sparse_layer_tex_coords(layer_tex_coords, layer);
-            generate_sparse_layer_vert_coords(layer_vert_coords, layer);
-
-            //Generate the mappings
-            //ONLY NEEDED FOR SPARSE
-            int x(0);
-            int y(0);
-            int idx(0);
-
-            for(auto tile_data = layer_data->begin(); tile_data != layer_data->end(); ++tile_data) {
-                std::shared_ptr<TileSet> tileset = tile_data->first;
-
-                //Set the index into the buffer
-                buffer_map->insert(std::make_pair(y*map_width + x, idx));
-
-                //Calculate the next index
-                //If we're not looking at a blank tile
-                if(tileset) {
-                    //Calculate the new offset
-                    idx += num_tile_dimensions*num_tile_vertices;
-
-                }
-
-                //ELSE: Offset unchanged
-
-                //Next tile
-                x++;
-
-                //if we're on a new layer
-                if(x >= map_width) {
-                    x = 0;
-                    y++;
-                }
+        // Build each chunk's buffers separately
+        for (int chunk_y = 0; chunk_y < layer->get_num_chunks_y(); ++chunk_y) {
+            for (int chunk_x = 0; chunk_x < layer->get_num_chunks_x(); ++chunk_x) {
+                generate_chunk_data(layer, chunk_x, chunk_y);
             }
         }
-
-        // Set this data in the renderable component for the layer
-        RenderableComponent* renderable_component = layer->get_renderable_component();
-        renderable_component->set_texture_coords_data(layer_tex_coords, tex_data_size, false);
-        renderable_component->set_vertex_data(layer_vert_coords, vert_data_size, false);
-        renderable_component->set_num_vertices_render(num_tiles*num_tile_vertices);
-
-        layer_num++;
     }
 }
 
-void Map::generate_layer_tex_coords(GLfloat* data, std::shared_ptr<Layer> layer, bool dense) {
-    auto layer_data = layer->get_layer_data();
+void Map::generate_chunk_data(std::shared_ptr<Layer> layer, int chunk_x, int chunk_y) {
+    const std::vector<uint8_t>  &tileset_indices(layer->get_tileset_indices());
+    const std::vector<uint16_t> &tile_ids(layer->get_tile_ids());
+    bool dense(layer->get_packing() == Layer::Packing::DENSE);
 
-    //Get all the tiles in the layer, moving from left to right and down
-    int offset(0);
-    const int num_floats(12);
-    for (auto &tile_data : *layer_data) {
-        std::shared_ptr<TileSet> tileset(tile_data.first);
-        int tile_id(tile_data.second);
+    // The tiles covered by this chunk; edge chunks may be smaller
+    int x_begin(chunk_x * Layer::chunk_size);
+    int y_begin(chunk_y * Layer::chunk_size);
+    int x_end(std::min(x_begin + Layer::chunk_size, map_width));
+    int y_end(std::min(y_begin + Layer::chunk_size, map_height));
 
-        //IF WE ARE GENERATING A SPARSE LAYER
-        //Skip out blank tiles:
-        //This get's us our sparse data structure
-        if (!dense && !tileset) {
-            continue;
+    if (int(tileset_indices.size()) < map_width * map_height) {
+        LOG(ERROR) << "Layer had less data than map dimensions in Map::generate_chunk_data";
+        return;
+    }
+
+    // Count the tiles that need geometry
+    int num_used(0);
+    for (int y = y_begin; y < y_end; ++y) {
+        for (int x = x_begin; x < x_end; ++x) {
+            if (tileset_indices[size_t(y * map_width + x)] != 0) {
+                ++num_used;
+            }
         }
+    }
 
-        // If this is a dense layer and the tile is blank, then we don't
-        // actually care about the texture coordinates. Only create data
-        // when we have a tileset.
-        if (tileset) {
-            //Get the texture coordinates for this tile
-            // GLfloat *tileset_ptr = &tileset_tex_coords[(tile_id)*8]; //*8 as 8 coordinates per tile
-            std::tuple<float,float,float,float> coords(tileset->get_atlas()->index_to_coords(tile_id));
+    // Dense chunks have a quad for every tile, sparse chunks have a
+    // quad slot for each tile that is set and some spare slots
+    int chunk_tiles((x_end - x_begin) * (y_end - y_begin));
+    int num_quads(dense ? chunk_tiles : ChunkSlots::capacity_for(num_used, chunk_tiles));
 
-            //bottom left
-            data[offset+0]  = std::get<0>(coords);
-            data[offset+1]  = std::get<2>(coords);
+    PackedQuad* chunk_quads(nullptr);
 
-            //top left
-            data[offset+2]  = std::get<0>(coords);
-            data[offset+3]  = std::get<3>(coords);
+    try {
+        chunk_quads = new PackedQuad[num_quads];
+    }
+    catch(std::bad_alloc& ba) {
+        LOG(ERROR) << "Out of memory in Map::generate_chunk_data";
+        return;
+    }
 
-            //bottom right
-            data[offset+4]  = std::get<1>(coords);
-            data[offset+5]  = std::get<2>(coords);
+    // Blank tiles and free slots are degenerate quads
+    std::fill(chunk_quads, &chunk_quads[num_quads], PackedQuad());
 
-            //top left
-            data[offset+6]  = std::get<0>(coords);
-            data[offset+7]  = std::get<3>(coords);
+    ChunkSlots &slots(layer->get_chunk_slots(chunk_x, chunk_y));
+    if (!dense) {
+        slots.reset(num_quads);
+    }
 
-            //top right
-            data[offset+8]  = std::get<1>(coords);
-            data[offset+9]  = std::get<3>(coords);
+    int tile_index(0);
+    for (int y = y_begin; y < y_end; ++y) {
+        for (int x = x_begin; x < x_end; ++x, ++tile_index) {
+            size_t index(size_t(y * map_width + x));
+            if (tileset_indices[index] == 0) {
+                continue;
+            }
 
-            //bottom right
-            data[offset+10] = std::get<1>(coords);
-            data[offset+11] = std::get<2>(coords);
+            PackedQuad &quad(chunk_quads[dense ? tile_index : slots.acquire(tile_index)]);
+            generate_tile_tex_coords(quad, (*tilesets)[tileset_indices[index] - 1u], tile_ids[index]);
+            generate_tile_vert_coords(quad, x - x_begin, y - y_begin);
         }
-
-        offset += num_floats;
     }
-}
-
-void Map::generate_sparse_layer_tex_coords(GLfloat* data, std::shared_ptr<Layer> layer) {
-    generate_layer_tex_coords(data, layer, false);
-}
 
+    // Set this data in the renderable component for the chunk
+    RenderableComponent* renderable_component(layer->get_chunk_renderable_component(chunk_x, chunk_y));
+    renderable_component->set_quad_data(chunk_quads, num_quads, false);
 
-void Map::generate_dense_layer_tex_coords(GLfloat* data, std::shared_ptr<Layer> layer) {
-    generate_layer_tex_coords(data, layer, true);
+    bump_chunk_version(x_begin, y_begin);
 }
 
-void Map::generate_layer_vert_coords(GLfloat* data, std::shared_ptr<Layer> layer, bool dense) {
-    LOG(INFO) << "Generating map coordinate data";
-
-    int num_floats(12);
-    int offset(0);
-    ///
-    /// Vertex winding order:
-    /// 1, 3   4
-    ///  * --- *
-    ///  |     |
-    ///  |     |
-    ///  * --- *
-    /// 0       2,5
-    ///
+void Map::generate_tile_tex_coords(PackedQuad &quad, const std::shared_ptr<TileSet> &tileset, int tile_id) {
+    //Get the texture coordinates for this tile
+    quad.set_tex_coords(tileset->get_atlas()->index_to_coords(tile_id));
+}
 
-    // The current tile's data
-    auto tile_data = layer->get_layer_data()->begin();
+void Map::generate_tile_index_texture(std::shared_ptr<Layer> layer) {
+    const std::vector<uint8_t>  &tileset_indices(layer->get_tileset_indices());
+    const std::vector<uint16_t> &tile_ids(layer->get_tile_ids());
+    int width(layer->get_width_tiles());
+    int height(layer->get_height_tiles());
 
-    // Generate one layer's worth of data
-    for (int y = 0; y < map_height; y++) {
-        for (int x = 0; x < map_width; x++) {
-            // If we exhaust the layer's data
-            if (tile_data == layer->get_layer_data()->end()) {
-                LOG(ERROR) << "Layer had less data than map dimensions in Map::generate_layer_vert_coords";
-                return;
-            }
+    if (int(tileset_indices.size()) < width * height) {
+        LOG(ERROR) << "Layer had less data than map dimensions in Map::generate_tile_index_texture";
+        return;
+    }
 
-            std::shared_ptr<TileSet> tileset(tile_data->first);
-            // int tile_id(tile_data->second);
+    std::unique_ptr<TileIndexTexture> texture(new TileIndexTexture(width, height));
 
-            // IF GENERATING A SPARSE LAYER
-            // Skip empty tiles
-            if (!dense && !tileset) {
-                ++tile_data;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            size_t index(size_t(y * width + x));
+            if (tileset_indices[index] == 0) {
                 continue;
             }
 
-            // Default to invisible.
-            float vx1(-1.0f), vy1(-1.0f);
-            float vx2(-1.0f), vy2(-1.0f);
-
-            if (tileset) {
-                // The tile is not blank, so set its x, y.
-                vx1 = float(x);
-                vy1 = float(y);
-                vx2 = float(x + 1.001);
-                vy2 = float(y + 1.001);
-            } else if (dense) {
-                LOG(INFO) << x << ", " << y;
-            }
-
-            //bottom left
-            data[offset + 0] = vx1;
-            data[offset + 1] = vy1;
-
-            //top left
-            data[offset + 2] = vx1;
-            data[offset + 3] = vy2;
-
-            //bottom right
-            data[offset + 4] = vx2;
-            data[offset + 5] = vy1;
+            std::shared_ptr<TileSet> tileset((*tilesets)[tileset_indices[index] - 1u]);
+            texture->set_tile(x, y, tileset->get_atlas()->index_to_coords(tile_ids[index]));
+        }
+    }
 
-            //top left
-            data[offset + 6] = vx1;
-            data[offset + 7] = vy2;
+    texture->upload();
+    layer->set_tile_index_texture(std::move(texture));
 
-            //top right
-            data[offset + 8] = vx2;
-            data[offset + 9] = vy2;
+    // The chunks' geometry isn't drawn, so free it
+    for (int chunk_y = 0; chunk_y < layer->get_num_chunks_y(); ++chunk_y) {
+        for (int chunk_x = 0; chunk_x < layer->get_num_chunks_x(); ++chunk_x) {
+            layer->get_chunk_renderable_component(chunk_x, chunk_y)->set_quad_data(nullptr, 0, false);
+        }
+    }
 
-            //bottom right
-            data[offset + 10] = vx2;
-            data[offset + 11] = vy1;
+    // One quad covers the whole layer, positioned in whole tiles so
+    // that the shader can find the tile under each fragment
+    PackedQuad* layer_quad(nullptr);
 
-            offset += num_floats;
-            ++tile_data;
-        }
+    try {
+        layer_quad = new PackedQuad[1];
+    }
+    catch(std::bad_alloc& ba) {
+        LOG(ERROR) << "Out of memory in Map::generate_tile_index_texture";
+        return;
     }
-}
 
-void Map::generate_dense_layer_vert_coords(GLfloat* data, std::shared_ptr<Layer> layer) {
-    generate_layer_vert_coords(data, layer, true);
+    layer_quad[0].set_position(0, 0, GLshort(width), GLshort(height));
+    layer_quad[0].set_tex_coords(std::make_tuple(0.0f, 1.0f, 0.0f, 1.0f));
+    layer->get_renderable_component()->set_quad_data(layer_quad, 1, false);
 }
 
-void Map::generate_sparse_layer_vert_coords(GLfloat* data, std::shared_ptr<Layer> layer) {
-    generate_layer_vert_coords(data, layer, false);
+void Map::generate_tile_vert_coords(PackedQuad &quad, int x, int y) {
+    // Positions are relative to the chunk, so that there is room for
+    // the quads to overlap their neighbours slightly, hiding seams
+    GLshort vx1(GLshort(x * PackedVertex::tile_units));
+    GLshort vy1(GLshort(y * PackedVertex::tile_units));
+    GLshort vx2(GLshort((x + 1) * PackedVertex::tile_units + 1));
+    GLshort vy2(GLshort((y + 1) * PackedVertex::tile_units + 1));
+
+    quad.set_position(vx1, vy1, vx2, vy2);
 }
 
 void Map::init_textures() {
-    // texture_atlases[0] = TextureAtlas::get_shared("../resources/basictiles_2.png");
-
     // WTF is going on?
     // Set the texture data in the rederable component for each layer
     for (int layer_id : layer_ids) {
         std::shared_ptr<Layer> layer = ObjectManager::get_instance().get_object<Layer>(layer_id);
         // layer->get_renderable_component()->set_texture((*layer->get_layer_data())[0].first->get_atlas());
-        layer->get_renderable_component()->set_texture(tilesets[0]->get_atlas());
+        layer->get_renderable_component()->set_texture((*tilesets)[0]->get_atlas());
+
+        for (int chunk_y = 0; chunk_y < layer->get_num_chunks_y(); ++chunk_y) {
+            for (int chunk_x = 0; chunk_x < layer->get_num_chunks_x(); ++chunk_x) {
+                layer->get_chunk_renderable_component(chunk_x, chunk_y)->set_texture((*tilesets)[0]->get_atlas());
+            }
+        }
     }
 }
 
@@ -488,305 +409,229 @@ bool Map::init_shaders() {
     for (int layer_id : layer_ids) {
         std::shared_ptr<Layer> layer = ObjectManager::get_instance().get_object<Layer>(layer_id);
         layer->get_renderable_component()->set_shader(shader);
+
+        for (int chunk_y = 0; chunk_y < layer->get_num_chunks_y(); ++chunk_y) {
+            for (int chunk_x = 0; chunk_x < layer->get_num_chunks_x(); ++chunk_x) {
+                layer->get_chunk_renderable_component(chunk_x, chunk_y)->set_shader(shader);
+            }
+        }
     }
 
     return true;
 }
 
-Map::Blocker::Blocker(glm::ivec2 tile, std::vector <std::vector<int>>* blocker):
-    tile(tile), blocker(blocker) {
-        (*blocker)[tile.x][tile.y]++;
-
-        VLOG(2) << "Block level at tile " << tile.x << " " <<tile.y
-                << " increased from " << (*blocker)[tile.x][tile.y] - 1
-                << " to " << (*blocker)[tile.x][tile.y] << ".";
+Map::Blocker::Blocker(glm::ivec2 tile, WalkabilityGrid* walkability_grid):
+    tile(tile), walkability_grid(walkability_grid) {
+        walkability_grid->block(tile.x, tile.y);
 }
 
 Map::Blocker::Blocker(const Map::Blocker &other):
-    tile(other.tile), blocker(other.blocker) {
-        (*blocker)[tile.x][tile.y]++;
-
-        VLOG(2) << "Block level at tile " << tile.x << " " <<tile.y
-                << " increased from " << (*blocker)[tile.x][tile.y] - 1
-                << " to " << (*blocker)[tile.x][tile.y] << ".";
+    tile(other.tile), walkability_grid(other.walkability_grid) {
+        walkability_grid->block(tile.x, tile.y);
 }
 
 Map::Blocker::~Blocker() {
     VLOG(2) << "Unblocking tile at " << tile.x << ", " << tile.y << ".";
 
-    blocker->at(tile.x).at(tile.y) -= 1;
-
-    VLOG(2) << "Block level at tile " << tile.x << " " <<tile.y
-            << " decreased from " << (*blocker)[tile.x][tile.y] + 1
-            << " to " << (*blocker)[tile.x][tile.y] << ".";
+    walkability_grid->unblock(tile.x, tile.y);
 }
 
 Map::Blocker Map::block_tile(glm::ivec2 tile) {
-    return Blocker(tile, &blocker);
+    return Blocker(tile, &walkability_grid);
 }
 
-bool Map::recalculate_layer_mappings(int x_pos, int y_pos, int layer_num) {
-    if (y_pos < 0 || x_pos < 0) {
-        return false;
-    }
-
-    auto layer(layer_mappings[layer_num]);
-    int index(y_pos * map_width + x_pos);
-    int size(int(layer->size()));
-
-    // Handle last element and those outside of range
-    // Note: index ≥ 0 by y_pos, map_width, x_pos > 0
-    if (index + 1 >= size) {
-        return false;
-    }
-
-    // Do we need to increment mappings?
-    // Compare offsets
-    if ((*layer)[index + 1] == (*layer)[index]) {
-        // The next element is the same so we need to increment
-        // further offsets.
-
-        // Shift all of the offsets down as we're putting a tile into
-        // this position
-        for (auto i = index + 1; i < size; i++) {
-            (*layer)[i] += num_tile_dimensions * num_tile_vertices;;
+void Map::generate_tile_names() {
+    for (size_t i = 0; i < tilesets->size(); ++i) {
+        for (auto &name : (*tilesets)[i]->get_atlas()->get_names_to_indexes()) {
+            // Earlier tilesets take precedence
+            tile_names.insert(std::make_pair(name.first, std::make_pair(int(i), name.second)));
         }
-
-        return false;
-    }
-    else {
-        // There is already a tile here, so don't mutate
-
-        // You can directly insert the tile
-        return true;
     }
 }
 
-void Map::update_tile(int x_pos, int y_pos, const std::string layer_name, const std::string tile_name) {
-    int tile_id = -1;
-    std::shared_ptr<TileSet> tileset;
-    for (std::shared_ptr<TileSet> tileset_i : tilesets) {
-        try {
-            tile_id = tileset_i->get_atlas()->get_name_index(tile_name);
-            tileset = tileset_i;
-            break;
-        } catch (std::exception) {
-            continue;
-        }
-    }
-    if (tile_id == -1) {
-        // Tile not found.
-        throw std::runtime_error("Tile not found: " + tile_name);
-    }
-
-    // Build the data for the update
-    GLfloat *data;
-    size_t data_size(sizeof(GLfloat) * num_tile_dimensions * num_tile_vertices);
-
-    // Get a buffer for the data
-    try {
-        data = new GLfloat[data_size];
-    }
-    catch(std::bad_alloc& ba) {
-        LOG(ERROR) << "Couldn't allocate memory in Map::update_tile";
-        return;
+std::shared_ptr<Layer> Map::find_layer(const std::string layer_name) {
+    auto layer_id(layer_ids_by_name.find(layer_name));
+    if (layer_id == std::end(layer_ids_by_name)) {
+        throw std::runtime_error("Layer not found: " + layer_name);
     }
 
-    // Get the texture coordinates for this tile
-    // GLfloat *tileset_ptr = &tileset_tex_coords[(tile_id)*8]; //*8 as 8 coordinates per tile
-    std::tuple<float,float,float,float> coords(tileset->get_atlas()->index_to_coords(tile_id));
-
-    //bottom left
-    data[0]  = std::get<0>(coords);
-    data[1]  = std::get<2>(coords);
+    return ObjectManager::get_instance().get_object<Layer>(layer_id->second);
+}
 
-    //top left
-    data[2]  = std::get<0>(coords);
-    data[3]  = std::get<3>(coords);
+void Map::update_tile(int x_pos, int y_pos, const std::string layer_name, const std::string tile_name) {
+    update_tiles(layer_name, {std::make_pair(glm::ivec2(x_pos, y_pos), tile_name)});
+}
 
-    //bottom right
-    data[4]  = std::get<1>(coords);
-    data[5]  = std::get<2>(coords);
+void Map::update_tiles(const std::string layer_name, const std::vector<std::pair<glm::ivec2, std::string>> &tiles) {
+    std::shared_ptr<Layer> layer(find_layer(layer_name));
 
-    //top left
-    data[6]  = std::get<0>(coords);
-    data[7]  = std::get<3>(coords);
+    // Check all the positions and resolve all the names first, so that
+    // a bad one changes nothing
+    check_tile_positions(layer->get_width_tiles(), layer->get_height_tiles(), tiles);
 
-    //top right
-    data[8]  = std::get<1>(coords);
-    data[9]  = std::get<3>(coords);
+    std::vector<std::pair<std::shared_ptr<TileSet>, int>> resolved;
+    resolved.reserve(tiles.size());
 
-    //bottom right
-    data[10] = std::get<1>(coords);
-    data[11] = std::get<2>(coords);
+    for (auto &tile : tiles) {
+        // An empty name clears the tile
+        if (tile.second.empty()) {
+            resolved.push_back(std::make_pair(std::shared_ptr<TileSet>(), 0));
+            continue;
+        }
 
+        auto tile_name(tile_names.find(tile.second));
+        if (tile_name == std::end(tile_names)) {
+            throw std::runtime_error("Tile not found: " + tile.second);
+        }
 
-    // Find the layer from the layer name name.
-    std::shared_ptr<Layer> layer;
-    int layer_num;
-    for (unsigned int i = 0; i < layer_ids.size(); i++) {
-        std::shared_ptr<Layer> layer_test(ObjectManager::get_instance().get_object<Layer>(layer_ids[i]));
-        if (layer_test->get_name() == layer_name) {
-            layer = layer_test;
-            layer_num = i;
-            break;
+        if (tile_name->second.second < 0 || tile_name->second.second > UINT16_MAX) {
+            throw std::runtime_error("Tile id out of range: " + tile.second);
         }
+
+        resolved.push_back(std::make_pair((*tilesets)[size_t(tile_name->second.first)], tile_name->second.second));
     }
 
-    if (!layer) {
-        throw std::runtime_error("Layer not found: " + layer_name);
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        set_tile(layer, tiles[i].first.x, tiles[i].first.y, resolved[i].first, resolved[i].second);
     }
+    FrameDamage::mark_dirty();
+}
 
-    // Put it into the buffers
+void Map::check_tile_positions(int width_tiles, int height_tiles,
+                               const std::vector<std::pair<glm::ivec2, std::string>> &tiles) {
+    for (auto &tile : tiles) {
+        const glm::ivec2 &position(tile.first);
 
-    Layer::Packing packing(layer->get_packing());
+        if (position.x < 0 || position.x >= width_tiles || position.y < 0 || position.y >= height_tiles) {
+            throw std::runtime_error("Tile position out of range: ("
+                                     + std::to_string(position.x) + ", " + std::to_string(position.y) + ")");
+        }
+    }
+}
 
+void Map::set_tile(std::shared_ptr<Layer> layer, int x_pos, int y_pos, std::shared_ptr<TileSet> tileset, int tile_id) {
     // Add this tile to the layer data structure
     layer->update_tile(x_pos, y_pos, tile_id, tileset);
 
-    int tile_offset;
-
-    // Perform O(1) update. no need to do mapping changes
-    if (packing == Layer::Packing::DENSE) {
-        tile_offset = y_pos * map_width + x_pos;
-
-        // Update the buffer
-        // Just update that tile directly
-        RenderableComponent *renderable_component(layer->get_renderable_component());
-        renderable_component->update_texture_buffer(
-            sizeof(GLfloat) * tile_offset * num_tile_vertices * num_tile_dimensions,
-            data_size,
-            data
-        );
+    // The collisions layer has no geometry, only walkability
+    if (layer->get_name() == "Collisions") {
+        walkability_grid.set_collision(x_pos, y_pos, tile_id != 0);
+        return;
     }
-    else {
-        // TODO: create a small buffer to hold these updates rather than rebuilding the entire buffer
 
-        // Generate the new tile's data
-        GLfloat* vertex_data = nullptr;
+    bump_chunk_version(x_pos, y_pos);
 
-        // Get a buffer for the data
-        try {
-            vertex_data = new GLfloat[data_size];
+    // With the tilemap shader only the tile's texel changes
+    TileIndexTexture *tile_index_texture(layer->get_tile_index_texture());
+    if (tile_index_texture) {
+        if (tileset) {
+            tile_index_texture->set_tile(x_pos, y_pos, tileset->get_atlas()->index_to_coords(tile_id));
         }
-        catch(std::bad_alloc& ba) {
-            LOG(ERROR) << "Couldn't allocate memory in Map::update_tile";
-            data = nullptr;
-            return;
+        else {
+            tile_index_texture->clear_tile(x_pos, y_pos);
         }
 
-        // Set the needed data
-
-        // bottom left
-        vertex_data[0]  = float(x_pos);
-        vertex_data[1]  = float(y_pos);
-
-        // top left
-        vertex_data[2]  = float(x_pos);
-        vertex_data[3]  = float(y_pos + 1);
-
-        // bottom right
-        vertex_data[4]  = float(x_pos + 1);
-        vertex_data[5]  = float(y_pos);
+        tile_index_texture->upload_tile(x_pos, y_pos);
+        return;
+    }
 
-        // top left
-        vertex_data[6]  = float(x_pos);
-        vertex_data[7]  = float(y_pos + 1);
+    // Only the chunk that owns the tile needs to change
+    int chunk_x(x_pos / Layer::chunk_size);
+    int chunk_y(y_pos / Layer::chunk_size);
+    RenderableComponent *renderable_component(layer->get_chunk_renderable_component(chunk_x, chunk_y));
 
-        // top right
-        vertex_data[8]  = float(x_pos + 1);
-        vertex_data[9]  = float(y_pos + 1);
+    // The tile's quad in the chunk
+    int quad(layer->get_tile_quad(x_pos, y_pos));
 
-        // bottom right
-        vertex_data[10] = float(x_pos + 1);
-        vertex_data[11] = float(y_pos);
+    if (layer->get_packing() == Layer::Packing::SPARSE) {
+        ChunkSlots &slots(layer->get_chunk_slots(chunk_x, chunk_y));
+        int tile_index(layer->get_chunk_tile_index(x_pos, y_pos));
 
-        // Fetch the offset from the data buffer
-        // Tile offset in floats
-        int offset((*layer_mappings[layer_num])[y_pos*map_width + x_pos]);
+        if (!tileset) {
+            // Free the tile's slot, if it has one
+            quad = slots.release(tile_index);
+        }
+        else if (quad == -1) {
+            int slot(slots.acquire(tile_index));
 
-        // Recalculate the layer mappings
-        bool overwrite(recalculate_layer_mappings(x_pos, y_pos, layer_num));
+            if (slot == -1) {
+                // The chunk is full: rebuild it with more spare slots.
+                // As the capacity grows geometrically this is rare.
+                generate_chunk_data(layer, chunk_x, chunk_y);
+                return;
+            }
 
-        // TODO: small buffer
-        // Get the data
-        RenderableComponent* layer_renderable_component(layer->get_renderable_component());
+            quad = slot;
+        }
 
-        GLfloat* layer_texture_data(layer_renderable_component->get_texture_coords_data());
-        GLfloat* layer_vertex_data (layer_renderable_component->get_vertex_data());
+        // Nothing to do when clearing a tile that has no quad
+        if (quad < 0) {
+            return;
+        }
+    }
 
-        size_t texture_data_size(layer_renderable_component->get_texture_coords_data_size());
-        size_t vertex_data_size (layer_renderable_component->get_vertex_data_size());
+    // Queue the chunk for upload the first time it changes this frame
+    if (!renderable_component->has_dirty_data()) {
+        dirty_chunks.push_back(renderable_component);
+    }
 
-        if (overwrite) {
-            // We just need to overwrite the tile
-            // Update the buffer
-            // Just update that tile directly
-            layer_renderable_component->update_texture_buffer(offset*sizeof(GLfloat), data_size, data);
-        }
-        else {
-            // We need to insert the tile: expand the buffers
+    // Write just this tile's quad; cleared tiles become degenerate
+    PackedQuad data = PackedQuad();
+    if (tileset) {
+        generate_tile_vert_coords(data, x_pos - chunk_x * Layer::chunk_size, y_pos - chunk_y * Layer::chunk_size);
+        generate_tile_tex_coords(data, tileset, tile_id);
+    }
 
-            //Generate the new buffers
-            GLfloat *new_texture_data;
-            GLfloat *new_vertex_data;
-            int new_texture_data_size(int(texture_data_size + data_size));
-            int new_vertex_data_size (int( vertex_data_size + data_size));
+    renderable_component->update_quad_data(quad, data);
+}
 
-            try {
-                new_texture_data = new GLfloat[new_texture_data_size];
-                new_vertex_data  = new GLfloat[new_vertex_data_size];
-            }
-            catch(std::bad_alloc& ba) {
-                LOG(ERROR) << "Couldn't allocate memory for new texture and vertex buffers in Map::update_tile";
-                return;
-            }
+void Map::bump_chunk_version(int x_pos, int y_pos) {
+    ++chunk_versions.at(size_t((y_pos / Layer::chunk_size) * get_num_chunks_x() + x_pos / Layer::chunk_size));
+}
 
-            //Copy the first part of the original data
-            int data_length(num_tile_vertices * num_tile_dimensions);
-            std::copy(layer_vertex_data, &layer_vertex_data[offset], new_vertex_data);
-            std::copy(layer_texture_data, &layer_texture_data[offset], new_texture_data);
+int Map::get_num_chunks_x() {
+    return (map_width + Layer::chunk_size - 1) / Layer::chunk_size;
+}
 
-            //Insert the new data into the correct position
-            std::copy(vertex_data, &vertex_data[data_length], &new_vertex_data[offset]);
-            std::copy(data, &data[data_length], &new_texture_data[offset]);
+int Map::get_num_chunks_y() {
+    return (map_height + Layer::chunk_size - 1) / Layer::chunk_size;
+}
 
-            //Copy the rest of the original data
-            std::copy(&layer_vertex_data[offset], &layer_vertex_data[vertex_data_size], &new_vertex_data[offset + data_length]);
-            std::copy(&layer_texture_data[offset], &layer_texture_data[texture_data_size], &new_texture_data[offset + data_length]);
+unsigned int Map::get_chunk_version(int chunk_x, int chunk_y) {
+    return chunk_versions.at(size_t(chunk_y * get_num_chunks_x() + chunk_x));
+}
 
-            //Set the new data
-            layer_renderable_component->set_vertex_data(new_vertex_data, new_vertex_data_size, false);
-            layer_renderable_component->set_num_vertices_render(new_texture_data_size / (int(sizeof(GLfloat)) * num_tile_dimensions));
-            layer_renderable_component->set_texture_coords_data(new_texture_data, new_texture_data_size, false);
-        }
-        delete[] vertex_data;
+void Map::flush_tile_updates() {
+    for (RenderableComponent *renderable_component : dirty_chunks) {
+        renderable_component->upload_dirty_data();
     }
-    delete[] data;
+
+    dirty_chunks.clear();
 }
 
-std::string Map::query_tile(int x_pos, int y_pos, const std::string layer_name) {
-    std::shared_ptr<Layer> layer;
-    for (unsigned int i = 0; i < layer_ids.size(); i++) {
-        std::shared_ptr<Layer> layer_test(ObjectManager::get_instance().get_object<Layer>(layer_ids[i]));
-        if (layer_test->get_name() == layer_name) {
-            layer = layer_test;
-        }
+void Map::set_gpu_tilemap(bool enabled) {
+    if (enabled == gpu_tilemap) {
+        return;
     }
 
-    if (!layer) {
-        throw std::runtime_error("Layer not found: " + layer_name);
-    }
+    LOG(INFO) << (enabled ? "Drawing the map with the tilemap shader" : "Drawing the map from tile geometry");
+    gpu_tilemap = enabled;
 
+    // Pending chunk changes are superseded by the regenerated data
+    dirty_chunks.clear();
+    generate_data();
+}
+
+std::string Map::query_tile(int x_pos, int y_pos, const std::string layer_name) {
+    std::shared_ptr<Layer> layer(find_layer(layer_name));
     std::pair<std::shared_ptr<TileSet>, int> tile = layer->get_tile(x_pos, y_pos);
 
     return tile.first ? tile.first->get_atlas()->get_index_name(tile.second) : "";
 }
 
-int Map::get_tile_texture_vbo_offset(int layer_num, int x_pos, int y_pos) {
-     // Fetch the offset from the data buffer
-     int tile_offset((*layer_mappings[layer_num])[y_pos*map_width + x_pos]);
+int Map::get_tile_quad(int layer_num, int x_pos, int y_pos) {
+    std::shared_ptr<Layer> layer(ObjectManager::get_instance().get_object<Layer>(layer_ids.at(size_t(layer_num))));
 
-     // The VBO offset is the tile offset times the dimenions and number of vertices
-     return tile_offset * num_tile_vertices * num_tile_dimensions;
+    // The quad is within the VBO of the chunk owning the tile
+    return layer->get_tile_quad(x_pos, y_pos);
 }
@@ -4,6 +4,8 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 //Include GLM
@@ -26,35 +28,26 @@
 #include "dispatcher.hpp"
 #include "fml.hpp"
 #include "map_loader.hpp"
+#include "spatial_index.hpp"
+#include "walkability_grid.hpp"
 
 class Layer;
-class TextureAtlas;
+struct PackedQuad;
+class RenderableComponent;
 class TileSet;
 
 class Map {
     ///
-    /// Vector of tilesets
+    /// Table of tilesets. The layers refer to tilesets by their index
+    /// in this table.
     ///
-    std::vector<std::shared_ptr<TileSet>> tilesets;
+    std::shared_ptr<std::vector<std::shared_ptr<TileSet>>> tilesets;
 
     ///
     /// Array of layers. Layers are objects so they have ids
     ///
     std::vector<int> layer_ids;
 
-    ///
-    /// A vector of layers which maps the (x, y) position in the map
-    /// onto the offset in the buffer. The offsets are based off of
-    /// the number of vertices and the number of dimensions. It gives
-    /// the GLfloat offset.
-    ///.This allows us to update the buffers to change the map.
-    /// First param: layer number, starts at 0
-    /// Second param: Map of (x, y) positions, flattened to a single
-    ///               number, this is x+ y*map_width, which maps these
-    ///               locations to their offset in the vertex and texture
-    ///
-    std::map<int, std::shared_ptr<std::map<int, int>>> layer_mappings;
-
     ///
     /// The ids of the map objects that are on this map
     ///
@@ -66,125 +59,126 @@ class Map {
     std::vector<int> sprite_ids;
 
     ///
-    /// Cache of the tileset texture data for this Map
+    /// The positions of the map objects on this map
     ///
-    GLfloat* tileset_tex_coords = nullptr;
+    SpatialIndex map_object_index;
 
     ///
-    /// This is the height of the map in tiles
+    /// The positions of the sprites on this map
     ///
-    int map_height;
+    SpatialIndex sprite_index;
 
     ///
-    /// The width of the map in tiles
+    /// The ids of the layers, by name
     ///
-    int map_width;
+    std::map<std::string, int> layer_ids_by_name;
 
     ///
-    /// The texture atlases which store the map tile textures
+    /// Every tile name the map's tilesets know, mapped to the tile's
+    /// index in the tileset table and its id in that tileset. Where
+    /// tilesets share a name, the first tileset's tile is used.
     ///
-    std::shared_ptr<TextureAtlas> texture_atlases[1];
+    std::unordered_map<std::string, std::pair<int, int>> tile_names;
 
     ///
-    /// The number of dimensions in the vertex and texture buffers for a tile: (x, y) here
+    /// The chunks with tile changes which haven't been uploaded yet
     ///
-    int num_tile_dimensions = 2;
+    std::vector<RenderableComponent *> dirty_chunks;
 
     ///
-    /// The number of vertices for a tile
+    /// A version for each chunk, bumped whenever a tile drawn in it
+    /// changes, so that copies of how it looks can tell when they are
+    /// out of date
     ///
-    int num_tile_vertices = 6;
+    std::vector<unsigned int> chunk_versions;
 
     ///
-    /// The function used to generate the cache of tile texture coordinates.
+    /// Bump the version of the chunk holding a tile
     ///
-    void generate_tileset_coords(std::shared_ptr<TextureAtlas> texture);
+    void bump_chunk_version(int x_pos, int y_pos);
 
     ///
-    /// Generate the map's texture and vertex data
+    /// Whether the layers are drawn from tile index textures by the
+    /// tilemap shader, rather than from their chunks' geometry
     ///
-    void generate_data();
+    bool gpu_tilemap = false;
 
     ///
-    /// Generates a layer's texture coordinates. Handles generating the
-    /// data if the layers are sparse or dense. A dense layer is one
-    /// with more tiles that are non-empty than empty ones.
+    /// This is the height of the map in tiles
+    ///
+    int map_height;
+
+    ///
+    /// The width of the map in tiles
+    ///
+    int map_width;
+
     ///
-    /// @data the array to put the data
-    /// @data_size the size of he array in bytes
-    /// @num_tiles the number of tiles to generate data for
-    /// @layer the layer to generate the texture coordinates for
-    /// @dense if the layer is dense or sparse
+    /// Generate the map's texture and vertex data
     ///
-    void generate_layer_tex_coords(GLfloat* data, std::shared_ptr<Layer> layer, bool dense=true);
+    void generate_data();
 
     ///
-    /// Generates a layer's vertex coordinates. Handles generating the
-    /// data if the layers are sparse or dense. A dense layer is one
-    /// with more tiles that are non-empty than empty ones.
+    /// Generates the texture and vertex data of one chunk of a layer.
+    /// Dense layers get a quad for every tile in the chunk, blank ones
+    /// being moved out of view; sparse layers get a slot for each tile
+    /// which is set plus some free slots, and have their chunk slots
+    /// rebuilt.
     ///
-    /// @data the array to put the data
-    /// @data_size the size of he array in bytes
-    /// @num_tiles the number of tiles to generate data for
-    /// @layer the layer to generate the texture coordinates for
-    /// @dense if the layer is dense or sparse
+    /// @param layer the layer the chunk belongs to
+    /// @param chunk_x the chunk's x index
+    /// @param chunk_y the chunk's y index
     ///
-    void generate_layer_vert_coords(GLfloat* data, std::shared_ptr<Layer> layer, bool dense=true);
+    void generate_chunk_data(std::shared_ptr<Layer> layer, int chunk_x, int chunk_y);
 
     ///
-    /// Calls genenerate_layer_vert_coords to generate a layer's vertex data
+    /// Generates the tile index texture of a layer, which is drawn as a
+    /// single quad covering the layer. The layer's chunks are emptied.
     ///
-    /// @data the array to put the data
-    /// @data_size the size of he array in bytes
-    /// @num_tiles the number of tiles to generate data for
-    /// @layer the layer to generate the texture coordinates for
-    /// @dense if the layer is dense or sparse
+    /// @param layer the layer to generate the texture for
     ///
-    void generate_dense_layer_vert_coords(GLfloat* data, std::shared_ptr<Layer> layer);
+    void generate_tile_index_texture(std::shared_ptr<Layer> layer);
 
     ///
-    /// Calls generate_layer_tex_coords
+    /// Writes the texture coordinates of a tile's quad.
     ///
-    /// @data the array to put the data
-    /// @data_size the size of he array in bytes
-    /// @num_tiles the number of tiles to generate data for
-    /// @layer the layer to generate the texture coordinates for
-    /// @dense if the layer is dense or sparse
+    /// @param quad the quad to put the data in
+    /// @param tileset the tileset of the tile
+    /// @param tile_id the tile's index in the tileset
     ///
-    void generate_dense_layer_tex_coords(GLfloat* data, std::shared_ptr<Layer> layer);
+    void generate_tile_tex_coords(PackedQuad &quad, const std::shared_ptr<TileSet> &tileset, int tile_id);
 
     ///
-    /// Calls generate_layer_vert_coords
+    /// Writes the vertex coordinates of a tile's quad, relative to
+    /// its chunk.
     ///
-    /// @data the array to put the data
-    /// @data_size the size of he array in bytes
-    /// @num_tiles the number of tiles to generate data for
-    /// @layer the layer to generate the texture coordinates for
-    /// @dense if the layer is dense or sparse
+    /// @param quad the quad to put the data in
+    /// @param x the x position of the tile in its chunk
+    /// @param y the y position of the tile in its chunk
     ///
-    void generate_sparse_layer_vert_coords(GLfloat* data, std::shared_ptr<Layer> layer);
+    void generate_tile_vert_coords(PackedQuad &quad, int x, int y);
 
     ///
-    /// Calls generate_layer_tex_coords
+    /// Fill the table of tile names from the tilesets
+    ///
+    void generate_tile_names();
+
     ///
-    /// @data the array to put the data
-    /// @data_size the size of he array in bytes
-    /// @num_tiles the number of tiles to generate data for
-    /// @layer the layer to generate the texture coordinates for
-    /// @dense if the layer is dense or sparse
+    /// Find a layer by its name.
+    /// Throws std::runtime_error if there is no such layer.
     ///
-    void generate_sparse_layer_tex_coords(GLfloat* data, std::shared_ptr<Layer> layer);
+    std::shared_ptr<Layer> find_layer(const std::string layer_name);
 
     ///
-    /// Used when a tile needs to be added at a point. This function
-    /// will recalculate the layer mappings as needed to ensure future
-    /// updates update the correct buffer locations. Used for sparse maps.
-    /// @param x_pos
-    /// @param y_pos
-    /// @param layer_num the layer
-    /// @return true if the tile can just be overwritten,false if it needs to be inserted
+    /// Change one tile of a layer, updating the CPU copy of its chunk's
+    /// geometry. The chunk is uploaded by flush_tile_updates.
+    /// @param layer the layer to change
+    /// @param x_pos the x position of the tile
+    /// @param y_pos the y position of the tile
+    /// @param tileset the tile's tileset, or nullptr to clear it
+    /// @param tile_id the tile's id in the tileset
     ///
-    bool recalculate_layer_mappings(int x_pos, int y_pos, int layer_num);
+    void set_tile(std::shared_ptr<Layer> layer, int x_pos, int y_pos, std::shared_ptr<TileSet> tileset, int tile_id);
 
     ///
     /// Initialises the textures
@@ -200,7 +194,12 @@ public:
     Dispatcher<int> event_sprite_add;
     PositionDispatcher<int> event_step_on;
     PositionDispatcher<int> event_step_off;
-    std::vector<std::vector<int>> blocker;
+
+    ///
+    /// Which tiles can be walked on, from the collisions layer and the
+    /// blockers placed by objects
+    ///
+    WalkabilityGrid walkability_grid;
 
     Map(const std::string map_src);
     ~Map();
@@ -249,6 +248,24 @@ public:
     ///
     const std::vector<int>& get_map_objects() { return map_object_ids; }
 
+    ///
+    /// Get the index of the positions of the map objects on this map
+    ///
+    const SpatialIndex& get_map_object_index() { return map_object_index; }
+
+    ///
+    /// Get the index of the positions of the sprites on this map
+    ///
+    const SpatialIndex& get_sprite_index() { return sprite_index; }
+
+    ///
+    /// Keep the spatial indexes up to date with an object's position.
+    /// Objects not on this map are ignored.
+    /// @param object_id the id of the map object or sprite
+    /// @param position the object's new position
+    ///
+    void update_object_position(int object_id, glm::vec2 position);
+
     ///
     /// Get the map width
     ///
@@ -260,21 +277,27 @@ public:
     int get_height() { return map_height; }
 
     ///
-    /// Is this location walkable
+    /// Is this location walkable: on the map, not on the collisions
+    /// layer and not blocked by an object
     ///
-    bool is_walkable(int x_pos, int y_pos);
+    bool is_walkable(int x_pos, int y_pos) { return walkability_grid.is_walkable(x_pos, y_pos); }
 
     ///
-    /// TODO: Heidi: Document this class
-    /// Collision detection for generated elements
+    /// Get which tiles are walkable, as is_walkable checks
+    ///
+    const WalkabilityGrid &get_walkability_grid() const { return walkability_grid; }
+
+    ///
+    /// Collision detection for generated elements. A Blocker makes its
+    /// tile unwalkable for as long as it, or any copy of it, exists.
     ///
     class Blocker {
         public:
-            Blocker(glm::ivec2 tile, std::vector <std::vector<int>>* blocker);
+            Blocker(glm::ivec2 tile, WalkabilityGrid* walkability_grid);
             ~Blocker();
             Blocker(const Map::Blocker &other);
             glm::ivec2 tile;
-            std::vector <std::vector<int>>* blocker;
+            WalkabilityGrid* walkability_grid;
     };
 
     Blocker block_tile(glm::ivec2 tile);
@@ -290,10 +313,66 @@ public:
     /// @param x_pos the x position of the tile
     /// @param y_pos the y position of the tile
     /// @param the the y position of the tile
-    /// @param tile_name the global name of the tile
+    /// @param tile_name the global name of the tile, or "" to clear it
     ///
     void update_tile(int x_pos, int y_pos, const std::string layer_name, const std::string tile_name);
 
+    ///
+    /// Update many tiles of a layer at once. The names and positions
+    /// are all checked before any tile changes, so a bad one changes
+    /// nothing.
+    /// Throws std::runtime_error if the layer or a tile isn't found, or
+    /// a position is outside the layer.
+    /// @param layer_name the layer to change
+    /// @param tiles the position of each tile and the global name of
+    ///        its new tile, or "" to clear it
+    ///
+    void update_tiles(const std::string layer_name, const std::vector<std::pair<glm::ivec2, std::string>> &tiles);
+
+    ///
+    /// Check every position of a batch of tile updates is inside a
+    /// layer of the given size.
+    /// Throws std::runtime_error for the first position that isn't.
+    /// @param width_tiles the width of the layer in tiles
+    /// @param height_tiles the height of the layer in tiles
+    /// @param tiles the tile updates, as given to update_tiles
+    ///
+    static void check_tile_positions(int width_tiles, int height_tiles,
+                                     const std::vector<std::pair<glm::ivec2, std::string>> &tiles);
+
+    ///
+    /// Upload the geometry of the chunks changed since the last call,
+    /// one upload per buffer of each changed chunk. Called once per
+    /// frame before the map is drawn.
+    ///
+    void flush_tile_updates();
+
+    ///
+    /// Get the number of chunks across and up the map
+    ///
+    int get_num_chunks_x();
+    int get_num_chunks_y();
+
+    ///
+    /// Get the version of a chunk, which changes whenever a tile drawn in
+    /// it does, in any layer
+    /// @param chunk_x the chunk's x index
+    /// @param chunk_y the chunk's y index
+    ///
+    unsigned int get_chunk_version(int chunk_x, int chunk_y);
+
+    ///
+    /// Get whether the layers are drawn by the tilemap shader
+    ///
+    bool get_gpu_tilemap() { return gpu_tilemap; }
+
+    ///
+    /// Switch between drawing the layers from their chunks' geometry
+    /// and from tile index textures, regenerating the map's data
+    /// @param enabled true to draw from tile index textures
+    ///
+    void set_gpu_tilemap(bool enabled);
+
     ///
     /// Query the tile at a given point in the map.
     /// @param x_pos the x position of the tile.
@@ -304,10 +383,11 @@ public:
 
 
     ///
-    /// Get a tile's texture offset in the VBO
-    /// @return the texture offset in the VBo
+    /// Get a tile's quad in the VBO of the chunk holding it
+    /// @return the index of the quad in the chunk's VBO, or -1 if the
+    /// tile has no geometry
     ///
-    int get_tile_texture_vbo_offset(int layer_num, int x_pos, int y_pos);
+    int get_tile_quad(int layer_num, int x_pos, int y_pos);
 
 };
 
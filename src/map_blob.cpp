@@ -0,0 +1,278 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "map_blob.hpp"
+
+namespace {
+    const char magic[8] = {'P', 'Y', 'L', 'M', 'A', 'P', '\0', '\0'};
+
+    ///
+    /// Reads values in order out of the mapped blob
+    ///
+    class BlobReader {
+        const char *data;
+        size_t size;
+        size_t offset;
+
+        void require(size_t length) {
+            if (length > size - offset) {
+                throw MapBlob::LoadException("Map blob is truncated");
+            }
+        }
+
+    public:
+        BlobReader(const char *data, size_t size): data(data), size(size), offset(0) {}
+
+        template <typename T>
+        T read() {
+            T value;
+            require(sizeof(T));
+            std::memcpy(&value, data + offset, sizeof(T));
+            offset += sizeof(T);
+            return value;
+        }
+
+        std::string read_string() {
+            uint32_t length(read<uint32_t>());
+            require(length);
+            std::string value(data + offset, length);
+            offset += length;
+            return value;
+        }
+
+        ///
+        /// Get an array in place. The writer aligns arrays to their
+        /// element size, and the mapping is page aligned.
+        ///
+        template <typename T>
+        const T *read_array(size_t count) {
+            size_t padding((sizeof(T) - offset % sizeof(T)) % sizeof(T));
+            require(padding);
+            offset += padding;
+
+            // Checked by division, as the length could overflow
+            if (count > (size - offset) / sizeof(T)) {
+                throw MapBlob::LoadException("Map blob is truncated");
+            }
+            const T *array(reinterpret_cast<const T *>(data + offset));
+            offset += sizeof(T) * count;
+            return array;
+        }
+    };
+
+    ///
+    /// Builds up a blob in memory in the same order BlobReader reads it
+    ///
+    class BlobWriter {
+        std::string buffer;
+
+    public:
+        template <typename T>
+        void write(T value) {
+            buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        void write_string(const std::string &value) {
+            write(uint32_t(value.size()));
+            buffer.append(value);
+        }
+
+        template <typename T>
+        void write_array(const T *array, size_t count) {
+            buffer.append((sizeof(T) - buffer.size() % sizeof(T)) % sizeof(T), '\0');
+            buffer.append(reinterpret_cast<const char *>(array), sizeof(T) * count);
+        }
+
+        const std::string &get_buffer() { return buffer; }
+    };
+
+    ///
+    /// Get the modification time and size of a file
+    /// @return false if the file can't be found
+    ///
+    bool stat_file(const std::string &path, int64_t &mtime, int64_t &size) {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            return false;
+        }
+
+        mtime = int64_t(info.st_mtime);
+        size  = int64_t(info.st_size);
+        return true;
+    }
+}
+
+MapBlob::LoadException::LoadException(const std::string &message): std::runtime_error(message) {}
+
+MapBlob::MapBlob(const std::string &path):
+    data(nullptr),
+    size(0),
+    source_mtime(0),
+    source_size(0),
+    map_width(0),
+    map_height(0) {
+
+    int fd(open(path.c_str(), O_RDONLY));
+    if (fd == -1) {
+        throw LoadException("Couldn't open map blob " + path);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        throw LoadException("Couldn't read map blob " + path);
+    }
+
+    size = size_t(info.st_size);
+    void *mapping(mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        throw LoadException("Couldn't map map blob " + path);
+    }
+
+    data = static_cast<const char *>(mapping);
+
+    try {
+        parse();
+    }
+    catch (LoadException &) {
+        munmap(const_cast<char *>(data), size);
+        throw;
+    }
+}
+
+MapBlob::~MapBlob() {
+    munmap(const_cast<char *>(data), size);
+}
+
+void MapBlob::parse() {
+    BlobReader reader(data, size);
+
+    if (std::memcmp(reader.read_array<char>(sizeof(magic)), magic, sizeof(magic)) != 0) {
+        throw LoadException("Not a map blob");
+    }
+
+    if (reader.read<uint32_t>() != version) {
+        throw LoadException("Map blob is of another version");
+    }
+
+    source_mtime = reader.read<int64_t>();
+    source_size  = reader.read<int64_t>();
+    map_width    = reader.read<int32_t>();
+    map_height   = reader.read<int32_t>();
+
+    uint32_t num_tilesets(reader.read<uint32_t>());
+    for (uint32_t i = 0; i < num_tilesets; ++i) {
+        TilesetData tileset;
+        tileset.name   = reader.read_string();
+        tileset.width  = reader.read<int32_t>();
+        tileset.height = reader.read<int32_t>();
+        tileset.atlas  = reader.read_string();
+        tilesets.push_back(tileset);
+    }
+
+    uint32_t num_layers(reader.read<uint32_t>());
+    for (uint32_t i = 0; i < num_layers; ++i) {
+        LayerData layer;
+        layer.name   = reader.read_string();
+        layer.width  = reader.read<int32_t>();
+        layer.height = reader.read<int32_t>();
+
+        if (layer.width < 0 || layer.height < 0) {
+            throw LoadException("Map blob has a layer of negative size");
+        }
+
+        size_t num_tiles(size_t(layer.width) * size_t(layer.height));
+        layer.tileset_indices = reader.read_array<uint8_t>(num_tiles);
+        layer.tile_ids        = reader.read_array<uint16_t>(num_tiles);
+        layers.push_back(layer);
+    }
+
+    uint32_t num_objects(reader.read<uint32_t>());
+    for (uint32_t i = 0; i < num_objects; ++i) {
+        ObjectData object;
+        object.group   = reader.read_string();
+        object.name    = reader.read_string();
+        object.x       = reader.read<int32_t>();
+        object.y       = reader.read<int32_t>();
+        object.tile_id = reader.read<int32_t>();
+        object.atlas   = reader.read_string();
+        objects.push_back(object);
+    }
+}
+
+bool MapBlob::is_fresh_for(const std::string &source) const {
+    int64_t mtime(0);
+    int64_t length(0);
+    if (!stat_file(source, mtime, length)) {
+        return true;
+    }
+
+    return mtime == source_mtime && length == source_size;
+}
+
+void MapBlob::write(const std::string &path,
+                    const std::string &source,
+                    int map_width,
+                    int map_height,
+                    const std::vector<TilesetData> &tilesets,
+                    const std::vector<LayerData> &layers,
+                    const std::vector<ObjectData> &objects) {
+
+    int64_t mtime(0);
+    int64_t length(0);
+    if (!stat_file(source, mtime, length)) {
+        throw LoadException("Couldn't find map source " + source);
+    }
+
+    BlobWriter writer;
+    writer.write_array(magic, sizeof(magic));
+    writer.write(version);
+    writer.write(mtime);
+    writer.write(length);
+    writer.write(int32_t(map_width));
+    writer.write(int32_t(map_height));
+
+    writer.write(uint32_t(tilesets.size()));
+    for (auto &tileset : tilesets) {
+        writer.write_string(tileset.name);
+        writer.write(int32_t(tileset.width));
+        writer.write(int32_t(tileset.height));
+        writer.write_string(tileset.atlas);
+    }
+
+    writer.write(uint32_t(layers.size()));
+    for (auto &layer : layers) {
+        size_t num_tiles(size_t(layer.width) * size_t(layer.height));
+        writer.write_string(layer.name);
+        writer.write(int32_t(layer.width));
+        writer.write(int32_t(layer.height));
+        writer.write_array(layer.tileset_indices, num_tiles);
+        writer.write_array(layer.tile_ids, num_tiles);
+    }
+
+    writer.write(uint32_t(objects.size()));
+    for (auto &object : objects) {
+        writer.write_string(object.group);
+        writer.write_string(object.name);
+        writer.write(int32_t(object.x));
+        writer.write(int32_t(object.y));
+        writer.write(int32_t(object.tile_id));
+        writer.write_string(object.atlas);
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(writer.get_buffer().data(), std::streamsize(writer.get_buffer().size()));
+    if (!file) {
+        throw LoadException("Couldn't write map blob " + path);
+    }
+}
@@ -0,0 +1,158 @@
+#ifndef MAP_BLOB_H
+#define MAP_BLOB_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+///
+/// A precompiled map, as written by map_compiler from a TMX file.
+///
+/// The blob holds everything MapLoader otherwise gets by parsing the
+/// TMX XML: the tilesets, each layer's tile grid in the same packed
+/// form Layer stores it, and the objects used for named locations.
+/// It is memory-mapped when loaded, so the layer grids are read
+/// straight out of the file without any decoding.
+///
+/// Blobs are written in the byte order of the machine that compiled
+/// them, and record the size and modification time of the TMX file
+/// they were compiled from so stale blobs can be detected.
+///
+class MapBlob {
+public:
+    ///
+    /// The version of the blob format. Blobs of other versions are
+    /// rejected when loading.
+    ///
+    static const uint32_t version = 1;
+
+    ///
+    /// A tileset used by the map
+    ///
+    struct TilesetData {
+        std::string name;
+        int width;
+        int height;
+        std::string atlas;
+    };
+
+    ///
+    /// A tile layer. The grids are row by row from the bottom left, as
+    /// in Layer. When loaded, they point into the mapped blob.
+    ///
+    struct LayerData {
+        std::string name;
+        int width;
+        int height;
+        ///
+        /// Each tile's index in the tileset table plus one, or 0 for a
+        /// blank tile
+        ///
+        const uint8_t *tileset_indices;
+        ///
+        /// Each tile's id in its tileset
+        ///
+        const uint16_t *tile_ids;
+    };
+
+    ///
+    /// An object from one of the map's object groups
+    ///
+    struct ObjectData {
+        std::string group;
+        std::string name;
+        ///
+        /// The object's position in pixels from the top left, as in TMX
+        ///
+        int x;
+        int y;
+        ///
+        /// The object's tile id within its tileset
+        ///
+        int tile_id;
+        ///
+        /// The atlas of the object's tileset
+        ///
+        std::string atlas;
+    };
+
+    ///
+    /// Represents a failure to load a blob, because it is missing,
+    /// truncated or of another version.
+    ///
+    class LoadException: public std::runtime_error {
+    public:
+        LoadException(const std::string &message);
+    };
+
+private:
+    ///
+    /// The mapped file
+    ///
+    const char *data;
+
+    ///
+    /// The size of the mapped file in bytes
+    ///
+    size_t size;
+
+    int64_t source_mtime;
+    int64_t source_size;
+    int map_width;
+    int map_height;
+    std::vector<TilesetData> tilesets;
+    std::vector<LayerData> layers;
+    std::vector<ObjectData> objects;
+
+    ///
+    /// Parse the mapped file
+    ///
+    void parse();
+
+    MapBlob(const MapBlob &) = delete;
+    MapBlob &operator=(const MapBlob &) = delete;
+
+public:
+    ///
+    /// Map a blob into memory.
+    /// Throws LoadException if it can't be read.
+    /// @param path the blob's path
+    ///
+    MapBlob(const std::string &path);
+    ~MapBlob();
+
+    ///
+    /// Get the path of the blob compiled from a TMX file
+    ///
+    static std::string path_for(const std::string &source) { return source + ".pmap"; }
+
+    ///
+    /// Check the blob was compiled from the current version of a TMX
+    /// file. If the TMX file is missing, the blob is used as is.
+    ///
+    bool is_fresh_for(const std::string &source) const;
+
+    ///
+    /// Write a blob.
+    /// Throws LoadException if it can't be written.
+    /// @param path the path of the blob
+    /// @param source the path of the TMX file it was compiled from
+    ///
+    static void write(const std::string &path,
+                      const std::string &source,
+                      int map_width,
+                      int map_height,
+                      const std::vector<TilesetData> &tilesets,
+                      const std::vector<LayerData> &layers,
+                      const std::vector<ObjectData> &objects);
+
+    int get_map_width() const { return map_width; }
+    int get_map_height() const { return map_height; }
+    const std::vector<TilesetData> &get_tilesets() const { return tilesets; }
+    const std::vector<LayerData> &get_layers() const { return layers; }
+    const std::vector<ObjectData> &get_objects() const { return objects; }
+};
+
+#endif
@@ -0,0 +1,134 @@
+///
+/// Offline map compiler.
+///
+/// Converts TMX maps into the blobs read by MapBlob, so that loading a
+/// challenge doesn't have to parse XML and decompress layer data:
+///
+///     map_compiler.bin map.tmx [more.tmx ...]
+///
+/// writes map.tmx.pmap next to each map. Run by "make maps".
+///
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <Tmx.h>
+#include <vector>
+
+#include "map_blob.hpp"
+
+static bool compile_map(const std::string &source) {
+    Tmx::Map map;
+    map.ParseFile(source);
+
+    if (map.HasError()) {
+        std::cerr << source << ": " << map.GetErrorCode() << " " << map.GetErrorText() << std::endl;
+        return false;
+    }
+
+    std::vector<MapBlob::TilesetData> tilesets;
+    for (int i = 0; i < map.GetNumTilesets(); ++i) {
+        const Tmx::Tileset *tileset(map.GetTileset(i));
+        tilesets.push_back({
+            tileset->GetName(),
+            tileset->GetImage()->GetWidth(),
+            tileset->GetImage()->GetHeight(),
+            tileset->GetImage()->GetSource()
+        });
+    }
+
+    // The grids must outlive the layer data pointing at them
+    std::vector<std::vector<uint8_t>>  tileset_indices(size_t(map.GetNumLayers()));
+    std::vector<std::vector<uint16_t>> tile_ids(size_t(map.GetNumLayers()));
+    std::vector<MapBlob::LayerData> layers;
+
+    for (int i = 0; i < map.GetNumLayers(); ++i) {
+        const Tmx::Layer *layer(map.GetLayer(i));
+        int num_tiles_x(layer->GetWidth());
+        int num_tiles_y(layer->GetHeight());
+
+        // As in MapLoader::load_layers: the TMX file has its origin in
+        // the top left, ours is in the bottom left
+        for (int y = num_tiles_y - 1; y >= 0; --y) {
+            for (int x = 0; x < num_tiles_x; ++x) {
+                unsigned tile_id(layer->GetTileId(x, y));
+                int tileset_index(layer->GetTileTilesetIndex(x, y));
+
+                if (tile_id > UINT16_MAX || tileset_index >= UINT8_MAX) {
+                    std::cerr << source << ": tile at " << x << ", " << y
+                              << " in layer " << layer->GetName() << " is out of range" << std::endl;
+                    return false;
+                }
+
+                tileset_indices[size_t(i)].push_back(uint8_t(tileset_index + 1));
+                tile_ids[size_t(i)].push_back(uint16_t(tile_id));
+            }
+        }
+
+        layers.push_back({
+            layer->GetName(),
+            num_tiles_x,
+            num_tiles_y,
+            tileset_indices[size_t(i)].data(),
+            tile_ids[size_t(i)].data()
+        });
+    }
+
+    std::vector<MapBlob::ObjectData> objects;
+    for (int i = 0; i < map.GetNumObjectGroups(); ++i) {
+        const Tmx::ObjectGroup *object_group(map.GetObjectGroup(i));
+
+        for (int j = 0; j < object_group->GetNumObjects(); ++j) {
+            const Tmx::Object *object(object_group->GetObject(j));
+
+            // For all the tilesets, with guaranteed increasing FirstGid values
+            const Tmx::Tileset *tileset(nullptr);
+            for (int k = 0; k < map.GetNumTilesets(); ++k) {
+                // Stop looking if too large
+                if (map.GetTileset(k)->GetFirstGid() > object->GetGid()) { break; }
+
+                // Save if succeeded
+                tileset = map.GetTileset(k);
+            }
+
+            if (!tileset) {
+                std::cerr << source << ": object " << object->GetName() << " has no tileset" << std::endl;
+                return false;
+            }
+
+            objects.push_back({
+                object_group->GetName(),
+                object->GetName(),
+                object->GetX(),
+                object->GetY(),
+                object->GetGid() - tileset->GetFirstGid(),
+                tileset->GetImage()->GetSource()
+            });
+        }
+    }
+
+    try {
+        MapBlob::write(MapBlob::path_for(source), source, map.GetWidth(), map.GetHeight(), tilesets, layers, objects);
+    }
+    catch (MapBlob::LoadException &e) {
+        std::cerr << source << ": " << e.what() << std::endl;
+        return false;
+    }
+
+    std::cout << "Compiled " << source << " to " << MapBlob::path_for(source) << std::endl;
+    return true;
+}
+
+int main(int argc, const char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " map.tmx [more.tmx ...]" << std::endl;
+        return 1;
+    }
+
+    bool success(true);
+    for (int i = 1; i < argc; ++i) {
+        success = compile_map(argv[i]) && success;
+    }
+
+    return success ? 0 : 1;
+}
@@ -7,10 +7,12 @@
 #include <string>
 #include <Tmx.h>
 #include <utility>
+#include <vector>
 
 #include "engine.hpp"
 #include "fml.hpp"
 #include "layer.hpp"
+#include "map_blob.hpp"
 #include "map_loader.hpp"
 #include "object_manager.hpp"
 #include "texture_atlas.hpp"
@@ -27,8 +29,21 @@
 /// attributes and have only parsed them if we need them.
 ///
 bool MapLoader::load_map(const std::string source) {
+    if (!read_map(source)) {
+        return false;
+    }
+
+    build_map();
+    return true;
+}
+
+bool MapLoader::read_map(const std::string source) {
 
     LOG(INFO) << "Loading map";
+    if (load_blob(source)) {
+        return true;
+    }
+
     map.ParseFile(source);
 
     if (map.HasError()) {
@@ -39,13 +54,69 @@ bool MapLoader::load_map(const std::string source) {
     map_width = map.GetWidth();
     map_height = map.GetHeight();
 
+    return true;
+}
+
+void MapLoader::build_map() {
     load_tileset();
     load_layers();
+}
 
+bool MapLoader::load_blob(const std::string source) {
+    std::unique_ptr<MapBlob> loaded;
+    try {
+        loaded.reset(new MapBlob(MapBlob::path_for(source)));
+    }
+    catch (MapBlob::LoadException &e) {
+        LOG(INFO) << "Not using precompiled map: " << e.what();
+        return false;
+    }
+
+    if (!loaded->is_fresh_for(source)) {
+        LOG(INFO) << "Precompiled map " << MapBlob::path_for(source) << " is stale; run 'make maps'";
+        return false;
+    }
+
+    LOG(INFO) << "Loading precompiled map " << MapBlob::path_for(source);
+
+    map_width = loaded->get_map_width();
+    map_height = loaded->get_map_height();
+
+    // The tilesets, layers and objects are created from the blob when
+    // the map is built
+    blob = std::move(loaded);
     return true;
 }
 
+std::vector<std::string> MapLoader::get_atlas_names() {
+    std::vector<std::string> atlas_names;
+
+    if (blob) {
+        for (auto &tileset : blob->get_tilesets()) {
+            atlas_names.push_back(tileset.atlas);
+        }
+    }
+    else {
+        for (int i = 0; i < map.GetNumTilesets(); ++i) {
+            atlas_names.push_back(map.GetTileset(i)->GetImage()->GetSource());
+        }
+    }
+
+    return atlas_names;
+}
+
 void MapLoader::load_layers() {
+    if (blob) {
+        for (auto &layer : blob->get_layers()) {
+            std::shared_ptr<Layer> layer_ptr = std::make_shared<Layer>(layer.width, layer.height, layer.name, tilesets);
+            layer_ptr->set_tiles(layer.tileset_indices, layer.tile_ids, size_t(layer.width) * size_t(layer.height));
+            layers.push_back(layer_ptr);
+            ObjectManager::get_instance().add_object(layer_ptr);
+        }
+
+        return;
+    }
+
     for (int i = 0; i < map.GetNumLayers(); ++i) {
         //Get the layer
         const Tmx::Layer* layer = map.GetLayer(i);
@@ -54,7 +125,7 @@ void MapLoader::load_layers() {
         std::string name = layer->GetName();
 
         //Generate a new layer
-        std::shared_ptr<Layer> layer_ptr = std::make_shared<Layer>(num_tiles_x, num_tiles_y, name);
+        std::shared_ptr<Layer> layer_ptr = std::make_shared<Layer>(num_tiles_x, num_tiles_y, name, tilesets);
         layers.push_back(layer_ptr);
         ObjectManager::get_instance().add_object(layer_ptr);
         //Get the tiles
@@ -64,17 +135,13 @@ void MapLoader::load_layers() {
                 //Get the tile identifier
                 int tile_id = layer->GetTileId(x, y);
 
-                //Gets the tileset to use for this tile
+                //Gets the tileset to use for this tile, or -1 for the
+                //default tile. Our tileset table is in the same order
+                //as the TMX file's.
                 int tileset_index = layer->GetTileTilesetIndex(x, y);
-                if(tileset_index == -1) {
-                    //Add the default tile
-                    layer_ptr->add_tile(nullptr, tile_id);
-                    continue;
-                }
-                const std::string tileset_name = map.GetTileset(tileset_index)->GetName();
 
                 //Add the tile to the layer
-                layer_ptr->add_tile(tilesets_by_name.find(tileset_name)->second, tile_id);
+                layer_ptr->add_tile(tileset_index, tile_id);
             }
         }
     }
@@ -83,6 +150,15 @@ void MapLoader::load_layers() {
 std::map<std::string, ObjectProperties> MapLoader::get_object_mapping() {
     std::map<std::string, ObjectProperties> named_tiles_mapping;
 
+    if (blob) {
+        for (auto &object : blob->get_objects()) {
+            add_object_mapping(named_tiles_mapping, object.group + "/" + object.name,
+                               object.x, object.y, object.tile_id, object.atlas);
+        }
+
+        return named_tiles_mapping;
+    }
+
     // For each object later
     for (int i = 0; i < map.GetNumObjectGroups(); ++i) {
         const Tmx::ObjectGroup *object_group(map.GetObjectGroup(i));
@@ -103,44 +179,58 @@ std::map<std::string, ObjectProperties> MapLoader::get_object_mapping() {
 
             CHECK_NOTNULL(tileset);
 
-            auto id(object->GetGid() - tileset->GetFirstGid());
+            add_object_mapping(named_tiles_mapping, object_group->GetName() + "/" + object->GetName(),
+                               object->GetX(), object->GetY(),
+                               object->GetGid() - tileset->GetFirstGid(),
+                               tileset->GetImage()->GetSource());
+        }
+    }
 
-            auto atlas(TextureAtlas::get_shared(tileset->GetImage()->GetSource()));
-            auto names_to_indexes(atlas->get_names_to_indexes());
+    return named_tiles_mapping;
+}
 
-            auto tile(
-                std::find_if(std::begin(names_to_indexes), std::end(names_to_indexes),
-                    [&] (std::pair<std::string, int> p) { return p.second == id; }
-                )
-            );
+void MapLoader::add_object_mapping(std::map<std::string, ObjectProperties> &mapping,
+                                   const std::string fullname, int x, int y, int id, const std::string atlas_name) {
 
-            if (tile == std::end(names_to_indexes)) {
-                throw std::runtime_error("no name for object tile id " + std::to_string(id));
-            }
+    auto atlas(TextureAtlas::get_shared(atlas_name));
+    auto names_to_indexes(atlas->get_names_to_indexes());
 
-            auto tile_name(tile->first);
+    auto tile(
+        std::find_if(std::begin(names_to_indexes), std::end(names_to_indexes),
+            [&] (std::pair<std::string, int> p) { return p.second == id; }
+        )
+    );
 
-            auto fullname(object_group->GetName() + "/" + object->GetName());
+    if (tile == std::end(names_to_indexes)) {
+        throw std::runtime_error("no name for object tile id " + std::to_string(id));
+    }
 
-            LOG(INFO) << "Adding object to mapping " << fullname
-                      << " with name " << tile_name;
+    auto tile_name(tile->first);
 
-            ObjectProperties properties({
-                glm::ivec2(
-                                 object->GetX() / Engine::get_tile_size(),
-                    map_height - object->GetY() / Engine::get_tile_size()
-                ),
-                tile_name
-            });
+    LOG(INFO) << "Adding object to mapping " << fullname
+              << " with name " << tile_name;
 
-            named_tiles_mapping.insert(std::make_pair(fullname, properties));
-        }
-    }
+    ObjectProperties properties({
+        glm::ivec2(
+                         x / Engine::get_tile_size(),
+            map_height - y / Engine::get_tile_size()
+        ),
+        tile_name
+    });
 
-    return named_tiles_mapping;
+    mapping.insert(std::make_pair(fullname, properties));
 }
 
 void MapLoader::load_tileset() {
+    if (blob) {
+        for (auto &tileset : blob->get_tilesets()) {
+            add_tileset(tileset.name, tileset.width, tileset.height, tileset.atlas);
+        }
+
+        merge_tilesets();
+        return;
+    }
+
     //For all the tilesets
     for (int i = 0; i < map.GetNumTilesets(); ++i) {
 
@@ -154,9 +244,7 @@ void MapLoader::load_tileset() {
         const std::string tileset_atlas(tileset->GetImage()->GetSource());
 
         //Create a new tileset and add it to the map
-        std::shared_ptr<TileSet> map_tileset = std::make_shared<TileSet>(tileset_name, tileset_width, tileset_height, tileset_atlas);
-        tilesets.push_back(map_tileset);
-        tilesets_by_name.insert(std::make_pair(tileset_name, map_tileset));
+        add_tileset(tileset_name, tileset_width, tileset_height, tileset_atlas);
 
         //We use the tileset properties to define collidable tiles for our collision
         //detection
@@ -182,9 +270,19 @@ void MapLoader::load_tileset() {
         }
     }
 
+    merge_tilesets();
+}
+
+void MapLoader::add_tileset(const std::string name, int width, int height, const std::string atlas) {
+    std::shared_ptr<TileSet> map_tileset = std::make_shared<TileSet>(name, width, height, atlas);
+    tilesets->push_back(map_tileset);
+    tilesets_by_name.insert(std::make_pair(name, map_tileset));
+}
+
+void MapLoader::merge_tilesets() {
     // Merge the tilesets.
     std::vector<std::shared_ptr<TextureAtlas>> atlases;
-    for (auto tileset : tilesets) {
+    for (auto tileset : *tilesets) {
         if (tileset->get_atlas()) {
             atlases.push_back(tileset->get_atlas());
         }
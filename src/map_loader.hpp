@@ -9,6 +9,8 @@
 #include <utility>
 #include <vector>
 
+#include "map_blob.hpp"
+
 class Layer;
 class MapObject;
 class TileSet;
@@ -38,19 +40,54 @@ class MapLoader {
     int map_height = 0;
 
     ///
-    /// Load layers from the TMX map
+    /// The precompiled map, if the map was loaded from one
+    ///
+    std::unique_ptr<MapBlob> blob;
+
+    ///
+    /// Read the map from its precompiled blob, if there is an up to
+    /// date one
+    /// @return true if the blob was read
+    ///
+    bool load_blob(const std::string source);
+
+    ///
+    /// Load layers from the TMX map or blob
     ///
     void load_layers();
 
     ///
-    /// Load tilesets from the TMX map
+    /// Add a tileset to the table of tilesets
+    ///
+    void add_tileset(const std::string name, int width, int height, const std::string atlas);
+
+    ///
+    /// Merge the atlases of all the tilesets, once they are all added
+    ///
+    void merge_tilesets();
+
+    ///
+    /// Add an object to the mapping of names to places and tile names
+    /// @param mapping the mapping to add to
+    /// @param fullname the object's group and name
+    /// @param x the object's x position in pixels from the left
+    /// @param y the object's y position in pixels from the top
+    /// @param id the object's tile id in its tileset
+    /// @param atlas the atlas of the object's tileset
+    ///
+    void add_object_mapping(std::map<std::string, ObjectProperties> &mapping,
+                            const std::string fullname, int x, int y, int id, const std::string atlas);
+
+    ///
+    /// Load tilesets from the TMX map or blob
     ///
     void load_tileset();
 
     ///
-    /// Vector of tilesets
+    /// Table of tilesets, in the order of the TMX file. Shared by the
+    /// layers, which refer to tilesets by their index in it.
     ///
-    std::vector<std::shared_ptr<TileSet>> tilesets;
+    std::shared_ptr<std::vector<std::shared_ptr<TileSet>>> tilesets = std::make_shared<std::vector<std::shared_ptr<TileSet>>>();
 
     ///
     /// Map of tileset names to tilesets
@@ -70,10 +107,31 @@ public:
     std::map<std::string, ObjectProperties> get_object_mapping();
 
     ///
-    /// Load the TMX map from the source file
+    /// Load the TMX map from the source file, or from its precompiled
+    /// blob if that is up to date. The same as read_map then build_map.
     ///
     bool load_map(const std::string source);
 
+    ///
+    /// Read the map's blob or TMX file, without creating any tilesets
+    /// or layers. This needs no GL context and touches no shared
+    /// state, so it may be done on another thread.
+    /// @return true if the map was read
+    ///
+    bool read_map(const std::string source);
+
+    ///
+    /// Create the tilesets and layers of a map which has been read.
+    /// This creates GL textures so must be done on the main thread.
+    ///
+    void build_map();
+
+    ///
+    /// Get the atlases used by the tilesets of a map which has been
+    /// read, so that they can be loaded ahead of building it
+    ///
+    std::vector<std::string> get_atlas_names();
+
     ///
     /// Gets the width of the ma
     /// @return the width of the map
@@ -90,9 +148,9 @@ public:
 
     ///
     /// Get the tilesets that this map uses
-    /// @return a vector of the tilesets, referenced by shared_ptrs
+    /// @return the table of tilesets, shared with the map's layers
     ///
-    std::vector<std::shared_ptr<TileSet>> get_tilesets() {return tilesets; }
+    std::shared_ptr<std::vector<std::shared_ptr<TileSet>>> get_tilesets() {return tilesets; }
 
     ///
     /// Get the map's layers
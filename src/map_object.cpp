@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <exception>
 #include <fstream>
 #include <glog/logging.h>
@@ -6,14 +7,18 @@
 #include <new>
 #include <stdexcept>
 #include <tuple>
+#include <vector>
 
 #include "animation_frames.hpp"
 #include "cacheable_resource.hpp"
 #include "engine.hpp"
+#include "frame_damage.hpp"
 #include "map_object.hpp"
 #include "map_viewer.hpp"
+#include "packed_vertex.hpp"
 #include "shader.hpp"
 #include "texture_atlas.hpp"
+#include "tile_registry.hpp"
 #include "walkability.hpp"
 
 #ifdef USE_GLES
@@ -49,9 +54,7 @@ MapObject::MapObject(glm::vec2 position,
         regenerate_blockers();
 
         init_shaders();
-        // Hack hack hack
-        load_textures(frames.get_frame(start_frame));
-        generate_tex_data(frames.get_frame(start_frame));
+        set_tile(this->frames.get_frame(start_frame));
         generate_vertex_data();
 
         LOG(INFO) << "MapObject initialized";
@@ -66,9 +69,9 @@ void MapObject::set_walkability(Walkability walkability) {
 }
 
 void MapObject::regenerate_blockers() {
-    body_blockers.clear();
     switch (walkability) {
         case Walkability::WALKABLE: {
+            body_blockers.clear();
             break;
         }
 
@@ -84,7 +87,24 @@ void MapObject::regenerate_blockers() {
             int x_right(x_left   + (float(x_left)   != position.x));
             int y_top  (y_bottom + (float(y_bottom) != position.y));
 
+            // Only touch the walkability grid when the object moves
+            // onto different tiles
             auto *map = Engine::get_map_viewer()->get_map();
+            std::vector<glm::ivec2> tiles({
+                glm::ivec2(x_left,  y_top),
+                glm::ivec2(x_left,  y_bottom),
+                glm::ivec2(x_right, y_top),
+                glm::ivec2(x_right, y_bottom)
+            });
+            if (body_blockers.size() == tiles.size()
+                && std::equal(tiles.begin(), tiles.end(), body_blockers.begin(),
+                              [&] (glm::ivec2 tile, const Map::Blocker &blocker) {
+                                  return tile == blocker.tile && blocker.walkability_grid == &map->walkability_grid;
+                              })) {
+                break;
+            }
+
+            body_blockers.clear();
             body_blockers = {
                 map->block_tile(glm::ivec2(x_left,  y_top)),
                 map->block_tile(glm::ivec2(x_left,  y_bottom)),
@@ -101,102 +121,85 @@ void MapObject::regenerate_blockers() {
     }
 }
 
-void MapObject::generate_tex_data(std::pair<int, std::string> tile) {
-    // holds the texture data
-    // need 12 float for the 2D texture coordinates
-    int num_floats = 12;
+void MapObject::generate_tex_data(const AnimationFrames::Frame &frame) {
+    PackedQuad quad(get_quad());
+    quad.set_tex_coords(frame.coords);
+    set_quad(quad);
 
-    GLfloat *map_object_tex_data;
+    tile_index = frame.index;
+}
+
+PackedQuad MapObject::get_quad() {
+    if (renderable_component.get_num_quads() == 0) {
+        return PackedQuad();
+    }
+
+    return renderable_component.get_quad_data()[0];
+}
+
+void MapObject::set_quad(const PackedQuad &quad) {
+    // Map objects are drawn by the MapViewer's SpriteBatch from the
+    // quad data, so changes needn't be uploaded
+    if (renderable_component.get_num_quads() == 1) {
+        renderable_component.update_quad_data(0, quad);
+        return;
+    }
+
+    PackedQuad *map_object_quad(nullptr);
     try {
-        map_object_tex_data = new GLfloat[sizeof(GLfloat)*num_floats];
+        map_object_quad = new PackedQuad[1];
     }
     catch(std::bad_alloc &) {
-        LOG(ERROR) << "ERROR in MapObject::generate_tex_data(), cannot allocate memory";
+        LOG(ERROR) << "ERROR in MapObject::set_quad(), cannot allocate memory";
         return;
     }
 
-    std::tuple<float,float,float,float> bounds(
-        renderable_component.get_texture()->index_to_coords(tile.first)
-    );
-
-    // bottom left
-    map_object_tex_data[ 0] = std::get<0>(bounds);
-    map_object_tex_data[ 1] = std::get<2>(bounds);
-
-    // top left
-    map_object_tex_data[ 2] = std::get<0>(bounds);
-    map_object_tex_data[ 3] = std::get<3>(bounds);
-
-    // bottom right
-    map_object_tex_data[ 4] = std::get<1>(bounds);
-    map_object_tex_data[ 5] = std::get<2>(bounds);
-
-    // top left
-    map_object_tex_data[ 6] = std::get<0>(bounds);
-    map_object_tex_data[ 7] = std::get<3>(bounds);
-
-    // top right
-    map_object_tex_data[ 8] = std::get<1>(bounds);
-    map_object_tex_data[ 9] = std::get<3>(bounds);
-
-    // bottom right
-    map_object_tex_data[10] = std::get<1>(bounds);
-    map_object_tex_data[11] = std::get<2>(bounds);
-
-    renderable_component.set_texture_coords_data(map_object_tex_data, sizeof(GLfloat)*num_floats, false);
+    map_object_quad[0] = quad;
+    renderable_component.set_quad_data(map_object_quad, 1, false);
 }
 
 void MapObject::set_position(glm::vec2 position) {
     this->position = position;
     VLOG(2) << std::fixed << position.x << " " << position.y;
+    FrameDamage::mark_dirty();
+
+    Map *map(Engine::get_map_viewer()->get_map());
+    if (map) {
+        map->update_object_position(get_id(), position);
+    }
+
     regenerate_blockers();
 }
 
 void MapObject::set_tile(std::pair<int, std::string> tile) {
-    load_textures(tile);
-    generate_tex_data(tile);
+    auto atlas(TextureAtlas::get_shared(tile.second));
+    set_tile(AnimationFrames::Frame{atlas, tile.first, atlas->index_to_coords(tile.first)});
 }
 
-void MapObject::generate_vertex_data() {
-    //holds the map object's vertex data
-    int num_dimensions(2);
-    int num_floats(num_dimensions * 6); // GL's Triangles
-    GLfloat *map_object_vert_data(nullptr);
+void MapObject::set_tile(const std::string &tile_name) {
+    set_tile(TileRegistry::get_instance().resolve(tile_name));
+}
 
-    try {
-        map_object_vert_data = new GLfloat[sizeof(GLfloat)*num_floats];
-    }
-    catch(std::bad_alloc& ba) {
-        LOG(ERROR) << "ERROR in MapObject::generate_vertex_data(), cannot allocate memory";
+void MapObject::set_tile(const AnimationFrames::Frame &frame) {
+    // Walking animations set the same frame for several game frames
+    // running, and only change the index when they do change
+    bool same_atlas(renderable_component.get_texture() == frame.atlas);
+    if (same_atlas && frame.index == tile_index) {
         return;
     }
 
-    //bottom left
-    map_object_vert_data[0]  = 0;
-    map_object_vert_data[1]  = 0;
-
-    //top left
-    map_object_vert_data[2]  = 0;
-    map_object_vert_data[3]  = 1;
-
-    //bottom right
-    map_object_vert_data[4]  = 1;
-    map_object_vert_data[5]  = 0;
-
-    //top left
-    map_object_vert_data[6]  = 0;
-    map_object_vert_data[7]  = 1;
-
-    //top right
-    map_object_vert_data[8]  = 1;
-    map_object_vert_data[9]  = 1;
-
-    //bottom right
-    map_object_vert_data[10] = 1;
-    map_object_vert_data[11] = 0;
+    if (!same_atlas) {
+        load_textures(frame);
+    }
+    generate_tex_data(frame);
+    FrameDamage::mark_dirty();
+}
 
-    renderable_component.set_vertex_data(map_object_vert_data, sizeof(GLfloat)*num_floats, false);
-    renderable_component.set_num_vertices_render(num_floats / num_dimensions);//GL_TRIANGLES being used
+void MapObject::generate_vertex_data() {
+    // A tile sized quad, relative to the object's position
+    PackedQuad quad(get_quad());
+    quad.set_position(0, 0, GLshort(PackedVertex::tile_units), GLshort(PackedVertex::tile_units));
+    set_quad(quad);
 }
 
 void MapObject::set_state_on_moving_start(glm::ivec2) {
@@ -216,9 +219,8 @@ void MapObject::set_state_on_moving_finish() {
     positions.insert(position);
 }
 
-// TODO: rewrite
-void MapObject::load_textures(std::pair<int, std::string> tile) {
-    renderable_component.set_texture(TextureAtlas::get_shared(tile.second));
+void MapObject::load_textures(const AnimationFrames::Frame &frame) {
+    renderable_component.set_texture(frame.atlas);
 }
 
 bool MapObject::init_shaders() {
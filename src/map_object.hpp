@@ -13,8 +13,10 @@
 #include <vector>
 
 #include "animation_frames.hpp"
+#include "frame_damage.hpp"
 #include "map.hpp"
 #include "object.hpp"
+#include "packed_vertex.hpp"
 #include "walkability.hpp"
 
 #ifndef KEYHASH
@@ -89,6 +91,12 @@ protected:
     ///
     bool moving = false;
 
+    ///
+    /// The index of the tile shown in the object's texture atlas, or -1
+    /// before one is set
+    ///
+    int tile_index = -1;
+
     ///
     /// Whether the object can be cut down
     ///
@@ -107,6 +115,16 @@ protected:
     ///
     Challenge *challenge = nullptr;
 
+    ///
+    /// Get a copy of the object's quad, or a blank one if it has none
+    ///
+    PackedQuad get_quad();
+
+    ///
+    /// Set the object's quad
+    ///
+    void set_quad(const PackedQuad &quad);
+
 public:
     ///
     /// Constructs a map object
@@ -176,18 +194,35 @@ public:
     /// If the object is to be rendered above sprites
     /// @param _render_above_sprites true if the object should be above sprites
     ///
-    virtual void set_render_above_sprites(bool _render_above_sprites) { render_above_sprite = _render_above_sprites; }
+    virtual void set_render_above_sprites(bool _render_above_sprites) {
+        render_above_sprite = _render_above_sprites;
+        FrameDamage::mark_dirty();
+    }
 
     ///
     /// Generate the texture coordinate data for the object
     ///
-    virtual void generate_tex_data(std::pair<int, std::string> tile);
+    virtual void generate_tex_data(const AnimationFrames::Frame &frame);
 
     ///
-    /// Change the tile of the sprite to that of the given name
+    /// Change the tile of the sprite to a tile in an atlas
+    /// @param tile the index of the tile and the name of its atlas
     ///
     virtual void set_tile(std::pair<int, std::string> tile);
 
+    ///
+    /// Change the tile of the sprite to that of the given name.
+    /// Throws std::runtime_error if there is no such tile.
+    ///
+    virtual void set_tile(const std::string &tile_name);
+
+    ///
+    /// Change the tile of the sprite to an animation frame. Nothing is
+    /// done if it is already showing it, and the texture is only changed
+    /// if the frame is in a different atlas.
+    ///
+    virtual void set_tile(const AnimationFrames::Frame &frame);
+
     ///
     /// Generate the vertex data for the object
     ///
@@ -196,7 +231,7 @@ public:
     ///
     /// Load the textures that are being used by the object
     ///
-    virtual void load_textures(std::pair<int, std::string> tile);
+    virtual void load_textures(const AnimationFrames::Frame &frame);
 
     ///
     /// Initialise the shaders that are being used by the object
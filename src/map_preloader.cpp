@@ -0,0 +1,108 @@
+#include <chrono>
+#include <exception>
+#include <future>
+#include <glog/logging.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "image.hpp"
+#include "map_loader.hpp"
+#include "map_preloader.hpp"
+#include "texture_atlas.hpp"
+
+MapPreloader::MapPreloader() {}
+
+MapPreloader::~MapPreloader() {}
+
+MapPreloader &MapPreloader::get_instance() {
+    // Lazy instantiation of the global instance
+    static MapPreloader global_instance;
+
+    return global_instance;
+}
+
+MapPreloader::Preloaded MapPreloader::read(const std::string source) {
+    Preloaded result;
+
+    std::unique_ptr<MapLoader> map_loader(new MapLoader());
+    if (!map_loader->read_map(source)) {
+        throw std::runtime_error("Couldn't read map " + source);
+    }
+
+    for (auto &atlas_name : map_loader->get_atlas_names()) {
+        result.images.push_back(std::make_pair(atlas_name, Image(atlas_name, true)));
+    }
+
+    result.map_loader = std::move(map_loader);
+    return result;
+}
+
+void MapPreloader::preload(const std::string source) {
+    // Waits for any read in progress
+    reading = std::future<Preloaded>();
+    preloaded = Preloaded();
+    atlases.clear();
+
+    LOG(INFO) << "Preloading map " << source;
+
+    this->source = source;
+    reading = std::async(std::launch::async, &MapPreloader::read, source);
+}
+
+void MapPreloader::finish_reading() {
+    if (!reading.valid()) {
+        return;
+    }
+
+    try {
+        preloaded = reading.get();
+    }
+    catch (std::exception &e) {
+        LOG(WARNING) << "Couldn't preload map " << source << ": " << e.what();
+        source.clear();
+    }
+}
+
+void MapPreloader::update() {
+    // Don't hold up the frame waiting for the worker
+    if (reading.valid()) {
+        if (reading.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return;
+        }
+
+        finish_reading();
+    }
+
+    // Create one atlas per frame
+    if (!preloaded.images.empty()) {
+        auto &image(preloaded.images.back());
+
+        try {
+            atlases.push_back(TextureAtlas::get_shared_decoded(image.first, image.second));
+        }
+        catch (std::exception &e) {
+            LOG(WARNING) << "Couldn't preload atlas " << image.first << ": " << e.what();
+        }
+
+        preloaded.images.pop_back();
+    }
+}
+
+std::unique_ptr<MapLoader> MapPreloader::take(const std::string source) {
+    if (source.empty() || source != this->source) {
+        return nullptr;
+    }
+
+    finish_reading();
+    this->source.clear();
+
+    // Create whichever atlases update hasn't got to yet
+    while (!preloaded.images.empty()) {
+        update();
+    }
+
+    return std::move(preloaded.map_loader);
+}
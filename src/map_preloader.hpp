@@ -0,0 +1,102 @@
+#ifndef MAP_PRELOADER_H
+#define MAP_PRELOADER_H
+
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "image.hpp"
+
+class MapLoader;
+class TextureAtlas;
+
+///
+/// Loads the next challenge's map in the background, while the
+/// current challenge runs. This uses the singleton pattern.
+///
+/// Reading the map and decoding its atlas images needs no GL context,
+/// so it is all done on a worker thread. Creating the atlases' GL
+/// textures has to happen on the main thread; update does it one atlas
+/// per frame so that no one frame stalls. Map then builds the layers
+/// from the preloaded map when it is created.
+///
+class MapPreloader {
+    ///
+    /// What the worker thread produces for a map
+    ///
+    struct Preloaded {
+        ///
+        /// The map, read but not yet built
+        ///
+        std::unique_ptr<MapLoader> map_loader;
+
+        ///
+        /// The images of the map's atlases, by filename
+        ///
+        std::vector<std::pair<std::string, Image>> images;
+    };
+
+    MapPreloader();
+    ~MapPreloader();
+
+    ///
+    /// Read a map and decode its atlas images. Run on the worker
+    /// thread.
+    ///
+    static Preloaded read(const std::string source);
+
+    ///
+    /// Collect the worker thread's result, waiting for it if it isn't
+    /// done yet. If reading failed, the preload is dropped.
+    ///
+    void finish_reading();
+
+    ///
+    /// The map being preloaded
+    ///
+    std::string source;
+
+    ///
+    /// The worker thread's result, while it is still reading
+    ///
+    std::future<Preloaded> reading;
+
+    ///
+    /// The result, once the worker thread is done
+    ///
+    Preloaded preloaded;
+
+    ///
+    /// The atlases created so far. Holding these keeps them in the
+    /// texture atlas cache for when the map is built.
+    ///
+    std::vector<std::shared_ptr<TextureAtlas>> atlases;
+
+public:
+    static MapPreloader &get_instance();
+
+    ///
+    /// Start loading a map in the background, replacing any map being
+    /// preloaded.
+    /// @param source the map's TMX file
+    ///
+    void preload(const std::string source);
+
+    ///
+    /// Make progress on the GL side of preloading. Call once per
+    /// frame from the main thread.
+    ///
+    void update();
+
+    ///
+    /// Take the preloaded map, finishing preloading it if needed.
+    /// @param source the map's TMX file
+    /// @return the read map ready to be built, or nullptr if the map
+    ///         isn't the one being preloaded or couldn't be read
+    ///
+    std::unique_ptr<MapLoader> take(const std::string source);
+};
+
+#endif
@@ -6,7 +6,6 @@
 #include <glog/logging.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
@@ -17,16 +16,20 @@
 #include <vector>
 
 #include "engine.hpp"
+#include "frame_damage.hpp"
 #include "game_window.hpp"
+#include "gl_state.hpp"
 #include "gui_manager.hpp"
 #include "layer.hpp"
 #include "map.hpp"
 #include "map_object.hpp"
 #include "map_viewer.hpp"
 #include "object_manager.hpp"
+#include "packed_vertex.hpp"
 #include "renderable_component.hpp"
 #include "shader.hpp"
 #include "sprite.hpp"
+#include "tile_index_texture.hpp"
 
 #ifdef USE_GL
 #define GL_GLEXT_PROTOTYPES
@@ -55,11 +58,12 @@ MapViewer::MapViewer(GameWindow *window, GUIManager *gui_manager):
         glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE);
         // Leave this here!!!
         //Disable back face culling.
-        glDisable(GL_CULL_FACE);
-        glEnable(GL_DEPTH_TEST);
+        GLState &gl_state(GLState::get_current());
+        gl_state.disable(GL_CULL_FACE);
+        gl_state.enable(GL_DEPTH_TEST);
         glDepthFunc(GL_LEQUAL);
-        glEnable(GL_SCISSOR_TEST);
-        glEnable(GL_BLEND);
+        gl_state.enable(GL_SCISSOR_TEST);
+        gl_state.enable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
@@ -75,6 +79,7 @@ void MapViewer::resize() {
     // Set the viewable fragments
     glScissor(0, 0, size.first, size.second);
     glViewport(0, 0, size.first, size.second);
+    FrameDamage::mark_dirty();
 
     if (get_map()) {
         // Readjust the map focus
@@ -87,15 +92,54 @@ void MapViewer::render() {
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     render_map();
-    render_objects(false);
-    render_sprites();
-    render_objects(true);
+
+    // Objects below the sprites, the sprites, then objects above them,
+    // all drawn together
+    batch_objects(false);
+    batch_sprites();
+    batch_objects(true);
+    render_batch();
+
     render_gui();
 }
 
+void MapViewer::render_layer_tilemap(Layer *layer, const glm::mat4 &projection_matrix, const glm::mat4 &model) {
+    RenderableComponent *layer_render_component(layer->get_renderable_component());
+    TileIndexTexture *tile_index_texture(layer->get_tile_index_texture());
+
+    if (!tilemap_shader) {
+        tilemap_shader = Shader::get_shared("tilemap_shader");
+    }
+
+    GLState &gl_state(GLState::get_current());
+    gl_state.use_program(tilemap_shader->get_program());
+
+    // The atlas is on unit 0 and the tile indices on unit 1
+    layer_render_component->bind_textures();
+    gl_state.active_texture(GL_TEXTURE1);
+    gl_state.bind_texture_2d(tile_index_texture->get_gl_texture());
+
+    tilemap_shader->set_uniform("mat_projection", projection_matrix);
+    tilemap_shader->set_uniform("mat_modelview", model);
+    tilemap_shader->set_uniform("s_texture", 0);
+    tilemap_shader->set_uniform("s_tiles", 1);
+    tilemap_shader->set_uniform("tiles_size", tile_index_texture->get_size());
+    tilemap_shader->set_uniform("unit_size", tile_index_texture->get_unit_size());
+
+    // The quad covers the whole layer; what is out of view is clipped
+    layer_render_component->bind_vbos();
+    layer_render_component->draw();
+}
+
 void MapViewer::render_map() {
     // Focus onto the player
     refocus_map();
+
+    // Switch how the layers are drawn if it has been changed
+    map->set_gpu_tilemap(Engine::get_gpu_tilemap());
+
+    // Upload this frame's tile changes, once per changed chunk
+    map->flush_tile_updates();
     // Calculate the projection and modelview matrix for the map
     std::pair<int, int> size(window->get_size());
     glm::mat4 projection_matrix(glm::ortho(0.0f, float(size.first), 0.0f, float(size.second), 0.0f, 1.0f));
@@ -104,8 +148,23 @@ void MapViewer::render_map() {
     model = glm::scale    (model, glm::vec3(Engine::get_actual_tile_size()));
     model = glm::translate(model, glm::vec3(-get_display_x(), -get_display_y(), 0.0f));
 
+    // The range of tiles in view, used to cull chunks that are off screen
+    float view_left  (get_display_x());
+    float view_bottom(get_display_y());
+    float view_right (view_left   + get_display_width());
+    float view_top   (view_bottom + get_display_height());
+
+    if (!map->get_gpu_tilemap() && Engine::get_chunk_cache()) {
+        int chunk_size(Layer::chunk_size);
+        render_map_cached(projection_matrix, model,
+                          std::max(0, int(std::floor(view_left   / float(chunk_size)))),
+                          std::max(0, int(std::floor(view_bottom / float(chunk_size)))),
+                          std::min(map->get_num_chunks_x(), int(std::floor(view_right / float(chunk_size))) + 1),
+                          std::min(map->get_num_chunks_y(), int(std::floor(view_top   / float(chunk_size))) + 1));
+        return;
+    }
+
     // Draw all the layers, from base to top to get the correct draw order
-    int layer_num = 0;
     for (int layer_id: map->get_layers()) {
         auto layer(ObjectManager::get_instance().get_object<Layer>(layer_id));
         if (!layer) {
@@ -116,49 +175,125 @@ void MapViewer::render_map() {
             continue;
         }
 
+        if (layer->get_tile_index_texture()) {
+            render_layer_tilemap(layer.get(), projection_matrix, model);
+            continue;
+        }
+
         RenderableComponent *layer_render_component(layer->get_renderable_component());
         Shader *layer_shader(layer_render_component->get_shader().get());
 
+        // Chunks overlapping the view, clamped to the layer
+        int chunk_size(Layer::chunk_size);
+        int chunk_x_begin(std::max(0, int(std::floor(view_left   / float(chunk_size)))));
+        int chunk_y_begin(std::max(0, int(std::floor(view_bottom / float(chunk_size)))));
+        int chunk_x_end(std::min(layer->get_num_chunks_x(), int(std::floor(view_right / float(chunk_size))) + 1));
+        int chunk_y_end(std::min(layer->get_num_chunks_y(), int(std::floor(view_top   / float(chunk_size))) + 1));
+
         //Set the matrices
         layer_render_component->set_projection_matrix(projection_matrix);
         layer_render_component->set_modelview_matrix(model);
 
+        // The chunks share the layer's shader, so it and the projection
+        // are only set once per layer
         layer_render_component->bind_shader();
 
-        //TODO: I don't want to actually expose the shader, put these into wrappers in the shader object
-        glUniformMatrix4fv(glGetUniformLocation(layer_shader->get_program(), "mat_projection"),
-                           1,
-                           GL_FALSE,
-                           glm::value_ptr(layer_render_component->get_projection_matrix()));
+        layer_shader->set_uniform("mat_projection", layer_render_component->get_projection_matrix());
 
-        glUniformMatrix4fv(glGetUniformLocation(layer_shader->get_program(), "mat_modelview"),
-                           1,
-                           GL_FALSE,
-                           glm::value_ptr(layer_render_component->get_modelview_matrix()));
+        layer_render_component->bind_textures();
 
+        for (int chunk_y = chunk_y_begin; chunk_y < chunk_y_end; ++chunk_y) {
+            for (int chunk_x = chunk_x_begin; chunk_x < chunk_x_end; ++chunk_x) {
+                RenderableComponent *chunk_render_component(layer->get_chunk_renderable_component(chunk_x, chunk_y));
 
-        layer_render_component->bind_vbos();
+                // Skip chunks without any tiles
+                if (chunk_render_component->get_num_quads() == 0) {
+                    continue;
+                }
 
-        layer_render_component->bind_textures();
+                // Chunk positions are fixed point, relative to the chunk
+                glm::mat4 chunk_model(glm::translate(model, glm::vec3(float(chunk_x * chunk_size), float(chunk_y * chunk_size), 0.0f)));
+                chunk_model = glm::scale(chunk_model, glm::vec3(1.0f / float(PackedVertex::tile_units)));
+                layer_shader->set_uniform("mat_modelview", chunk_model);
 
-        glDrawArrays(GL_TRIANGLES, 0, layer_render_component->get_num_vertices_render());
+                chunk_render_component->bind_vbos();
+                chunk_render_component->draw();
+            }
+        }
+    }
+}
 
-        //Release the vertex buffers and texppptures
-        layer_render_component->release_textures();
-        layer_render_component->release_vbos();
+void MapViewer::render_map_cached(const glm::mat4 &projection_matrix, const glm::mat4 &model,
+                                  int chunk_x_begin, int chunk_y_begin, int chunk_x_end, int chunk_y_end) {
+    // The layers to draw, from base to top
+    std::vector<Layer *> layers;
+    std::vector<int> layer_ids;
+    for (int layer_id: map->get_layers()) {
+        auto layer(ObjectManager::get_instance().get_object<Layer>(layer_id));
+        if (!layer || !layer->is_renderable()) {
+            continue;
+        }
 
-        layer_render_component->release_shader();
+        layers.push_back(layer.get());
+        layer_ids.push_back(layer_id);
+    }
 
-        //next layer
-        layer_num ++;
+    std::pair<int, int> size(window->get_size());
+    chunk_cache.begin_frame(Engine::get_actual_tile_size(), layer_ids, size.first, size.second);
+
+    int chunk_size(Layer::chunk_size);
+    for (int chunk_y = chunk_y_begin; chunk_y < chunk_y_end; ++chunk_y) {
+        for (int chunk_x = chunk_x_begin; chunk_x < chunk_x_end; ++chunk_x) {
+            // Edge chunks may be smaller
+            int width_tiles (std::min(chunk_size, map->get_width()  - chunk_x * chunk_size));
+            int height_tiles(std::min(chunk_size, map->get_height() - chunk_y * chunk_size));
+
+            glm::mat4 chunk_model(glm::translate(model, glm::vec3(float(chunk_x * chunk_size), float(chunk_y * chunk_size), 0.0f)));
+
+            ChunkCache::DrawFunction draw_layers([&] (const glm::mat4 &layer_projection, const glm::mat4 &layer_model) {
+                for (Layer *layer : layers) {
+                    render_layer_chunk(layer, chunk_x, chunk_y, layer_projection, layer_model);
+                }
+            });
+
+            if (!chunk_cache.draw(chunk_x, chunk_y, width_tiles, height_tiles, map->get_chunk_version(chunk_x, chunk_y),
+                                  projection_matrix, chunk_model, draw_layers)) {
+                draw_layers(projection_matrix, chunk_model);
+            }
+        }
     }
 }
 
-void MapViewer::render_sprites() {
-    //Calculate the projection matrix
-    std::pair<int, int> size = window->get_size();
-    glm::mat4 projection_matrix = glm::ortho(0.0f, float(size.first), 0.0f, float(size.second), 0.0f, 1.0f);
-    //Draw the sprites
+void MapViewer::render_layer_chunk(Layer *layer, int chunk_x, int chunk_y,
+                                   const glm::mat4 &projection_matrix, const glm::mat4 &chunk_model) {
+    RenderableComponent *chunk_render_component(layer->get_chunk_renderable_component(chunk_x, chunk_y));
+
+    // Skip chunks without any tiles
+    if (chunk_render_component->get_num_quads() == 0) {
+        return;
+    }
+
+    RenderableComponent *layer_render_component(layer->get_renderable_component());
+    Shader *layer_shader(layer_render_component->get_shader().get());
+
+    layer_render_component->bind_shader();
+    layer_render_component->bind_textures();
+
+    // Chunk positions are fixed point, relative to the chunk
+    layer_shader->set_uniform("mat_projection", projection_matrix);
+    layer_shader->set_uniform("mat_modelview", glm::scale(chunk_model, glm::vec3(1.0f / float(PackedVertex::tile_units))));
+
+    chunk_render_component->bind_vbos();
+    chunk_render_component->draw();
+}
+
+bool MapViewer::is_in_view(glm::vec2 position) {
+    // Objects are a tile in size, so include those partly in view
+    return position.x > get_display_x() - 1.0f && position.x < get_display_x() + get_display_width()
+        && position.y > get_display_y() - 1.0f && position.y < get_display_y() + get_display_height();
+}
+
+void MapViewer::batch_sprites() {
     const std::vector<int>& sprites = map->get_sprites();
     ObjectManager& object_manager = ObjectManager::get_instance();
     for (auto it = sprites.begin(); it != sprites.end(); ++it) {
@@ -173,52 +308,16 @@ void MapViewer::render_sprites() {
                 continue;
             }
 
-            RenderableComponent* sprite_render_component = sprite->get_renderable_component();
-
-            //Move sprite to the required position
-            glm::vec3 translator(
-                sprite->get_position().x - get_display_x(),
-                sprite->get_position().y - get_display_y(),
-                0.0f
-            );
-
-            glm::mat4 model(glm::mat4(1.0f));
-            model = glm::scale    (model, glm::vec3(Engine::get_actual_tile_size()));
-            model = glm::translate(model, translator);
-
-            sprite_render_component->set_modelview_matrix(model);
-            sprite_render_component->set_projection_matrix(projection_matrix);
-
-            sprite_render_component->bind_shader();
-
-            Shader* shader = sprite_render_component->get_shader().get();
-
-            if(shader == nullptr) {
-                LOG(ERROR) << "MapViewer::render_map: Shader (sprite_render_component->get_shader()) should not be null";
-                return;
+            if (!is_in_view(sprite->get_position())) {
+                continue;
             }
 
-            //TODO: I don't want to actually expose the shader, put these into wrappers in the shader object
-            glUniformMatrix4fv(glGetUniformLocation(shader->get_program(), "mat_projection"), 1, GL_FALSE,glm::value_ptr(sprite_render_component->get_projection_matrix()));
-
-            glUniformMatrix4fv(glGetUniformLocation(shader->get_program(), "mat_modelview"), 1, GL_FALSE, glm::value_ptr(sprite_render_component->get_modelview_matrix()));
-
-            sprite_render_component->bind_vbos();
-            sprite_render_component->bind_textures();
-
-            glDrawArrays(GL_TRIANGLES, 0, sprite_render_component->get_num_vertices_render());
-
-            sprite_render_component->release_textures();
-            sprite_render_component->release_vbos();
-            sprite_render_component->release_shader();
+            object_batch.add(1, sprite->get_renderable_component(), sprite->get_position());
         }
     }
 }
-void MapViewer::render_objects(bool above_sprite) {
-    //Calculate the projection matrix
-    std::pair<int, int> size = window->get_size();
-    glm::mat4 projection_matrix = glm::ortho(0.0f, float(size.first), 0.0f, float(size.second), 0.0f, 1.0f);
-    //Draw the objects
+
+void MapViewer::batch_objects(bool above_sprite) {
     const std::vector<int>& objects = map->get_map_objects();
     ObjectManager& object_manager = ObjectManager::get_instance();
     for(auto it = objects.begin(); it != objects.end(); ++it) {
@@ -235,50 +334,27 @@ void MapViewer::render_objects(bool above_sprite) {
             if(above_sprite ^ object->render_above_sprites())
                 continue;
 
-            RenderableComponent* object_render_component = object->get_renderable_component();
-
-            //Move object to the required position
-            glm::vec3 translator(
-                object->get_position().x - get_display_x(),
-                object->get_position().y - get_display_y(),
-                0.0f
-            );
-
-            glm::mat4 model(glm::mat4(1.0f));
-            model = glm::scale    (model, glm::vec3(Engine::get_actual_tile_size()));
-            model = glm::translate(model, translator);
-
-            object_render_component->set_modelview_matrix(model);
-            object_render_component->set_projection_matrix(projection_matrix);
-
-            object_render_component->bind_shader();
-
-            Shader* shader = object_render_component->get_shader().get();
-            if(shader == nullptr) {
-                LOG(ERROR) << "MapViewer::render_map: Shader (object_render_component->get_shader()) should not be null";
-                return;
-            }
-
-            // TODO: I don't want to actually expose the shader, put these into wrappers in the shader object
-            GLuint mat_projection(glGetUniformLocation(shader->get_program(), "mat_projection"));
-            glUniformMatrix4fv(mat_projection, 1, GL_FALSE,
-                               glm::value_ptr(object_render_component->get_projection_matrix()));
+            if (!is_in_view(object->get_position()))
+                continue;
 
-            GLuint mat_modelview(glGetUniformLocation(shader->get_program(), "mat_modelview"));
-            glUniformMatrix4fv(mat_modelview, 1, GL_FALSE,
-                               glm::value_ptr(object_render_component->get_modelview_matrix()));
+            object_batch.add(above_sprite ? 2 : 0, object->get_renderable_component(), object->get_position());
+        }
+    }
+}
 
-            object_render_component->bind_vbos();
-            object_render_component->bind_textures();
+void MapViewer::render_batch() {
+    //Calculate the projection matrix
+    std::pair<int, int> size = window->get_size();
+    glm::mat4 projection_matrix = glm::ortho(0.0f, float(size.first), 0.0f, float(size.second), 0.0f, 1.0f);
 
-            glDrawArrays(GL_TRIANGLES, 0, object_render_component->get_num_vertices_render());
+    // The batch's geometry is in tiles, like the map's
+    glm::mat4 model(glm::mat4(1.0f));
+    model = glm::scale    (model, glm::vec3(Engine::get_actual_tile_size()));
+    model = glm::translate(model, glm::vec3(-get_display_x(), -get_display_y(), 0.0f));
 
-            object_render_component->release_textures();
-            object_render_component->release_vbos();
-            object_render_component->release_shader();
-        }
-    }
+    object_batch.render(projection_matrix, model);
 }
+
 void MapViewer::render_gui() {
     //Calculate the projection matrix
     std::pair<int, int> size = window->get_size();
@@ -287,8 +363,9 @@ void MapViewer::render_gui() {
     //TODO: Hacky method, clean it up
     RenderableComponent* gui_render_component = gui_manager->get_renderable_component();
 
-    //Move gui_manager to the required position
-    glm::mat4 model2 = glm::mat4(1.0f);
+    //Move gui_manager to the required position. Its positions are
+    //fixed point pixels.
+    glm::mat4 model2 = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / float(PackedVertex::pixel_units)));
     gui_render_component->set_modelview_matrix(model2);
     gui_render_component->set_projection_matrix(projection_matrix);
 
@@ -300,19 +377,13 @@ void MapViewer::render_gui() {
         return;
     }
 
-    //TODO: I don't want to actually expose the shader, put these into wrappers in the shader object
-    glUniformMatrix4fv(glGetUniformLocation(gui_shader->get_program(), "mat_projection"), 1, GL_FALSE,glm::value_ptr(gui_render_component->get_projection_matrix()));
-
-    glUniformMatrix4fv(glGetUniformLocation(gui_shader->get_program(), "mat_modelview"), 1, GL_FALSE, glm::value_ptr(gui_render_component->get_modelview_matrix()));
+    gui_shader->set_uniform("mat_projection", gui_render_component->get_projection_matrix());
+    gui_shader->set_uniform("mat_modelview",  gui_render_component->get_modelview_matrix());
 
     gui_render_component->bind_vbos();
     gui_render_component->bind_textures();
 
-    glDrawArrays(GL_TRIANGLES, 0, gui_render_component->get_num_vertices_render());
-
-    gui_render_component->release_textures();
-    gui_render_component->release_vbos();
-    gui_render_component->release_shader();
+    gui_render_component->draw();
 
     gui_manager->render_text();
 }
@@ -434,6 +505,8 @@ void MapViewer::set_map(Map* new_map) {
     map_focus_object = 0;
     map_display_x = 0.0f;
     map_display_y = 0.0f;
+    chunk_cache.clear();
+    FrameDamage::mark_dirty();
 
     //Resize the map display
     resize();
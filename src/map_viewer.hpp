@@ -1,11 +1,20 @@
 #ifndef MAPVIEWER_H
 #define MAPVIEWER_H
 
+#define GLM_FORCE_RADIANS
+#include <glm/mat4x4.hpp>
 #include <glm/vec2.hpp>
+#include <memory>
+
+#include "chunk_cache.hpp"
+#include "frame_damage.hpp"
+#include "sprite_batch.hpp"
 
 class GameWindow;
 class GUIManager;
+class Layer;
 class Map;
+class Shader;
 
 class MapViewer {
 
@@ -50,15 +59,75 @@ class MapViewer {
     void render_map();
 
     ///
-    /// Render objects on the map
+    /// The shader drawing layers from their tile index textures, loaded
+    /// the first time it is needed
+    ///
+    std::shared_ptr<Shader> tilemap_shader;
+
+    ///
+    /// Render a layer as a single quad, with the tilemap shader looking
+    /// up each tile in the layer's tile index texture
+    /// @param layer the layer to render
+    /// @param projection_matrix the map's projection
+    /// @param model the map's modelview, in tiles
+    ///
+    void render_layer_tilemap(Layer *layer, const glm::mat4 &projection_matrix, const glm::mat4 &model);
+
+    ///
+    /// The map's chunks, with their layers composited
+    ///
+    ChunkCache chunk_cache;
+
+    ///
+    /// Render the chunks in view from their composited layers, drawing
+    /// those which aren't cached layer by layer
+    /// @param projection_matrix the map's projection
+    /// @param model the map's modelview, in tiles
+    /// @param chunk_x_begin the first chunk across in view
+    /// @param chunk_y_begin the first chunk up in view
+    /// @param chunk_x_end one past the last chunk across in view
+    /// @param chunk_y_end one past the last chunk up in view
+    ///
+    void render_map_cached(const glm::mat4 &projection_matrix, const glm::mat4 &model,
+                           int chunk_x_begin, int chunk_y_begin, int chunk_x_end, int chunk_y_end);
+
+    ///
+    /// Render one chunk of a layer
+    /// @param layer the layer
+    /// @param chunk_x the chunk's x index
+    /// @param chunk_y the chunk's y index
+    /// @param projection_matrix the projection to draw with
+    /// @param chunk_model the modelview from tiles, relative to the chunk
+    ///
+    void render_layer_chunk(Layer *layer, int chunk_x, int chunk_y,
+                            const glm::mat4 &projection_matrix, const glm::mat4 &chunk_model);
+
+    ///
+    /// Batches the sprites and map objects, so that they're drawn with
+    /// a few draw calls rather than some for each object
+    ///
+    SpriteBatch object_batch;
+
+    ///
+    /// Whether an object at a position could be in view
+    ///
+    bool is_in_view(glm::vec2 position);
+
+    ///
+    /// Add the objects on the map that are in view to the batch
     /// @param above_sprite if the object is to be rendered above the sprites
     ///
-    void render_objects(bool above_sprite);
+    void batch_objects(bool above_sprite);
+
+    ///
+    /// Add the sprites on the map that are in view to the batch
+    ///
+    void batch_sprites();
 
     ///
-    /// Render sprites on the map
+    /// Render the batched objects and sprites
     ///
-    void render_sprites();
+    void render_batch();
 
 public:
     MapViewer(GameWindow* window, GUIManager* manager);
@@ -131,7 +200,12 @@ public:
     /// Set the x display position of the map
     /// @param new_display_x the new display position
     ///
-    void set_display_x(float new_display_x) { map_display_x = new_display_x; }
+    void set_display_x(float new_display_x) {
+        if (map_display_x != new_display_x) {
+            map_display_x = new_display_x;
+            FrameDamage::mark_dirty();
+        }
+    }
 
     ///
     /// Get the map display bottom y position
@@ -142,7 +216,12 @@ public:
     /// Set the y display position of the map
     /// @param new_display_y the new display position
     ///
-    void set_display_y(float new_display_y) { map_display_y = new_display_y; }
+    void set_display_y(float new_display_y) {
+        if (map_display_y != new_display_y) {
+            map_display_y = new_display_y;
+            FrameDamage::mark_dirty();
+        }
+    }
 
     ///
     /// converts pixel location inside window to a map tile
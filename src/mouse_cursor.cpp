@@ -19,7 +19,9 @@ extern "C" {
 
 #include "mouse_cursor.hpp"
 
+#include "frame_damage.hpp"
 #include "game_window.hpp"
+#include "gl_state.hpp"
 #include "input_manager.hpp"
 #include "lifeline.hpp"
 #include "mouse_input_event.hpp"
@@ -43,6 +45,7 @@ MouseCursor::MouseCursor(GameWindow* window):
             x = event.to.x;
             y = event.to.y;
             dirty = true;
+            FrameDamage::mark_dirty();
         })),
     atlas(TextureAtlas::get_shared("../resources/cursor.png")),
     shader(Shader::get_shared("cursor_shader")),
@@ -62,17 +65,18 @@ MouseCursor::MouseCursor(GameWindow* window):
 }
 
 MouseCursor::~MouseCursor() {
-    glDeleteBuffers(1, &vbo);
+    GLState::delete_buffer(vbo);
 }
 
 
 void MouseCursor::display() {
     window->use_context();
 
-    glUseProgram(shader->get_program());
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, atlas->get_gl_texture());
+    GLState &gl_state(GLState::get_current());
+    gl_state.use_program(shader->get_program());
+    gl_state.bind_array_buffer(vbo);
+    gl_state.active_texture(GL_TEXTURE0);
+    gl_state.bind_texture_2d(atlas->get_gl_texture());
 
     if (dirty) {
         std::pair<float,float> lower = window->get_ratio_from_pixels(std::make_pair(x-32, y-32));
@@ -99,23 +103,26 @@ void MouseCursor::display() {
             upper.first, lower.second,
             tex_x2     , tex_y1
         };
+        gl_state.count_calls();
         glBufferData(GL_ARRAY_BUFFER, sizeof(vbo_data), vbo_data, GL_DYNAMIC_DRAW);
         dirty = false;
     }
 
     // Position data.
+    gl_state.count_calls(2);
     glVertexAttribPointer(SHADER_LOCATION_POSITION, 2, GL_FLOAT, GL_FALSE, 4 * (GLsizei)sizeof(GLfloat), (GLvoid*)(0 * sizeof(GLfloat)));
     // Texture data.
     glVertexAttribPointer(SHADER_LOCATION_TEXTURE, 2, GL_FLOAT, GL_FALSE, 4 * (GLsizei)sizeof(GLfloat), (GLvoid*)(2 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(SHADER_LOCATION_POSITION);
-    glEnableVertexAttribArray(SHADER_LOCATION_TEXTURE);
+    gl_state.enable_vertex_attrib_array(SHADER_LOCATION_POSITION);
+    gl_state.enable_vertex_attrib_array(SHADER_LOCATION_TEXTURE);
     
-    glDisable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
+    gl_state.disable(GL_DEPTH_TEST);
+    gl_state.enable(GL_BLEND);
 
+    gl_state.count_calls();
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    gl_state.draw_arrays(GL_TRIANGLES, 0, 6);
 
-    glEnable(GL_DEPTH_TEST);
+    gl_state.enable(GL_DEPTH_TEST);
 }
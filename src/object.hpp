@@ -4,6 +4,7 @@
 #include <memory>
 #include <string>
 
+#include "frame_damage.hpp"
 #include "renderable_component.hpp"
 
 
@@ -84,7 +85,12 @@ public:
     /// Set whether the object can be rendered
     /// @param can_render true if the object can be rendered and false if not
     ///
-    void set_renderable(bool can_render) { renderable = can_render; }
+    void set_renderable(bool can_render) {
+        if (renderable != can_render) {
+            renderable = can_render;
+            FrameDamage::mark_dirty();
+        }
+    }
 
     ///
     /// The Python thread for running scripts in.
@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+
+#if defined(USE_GL)
+#define GL_GLEXT_PROTOTYPES
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+#include "packed_vertex.hpp"
+
+const int PackedVertex::tile_units;
+const int PackedVertex::pixel_units;
+const int PackedQuad::num_vertices;
+const int PackedQuad::num_indices;
+
+GLshort PackedVertex::pack_position(float position, int units) {
+    float packed(std::round(position * float(units)));
+    packed = std::min(packed, float(std::numeric_limits<GLshort>::max()));
+    packed = std::max(packed, float(std::numeric_limits<GLshort>::min()));
+
+    return GLshort(packed);
+}
+
+GLushort PackedVertex::pack_tex_coord(float tex_coord) {
+    float packed(std::round(tex_coord * float(std::numeric_limits<GLushort>::max())));
+    packed = std::min(packed, float(std::numeric_limits<GLushort>::max()));
+    packed = std::max(packed, 0.0f);
+
+    return GLushort(packed);
+}
+
+void PackedQuad::set_position(GLshort left, GLshort bottom, GLshort right, GLshort top) {
+    vertices[0].x = left;  vertices[0].y = bottom;
+    vertices[1].x = left;  vertices[1].y = top;
+    vertices[2].x = right; vertices[2].y = top;
+    vertices[3].x = right; vertices[3].y = bottom;
+}
+
+void PackedQuad::set_tex_coords(std::tuple<float, float, float, float> bounds) {
+    GLushort left  (PackedVertex::pack_tex_coord(std::get<0>(bounds)));
+    GLushort right (PackedVertex::pack_tex_coord(std::get<1>(bounds)));
+    GLushort bottom(PackedVertex::pack_tex_coord(std::get<2>(bounds)));
+    GLushort top   (PackedVertex::pack_tex_coord(std::get<3>(bounds)));
+
+    vertices[0].u = left;  vertices[0].v = bottom;
+    vertices[1].u = left;  vertices[1].v = top;
+    vertices[2].u = right; vertices[2].v = top;
+    vertices[3].u = right; vertices[3].v = bottom;
+}
+
+void PackedQuad::set_from_triangles(const GLfloat *triangle_vertices, const GLfloat *tex_coords, int units) {
+    // Bottom left, top left, top right and bottom right are the 0th,
+    // 1st, 4th and 5th of the triangles' vertices
+    const int corners[num_vertices] = {0, 1, 4, 5};
+
+    for (int i = 0; i < num_vertices; ++i) {
+        int corner(corners[i]);
+        vertices[i].x = PackedVertex::pack_position(triangle_vertices[corner * 2 + 0], units);
+        vertices[i].y = PackedVertex::pack_position(triangle_vertices[corner * 2 + 1], units);
+        vertices[i].u = PackedVertex::pack_tex_coord(tex_coords[corner * 2 + 0]);
+        vertices[i].v = PackedVertex::pack_tex_coord(tex_coords[corner * 2 + 1]);
+    }
+}
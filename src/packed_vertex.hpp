@@ -0,0 +1,110 @@
+#ifndef PACKED_VERTEX_H
+#define PACKED_VERTEX_H
+
+#include <tuple>
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+
+#if defined(USE_GL)
+#define GL_GLEXT_PROTOTYPES
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+///
+/// A vertex packed into 8 bytes, with its position and texture
+/// coordinates interleaved.
+///
+/// Positions are fixed point, in units chosen by whoever draws them,
+/// and are given to the shader as-is; the modelview matrix scales
+/// them back. Texture coordinates are normalised, so 65535 is 1.0.
+///
+struct PackedVertex {
+    ///
+    /// The number of position units in a tile
+    ///
+    static const int tile_units = 256;
+
+    ///
+    /// The number of position units in a pixel
+    ///
+    static const int pixel_units = 4;
+
+    GLshort x;
+    GLshort y;
+    GLushort u;
+    GLushort v;
+
+    ///
+    /// Convert a position to fixed point, clamping it to the range
+    /// @param position the position
+    /// @param units the number of fixed point units in one
+    ///
+    static GLshort pack_position(float position, int units);
+
+    ///
+    /// Normalise a texture coordinate, clamping it to [0, 1]
+    ///
+    static GLushort pack_tex_coord(float tex_coord);
+};
+
+///
+/// A quad of four packed vertices, drawn as two triangles with the
+/// indices from QuadIndexBuffer.
+///
+/// Vertex order:
+/// 1     2
+///  * --- *
+///  |     |
+///  |     |
+///  * --- *
+/// 0     3
+///
+/// A quad which is all zeros is degenerate, so isn't drawn.
+///
+struct PackedQuad {
+    ///
+    /// The number of vertices in a quad
+    ///
+    static const int num_vertices = 4;
+
+    ///
+    /// The number of indices drawn for a quad
+    ///
+    static const int num_indices = 6;
+
+    PackedVertex vertices[num_vertices];
+
+    ///
+    /// Set the corners of the quad
+    /// @param left the left edge, in fixed point units
+    /// @param bottom the bottom edge, in fixed point units
+    /// @param right the right edge, in fixed point units
+    /// @param top the top edge, in fixed point units
+    ///
+    void set_position(GLshort left, GLshort bottom, GLshort right, GLshort top);
+
+    ///
+    /// Set the texture coordinates of the quad
+    /// @param bounds the texture coordinates of the left, right, bottom
+    ///        and top edges, as from TextureAtlas::index_to_coords
+    ///
+    void set_tex_coords(std::tuple<float, float, float, float> bounds);
+
+    ///
+    /// Pack a quad given as two triangles of floats, in the order
+    /// bottom left, top left, bottom right, top left, top right,
+    /// bottom right.
+    /// @param vertices the 12 floats of the positions
+    /// @param tex_coords the 12 floats of the texture coordinates
+    /// @param units the number of fixed point units in one
+    ///
+    void set_from_triangles(const GLfloat *vertices, const GLfloat *tex_coords, int units);
+};
+
+#endif
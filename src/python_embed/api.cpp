@@ -5,12 +5,16 @@
 #include <boost/multi_index/detail/ord_index_node.hpp>
 #include <boost/python/list.hpp>
 #include <boost/range/adaptor/reversed.hpp>
+#include <chrono>
+#include <exception>
 #include <glm/vec2.hpp>
 #include <glog/logging.h>
 #include <ostream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include "api.hpp"
@@ -18,30 +22,73 @@
 #include "event_manager.hpp"
 #include "game_time.hpp"
 #include "gil_safe_future.hpp"
+#include "locks.hpp"
 #include "object_manager.hpp"
+#include "snapshot_buffer.hpp"
 #include "sprite.hpp"
+#include "world_snapshot.hpp"
+
+namespace {
+    ///
+    /// How long to wait for a snapshot showing an entity's change before
+    /// asking the main thread instead
+    ///
+    const std::chrono::milliseconds snapshot_timeout(500);
+}
 
 
 Entity::Entity(glm::vec2 start, std::string name, int id):
-    start(start), id(id), call_number(0) {
+    start(start), snapshot_generation(0), id(id), call_number(0) {
         this->name = std::string(name);
 }
 
+void Entity::changed_world() {
+    // The change was made by the main thread, which publishes a snapshot
+    // after it. That may already have been published, but waiting for
+    // the one after is never wrong.
+    snapshot_generation = SnapshotBuffer::get_instance().get_generation() + 1;
+}
+
+bool Entity::wait_for_snapshot() {
+    SnapshotBuffer &snapshots(SnapshotBuffer::get_instance());
+    if (snapshots.get_generation() >= snapshot_generation) {
+        return true;
+    }
+
+    lock::ThreadGILRelease unlock_thread;
+    // Snapshots are published after events, so make sure there are some
+    // even if the main thread is idle
+    EventManager::get_instance().add_event([] () {});
+    return snapshots.wait_for(snapshot_generation, snapshot_timeout);
+}
+
 bool Entity::move(int x, int y) {
     ++call_number;
 
     auto id = this->id;
-    return GilSafeFuture<bool>::execute(
+    bool walk_succeeded(GilSafeFuture<bool>::execute(
         [id, x, y] (GilSafeFuture<bool> walk_succeeded_return) {
             Engine::move_object(id, glm::ivec2(x, y), walk_succeeded_return);
         },
         false
-    );
+    ));
+
+    changed_world();
+    return walk_succeeded;
 }
 
 bool Entity::walkable(int x, int y) {
     ++call_number;
 
+    if (wait_for_snapshot()) {
+        SnapshotBuffer::Reader snapshot(SnapshotBuffer::get_instance().read());
+        const WorldSnapshot::Object *object(snapshot->find_object(id));
+
+        if (object) {
+            return snapshot->walkable(glm::ivec2(object->position) + glm::ivec2(x, y));
+        }
+    }
+
     auto id = this->id;
     return GilSafeFuture<bool>::execute(
         [id, x, y] (GilSafeFuture<bool> walk_succeeded_return) {
@@ -79,19 +126,48 @@ bool Entity::cut(int x, int y) {
     ++call_number;
 
     auto id = this->id;
-    return GilSafeFuture<bool>::execute(
+    bool cut_succeeded(GilSafeFuture<bool>::execute(
         [id, x, y] (GilSafeFuture<bool> cut_succeeded_return) {
             //we are in an even
             bool result = Engine::cut(id, glm::ivec2(x, y));
             cut_succeeded_return.set(result);
         },
         true
-    );
+    ));
+
+    changed_world();
+    return cut_succeeded;
 }
 
 py::list Entity::look(int search_range) {
     ++call_number;
 
+    if (wait_for_snapshot()) {
+        std::vector<std::tuple<std::string, int, int>> objects_found;
+        bool found(false);
+        {
+            SnapshotBuffer::Reader snapshot(SnapshotBuffer::get_instance().read());
+            const WorldSnapshot::Object *object(snapshot->find_object(id));
+
+            if (object && object->sprite) {
+                objects_found = snapshot->look(*object, search_range);
+                found = true;
+            }
+        }
+
+        if (found) {
+            py::list objects;
+            for (auto object : objects_found) {
+                objects.append(py::make_tuple(
+                    py::api::object(std::get<0>(object)),
+                    py::api::object(std::get<1>(object)),
+                    py::api::object(std::get<2>(object))
+                ));
+            }
+            return objects;
+        }
+    }
+
     auto id = this->id;
     return GilSafeFuture<py::list>::execute(
         [id, search_range] (GilSafeFuture<py::list> found_objects_return) {
@@ -113,7 +189,49 @@ py::list Entity::look(int search_range) {
     );
 }
 
+bool Entity::change_tiles(std::string layer_name, py::list tiles) {
+    ++call_number;
+
+    // Unpack the list here, while we hold the GIL
+    std::vector<std::pair<glm::ivec2, std::string>> changes;
+    for (py::ssize_t i = 0; i < py::len(tiles); ++i) {
+        py::object tile(tiles[i]);
+        changes.push_back(std::make_pair(
+            glm::ivec2(py::extract<int>(tile[0]), py::extract<int>(tile[1])),
+            py::extract<std::string>(tile[2])()
+        ));
+    }
+
+    bool change_succeeded(GilSafeFuture<bool>::execute(
+        [layer_name, changes] (GilSafeFuture<bool> change_succeeded_return) {
+            try {
+                Engine::change_tiles(layer_name, changes);
+                change_succeeded_return.set(true);
+            }
+            // Layer throws LayerInvalidException, which isn't a
+            // runtime_error, and an uncaught one would end the game
+            catch (std::exception &e) {
+                LOG(WARNING) << "Couldn't change tiles: " << e.what();
+                change_succeeded_return.set(false);
+            }
+        },
+        false
+    ));
+
+    changed_world();
+    return change_succeeded;
+}
+
 std::string Entity::get_instructions() {
+    if (wait_for_snapshot()) {
+        SnapshotBuffer::Reader snapshot(SnapshotBuffer::get_instance().read());
+        const WorldSnapshot::Object *object(snapshot->find_object(id));
+
+        if (object && object->sprite) {
+            return object->instructions;
+        }
+    }
+
     auto id(this->id);
     return GilSafeFuture<std::string>::execute([id] (GilSafeFuture<std::string> instructions_return) {
         auto sprite(ObjectManager::get_instance().get_object<Sprite>(id));
@@ -156,6 +274,31 @@ void Entity::py_update_status(std::string status){
 //
 // but I blame C++
 py::list Entity::get_retrace_steps() {
+    if (wait_for_snapshot()) {
+        std::vector<glm::vec2> steps;
+        bool found(false);
+        {
+            SnapshotBuffer::Reader snapshot(SnapshotBuffer::get_instance().read());
+            const WorldSnapshot::Object *object(snapshot->find_object(id));
+
+            if (object && object->sprite) {
+                steps = WorldSnapshot::get_retrace_steps(*object);
+                found = true;
+            }
+        }
+
+        if (found) {
+            py::list retrace_steps;
+            for (glm::vec2 step : steps) {
+                retrace_steps.append(py::make_tuple(
+                    py::api::object(float(step.x)),
+                    py::api::object(float(step.y))
+                ));
+            }
+            return retrace_steps;
+        }
+    }
+
     auto id(this->id);
     return GilSafeFuture<py::list>::execute([id] (GilSafeFuture<py::list> retrace_steps_return) {
         py::list retrace_steps;
@@ -14,6 +14,11 @@ namespace py = boost::python;
 ///
 /// Player object passable to Python after wrapping.
 ///
+/// Calls which change the world are run by the main thread as events,
+/// and wait for it. Queries are answered from the latest SnapshotBuffer
+/// snapshot instead, falling back to asking the main thread when the
+/// entity isn't in it.
+///
 class Entity {
     private:
         ///
@@ -21,6 +26,27 @@ class Entity {
         ///
         glm::vec2 start;
 
+        ///
+        /// The generation of world snapshot which will show this
+        /// entity's last change to the world. Queries wait for it, so
+        /// they see their own changes.
+        ///
+        uint64_t snapshot_generation;
+
+        ///
+        /// Note that this entity has changed the world.
+        ///
+        void changed_world();
+
+        ///
+        /// Wait for a snapshot which shows this entity's last change.
+        ///
+        /// @return
+        ///     Whether one was published. If not, queries should ask the
+        ///     main thread instead.
+        ///
+        bool wait_for_snapshot();
+
 
     public:
         ///
@@ -116,6 +142,23 @@ class Entity {
         ///
         py::list look(int search_range);
 
+        ///
+        /// Change many tiles of a layer of the map at once. The tiles
+        /// are all changed in the same frame.
+        ///
+        /// @param layer_name
+        ///     the layer of the tiles to change
+        ///
+        /// @param tiles
+        ///     a list of (x, y, tile_name) tuples, where tile_name is
+        ///     the global name of the new tile or "" to clear it
+        ///
+        /// @return
+        ///     Whether the tiles were changed. If the layer or any of
+        ///     the names are unknown, no tiles are changed.
+        ///
+        bool change_tiles(std::string layer_name, py::list tiles);
+
         void py_print_debug(std::string text);
         void py_print_dialogue(std::string text);
 
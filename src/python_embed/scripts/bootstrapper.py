@@ -70,6 +70,16 @@ def create_execution_scope(entity):
         else:
             entity.print_dialogue(entity.get_instructions())
 
+    def change_tiles(layer_name: str, tiles: [(int, int, str)]) -> bool:
+        """
+        Change many tiles of a layer of the map at once.
+        Takes a list of (x, y, tile_name) tuples, and returns
+        whether the tiles could all be changed.
+        """
+
+        tiles = [(cast("int", x), cast("int", y), str(name)) for x, y, name in tiles]
+        return entity.change_tiles(layer_name, tiles)
+
     def get_retrace_steps():
         """
         Get a list of directions to move in that will undo all
@@ -138,6 +148,7 @@ def create_execution_scope(entity):
         "east": east,
         "west": west,
 
+        "change_tiles": change_tiles,
         "cut": cut,
         "help": help,
         "get_retrace_steps": get_retrace_steps,
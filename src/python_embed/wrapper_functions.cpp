@@ -12,6 +12,7 @@ BOOST_PYTHON_MODULE(wrapper_functions) {
         .def_readwrite("id",      &Entity::id)
         .def_readwrite("name",    &Entity::name)
         .def("__set_game_speed",  &Entity::__set_game_speed)
+        .def("change_tiles",      &Entity::change_tiles)
         .def("cut",               &Entity::cut)
         .def("get_instructions",  &Entity::get_instructions)
         .def("get_retrace_steps", &Entity::get_retrace_steps)
@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <glog/logging.h>
+#include <vector>
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+
+#if defined(USE_GL)
+#define GL_GLEXT_PROTOTYPES
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+#include "gl_state.hpp"
+#include "graphics_context.hpp"
+#include "packed_vertex.hpp"
+#include "quad_index_buffer.hpp"
+
+const int QuadIndexBuffer::max_quads;
+
+QuadIndexBuffer &QuadIndexBuffer::get_current() {
+    return CHECK_NOTNULL(GraphicsContext::get_current())->get_quad_index_buffer();
+}
+
+void QuadIndexBuffer::bind(int num_quads) {
+    CHECK(num_quads <= max_quads);
+
+    GLState &gl_state(GLState::get_current());
+
+    if (buffer == 0) {
+        glGenBuffers(1, &buffer);
+        gl_state.count_calls();
+    }
+
+    gl_state.bind_element_array_buffer(buffer);
+
+    if (num_quads <= capacity) {
+        return;
+    }
+
+    // Grow geometrically, so that the buffer soon settles
+    capacity = std::min(std::max(num_quads, capacity * 2), max_quads);
+    VLOG(1) << "Growing the quad index buffer to " << capacity << " quads";
+
+    std::vector<GLushort> indices;
+    indices.reserve(size_t(capacity * PackedQuad::num_indices));
+
+    for (int quad = 0; quad < capacity; ++quad) {
+        GLushort first(GLushort(quad * PackedQuad::num_vertices));
+
+        // Bottom left, top left, bottom right
+        indices.push_back(GLushort(first + 0));
+        indices.push_back(GLushort(first + 1));
+        indices.push_back(GLushort(first + 3));
+
+        // Top left, top right, bottom right
+        indices.push_back(GLushort(first + 1));
+        indices.push_back(GLushort(first + 2));
+        indices.push_back(GLushort(first + 3));
+    }
+
+    gl_state.count_calls();
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 GLsizeiptr(sizeof(GLushort) * indices.size()),
+                 indices.data(),
+                 GL_STATIC_DRAW);
+}
+
+void QuadIndexBuffer::draw(int first_quad, int num_quads) {
+    CHECK(first_quad + num_quads <= capacity);
+
+    GLState::get_current().draw_elements(GL_TRIANGLES,
+                                         num_quads * PackedQuad::num_indices,
+                                         GL_UNSIGNED_SHORT,
+                                         sizeof(GLushort) * size_t(first_quad * PackedQuad::num_indices));
+}
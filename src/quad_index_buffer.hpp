@@ -0,0 +1,68 @@
+#ifndef QUAD_INDEX_BUFFER_H
+#define QUAD_INDEX_BUFFER_H
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+
+#if defined(USE_GL)
+#define GL_GLEXT_PROTOTYPES
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+///
+/// The element array buffer shared by everything that draws
+/// PackedQuads, holding the two triangles of each quad.
+///
+/// There is one for each GraphicsContext. It is static once it has
+/// grown to the largest number of quads drawn at once, so drawing a
+/// quad only sends its four vertices rather than six.
+///
+class QuadIndexBuffer {
+    ///
+    /// The GL buffer, made when first bound
+    ///
+    GLuint buffer = 0;
+
+    ///
+    /// The number of quads the buffer has indices for
+    ///
+    int capacity = 0;
+
+    QuadIndexBuffer(const QuadIndexBuffer &) = delete;
+    QuadIndexBuffer &operator=(const QuadIndexBuffer &) = delete;
+
+public:
+    ///
+    /// The most quads which can be drawn from one vertex buffer
+    /// offset, as the indices are GLushorts
+    ///
+    static const int max_quads = 65536 / 4;
+
+    QuadIndexBuffer() {}
+
+    ///
+    /// Get the buffer of the current graphics context
+    ///
+    static QuadIndexBuffer &get_current();
+
+    ///
+    /// Bind the buffer, growing it to hold at least a number of quads
+    /// @param num_quads the number of quads to draw, at most max_quads
+    ///
+    void bind(int num_quads);
+
+    ///
+    /// Draw quads from the bound vertex buffer. The index buffer must
+    /// be bound and hold enough quads.
+    /// @param first_quad the first quad to draw
+    /// @param num_quads the number of quads to draw
+    ///
+    void draw(int first_quad, int num_quads);
+};
+
+#endif
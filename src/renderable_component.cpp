@@ -1,8 +1,13 @@
+#include <algorithm>
+#include <cstddef>
 #include <memory>
 #include <ostream>
 
 #include <glog/logging.h>
 
+#include "gl_state.hpp"
+#include "packed_vertex.hpp"
+#include "quad_index_buffer.hpp"
 #include "shader.hpp"
 #include "texture_atlas.hpp"
 #include "renderable_component.hpp"
@@ -12,148 +17,112 @@
 
 RenderableComponent::RenderableComponent() {
 
-    //Generate the vertex buffers
-    glGenBuffers(1, &vbo_vertex_id);
-    glGenBuffers(1, &vbo_texture_id);
-    LOG(INFO) << "RenderableComponent::RenderableComponent: Buffers "<< vbo_vertex_id;
-    LOG(INFO) << "RenderableComponent::RenderableComponent: Buffers " << vbo_texture_id;
+    //Generate the vertex buffer
+    glGenBuffers(1, &vbo_id);
+    LOG(INFO) << "RenderableComponent::RenderableComponent: Buffer " << vbo_id;
 }
 
 RenderableComponent::~RenderableComponent() {
-    //Delete the vertex buffers
-    glDeleteBuffers(1, &vbo_vertex_id);
-    glDeleteBuffers(1, &vbo_texture_id);
+    //Delete the vertex buffer
+    GLState::delete_buffer(vbo_id);
 
-    delete[] vertex_data;
-    delete[] texture_coords_data;
+    delete[] quad_data;
 }
-void RenderableComponent::set_vertex_data(GLfloat* new_vertex_data, size_t data_size, bool is_dynamic) {
-    delete[] vertex_data;
-    vertex_data = new_vertex_data;
-    vertex_data_size = data_size;
 
-    //Get current shader
-    GLint id;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &id);
-
-    //Bind our shader
-    bind_shader();
+void RenderableComponent::set_quad_data(PackedQuad* new_quad_data, int new_num_quads, bool is_dynamic) {
+    delete[] quad_data;
+    quad_data = new_quad_data;
+    num_quads = new_num_quads;
+    dirty_begin = dirty_end = 0;
 
     //Set up buffer usage
     GLenum usage = GL_STATIC_DRAW;
     if(is_dynamic)
         usage = GL_DYNAMIC_DRAW;
 
-    //Pass in data to the buffer buffer
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_vertex_id);
-    glBufferData(GL_ARRAY_BUFFER, vertex_data_size, vertex_data, usage);
-
-    //Restore previous program
-    glUseProgram(id);
+    //Pass in data to the buffer. The buffer binding doesn't depend on
+    //the program, so there's no need to bind ours.
+    GLState &gl_state(GLState::get_current());
+    gl_state.bind_array_buffer(vbo_id);
+    gl_state.count_calls();
+    glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(sizeof(PackedQuad) * size_t(num_quads)), quad_data, usage);
 }
 
 void RenderableComponent::set_texture(std::shared_ptr<TextureAtlas> texture_atlas) {
     this->texture_atlas = texture_atlas;
 }
 
-void RenderableComponent::set_texture_coords_data(GLfloat* new_texture_data, size_t data_size, bool is_dynamic) {
-    delete[] texture_coords_data;
-    texture_coords_data = new_texture_data;
-    texture_coords_data_size = data_size;
-    //Get current shader
-    GLint id;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &id);
-
-    //Bind our shader
-    bind_shader();
-
-    //Set up buffer usage
-    GLenum usage = GL_STATIC_DRAW;
-    if(is_dynamic)
-        usage = GL_DYNAMIC_DRAW;
-
-    //Pass in data to the buffer buffer
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_texture_id);
-    glBufferData(GL_ARRAY_BUFFER, texture_coords_data_size, texture_coords_data, usage);
-
-    //Release shader
-    glUseProgram(id);
+void RenderableComponent::set_attrib_pointers(int first_quad) {
+    GLState &gl_state(GLState::get_current());
+    size_t offset(sizeof(PackedQuad) * size_t(first_quad));
+
+    // Positions are fixed point, given to the shader unnormalised;
+    // texture coordinates are normalised to [0, 1]
+    gl_state.count_calls(2);
+    glVertexAttribPointer(VERTEX_POS_INDX, 2, GL_SHORT, GL_FALSE, sizeof(PackedVertex),
+                          reinterpret_cast<GLvoid *>(offset + offsetof(PackedVertex, x)));
+    glVertexAttribPointer(VERTEX_TEXCOORD0_INDX, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex),
+                          reinterpret_cast<GLvoid *>(offset + offsetof(PackedVertex, u)));
+    gl_state.enable_vertex_attrib_array(VERTEX_POS_INDX);
+    gl_state.enable_vertex_attrib_array(VERTEX_TEXCOORD0_INDX);
 }
 
 void RenderableComponent::bind_vbos() {
+    GLState::get_current().bind_array_buffer(vbo_id);
+    set_attrib_pointers(0);
 
-    //Bind the vertex data buffer
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_vertex_id);
-    glVertexAttribPointer(0 /*VERTEX_POS_INDX*/, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-    glEnableVertexAttribArray(0 /* VERTEX_POS_INDX */);
-
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_texture_id);
-    glVertexAttribPointer(1 /* VERTEX_TEXCOORD0_INDX */, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-    glEnableVertexAttribArray( 1 /*VERTEX_TEXCOORD0_INDX*/);
-    //    glBindAttribLocation(shader->get_program(), glGetAttribLocation(shader->get_program(), "a_position") /*VERTEX_POS_INDX*/, "a_position");
-
-    //    glBindAttribLocation(shader->get_program(), glGetAttribLocation(shader->get_program(), "a_texCoord")                         /*VERTEX_TEXCOORD0_INDX*/, "a_texCoord");
-
-
-    //set sampler texture to unit 0
-    glUniform1i(glGetUniformLocation(shader->get_program(), "s_texture"), 0);
+    QuadIndexBuffer::get_current().bind(num_quads);
 }
-void RenderableComponent::bind_textures() {
-    glActiveTexture(GL_TEXTURE0);
 
-    //Bind tiles texture
-    glBindTexture(GL_TEXTURE_2D, texture_atlas->get_gl_texture());
+void RenderableComponent::draw() {
+    QuadIndexBuffer::get_current().draw(0, num_quads);
 }
 
-void RenderableComponent::release_textures() {
-    glBindTexture(GL_TEXTURE_2D, 0);
-}
-void RenderableComponent::release_vbos() {
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+void RenderableComponent::bind_textures() {
+    GLState &gl_state(GLState::get_current());
+    gl_state.active_texture(GL_TEXTURE0);
 
+    //Bind tiles texture
+    gl_state.bind_texture_2d(texture_atlas->get_gl_texture());
 }
 
 void RenderableComponent::bind_shader() {
     if(!shader)
         return;
-    glUseProgram(shader->get_program());
-}
 
-void RenderableComponent::release_shader() {
-    glUseProgram(0);
-}
-
-void RenderableComponent::update_vertex_buffer(GLintptr offset, size_t size, GLfloat* data) {
-    //Get current shader
-    GLint id;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &id);
+    GLState::get_current().use_program(shader->get_program());
 
-    //Bind our shader
-    bind_shader();
+    //set sampler texture to unit 0
+    shader->set_uniform("s_texture", 0);
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_vertex_id);
+void RenderableComponent::update_quad_data(int quad, const PackedQuad &data) {
+    CHECK(quad >= 0 && quad < num_quads);
 
-    //Update the buffer
-    glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+    quad_data[quad] = data;
 
-    //Release shader
-    glUseProgram(id);
+    if (dirty_begin < dirty_end) {
+        dirty_begin = std::min(dirty_begin, quad);
+        dirty_end   = std::max(dirty_end,   quad + 1);
+    }
+    else {
+        dirty_begin = quad;
+        dirty_end   = quad + 1;
+    }
 }
 
-void RenderableComponent::update_texture_buffer(GLintptr offset, size_t size, GLfloat* data) {
-    //Get current shader
-    GLint id;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &id);
-
-    //Bind our shader
-    bind_shader();
+void RenderableComponent::upload_dirty_data() {
+    if (dirty_begin >= dirty_end) {
+        return;
+    }
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_texture_id);
+    GLState &gl_state(GLState::get_current());
+    gl_state.bind_array_buffer(vbo_id);
+    gl_state.count_calls();
+    glBufferSubData(GL_ARRAY_BUFFER,
+                    GLintptr(sizeof(PackedQuad) * size_t(dirty_begin)),
+                    GLsizeiptr(sizeof(PackedQuad) * size_t(dirty_end - dirty_begin)),
+                    &quad_data[dirty_begin]);
 
-    //Update the buffer
-    glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
-    LOG(INFO) << " BUF " << vbo_texture_id;
-    //Release shader
-    glUseProgram(id);
+    dirty_begin = dirty_end = 0;
 }
-
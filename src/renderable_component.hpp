@@ -22,6 +22,8 @@
 #endif
 #endif
 
+#include "packed_vertex.hpp"
+
 class Shader;
 class TextureAtlas;
 
@@ -45,29 +47,21 @@ class TextureAtlas;
 ///
 class RenderableComponent {
     ///
-    /// The buffer holding the vertex data
-    ///
-    GLfloat* vertex_data = nullptr;
-
-    ///
-    /// The size of the vertex data in bytes
-    ///
-    size_t vertex_data_size = 0;
-
-    ///
-    /// The number of vertices to render
+    /// The quads, as interleaved packed vertices
     ///
-    GLsizei num_vertices_render = 0;
+    PackedQuad* quad_data = nullptr;
 
     ///
-    /// The buffer holding the texture coordinate data
+    /// The number of quads in the quad data
     ///
-    GLfloat* texture_coords_data = nullptr;
+    int num_quads = 0;
 
     ///
-    /// The size of the texture coordinate buffer in bytes
+    /// The range of quads which have changed since they were last
+    /// uploaded. Empty if the begin isn't before the end.
     ///
-    size_t texture_coords_data_size = 0;
+    int dirty_begin = 0;
+    int dirty_end = 0;
 
     ///
     /// Texture atlas holding abstracted and managed gl texture.
@@ -75,14 +69,9 @@ class RenderableComponent {
     std::shared_ptr<TextureAtlas> texture_atlas;
 
     ///
-    /// The vertex buffer object identifier for the vertex buffer
+    /// The vertex buffer object identifier for the quads
     ///
-    GLuint vbo_vertex_id = 0;
-
-    ///
-    /// The vertex buffer object identifier for the texture buffer
-    ///
-    GLuint vbo_texture_id = 0;
+    GLuint vbo_id = 0;
 
     ///
     /// The width of this component
@@ -140,14 +129,13 @@ public:
     void set_modelview_matrix(glm::mat4 new_modelview_matrix) { modelview_matrix = new_modelview_matrix; }
 
     ///
-    /// Bind the shader program to the Opengl pipeline to use it for rendering
+    /// Bind the shader program to the Opengl pipeline to use it for
+    /// rendering, with its sampler on texture unit 0.
     ///
-    void bind_shader();
-
-    ///
-    /// Release the shader program from the Opengl pipeline
+    /// Bindings are left in place after drawing, as GLState skips
+    /// binding them again.
     ///
-    void release_shader();
+    void bind_shader();
 
     ///
     /// Sets the shader to use for this component
@@ -160,50 +148,41 @@ public:
     std::shared_ptr<Shader> get_shader() { return shader; }
 
     ///
-    /// Bind the vertex buffers
+    /// Bind the vertex buffer and the quad index buffer
     ///
     void bind_vbos();
 
     ///
-    /// Release the vertex buffers
+    /// Point the vertex attributes at packed quads in the bound vertex
+    /// buffer
+    /// @param first_quad the quad in the buffer to start from
     ///
-    void release_vbos();
+    static void set_attrib_pointers(int first_quad);
 
     ///
-    /// Get a pointer to the vertex data
+    /// Draw all the quads, after binding the shader, vertex buffers
+    /// and textures
     ///
-    GLfloat* get_vertex_data() { return vertex_data; }
+    void draw();
 
     ///
-    /// Get the size of the vertex data
+    /// Get a pointer to the quad data
     ///
-    size_t get_vertex_data_size() { return vertex_data_size; }
+    PackedQuad* get_quad_data() { return quad_data; }
 
     ///
-    /// Set the vertex data to use for this component.
-    /// @param new_vertex_data The new data to use for ther vertices of this object
-    /// @param the size of the data in bytes
-    /// @param is_dynamic If true, then the data for this buffer will be changed often. If false, it is static geometry
-    ///
-    void set_vertex_data(GLfloat* new_vertex_data, size_t data_size,  bool is_dynamic);
-
-    ///
-    /// Get a pointer to the texture coordinate data
+    /// Get the number of quads
     ///
-    GLfloat* get_texture_coords_data() { return texture_coords_data; }
+    int get_num_quads() { return num_quads; }
 
     ///
-    /// Set the texture coordinate data to use for this component
-    /// @param new_texture_data The new data to use for ther tehadxture coordinates of this object
-    /// @param data_size The size of the data in bytes
-    /// @param is_dynamic If true, then the data for this buffer will be changed often. If false, it is static
+    /// Set the quads to use for this component.
+    /// @param new_quad_data The new quads, which this component takes ownership of
+    /// @param new_num_quads The number of quads
+    /// @param is_dynamic If true, then the data for this buffer will be changed often. If false, it is static geometry
     ///
-    void set_texture_coords_data(GLfloat* new_texture_data, size_t data_size, bool is_dynamic);
+    void set_quad_data(PackedQuad* new_quad_data, int new_num_quads, bool is_dynamic);
 
-    ///
-    /// Get the texture coords data size
-    ///
-    size_t get_texture_coords_data_size() { return texture_coords_data_size; }
     ///
     /// Set the texture atlas.
     ///
@@ -236,35 +215,25 @@ public:
     void bind_textures();
 
     ///
-    /// Release the texture objects
-    ///
-    void release_textures();
-
-    ///
-    /// Get the number of vertices to render
-    ///
-    GLsizei get_num_vertices_render() { return num_vertices_render; }
-
-    ///
-    /// Set the number of vertices we need to render
+    /// Change a quad, without uploading it. The changes are uploaded
+    /// by upload_dirty_data.
+    /// @param quad the index of the quad
+    /// @param data the new quad
     ///
-    void set_num_vertices_render(GLsizei num_vertices) { num_vertices_render = num_vertices; }
+    void update_quad_data(int quad, const PackedQuad &data);
 
     ///
-    /// Update the texture buffer
-    /// @param offset the byte offset into the buffer
-    /// @param size the size of the data to put into the buffer in bytes
-    /// @param data the data to put into the buffer
+    /// Whether there are changes to the data which haven't been
+    /// uploaded
     ///
-    void update_texture_buffer(GLintptr offset, size_t size, GLfloat* data);
+    bool has_dirty_data() { return dirty_begin < dirty_end; }
 
     ///
-    /// Update the vertex buffer
-    /// @param offset the byte offset into the buffer
-    /// @param size the size of the data to put into the buffer in bytes
-    /// @param data the data to put into the buffer
+    /// Upload the changed data. All the changes since the last upload
+    /// are sent with a single glBufferSubData, covering the range from
+    /// the first changed quad to the last.
     ///
-    void update_vertex_buffer(GLintptr offset, size_t size, GLfloat* data);
+    void upload_dirty_data();
 
 };
 
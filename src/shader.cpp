@@ -1,9 +1,18 @@
+#include <algorithm>
 #include <glog/logging.h>
 #include <fstream>
+#include <iterator>
+#include <map>
 #include <memory>
 #include <stdexcept>
 #include <string>
 #include <sstream>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
 
 #if defined(USE_GL)
 #define GL_GLEXT_PROTOTYPES
@@ -19,6 +28,7 @@
 #endif
 
 #include "cacheable_resource.hpp"
+#include "gl_state.hpp"
 #include "resource_cache.hpp"
 #include "shader.hpp"
 
@@ -106,6 +116,8 @@ Shader::Shader(const std::string vs, const std::string fs): CacheableResource()
         throw Shader::LoadException("Unable to link shader program");
     }
 
+    cache_uniform_locations();
+
     loaded = true;
 }
 
@@ -167,4 +179,96 @@ void Shader::bind_location_to_attribute(GLuint location, const char* variable) {
 
 void Shader::link() {
     glLinkProgram(program_obj);
+
+    // Linking can move the uniforms, and resets their values
+    cache_uniform_locations();
+}
+
+
+void Shader::cache_uniform_locations() {
+    uniform_locations.clear();
+    uniform_int_values.clear();
+
+    GLint num_uniforms(0);
+    GLint max_name_length(0);
+    glGetProgramiv(program_obj, GL_ACTIVE_UNIFORMS, &num_uniforms);
+    glGetProgramiv(program_obj, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+
+    std::vector<GLchar> name_buffer(size_t(std::max(max_name_length, 1)));
+
+    for (GLint i = 0; i < num_uniforms; ++i) {
+        GLsizei name_length(0);
+        GLint size(0);
+        GLenum type(0);
+        glGetActiveUniform(program_obj, GLuint(i), GLsizei(name_buffer.size()), &name_length, &size, &type, name_buffer.data());
+
+        std::string name(name_buffer.data(), size_t(name_length));
+
+        // Arrays are reported as their first element
+        std::string array_suffix("[0]");
+        if (name.size() > array_suffix.size()
+            && name.compare(name.size() - array_suffix.size(), array_suffix.size(), array_suffix) == 0) {
+            name.erase(name.size() - array_suffix.size());
+        }
+
+        uniform_locations[name] = glGetUniformLocation(program_obj, name.c_str());
+    }
+
+    VLOG(2) << "Shader " << program_obj << " has " << uniform_locations.size() << " uniforms";
+}
+
+
+GLint Shader::get_uniform_location(const std::string &name) {
+    auto location(uniform_locations.find(name));
+    if (location == std::end(uniform_locations)) {
+        return -1;
+    }
+
+    return location->second;
+}
+
+
+void Shader::set_uniform(const std::string &name, const glm::mat4 &value) {
+    GLint location(get_uniform_location(name));
+    if (location == -1) {
+        return;
+    }
+
+    GLState &gl_state(GLState::get_current());
+    gl_state.use_program(program_obj);
+    gl_state.count_calls();
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+
+void Shader::set_uniform(const std::string &name, const glm::vec2 &value) {
+    GLint location(get_uniform_location(name));
+    if (location == -1) {
+        return;
+    }
+
+    GLState &gl_state(GLState::get_current());
+    gl_state.use_program(program_obj);
+    gl_state.count_calls();
+    glUniform2f(location, value.x, value.y);
+}
+
+
+void Shader::set_uniform(const std::string &name, GLint value) {
+    GLint location(get_uniform_location(name));
+    if (location == -1) {
+        return;
+    }
+
+    auto old_value(uniform_int_values.find(location));
+    if (old_value != std::end(uniform_int_values) && old_value->second == value) {
+        return;
+    }
+
+    GLState &gl_state(GLState::get_current());
+    gl_state.use_program(program_obj);
+    gl_state.count_calls();
+    glUniform1i(location, value);
+
+    uniform_int_values[location] = value;
 }
@@ -1,10 +1,15 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+#include <map>
 #include <memory>
 #include <stdexcept>
 #include <string>
 
+#define GLM_FORCE_RADIANS
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+
 #if defined(USE_GL)
 #define GL_GLEXT_PROTOTYPES
 #if defined(__APPLE__)
@@ -55,6 +60,30 @@ private:
     ///
     GLuint vertex_shader = 0;
 
+    ///
+    /// The locations of the program's active uniforms, by name. Arrays
+    /// are stored under their base name, without "[0]".
+    ///
+    std::map<std::string, GLint> uniform_locations;
+
+    ///
+    /// The values last given to the program's integer uniforms, such
+    /// as samplers, by location
+    ///
+    std::map<GLint, GLint> uniform_int_values;
+
+    ///
+    /// Look up the locations of the program's active uniforms. They
+    /// only change when the program is linked.
+    ///
+    void cache_uniform_locations();
+
+    ///
+    /// Get the location of a uniform, without asking GL
+    /// @return the location, or -1 if the program has no such uniform
+    ///
+    GLint get_uniform_location(const std::string &name);
+
     /// This function loads the shaders
     /// @param type The type of the shader: fragment or vertex
     /// @param src The source file for the shader's source
@@ -121,6 +150,34 @@ public:
     /// Wrapper around glLinkProgram
     ///
     void link();
+
+    ///
+    /// Set a matrix uniform, making the program current.
+    ///
+    /// Names the program doesn't have are ignored, like in GL.
+    ///
+    /// @param name The uniform's name.
+    /// @param value The matrix to give it.
+    ///
+    void set_uniform(const std::string &name, const glm::mat4 &value);
+
+    ///
+    /// Set a vector uniform, making the program current.
+    ///
+    /// @param name The uniform's name.
+    /// @param value The vector to give it.
+    ///
+    void set_uniform(const std::string &name, const glm::vec2 &value);
+
+    ///
+    /// Set an integer or sampler uniform, making the program current.
+    ///
+    /// The call is skipped when the uniform already has the value.
+    ///
+    /// @param name The uniform's name.
+    /// @param value The value to give it.
+    ///
+    void set_uniform(const std::string &name, GLint value);
 };
 
 
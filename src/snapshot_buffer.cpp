@@ -0,0 +1,87 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "snapshot_buffer.hpp"
+#include "world_snapshot.hpp"
+
+SnapshotBuffer::Reader::Reader(SnapshotBuffer &buffer):
+    buffer(&buffer) {
+
+    // Atomics are sequentially consistent throughout. After counting
+    // in, either the publisher sees this reader and waits for it, or
+    // this reader sees the generation moved on and tries again.
+    for (;;) {
+        generation = buffer.generation;
+        slot = int(generation % 2);
+
+        ++buffer.readers[slot];
+        if (buffer.generation == generation) {
+            break;
+        }
+        --buffer.readers[slot];
+    }
+}
+
+SnapshotBuffer::Reader::Reader(Reader &&other):
+    buffer(other.buffer),
+    slot(other.slot),
+    generation(other.generation) {
+        other.buffer = nullptr;
+}
+
+SnapshotBuffer::Reader::~Reader() {
+    if (buffer) {
+        --buffer->readers[slot];
+    }
+}
+
+
+SnapshotBuffer::SnapshotBuffer():
+    generation(0),
+    waiting(0) {
+        readers[0] = 0;
+        readers[1] = 0;
+}
+
+SnapshotBuffer &SnapshotBuffer::get_instance() {
+    static SnapshotBuffer global_instance;
+    return global_instance;
+}
+
+
+void SnapshotBuffer::publish(const std::function<void (WorldSnapshot &)> &fill) {
+    uint64_t next(generation + 1);
+    int back(int(next % 2));
+
+    // Readers only stay on the back snapshot if they counted in just
+    // as it was swapped out, and they are copying out of it
+    while (readers[back] != 0) {
+        std::this_thread::yield();
+    }
+
+    fill(snapshots[back]);
+    generation = next;
+
+    if (waiting != 0) {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        published.notify_all();
+    }
+}
+
+bool SnapshotBuffer::wait_for(uint64_t generation, std::chrono::steady_clock::duration timeout) {
+    if (this->generation >= generation) {
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(wait_mutex);
+    ++waiting;
+    bool published_in_time(published.wait_for(lock, timeout, [&] () { return this->generation >= generation; }));
+    --waiting;
+
+    return published_in_time;
+}
@@ -0,0 +1,108 @@
+#ifndef SNAPSHOT_BUFFER_H
+#define SNAPSHOT_BUFFER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+#include "world_snapshot.hpp"
+
+///
+/// Double buffers WorldSnapshots, so that other threads can read the
+/// world without waiting for the main thread.
+///
+/// The main thread fills the back snapshot and publishes it by moving
+/// the generation on, which swaps the front and back. Readers never
+/// lock: a reader notes the generation, counts itself in on that
+/// generation's snapshot and checks the generation hasn't moved on
+/// meanwhile, trying again if it has. Before refilling a snapshot, the
+/// main thread waits for the readers counted in on it to leave, which
+/// is only ever the few who were copying out of it as it was swapped.
+///
+/// Reads therefore see the world as it was at the last publish, which
+/// may be slightly behind the main thread. wait_for lets a thread which
+/// has just changed the world wait until a snapshot shows its change.
+///
+class SnapshotBuffer {
+    WorldSnapshot snapshots[2];
+
+    ///
+    /// The number of snapshots published. The front snapshot is the
+    /// one at the generation modulo 2.
+    ///
+    std::atomic<uint64_t> generation;
+
+    ///
+    /// The number of readers of each snapshot
+    ///
+    std::atomic<int> readers[2];
+
+    ///
+    /// Signals publishes to threads in wait_for, only when some are
+    /// waiting
+    ///
+    std::mutex wait_mutex;
+    std::condition_variable published;
+    std::atomic<int> waiting;
+
+public:
+    ///
+    /// Holds a snapshot for reading. Hold it only long enough to copy
+    /// out what is needed, as publishing may wait for it.
+    ///
+    class Reader {
+        SnapshotBuffer *buffer;
+        int slot;
+        uint64_t generation;
+
+    public:
+        Reader(SnapshotBuffer &buffer);
+        Reader(Reader &&other);
+        ~Reader();
+
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+        Reader &operator=(Reader &&) = delete;
+
+        const WorldSnapshot &operator*() const { return buffer->snapshots[slot]; }
+        const WorldSnapshot *operator->() const { return &buffer->snapshots[slot]; }
+
+        ///
+        /// Get the generation of the snapshot being read
+        ///
+        uint64_t get_generation() const { return generation; }
+    };
+
+    SnapshotBuffer();
+
+    static SnapshotBuffer &get_instance();
+
+    ///
+    /// Read the latest snapshot
+    ///
+    Reader read() { return Reader(*this); }
+
+    ///
+    /// Fill the back snapshot and publish it. Only one thread, the main
+    /// thread, may publish.
+    /// @param fill called with the snapshot to fill, which holds what
+    ///             was published two generations ago
+    ///
+    void publish(const std::function<void (WorldSnapshot &)> &fill);
+
+    ///
+    /// Get the generation of the latest snapshot
+    ///
+    uint64_t get_generation() const { return generation; }
+
+    ///
+    /// Wait until a generation has been published.
+    /// @return whether it was published before the timeout
+    ///
+    bool wait_for(uint64_t generation, std::chrono::steady_clock::duration timeout);
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/geometric.hpp>
+#include <glm/vec2.hpp>
+
+#include "spatial_index.hpp"
+
+SpatialIndex::SpatialIndex(int width, int height, int cell_size):
+    cell_size(cell_size),
+    num_cells_x(std::max(1, (width  + cell_size - 1) / cell_size)),
+    num_cells_y(std::max(1, (height + cell_size - 1) / cell_size)),
+    cells(size_t(num_cells_x * num_cells_y)),
+    entries() {
+}
+
+int SpatialIndex::cell_x(float x) const {
+    return std::min(num_cells_x - 1, std::max(0, int(std::floor(x / float(cell_size)))));
+}
+
+int SpatialIndex::cell_y(float y) const {
+    return std::min(num_cells_y - 1, std::max(0, int(std::floor(y / float(cell_size)))));
+}
+
+void SpatialIndex::remove_from_cell(int id, int cell) {
+    auto &ids(cells[size_t(cell)]);
+    auto found(std::find(ids.begin(), ids.end(), id));
+    if (found != ids.end()) {
+        // Order within a cell doesn't matter
+        *found = ids.back();
+        ids.pop_back();
+    }
+}
+
+void SpatialIndex::insert(int id, glm::vec2 position) {
+    if (contains(id)) {
+        move(id, position);
+        return;
+    }
+
+    int cell(cell_of(position));
+    entries[id] = Entry{position, cell};
+    cells[size_t(cell)].push_back(id);
+}
+
+void SpatialIndex::move(int id, glm::vec2 position) {
+    auto entry(entries.find(id));
+    if (entry == entries.end()) {
+        return;
+    }
+
+    entry->second.position = position;
+
+    // Only objects crossing into another cell need rebucketing
+    int cell(cell_of(position));
+    if (cell != entry->second.cell) {
+        remove_from_cell(id, entry->second.cell);
+        cells[size_t(cell)].push_back(id);
+        entry->second.cell = cell;
+    }
+}
+
+void SpatialIndex::remove(int id) {
+    auto entry(entries.find(id));
+    if (entry == entries.end()) {
+        return;
+    }
+
+    remove_from_cell(id, entry->second.cell);
+    entries.erase(entry);
+}
+
+std::vector<int> SpatialIndex::query_point(glm::vec2 position) const {
+    std::vector<int> results;
+    for (int id : cells[size_t(cell_of(position))]) {
+        if (entries.at(id).position == position) {
+            results.push_back(id);
+        }
+    }
+
+    std::sort(results.begin(), results.end());
+    return results;
+}
+
+std::vector<int> SpatialIndex::query_rect(glm::vec2 bottom_left, glm::vec2 top_right) const {
+    std::vector<int> results;
+    for (int y = cell_y(bottom_left.y); y <= cell_y(top_right.y); ++y) {
+        for (int x = cell_x(bottom_left.x); x <= cell_x(top_right.x); ++x) {
+            for (int id : cells[size_t(y * num_cells_x + x)]) {
+                glm::vec2 position(entries.at(id).position);
+                if (bottom_left.x <= position.x && position.x <= top_right.x
+                    && bottom_left.y <= position.y && position.y <= top_right.y) {
+                    results.push_back(id);
+                }
+            }
+        }
+    }
+
+    std::sort(results.begin(), results.end());
+    return results;
+}
+
+std::vector<int> SpatialIndex::query_radius(glm::vec2 centre, float radius) const {
+    std::vector<int> results(query_rect(centre - glm::vec2(radius), centre + glm::vec2(radius)));
+
+    // Trim the bounding square down to the circle
+    results.erase(
+        std::remove_if(results.begin(), results.end(), [&] (int id) {
+            return glm::length(entries.at(id).position - centre) > radius;
+        }),
+        results.end()
+    );
+
+    return results;
+}
@@ -0,0 +1,133 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <unordered_map>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/vec2.hpp>
+
+///
+/// A uniform grid over a map, bucketing object ids by their position so
+/// that the objects at or around a location can be found without
+/// scanning every object on the map.
+///
+/// Positions outside the map are kept in the nearest edge cell.
+///
+class SpatialIndex {
+    ///
+    /// Where an object is and which cell it is bucketed in
+    ///
+    struct Entry {
+        glm::vec2 position;
+        int cell;
+    };
+
+    ///
+    /// The width and height of a cell in tiles
+    ///
+    int cell_size;
+
+    ///
+    /// The number of cells across the map
+    ///
+    int num_cells_x;
+
+    ///
+    /// The number of cells up the map
+    ///
+    int num_cells_y;
+
+    ///
+    /// The ids of the objects in each cell, row by row from the bottom
+    /// left
+    ///
+    std::vector<std::vector<int>> cells;
+
+    ///
+    /// The objects in the index, by id
+    ///
+    std::unordered_map<int, Entry> entries;
+
+    ///
+    /// Get the cell column holding an x position, clamped to the grid
+    ///
+    int cell_x(float x) const;
+
+    ///
+    /// Get the cell row holding a y position, clamped to the grid
+    ///
+    int cell_y(float y) const;
+
+    ///
+    /// Get the index of the cell holding a position
+    ///
+    int cell_of(glm::vec2 position) const { return cell_y(position.y) * num_cells_x + cell_x(position.x); }
+
+    ///
+    /// Take an object out of a cell's list
+    ///
+    void remove_from_cell(int id, int cell);
+
+public:
+    ///
+    /// Construct an empty index for a map
+    /// @param width the width of the map in tiles
+    /// @param height the height of the map in tiles
+    /// @param cell_size the width and height of a cell in tiles
+    ///
+    SpatialIndex(int width = 0, int height = 0, int cell_size = 8);
+
+    ///
+    /// Add an object to the index, or move it if it is already there
+    /// @param id the object's id
+    /// @param position the object's position
+    ///
+    void insert(int id, glm::vec2 position);
+
+    ///
+    /// Move an object in the index. Objects not in the index are ignored.
+    /// @param id the object's id
+    /// @param position the object's new position
+    ///
+    void move(int id, glm::vec2 position);
+
+    ///
+    /// Remove an object from the index, if it is there
+    /// @param id the object's id
+    ///
+    void remove(int id);
+
+    ///
+    /// Is an object in the index
+    ///
+    bool contains(int id) const { return entries.count(id) != 0; }
+
+    ///
+    /// Get an object's position
+    /// Throws std::out_of_range if the object is not in the index
+    ///
+    glm::vec2 get_position(int id) const { return entries.at(id).position; }
+
+    ///
+    /// Find the objects at exactly a position
+    /// @return the ids, in ascending order
+    ///
+    std::vector<int> query_point(glm::vec2 position) const;
+
+    ///
+    /// Find the objects in a rectangle, edges included
+    /// @param bottom_left the lowest x and y positions to include
+    /// @param top_right the highest x and y positions to include
+    /// @return the ids, in ascending order
+    ///
+    std::vector<int> query_rect(glm::vec2 bottom_left, glm::vec2 top_right) const;
+
+    ///
+    /// Find the objects within a distance of a position, edge included
+    /// @return the ids, in ascending order
+    ///
+    std::vector<int> query_radius(glm::vec2 centre, float radius) const;
+};
+
+#endif
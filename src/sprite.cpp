@@ -193,20 +193,20 @@ void Sprite::set_sprite_status(std::string _sprite_status) {
     switch (sprite_status) {
         case Sprite_Status::NOTHING:
         case Sprite_Status::STOPPED:
-            status_icon->set_tile(TextureAtlas::from_name("gui/status/stationary"));
+            status_icon->set_tile("gui/status/stationary");
             break;
 
         case Sprite_Status::KILLED:
-            status_icon->set_tile(TextureAtlas::from_name("gui/status/failed"));
+            status_icon->set_tile("gui/status/failed");
             break;
 
         case Sprite_Status::RUNNING:
-            status_icon->set_tile(TextureAtlas::from_name("gui/status/running"));
+            status_icon->set_tile("gui/status/running");
             break;
 
         case Sprite_Status::FAILED:
             // TODO: stopping should also be here
-            status_icon->set_tile(TextureAtlas::from_name("gui/status/failed"));
+            status_icon->set_tile("gui/status/failed");
             break;
     }
 }
@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <glog/logging.h>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+
+#if defined(USE_GL)
+#define GL_GLEXT_PROTOTYPES
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+#include "gl_state.hpp"
+#include "packed_vertex.hpp"
+#include "quad_index_buffer.hpp"
+#include "renderable_component.hpp"
+#include "shader.hpp"
+#include "sprite_batch.hpp"
+#include "texture_atlas.hpp"
+
+namespace {
+    ///
+    /// Move a quad to its position relative to an origin, clamping any
+    /// vertex out of range.
+    /// @return whether every vertex was in range
+    ///
+    bool move_quad(const SpriteBatch::Quad &quad, glm::vec2 origin, PackedQuad &moved) {
+        long x(std::lround((quad.position.x - origin.x) * float(PackedVertex::tile_units)));
+        long y(std::lround((quad.position.y - origin.y) * float(PackedVertex::tile_units)));
+
+        const long min(std::numeric_limits<GLshort>::min());
+        const long max(std::numeric_limits<GLshort>::max());
+
+        bool in_range(true);
+        moved = quad.quad;
+        for (PackedVertex &vertex : moved.vertices) {
+            long vertex_x(x + vertex.x);
+            long vertex_y(y + vertex.y);
+
+            in_range = in_range && vertex_x >= min && vertex_x <= max && vertex_y >= min && vertex_y <= max;
+            vertex.x = GLshort(std::max(min, std::min(max, vertex_x)));
+            vertex.y = GLshort(std::max(min, std::min(max, vertex_y)));
+        }
+
+        return in_range;
+    }
+}
+
+SpriteBatch::SpriteBatch() {
+    glGenBuffers(1, &vbo);
+
+    try {
+        shader = Shader::get_shared("tile_shader");
+    }
+    catch (std::exception &e) {
+        LOG(ERROR) << "Failed to create the shader for the sprite batch: " << e.what();
+    }
+}
+
+SpriteBatch::~SpriteBatch() {
+    GLState::delete_buffer(vbo);
+}
+
+void SpriteBatch::add(int draw_layer, RenderableComponent *renderable_component, glm::vec2 position) {
+    if (renderable_component->get_num_quads() < 1 || !renderable_component->get_texture()) {
+        return;
+    }
+
+    Quad quad;
+    quad.draw_layer = draw_layer;
+    quad.texture = renderable_component->get_texture()->get_gl_texture();
+    quad.position = position;
+    quad.quad = renderable_component->get_quad_data()[0];
+
+    quads.push_back(quad);
+}
+
+void SpriteBatch::render(const glm::mat4 &projection_matrix, const glm::mat4 &modelview_matrix) {
+    if (quads.empty()) {
+        return;
+    }
+
+    if (!shader) {
+        quads.clear();
+        return;
+    }
+
+    // Group the quads into draws, keeping the order within each draw
+    std::stable_sort(quads.begin(), quads.end(), [] (const Quad &a, const Quad &b) {
+        return a.draw_layer != b.draw_layer ? a.draw_layer < b.draw_layer : a.texture < b.texture;
+    });
+
+    pack(quads, vertex_data, spans);
+
+    auto set_origin([&] (glm::vec2 origin) {
+        glm::mat4 batch_modelview_matrix(glm::translate(modelview_matrix, glm::vec3(origin, 0.0f)));
+        batch_modelview_matrix = glm::scale(batch_modelview_matrix, glm::vec3(1.0f / float(PackedVertex::tile_units)));
+        shader->set_uniform("mat_modelview", batch_modelview_matrix);
+    });
+
+    GLState &gl_state(GLState::get_current());
+    gl_state.use_program(shader->get_program());
+    shader->set_uniform("mat_projection", projection_matrix);
+    set_origin(spans.front().origin);
+    shader->set_uniform("s_texture", 0);
+
+    // Upload the whole frame's geometry at once. Respecifying the
+    // buffer lets the driver hand us fresh storage rather than waiting
+    // for last frame's draws to finish with it.
+    gl_state.bind_array_buffer(vbo);
+    gl_state.count_calls();
+    glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(sizeof(PackedQuad) * vertex_data.size()), vertex_data.data(), GL_STREAM_DRAW);
+
+    QuadIndexBuffer &quad_index_buffer(QuadIndexBuffer::get_current());
+    quad_index_buffer.bind(int(std::min(quads.size(), size_t(QuadIndexBuffer::max_quads))));
+
+    gl_state.active_texture(GL_TEXTURE0);
+
+    // One draw for each run of quads in the same layer with the same
+    // texture. The indices only reach max_quads quads, so the vertex
+    // attributes are moved along the buffer in steps of that many.
+    // Runs are also split where the origin changes.
+    int segment(-1);
+    size_t span(0);
+    size_t begin(0);
+    while (begin < quads.size()) {
+        size_t end(begin + 1);
+        while (end < quads.size()
+               && quads[end].draw_layer == quads[begin].draw_layer
+               && quads[end].texture    == quads[begin].texture) {
+            ++end;
+        }
+
+        gl_state.bind_texture_2d(quads[begin].texture);
+
+        while (begin < end) {
+            int begin_segment(int(begin) / QuadIndexBuffer::max_quads);
+            int segment_begin(begin_segment * QuadIndexBuffer::max_quads);
+            size_t draw_end(std::min(end, size_t(segment_begin + QuadIndexBuffer::max_quads)));
+
+            while (span + 1 < spans.size() && spans[span + 1].begin <= begin) {
+                ++span;
+                set_origin(spans[span].origin);
+            }
+            if (span + 1 < spans.size()) {
+                draw_end = std::min(draw_end, spans[span + 1].begin);
+            }
+
+            if (begin_segment != segment) {
+                RenderableComponent::set_attrib_pointers(segment_begin);
+                segment = begin_segment;
+            }
+
+            quad_index_buffer.draw(int(begin) - segment_begin, int(draw_end - begin));
+            begin = draw_end;
+        }
+    }
+
+    quads.clear();
+}
+
+void SpriteBatch::pack(const std::vector<Quad> &quads, std::vector<PackedQuad> &vertex_data, std::vector<Span> &spans) {
+    vertex_data.clear();
+    spans.clear();
+
+    for (const Quad &quad : quads) {
+        PackedQuad moved;
+        if (spans.empty() || !move_quad(quad, spans.back().origin, moved)) {
+            Span span;
+            span.begin  = vertex_data.size();
+            span.origin = glm::floor(quad.position);
+            spans.push_back(span);
+
+            move_quad(quad, span.origin, moved);
+        }
+
+        vertex_data.push_back(moved);
+    }
+}
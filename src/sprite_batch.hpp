@@ -0,0 +1,136 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include <memory>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+
+#if defined(USE_GL)
+#define GL_GLEXT_PROTOTYPES
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+#include "packed_vertex.hpp"
+
+class RenderableComponent;
+class Shader;
+
+///
+/// Draws many small objects, such as sprites and map objects, with few
+/// GL calls.
+///
+/// Each frame, the objects to draw are added with the draw layer they
+/// belong to. On render, their packed quads are moved to their
+/// positions and written into one streaming vertex buffer, which is
+/// uploaded once, and then drawn with one call for each GL texture in
+/// each draw layer. Lower draw layers are drawn
+/// first; within a draw layer, objects sharing a texture keep the order
+/// they were added in.
+///
+class SpriteBatch {
+public:
+    ///
+    /// An object's quad, waiting to be drawn
+    ///
+    struct Quad {
+        int draw_layer;
+        GLuint texture;
+        glm::vec2 position;
+        PackedQuad quad;
+    };
+
+    ///
+    /// A run of the vertex data whose positions are relative to the
+    /// same origin
+    ///
+    struct Span {
+        ///
+        /// The index of the first quad in the span
+        ///
+        size_t begin;
+
+        ///
+        /// The origin, in tiles
+        ///
+        glm::vec2 origin;
+    };
+
+private:
+    ///
+    /// The quads added this frame. Kept between frames so that the
+    /// memory is reused.
+    ///
+    std::vector<Quad> quads;
+
+    ///
+    /// The vertex data, in the order it is drawn
+    ///
+    std::vector<PackedQuad> vertex_data;
+
+    ///
+    /// The origins of the vertex data
+    ///
+    std::vector<Span> spans;
+
+    ///
+    /// The streaming vertex buffer
+    ///
+    GLuint vbo = 0;
+
+    ///
+    /// The shader used to draw the objects
+    ///
+    std::shared_ptr<Shader> shader;
+
+    SpriteBatch(const SpriteBatch &) = delete;
+    SpriteBatch &operator=(const SpriteBatch &) = delete;
+
+public:
+    SpriteBatch();
+    ~SpriteBatch();
+
+    ///
+    /// Add an object to draw this frame.
+    /// @param draw_layer the object's draw layer
+    /// @param renderable_component the object's component, holding its
+    ///        quad relative to its position
+    /// @param position the object's position, in tiles
+    ///
+    void add(int draw_layer, RenderableComponent *renderable_component, glm::vec2 position);
+
+    ///
+    /// Draw and then forget all the objects added since the last render.
+    /// @param projection_matrix the projection matrix
+    /// @param modelview_matrix the matrix from tiles to the view
+    ///
+    void render(const glm::mat4 &projection_matrix, const glm::mat4 &modelview_matrix);
+
+    ///
+    /// Move quads to their positions in packed vertex data. Positions
+    /// are relative to an origin, and a new origin is started whenever
+    /// a quad is too far from the last one for 16 bits, so that quads
+    /// anywhere on a large map stay where they are.
+    /// @param quads the quads, in the order to draw them
+    /// @param vertex_data filled with the moved quads
+    /// @param spans filled with the origin of each run of quads
+    ///
+    static void pack(const std::vector<Quad> &quads, std::vector<PackedQuad> &vertex_data, std::vector<Span> &spans);
+
+    ///
+    /// Get the number of objects waiting to be drawn
+    ///
+    size_t size() { return quads.size(); }
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "atlas_cache.hpp"
+#include "binary_cache.hpp"
+#include "catch.hpp"
+#include "image.hpp"
+
+SCENARIO("Merged atlases round trip through the cache", "[atlas_cache]") {
+
+    GIVEN("a cached atlas") {
+        BinaryCache::set_directory(".");
+
+        std::string source_path("test_atlas_cache.png");
+        std::ofstream(source_path) << "image";
+        std::vector<AtlasCache::Source> sources({{source_path, 3}, {"test_atlas_cache_missing.png", 1}});
+
+        AtlasCache cache(sources, 2, 2, 1024);
+
+        Image image(4, 4, true);
+        for (int y = 0; y < 4; ++y) {
+            for (int x = 0; x < 4; ++x) {
+                image.flipped_pixels[y][x].r = Uint8(x + y * 4);
+                image.flipped_pixels[y][x].a = 255;
+            }
+        }
+        cache.save(AtlasCache::Contents{2, 2, image, {"grass", "", "wall", "door"}});
+
+        WHEN("it is loaded again") {
+            AtlasCache::Contents contents(AtlasCache(sources, 2, 2, 1024).load());
+
+            THEN("the layout and names are kept") {
+                REQUIRE(contents.columns == 2);
+                REQUIRE(contents.rows == 2);
+                REQUIRE(contents.names == std::vector<std::string>({"grass", "", "wall", "door"}));
+            }
+
+            THEN("the pixels are kept") {
+                REQUIRE(contents.image.width == 4);
+                REQUIRE(contents.image.height == 4);
+                REQUIRE(contents.image.flipped_pixels[2][3].r == 11);
+                REQUIRE(contents.image.flipped_pixels[0][1].a == 255);
+            }
+        }
+
+        WHEN("other atlases are merged") {
+            AtlasCache other({{source_path, 4}}, 2, 2, 1024);
+
+            THEN("it isn't used") {
+                REQUIRE(other.get_path() != cache.get_path());
+                REQUIRE_THROWS_AS(other.load(), AtlasCache::LoadException);
+            }
+        }
+
+        WHEN("the largest texture size is different") {
+            THEN("it isn't used") {
+                REQUIRE_THROWS_AS(AtlasCache(sources, 2, 2, 2048).load(), AtlasCache::LoadException);
+            }
+        }
+
+        WHEN("an atlas's image changes") {
+            std::ofstream(source_path) << "a longer image";
+
+            THEN("it is stale") {
+                REQUIRE_THROWS_AS(AtlasCache(sources, 2, 2, 1024).load(), AtlasCache::LoadException);
+            }
+        }
+
+        std::remove(cache.get_path().c_str());
+        std::remove(source_path.c_str());
+    }
+}
+
+SCENARIO("Benchmark loading merged atlases", "[.][benchmark][atlas_cache]") {
+    BinaryCache::set_directory(".");
+
+    for (int size : {512, 1024, 2048}) {
+        int count((size / 32) * (size / 32));
+        AtlasCache cache({{"test_atlas_cache_benchmark.png", count}}, 32, 32, 4096);
+
+        Image image(size, size, true);
+        cache.save(AtlasCache::Contents{size / 32, size / 32, image, std::vector<std::string>(std::size_t(count))});
+
+        auto start(std::chrono::steady_clock::now());
+        AtlasCache::Contents contents(cache.load());
+        auto end(std::chrono::steady_clock::now());
+
+        std::cout << count << " units, " << size << "x" << size << ": loaded in "
+                  << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+
+        REQUIRE(contents.image.width == size);
+        std::remove(cache.get_path().c_str());
+    }
+}
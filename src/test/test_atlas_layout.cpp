@@ -0,0 +1,238 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "atlas_layout.hpp"
+#include "catch.hpp"
+#include "image.hpp"
+
+namespace {
+    ///
+    /// Give every pixel of an image a value from its position
+    ///
+    void fill(Image &image) {
+        for (int y = 0; y < image.height; ++y) {
+            for (int x = 0; x < image.width; ++x) {
+                image.flipped_pixels[y][x].r = Uint8(x);
+                image.flipped_pixels[y][x].g = Uint8(y);
+                image.flipped_pixels[y][x].b = Uint8(x >> 8);
+                image.flipped_pixels[y][x].a = Uint8(y >> 8);
+            }
+        }
+    }
+
+    bool same_pixel(Image::Pixel a, Image::Pixel b) {
+        return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+    }
+
+    ///
+    /// Check a unit of one grid was copied to the same index in another
+    ///
+    bool same_unit(Image &a, int a_columns, Image &b, int b_columns, int index, int unit_w, int unit_h) {
+        int a_x((index % a_columns) * unit_w);
+        int a_y((index / a_columns) * unit_h);
+        int b_x((index % b_columns) * unit_w);
+        int b_y((index / b_columns) * unit_h);
+
+        for (int y = 0; y < unit_h; ++y) {
+            for (int x = 0; x < unit_w; ++x) {
+                if (!same_pixel(a.flipped_pixels[a_y + y][a_x + x], b.flipped_pixels[b_y + y][b_x + x])) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    ///
+    /// The layout merging used to choose: one row, or as many columns as
+    /// fit
+    ///
+    AtlasLayout naive_pack(int count, int unit_w, int unit_h, int max_size) {
+        int max_columns(max_size / unit_w);
+        int columns(count <= max_columns ? count : max_columns);
+        int rows((count + columns - 1) / columns);
+        return AtlasLayout{columns, rows, columns * unit_w, rows * unit_h};
+    }
+}
+
+SCENARIO("Atlas layouts use little texture memory", "[atlas_layout]") {
+
+    GIVEN("units which fit in one row") {
+        AtlasLayout layout(AtlasLayout::pack(5, 32, 32, 4096));
+
+        THEN("every unit has a place") {
+            int places(layout.columns * layout.rows);
+            REQUIRE(places >= 5);
+            REQUIRE(layout.width  == layout.columns * 32);
+            REQUIRE(layout.height == layout.rows    * 32);
+        }
+
+        THEN("the powers of two cover no more than one row would") {
+            REQUIRE(layout.texture_bytes() <= naive_pack(5, 32, 32, 4096).texture_bytes());
+        }
+    }
+
+    GIVEN("many units") {
+        AtlasLayout layout(AtlasLayout::pack(300, 32, 32, 4096));
+        AtlasLayout naive(naive_pack(300, 32, 32, 4096));
+
+        THEN("they are packed into a grid which fits") {
+            int places(layout.columns * layout.rows);
+            REQUIRE(places >= 300);
+            REQUIRE(layout.width  <= 4096);
+            REQUIRE(layout.height <= 4096);
+        }
+
+        THEN("no more memory is used than by rows as wide as fit") {
+            REQUIRE(layout.texture_bytes() <= naive.texture_bytes());
+        }
+
+        THEN("the grid is roughly square") {
+            REQUIRE(layout.width  <= 2 * layout.height);
+            REQUIRE(layout.height <= 2 * layout.width);
+        }
+    }
+
+    GIVEN("units of a size which isn't a power of two") {
+        AtlasLayout layout(AtlasLayout::pack(100, 48, 48, 4096));
+        AtlasLayout naive(naive_pack(100, 48, 48, 4096));
+
+        THEN("far less memory is used than by rows as wide as fit") {
+            int64_t doubled(layout.texture_bytes() * 2);
+            REQUIRE(doubled <= naive.texture_bytes());
+        }
+    }
+
+    GIVEN("a power of two number of units") {
+        AtlasLayout layout(AtlasLayout::pack(256, 16, 16, 2048));
+
+        THEN("nothing is wasted") {
+            REQUIRE(layout.texture_bytes() == 256 * 16 * 16 * 4);
+        }
+    }
+
+    GIVEN("more units than fit in a row") {
+        AtlasLayout layout(AtlasLayout::pack(50, 32, 32, 256));
+
+        THEN("the grid is within the largest texture") {
+            REQUIRE(layout.width  <= 256);
+            REQUIRE(layout.height <= 256);
+            int places(layout.columns * layout.rows);
+            REQUIRE(places >= 50);
+        }
+    }
+
+    GIVEN("more units than fit in a texture") {
+        AtlasLayout layout(AtlasLayout::pack(100, 32, 32, 64));
+
+        THEN("as many columns as fit are used") {
+            REQUIRE(layout.columns == 2);
+            REQUIRE(layout.rows == 50);
+        }
+    }
+
+    GIVEN("no units") {
+        AtlasLayout layout(AtlasLayout::pack(0, 32, 32, 4096));
+
+        THEN("the grid is empty") {
+            REQUIRE(layout.columns == 0);
+            REQUIRE(layout.rows == 0);
+        }
+    }
+}
+
+SCENARIO("Units are copied between grids", "[atlas_layout]") {
+
+    GIVEN("a grid of units") {
+        Image source(5 * 4, 3 * 4, true);
+        fill(source);
+
+        WHEN("they are copied into a narrower grid") {
+            Image destination(3 * 4, 5 * 4, true);
+            AtlasLayout::blit_units(destination, 3, 0, source, 5, 15, 4, 4);
+
+            THEN("every unit keeps its index") {
+                for (int i = 0; i < 15; ++i) {
+                    REQUIRE(same_unit(source, 5, destination, 3, i, 4, 4));
+                }
+            }
+        }
+
+        WHEN("they are copied after other units") {
+            Image destination(7 * 4, 3 * 4, true);
+            AtlasLayout::blit_units(destination, 7, 4, source, 5, 15, 4, 4);
+
+            THEN("every unit is offset by the units before it") {
+                for (int i = 0; i < 15; ++i) {
+                    int x(((i + 4) % 7) * 4);
+                    int y(((i + 4) / 7) * 4);
+                    int source_x((i % 5) * 4);
+                    int source_y((i / 5) * 4);
+                    REQUIRE(same_pixel(destination.flipped_pixels[y + 3][x + 2],
+                                       source.flipped_pixels[source_y + 3][source_x + 2]));
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Benchmark merging atlases", "[.][benchmark][atlas_layout]") {
+    const int max_size(4096);
+    const int tileset_columns(16);
+
+    for (int unit_size : {32, 48}) {
+        for (int tilesets : {2, 6, 12}) {
+            // Tilesets of 16 by 16 tiles
+            int count(tilesets * tileset_columns * tileset_columns);
+            std::vector<Image> sources;
+            for (int i = 0; i < tilesets; ++i) {
+                sources.push_back(Image(tileset_columns * unit_size, tileset_columns * unit_size, true));
+                fill(sources.back());
+            }
+
+            AtlasLayout naive(naive_pack(count, unit_size, unit_size, max_size));
+            AtlasLayout layout(AtlasLayout::pack(count, unit_size, unit_size, max_size));
+
+            // Unit by unit, pixel by pixel, into rows as wide as fit
+            auto naive_start(std::chrono::steady_clock::now());
+            Image naive_image(naive.width, naive.height, true);
+            int super_i(0);
+            for (Image &source : sources) {
+                for (int i = 0; i < tileset_columns * tileset_columns; ++i, ++super_i) {
+                    int x((super_i % naive.columns) * unit_size);
+                    int y((super_i / naive.columns) * unit_size);
+                    int source_x((i % tileset_columns) * unit_size);
+                    int source_y((i / tileset_columns) * unit_size);
+                    for (int row = 0; row < unit_size; ++row) {
+                        for (int column = 0; column < unit_size; ++column) {
+                            naive_image.flipped_pixels[y + row][x + column] = source.flipped_pixels[source_y + row][source_x + column];
+                        }
+                    }
+                }
+            }
+            auto naive_end(std::chrono::steady_clock::now());
+
+            auto start(std::chrono::steady_clock::now());
+            layout = AtlasLayout::pack(count, unit_size, unit_size, max_size);
+            Image image(layout.width, layout.height, true);
+            for (int i = 0; i < tilesets; ++i) {
+                AtlasLayout::blit_units(image, layout.columns, i * tileset_columns * tileset_columns,
+                                        sources[std::size_t(i)], tileset_columns,
+                                        tileset_columns * tileset_columns, unit_size, unit_size);
+            }
+            auto end(std::chrono::steady_clock::now());
+
+            std::cout << count << " units of " << unit_size << ": naive "
+                      << std::chrono::duration<double, std::milli>(naive_end - naive_start).count() << " ms, "
+                      << naive.width << "x" << naive.height << ", "
+                      << double(naive.texture_bytes()) / (1024.0 * 1024.0) << " MiB; packed "
+                      << std::chrono::duration<double, std::milli>(end - start).count() << " ms, "
+                      << layout.width << "x" << layout.height << ", "
+                      << double(layout.texture_bytes()) / (1024.0 * 1024.0) << " MiB" << std::endl;
+
+            REQUIRE(layout.texture_bytes() <= naive.texture_bytes());
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <ostream>
+#include <string>
+
+#include "binary_cache.hpp"
+#include "catch.hpp"
+
+SCENARIO("Binary cache files check their header", "[binary_cache]") {
+
+    GIVEN("a saved cache file") {
+        BinaryCache::set_directory(".");
+
+        std::string path(BinaryCache::get_path("test", "test_binary_cache", ".ptest"));
+        BinaryCache::save(path, "PYLTESTS", 2, "key;1", [] (std::ostream &file) {
+            BinaryCache::write(file, int32_t(-7));
+            BinaryCache::write_string(file, "contents");
+        });
+
+        THEN("it is named after a hash of its name") {
+            REQUIRE(path == "./test-4d6c36dc97eeccf2.ptest");
+        }
+
+        THEN("it reads back with the same header") {
+            std::ifstream file(path, std::ios::binary);
+            BinaryCache::read_header(file, "PYLTESTS", 2, "key;1");
+
+            REQUIRE(BinaryCache::read<int32_t>(file) == -7);
+            REQUIRE(BinaryCache::read_string(file) == "contents");
+            REQUIRE_THROWS_AS(BinaryCache::read<int32_t>(file), BinaryCache::LoadException);
+        }
+
+        THEN("it isn't read as another kind of cache") {
+            std::ifstream file(path, std::ios::binary);
+            REQUIRE_THROWS_AS(BinaryCache::read_header(file, "PYLOTHER", 2, "key;1"), BinaryCache::LoadException);
+        }
+
+        THEN("it isn't read as another version") {
+            std::ifstream file(path, std::ios::binary);
+            REQUIRE_THROWS_AS(BinaryCache::read_header(file, "PYLTESTS", 3, "key;1"), BinaryCache::LoadException);
+        }
+
+        THEN("it isn't read for another key") {
+            std::ifstream file(path, std::ios::binary);
+            REQUIRE_THROWS_AS(BinaryCache::read_header(file, "PYLTESTS", 2, "key;2"), BinaryCache::LoadException);
+        }
+
+        THEN("no partial file is left") {
+            REQUIRE(!std::ifstream(path + ".partial"));
+        }
+
+        std::remove(path.c_str());
+    }
+}
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "catch.hpp"
+#include "bloom.hpp"
+
+// The bloom Text used before Bloom, kept to check against: a vertical
+// scan of distances, then a search over the radius along each row.
+static void reference_bloom(uint8_t *pixels, int width, int height, int stride,
+                            int glow_radius, const uint8_t rgba[4], const uint8_t glow_rgba[4]) {
+    auto alpha([&] (int x, int y) -> uint8_t & { return pixels[(y * stride + x) * 4 + 3]; });
+
+    std::vector<int> vertical_scan(size_t(width * height));
+    int grpo = glow_radius + 1;
+
+    for (int x = 0; x < width; ++x) {
+        int seed_y = 0;
+        for (; seed_y < height && alpha(x, seed_y) == 0; ++seed_y);
+        int seed_y_prev = -1;
+        for (int y = 0; y < height; ++y) {
+            if (y == seed_y) {
+                for (++seed_y; seed_y < height && alpha(x, seed_y) == 0; ++seed_y);
+                seed_y_prev = y;
+            }
+
+            int r(0);
+            if (seed_y_prev != -1) {
+                r = glow_radius - (y - seed_y_prev);
+            }
+            if (seed_y != height) {
+                int r2(glow_radius - (seed_y - y));
+                if (r2 > r) {
+                    r = r2;
+                }
+            }
+            vertical_scan[size_t(y * width + x)] = (r > 0) ? r : 0;
+        }
+    }
+
+    std::vector<int> pythag(size_t(grpo * grpo));
+    for (int y = 0; y <= glow_radius; ++y) {
+        int ry = glow_radius - y;
+        for (int x = 0; x <= glow_radius; ++x) {
+            int rx = x;
+            int score(int((float(glow_radius) - sqrt(float(rx*rx + ry*ry))) * 255.0f / float(glow_radius)));
+            pythag[size_t(x+y*grpo)] = (score > 0) ? score*score/255 : 0;
+        }
+    }
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            int i = y * width + x;
+            int winner = pythag[size_t(vertical_scan[size_t(i)]*grpo)];
+            uint8_t *pixel(&pixels[(y * stride + x) * 4]);
+
+            if (pixel[3] == 0) {
+                for (int dx = 1; dx < glow_radius; ++dx) {
+                    int candidate(0);
+                    if (x - dx >= 0) {
+                        candidate = pythag[size_t(dx+vertical_scan[size_t(i - dx)]*grpo)];
+                    }
+                    if (x + dx < width) {
+                        int candidate2(pythag[size_t(dx+vertical_scan[size_t(i + dx)]*grpo)]);
+                        if (candidate2 > candidate) {
+                            candidate = candidate2;
+                        }
+                    }
+                    if (candidate > winner) {
+                        winner = candidate;
+                    }
+                }
+                pixel[0] = glow_rgba[0];
+                pixel[1] = glow_rgba[1];
+                pixel[2] = glow_rgba[2];
+                pixel[3] = uint8_t(int(glow_rgba[3]) * winner / 255);
+            }
+            else {
+                int a(pixel[3]);
+                for (int channel = 0; channel < 4; ++channel) {
+                    pixel[channel] = uint8_t(((255-a) * glow_rgba[channel] + a * rgba[channel]) / 255);
+                }
+            }
+        }
+    }
+}
+
+// Text-like coverage: lines of glyphs made of strokes, with soft edges
+// and the odd stray pixel, on a clear background.
+static std::vector<uint8_t> make_text_image(int width, int height, int stride, unsigned seed) {
+    auto random([&seed] () {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) & 0x7fff;
+    });
+
+    std::vector<uint8_t> pixels(size_t(stride * height * 4), 0);
+    auto cover([&] (int x, int y, unsigned coverage) {
+        if (x >= 0 && x < width && y >= 0 && y < height) {
+            uint8_t &alpha(pixels[size_t((y * stride + x) * 4 + 3)]);
+            alpha = std::max(alpha, uint8_t(coverage));
+        }
+    });
+
+    const int line_height(18);
+    for (int top = 2; top < height; top += line_height) {
+        for (int left = 1; left < width; left += 4 + int(random() % 8)) {
+            // A glyph: a couple of vertical and horizontal strokes
+            int glyph_width(2 + int(random() % 6));
+            int glyph_height(6 + int(random() % 8));
+            for (int stroke = 0; stroke < 2; ++stroke) {
+                int x(left + int(random() % unsigned(glyph_width)));
+                for (int y = top; y < top + glyph_height; ++y) {
+                    cover(x, y, 255);
+                    cover(x + 1, y, 64 + random() % 192);
+                }
+                int y(top + int(random() % unsigned(glyph_height)));
+                for (int x = left; x < left + glyph_width; ++x) {
+                    cover(x, y, 128 + random() % 128);
+                }
+            }
+            left += glyph_width;
+        }
+        cover(int(random() % unsigned(width)), top + line_height - 2, 1 + random() % 255);
+    }
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint8_t *pixel(&pixels[size_t((y * stride + x) * 4)]);
+            pixel[0] = 10;
+            pixel[1] = 20;
+            pixel[2] = 30;
+        }
+    }
+    return pixels;
+}
+
+SCENARIO("Bloom matches the old bloom exactly", "[bloom]") {
+    const uint8_t rgba[4] = {255, 255, 255, 255};
+    const uint8_t glow_rgba[4] = {0, 0, 0, 200};
+
+    GIVEN("images of text of awkward sizes") {
+        const int sizes[][3] = {{1, 1, 1}, {3, 17, 3}, {16, 4, 16}, {33, 9, 40}, {100, 31, 128}};
+
+        THEN("every radius gives the same pixels") {
+            for (auto &size : sizes) {
+                for (int radius = 1; radius <= 12; ++radius) {
+                    std::vector<uint8_t> expected(make_text_image(size[0], size[1], size[2], unsigned(radius)));
+                    std::vector<uint8_t> actual(expected);
+
+                    reference_bloom(expected.data(), size[0], size[1], size[2], radius, rgba, glow_rgba);
+                    Bloom(radius, rgba, glow_rgba).apply(actual.data(), size[0], size[1], size[2]);
+
+                    REQUIRE(actual == expected);
+                }
+            }
+        }
+    }
+
+    GIVEN("an image with nothing covered") {
+        std::vector<uint8_t> pixels(size_t(20 * 20 * 4), 0);
+
+        THEN("it is all clear glow") {
+            Bloom(6, rgba, glow_rgba).apply(pixels.data(), 20, 20, 20);
+            for (size_t i = 0; i < pixels.size(); i += 4) {
+                REQUIRE(pixels[i + 3] == 0);
+            }
+        }
+    }
+
+    GIVEN("a single covered pixel") {
+        std::vector<uint8_t> pixels(size_t(21 * 21 * 4), 0);
+        pixels[size_t((10 * 21 + 10) * 4 + 3)] = 255;
+        Bloom(6, rgba, glow_rgba).apply(pixels.data(), 21, 21, 21);
+
+        THEN("the glow fades with distance and is round") {
+            auto alpha([&] (int x, int y) { return pixels[size_t((y * 21 + x) * 4 + 3)]; });
+            REQUIRE(alpha(11, 10) > alpha(12, 10));
+            REQUIRE(alpha(12, 10) > alpha(14, 10));
+            REQUIRE(alpha(10, 13) == alpha(13, 10));
+            REQUIRE(alpha(10, 16) == 0);
+            REQUIRE(alpha(0, 0) == 0);
+        }
+    }
+}
+
+SCENARIO("Bloom is faster than the old bloom", "[.][benchmark][bloom]") {
+    const uint8_t rgba[4] = {255, 255, 255, 255};
+    const uint8_t glow_rgba[4] = {0, 0, 0, 200};
+
+    GIVEN("a notification-sized image of text") {
+        const int width(600);
+        const int height(120);
+        const int stride(1024);
+        const int repeats(50);
+        std::vector<uint8_t> source(make_text_image(width, height, stride, 1));
+
+        for (int radius : {4, 6, 16}) {
+            std::vector<uint8_t> expected;
+            std::vector<uint8_t> actual;
+
+            auto start(std::chrono::steady_clock::now());
+            for (int i = 0; i < repeats; ++i) {
+                expected = source;
+                reference_bloom(expected.data(), width, height, stride, radius, rgba, glow_rgba);
+            }
+            std::chrono::duration<double> old_taken(std::chrono::steady_clock::now() - start);
+
+            Bloom bloom(radius, rgba, glow_rgba);
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < repeats; ++i) {
+                actual = source;
+                bloom.apply(actual.data(), width, height, stride);
+            }
+            std::chrono::duration<double> new_taken(std::chrono::steady_clock::now() - start);
+
+            std::cout << "Bloom of radius " << radius << " over " << width << "x" << height << ": old "
+                      << old_taken.count() / repeats * 1000.0 << "ms, new "
+                      << new_taken.count() / repeats * 1000.0 << "ms" << std::endl;
+
+            REQUIRE(actual == expected);
+        }
+    }
+}
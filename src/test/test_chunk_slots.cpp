@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "catch.hpp"
+#include "chunk_slots.hpp"
+
+SCENARIO("Chunk slots hand out and reuse quad slots", "[chunk_slots]") {
+
+    GIVEN("the slots of a chunk with 16 tiles and room for 4 quads") {
+        ChunkSlots slots(16);
+        slots.reset(4);
+
+        THEN("no tile has a slot") {
+            for (int tile = 0; tile < 16; ++tile) {
+                REQUIRE(slots.get_slot(tile) == -1);
+            }
+            REQUIRE(slots.get_num_used() == 0);
+        }
+
+        WHEN("tiles acquire slots") {
+            int first(slots.acquire(3));
+            int second(slots.acquire(9));
+
+            THEN("they get distinct slots, lowest first") {
+                REQUIRE(first == 0);
+                REQUIRE(second == 1);
+                REQUIRE(slots.get_slot(3) == 0);
+                REQUIRE(slots.get_slot(9) == 1);
+                REQUIRE(slots.get_num_used() == 2);
+            }
+
+            THEN("acquiring again keeps the same slot") {
+                REQUIRE(slots.acquire(3) == first);
+                REQUIRE(slots.get_num_used() == 2);
+            }
+
+            THEN("releasing a tile frees its slot for reuse") {
+                REQUIRE(slots.release(3) == first);
+                REQUIRE(slots.get_slot(3) == -1);
+                REQUIRE(slots.release(3) == -1);
+                REQUIRE(slots.acquire(12) == first);
+            }
+        }
+
+        WHEN("more tiles than slots are set") {
+            for (int tile = 0; tile < 4; ++tile) {
+                slots.acquire(tile);
+            }
+
+            THEN("there are no slots left") {
+                REQUIRE(slots.acquire(4) == -1);
+                REQUIRE(slots.get_slot(4) == -1);
+            }
+        }
+    }
+
+    GIVEN("the capacity for a chunk") {
+        THEN("empty chunks stay empty") {
+            REQUIRE(ChunkSlots::capacity_for(0, 256) == 0);
+        }
+
+        THEN("there are spare slots, up to the size of the chunk") {
+            REQUIRE(ChunkSlots::capacity_for(1, 256) > 1);
+            REQUIRE(ChunkSlots::capacity_for(100, 256) >= 150);
+            REQUIRE(ChunkSlots::capacity_for(250, 256) == 256);
+        }
+    }
+}
+
+SCENARIO("Chunk slots make sparse tile insertion cheap", "[.][benchmark][chunk_slots]") {
+
+    GIVEN("an empty 256 by 256 tile layer") {
+        const int num_tiles(256 * 256);
+        const int num_floats(12);
+        std::vector<int> order(num_tiles);
+        for (int i = 0; i < num_tiles; ++i) {
+            order[size_t(i)] = (i * 7919) % num_tiles;
+        }
+
+        WHEN("every tile is painted into a single growing buffer") {
+            // The old scheme: copy the whole buffer for each new tile.
+            // Only a quarter of the layer is painted to keep this quick.
+            auto start(std::chrono::steady_clock::now());
+            std::vector<float> buffer;
+            for (int i = 0; i < num_tiles / 4; ++i) {
+                std::vector<float> grown(buffer.size() + size_t(num_floats));
+                std::copy(buffer.begin(), buffer.end(), grown.begin());
+                buffer.swap(grown);
+            }
+            std::chrono::duration<double> taken(std::chrono::steady_clock::now() - start);
+            std::cout << "Reallocating insertion of " << num_tiles / 4 << " tiles: "
+                      << taken.count() << "s" << std::endl;
+
+            THEN("the buffer holds every tile") {
+                REQUIRE(int(buffer.size()) == num_tiles / 4 * num_floats);
+            }
+        }
+
+        WHEN("every tile is painted into 16 by 16 chunks with free slots") {
+            const int chunk_tiles(16 * 16);
+            std::vector<ChunkSlots> chunks(size_t(num_tiles / chunk_tiles), ChunkSlots(chunk_tiles));
+            std::vector<std::vector<float>> buffers(chunks.size());
+            int num_rebuilds(0);
+
+            auto start(std::chrono::steady_clock::now());
+            for (int tile : order) {
+                size_t chunk(size_t(tile / chunk_tiles));
+                int tile_index(tile % chunk_tiles);
+
+                int slot(chunks[chunk].acquire(tile_index));
+                if (slot == -1) {
+                    // Grow the chunk, as Map::generate_chunk_data does
+                    int num_used(chunks[chunk].get_num_used());
+                    std::vector<int> used;
+                    for (int i = 0; i < chunk_tiles; ++i) {
+                        if (chunks[chunk].get_slot(i) != -1) {
+                            used.push_back(i);
+                        }
+                    }
+                    chunks[chunk].reset(ChunkSlots::capacity_for(num_used + 1, chunk_tiles));
+                    for (int i : used) {
+                        chunks[chunk].acquire(i);
+                    }
+                    buffers[chunk].assign(size_t(chunks[chunk].get_capacity() * num_floats), -1.0f);
+                    slot = chunks[chunk].acquire(tile_index);
+                    ++num_rebuilds;
+                }
+
+                std::fill_n(&buffers[chunk][size_t(slot * num_floats)], num_floats, float(tile));
+            }
+            std::chrono::duration<double> taken(std::chrono::steady_clock::now() - start);
+            std::cout << "Slot insertion of " << num_tiles << " tiles: "
+                      << taken.count() << "s, " << num_rebuilds << " chunk rebuilds" << std::endl;
+
+            THEN("every tile has a slot and chunks were rarely rebuilt") {
+                for (auto &slots : chunks) {
+                    REQUIRE(slots.get_num_used() == chunk_tiles);
+                }
+                REQUIRE(num_rebuilds < num_tiles / 16);
+            }
+        }
+    }
+}
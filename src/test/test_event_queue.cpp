@@ -0,0 +1,333 @@
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+#include "event_manager.hpp"
+#include "event_queue.hpp"
+#include "event_task.hpp"
+
+namespace {
+    ///
+    /// The shape of a GilSafeFuture: a promise and a lifeline, both
+    /// shared
+    ///
+    struct FakeFuture {
+        std::shared_ptr<int> promise;
+        std::shared_ptr<int> lifeline;
+    };
+
+    ///
+    /// The queue as it was, with a lock around a list of functions
+    ///
+    class LockedQueue {
+        std::mutex queue_mutex;
+        std::list<std::function<void ()>> queue;
+
+    public:
+        void push(std::function<void ()> func) {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            queue.push_back(func);
+        }
+
+        int run_all() {
+            int runs(0);
+            while (true) {
+                std::function<void ()> func;
+                {
+                    std::lock_guard<std::mutex> lock(queue_mutex);
+                    if (queue.empty()) { break; }
+                    func = queue.front();
+                    queue.pop_front();
+                }
+                func();
+                ++runs;
+            }
+            return runs;
+        }
+    };
+
+    int run_all(EventQueue &queue) {
+        int runs(0);
+        EventQueue::Batch batch(queue.take_all());
+        while (!batch.empty()) {
+            batch.pop()();
+            ++runs;
+        }
+        return runs;
+    }
+
+    ///
+    /// Time producers pushing to a queue while one thread runs what they
+    /// push, like Python threads adding events during frames.
+    ///
+    template <typename Queue, typename RunAll>
+    double time_contention(Queue &queue, RunAll run_all, int producers, int per_producer) {
+        std::atomic<int> ready(0);
+        std::atomic<bool> go(false);
+        std::atomic<long> sum(0);
+
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p] () {
+                FakeFuture future{std::make_shared<int>(p), std::make_shared<int>(p)};
+                ++ready;
+                while (!go) { std::this_thread::yield(); }
+
+                for (int i = 0; i < per_producer; ++i) {
+                    queue.push([&sum, future, i] () { sum += *future.promise + i; });
+                }
+            });
+        }
+
+        while (ready != producers) { std::this_thread::yield(); }
+
+        auto start(std::chrono::steady_clock::now());
+        go = true;
+
+        long total(long(producers) * per_producer);
+        long runs(0);
+        while (runs < total) {
+            runs += run_all(queue);
+        }
+        auto end(std::chrono::steady_clock::now());
+
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        long expected(0);
+        for (int p = 0; p < producers; ++p) {
+            expected += long(p) * per_producer + long(per_producer) * (per_producer - 1) / 2;
+        }
+        REQUIRE(sum == expected);
+
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+}
+
+SCENARIO("Event tasks store small callables inline", "[event_queue]") {
+
+    GIVEN("callables of the sizes events use") {
+        int runs(0);
+        FakeFuture future{std::make_shared<int>(1), std::make_shared<int>(2)};
+        std::function<void (FakeFuture)> callback([&runs] (FakeFuture) { ++runs; });
+        std::string text("a notification");
+
+        THEN("they are stored without allocating") {
+            EventTask empty;
+            EventTask lambda([&runs] () { ++runs; });
+            EventTask bound(std::bind(callback, future));
+            EventTask captured([callback, future] () { callback(future); });
+            EventTask function(std::function<void ()>([&runs] () { ++runs; }));
+            EventTask string([text] () {});
+
+            REQUIRE(empty.is_inline());
+            REQUIRE(lambda.is_inline());
+            REQUIRE(bound.is_inline());
+            REQUIRE(captured.is_inline());
+            REQUIRE(function.is_inline());
+            REQUIRE(string.is_inline());
+        }
+
+        THEN("large callables are stored on the heap and still run") {
+            char big[EventTask::inline_size + 1] = {};
+            EventTask task([&runs, big] () { runs += big[0] + 1; });
+
+            REQUIRE_FALSE(task.is_inline());
+            task();
+            REQUIRE(runs == 1);
+        }
+
+        WHEN("a task is moved") {
+            EventTask task([&runs, future] () { runs += *future.promise; });
+            EventTask moved(std::move(task));
+
+            THEN("the callable moves with it") {
+                REQUIRE_FALSE(task);
+                REQUIRE(moved);
+                REQUIRE(future.promise.use_count() == 2);
+                moved();
+                REQUIRE(runs == 1);
+            }
+        }
+
+        WHEN("a task is destroyed") {
+            {
+                EventTask task([future] () {});
+                REQUIRE(future.promise.use_count() == 2);
+            }
+
+            THEN("the callable is destroyed") {
+                REQUIRE(future.promise.use_count() == 1);
+            }
+        }
+
+        THEN("empty functions make empty tasks") {
+            REQUIRE_FALSE(EventTask(std::function<void ()>()));
+            REQUIRE_FALSE(EventTask(nullptr));
+        }
+    }
+}
+
+SCENARIO("Event queues run tasks in order", "[event_queue]") {
+
+    GIVEN("an event queue") {
+        EventQueue queue;
+        std::vector<int> order;
+
+        THEN("it starts empty") {
+            REQUIRE(queue.empty());
+            REQUIRE(run_all(queue) == 0);
+        }
+
+        WHEN("tasks are pushed") {
+            for (int i = 0; i < 1000; ++i) {
+                queue.push([&order, i] () { order.push_back(i); });
+            }
+
+            THEN("they come out in the order they were pushed") {
+                REQUIRE_FALSE(queue.empty());
+                REQUIRE(run_all(queue) == 1000);
+                REQUIRE(order.size() == 1000);
+                for (int i = 0; i < 1000; ++i) {
+                    REQUIRE(order[size_t(i)] == i);
+                }
+                REQUIRE(queue.empty());
+            }
+
+            THEN("their nodes are reused") {
+                uint32_t capacity(queue.get_capacity());
+                run_all(queue);
+
+                for (int i = 0; i < 1000; ++i) {
+                    queue.push([] () {});
+                }
+                run_all(queue);
+                REQUIRE(queue.get_capacity() == capacity);
+            }
+        }
+
+        WHEN("a batch is dropped") {
+            std::shared_ptr<int> held(std::make_shared<int>(0));
+            queue.push([held] () {});
+            queue.push([held] () {});
+            queue.take_all().clear();
+
+            THEN("its tasks are destroyed unrun") {
+                REQUIRE(held.use_count() == 1);
+                REQUIRE(queue.empty());
+            }
+        }
+
+        WHEN("many threads push at once") {
+            std::vector<std::thread> threads;
+            std::vector<std::vector<int>> seen(4);
+
+            for (int t = 0; t < 4; ++t) {
+                threads.emplace_back([&queue, &seen, t] () {
+                    for (int i = 0; i < 5000; ++i) {
+                        queue.push([&seen, t, i] () { seen[size_t(t)].push_back(i); });
+                    }
+                });
+            }
+
+            int runs(0);
+            while (runs < 4 * 5000) {
+                runs += run_all(queue);
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+
+            THEN("each thread's tasks run once, in its order") {
+                for (auto &thread_seen : seen) {
+                    REQUIRE(thread_seen.size() == 5000);
+                    bool ordered(true);
+                    for (size_t i = 0; i < thread_seen.size(); ++i) {
+                        ordered = ordered && thread_seen[i] == int(i);
+                    }
+                    REQUIRE(ordered);
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("The event manager keeps frames apart", "[event_queue]") {
+
+    GIVEN("an empty event manager") {
+        EventManager &em(EventManager::get_instance());
+        em.flush_and_disable();
+        em.reenable();
+        em.process_events();
+
+        std::vector<std::string> order;
+
+        WHEN("events add events for this frame and the next") {
+            em.add_event([&] () {
+                order.push_back("first");
+                em.add_event_next_frame([&] () { order.push_back("next frame"); });
+                em.add_event([&] () { order.push_back("same frame"); });
+            });
+
+            int first_runs(em.process_events());
+
+            THEN("events for this frame run in it") {
+                REQUIRE(first_runs == 2);
+                REQUIRE(order == std::vector<std::string>({"first", "same frame"}));
+                REQUIRE_FALSE(em.is_idle());
+            }
+
+            THEN("events for the next frame run before ones added since") {
+                em.add_event([&] () { order.push_back("added"); });
+                REQUIRE(em.process_events() == 2);
+                REQUIRE(order == std::vector<std::string>({"first", "same frame", "next frame", "added"}));
+                REQUIRE(em.is_idle());
+            }
+        }
+
+        WHEN("it is flushed and disabled") {
+            std::shared_ptr<int> held(std::make_shared<int>(0));
+            em.add_event([held] () {});
+            em.add_event_next_frame([held] () {});
+            em.flush_and_disable();
+            em.add_event([held] () {});
+
+            THEN("events are dropped and ignored") {
+                REQUIRE(held.use_count() == 1);
+                REQUIRE(em.is_idle());
+                REQUIRE(em.process_events() == 0);
+            }
+
+            em.reenable();
+        }
+    }
+}
+
+SCENARIO("Benchmark event queue contention", "[.][benchmark][event_queue]") {
+    const int events(320000);
+
+    for (int producers : {1, 4, 16, 64}) {
+        int per_producer(events / producers);
+
+        EventQueue queue;
+        double lock_free(time_contention(queue, [] (EventQueue &queue) { return run_all(queue); },
+                                         producers, per_producer));
+
+        LockedQueue locked_queue;
+        double locked(time_contention(locked_queue, [] (LockedQueue &queue) { return queue.run_all(); },
+                                      producers, per_producer));
+
+        std::cout << producers << " producers x " << per_producer << " events: "
+                  << lock_free << " ms lock-free, " << locked << " ms locked list; "
+                  << queue.get_capacity() << " nodes pooled" << std::endl;
+    }
+}
@@ -0,0 +1,36 @@
+#include "catch.hpp"
+#include "frame_damage.hpp"
+
+SCENARIO("Frame damage says when frames need drawing", "[frame_damage]") {
+
+    GIVEN("a frame which has been drawn") {
+        FrameDamage::set_tracking(true);
+        FrameDamage::take();
+
+        THEN("the next frame doesn't need drawing") {
+            REQUIRE_FALSE(FrameDamage::is_dirty());
+            REQUIRE_FALSE(FrameDamage::take());
+        }
+
+        WHEN("something changes") {
+            FrameDamage::mark_dirty();
+
+            THEN("the next frame needs drawing, but not the one after") {
+                REQUIRE(FrameDamage::is_dirty());
+                REQUIRE(FrameDamage::take());
+                REQUIRE_FALSE(FrameDamage::take());
+            }
+        }
+
+        WHEN("damage isn't tracked") {
+            FrameDamage::set_tracking(false);
+
+            THEN("every frame needs drawing") {
+                REQUIRE(FrameDamage::take());
+                REQUIRE(FrameDamage::take());
+            }
+
+            FrameDamage::set_tracking(true);
+        }
+    }
+}
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+#include "event_manager.hpp"
+#include "frame_scheduler.hpp"
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+SCENARIO("The event manager can be waited on", "[frame_scheduler]") {
+
+    GIVEN("an empty event manager") {
+        EventManager &em(EventManager::get_instance());
+        em.flush_and_disable();
+        em.reenable();
+        em.process_events();
+
+        THEN("it is idle") {
+            REQUIRE(em.is_idle());
+        }
+
+        WHEN("nothing is added") {
+            auto start(steady_clock::now());
+            bool woken(em.wait_for_event(start + milliseconds(20)));
+
+            THEN("waiting times out") {
+                REQUIRE_FALSE(woken);
+                bool waited(steady_clock::now() - start >= milliseconds(20));
+                REQUIRE(waited);
+            }
+        }
+
+        WHEN("an event is added from another thread") {
+            int runs(0);
+            std::thread adder([&] () {
+                std::this_thread::sleep_for(milliseconds(10));
+                em.add_event([&] () { ++runs; });
+            });
+
+            auto start(steady_clock::now());
+            bool woken(em.wait_for_event(start + milliseconds(5000)));
+            adder.join();
+
+            THEN("waiting ends early and the event can be run") {
+                REQUIRE(woken);
+                bool early(steady_clock::now() - start < milliseconds(5000));
+                REQUIRE(early);
+                REQUIRE(em.process_events() == 1);
+                REQUIRE(runs == 1);
+            }
+        }
+
+        WHEN("an event is added for the next frame") {
+            em.add_event_next_frame([] () {});
+
+            THEN("it doesn't end waits but the manager isn't idle") {
+                REQUIRE_FALSE(em.wait_for_event(steady_clock::now() + milliseconds(10)));
+                REQUIRE_FALSE(em.is_idle());
+            }
+
+            em.flush_and_disable();
+            em.reenable();
+        }
+    }
+}
+
+SCENARIO("The frame scheduler paces frames", "[frame_scheduler]") {
+
+    GIVEN("a scheduler at 50 frames a second") {
+        EventManager &em(EventManager::get_instance());
+        em.flush_and_disable();
+        em.reenable();
+
+        FrameScheduler scheduler(50);
+        scheduler.set_adaptive(false);
+
+        WHEN("a frame has nothing to do") {
+            scheduler.begin_frame();
+            scheduler.run_events();
+            scheduler.end_frame();
+
+            THEN("it lasts about a frame") {
+                REQUIRE(scheduler.get_frame_time() >= 0.019);
+                REQUIRE(scheduler.get_frame_time() < 1.0);
+            }
+
+            THEN("it uses little of the CPU") {
+                REQUIRE(scheduler.get_frame_cpu_time() < scheduler.get_frame_time());
+            }
+        }
+
+        WHEN("events are added during a frame") {
+            int runs(0);
+            std::thread adder([&] () {
+                for (int i = 0; i < 3; ++i) {
+                    std::this_thread::sleep_for(milliseconds(2));
+                    em.add_event([&] () { ++runs; });
+                }
+            });
+
+            scheduler.begin_frame();
+            scheduler.run_events();
+            scheduler.end_frame();
+            adder.join();
+            em.process_events();
+
+            THEN("they are all run") {
+                REQUIRE(runs == 3);
+            }
+        }
+
+        WHEN("something is to be called after events") {
+            std::vector<int> runs_seen;
+            int runs(0);
+            scheduler.set_after_events([&] () { runs_seen.push_back(runs); });
+
+            em.add_event([&] () { ++runs; });
+            std::thread adder([&] () {
+                std::this_thread::sleep_for(milliseconds(5));
+                em.add_event([&] () { ++runs; });
+            });
+
+            scheduler.begin_frame();
+            scheduler.run_events();
+            scheduler.end_frame();
+            adder.join();
+
+            THEN("it is called after each batch, once the batch has run") {
+                REQUIRE(runs_seen.size() >= 2);
+                REQUIRE(runs_seen.front() == 1);
+                REQUIRE(runs_seen.back() == 2);
+            }
+        }
+
+        WHEN("it is adaptive and nothing happens") {
+            scheduler.set_adaptive(true);
+            scheduler.set_idle_fps(20);
+            scheduler.set_idle_delay(milliseconds(0));
+
+            scheduler.begin_frame();
+            scheduler.run_events();
+            scheduler.end_frame();
+
+            THEN("it drops to the idle rate") {
+                REQUIRE(scheduler.is_idle());
+                REQUIRE(scheduler.get_frame_time() >= 0.049);
+            }
+        }
+
+        WHEN("it is adaptive and something is animating") {
+            scheduler.set_adaptive(true);
+            scheduler.set_idle_fps(1);
+            scheduler.set_idle_delay(milliseconds(30));
+
+            // Animations queue themselves again every frame
+            std::function<void ()> animate;
+            animate = [&] () { em.add_event_next_frame(animate); };
+            em.add_event_next_frame(animate);
+
+            double longest_frame(0.0);
+            for (int i = 0; i < 4; ++i) {
+                scheduler.begin_frame();
+                scheduler.run_events();
+                scheduler.end_frame();
+                longest_frame = std::max(longest_frame, scheduler.get_frame_time());
+            }
+
+            THEN("it stays at the full rate") {
+                REQUIRE_FALSE(scheduler.is_idle());
+                REQUIRE(longest_frame < 0.5);
+            }
+
+            em.flush_and_disable();
+            em.reenable();
+        }
+    }
+}
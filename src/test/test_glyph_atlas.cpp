@@ -0,0 +1,52 @@
+#include <string>
+
+#include "catch.hpp"
+#include "glyph_atlas.hpp"
+
+static std::vector<uint32_t> decode(const std::string &text) {
+    std::vector<uint32_t> code_points;
+    for (size_t i = 0; i < text.size();) {
+        code_points.push_back(GlyphAtlas::next_code_point(text, i));
+    }
+
+    return code_points;
+}
+
+SCENARIO("Text is read as code points", "[glyph_atlas]") {
+
+    GIVEN("ASCII text") {
+        THEN("each byte is a code point") {
+            REQUIRE(decode("Hi!") == std::vector<uint32_t>({'H', 'i', '!'}));
+        }
+    }
+
+    GIVEN("multi-byte sequences") {
+        THEN("they are read as one code point each") {
+            // e acute, the euro sign and an emoji
+            REQUIRE(decode("\xc3\xa9") == std::vector<uint32_t>({0xe9}));
+            REQUIRE(decode("\xe2\x82\xac") == std::vector<uint32_t>({0x20ac}));
+            REQUIRE(decode("\xf0\x9f\x98\x80") == std::vector<uint32_t>({0x1f600}));
+            REQUIRE(decode("a\xc3\xa9z") == std::vector<uint32_t>({'a', 0xe9, 'z'}));
+        }
+    }
+
+    GIVEN("malformed sequences") {
+        std::vector<uint32_t> replaced(2, GlyphAtlas::replacement);
+
+        THEN("stray continuation bytes are replaced") {
+            REQUIRE(decode("\x80z") == std::vector<uint32_t>({GlyphAtlas::replacement, 'z'}));
+        }
+
+        THEN("truncated sequences are replaced a byte at a time") {
+            REQUIRE(decode("\xe2\x82") == replaced);
+        }
+
+        THEN("overlong encodings are replaced") {
+            REQUIRE(decode("\xc0\xaf") == replaced);
+        }
+
+        THEN("sequences broken by another character are replaced") {
+            REQUIRE(decode("\xc3z") == std::vector<uint32_t>({GlyphAtlas::replacement, 'z'}));
+        }
+    }
+}
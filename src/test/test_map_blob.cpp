@@ -0,0 +1,156 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "map_blob.hpp"
+
+SCENARIO("Map blobs round trip the data of a map", "[map_blob]") {
+
+    GIVEN("a compiled map") {
+        std::string source("test_map_blob.tmx");
+        std::string blob_path(MapBlob::path_for(source));
+        std::ofstream(source) << "<map/>";
+
+        std::vector<uint8_t>  tileset_indices({0, 1, 1, 2, 0, 1});
+        std::vector<uint16_t> tile_ids({0, 4, 5, 300, 0, 7});
+
+        MapBlob::write(
+            blob_path, source, 3, 2,
+            {{"base", 64, 128, "tiles/base.png"}, {"extra", 32, 32, "tiles/extra.png"}},
+            {{"Ground", 3, 2, tileset_indices.data(), tile_ids.data()}},
+            {{"Objects", "start", 32, 64, 3, "tiles/base.png"}}
+        );
+
+        WHEN("it is loaded") {
+            MapBlob blob(blob_path);
+
+            THEN("the map's size is kept") {
+                REQUIRE(blob.get_map_width() == 3);
+                REQUIRE(blob.get_map_height() == 2);
+            }
+
+            THEN("the tilesets are kept") {
+                REQUIRE(blob.get_tilesets().size() == 2);
+                REQUIRE(blob.get_tilesets()[1].name == "extra");
+                REQUIRE(blob.get_tilesets()[0].height == 128);
+                REQUIRE(blob.get_tilesets()[0].atlas == "tiles/base.png");
+            }
+
+            THEN("the layer grids are kept") {
+                REQUIRE(blob.get_layers().size() == 1);
+                auto &layer(blob.get_layers()[0]);
+                REQUIRE(layer.name == "Ground");
+                REQUIRE(std::vector<uint8_t> (layer.tileset_indices, layer.tileset_indices + 6) == tileset_indices);
+                REQUIRE(std::vector<uint16_t>(layer.tile_ids,        layer.tile_ids        + 6) == tile_ids);
+            }
+
+            THEN("the objects are kept") {
+                REQUIRE(blob.get_objects().size() == 1);
+                REQUIRE(blob.get_objects()[0].group == "Objects");
+                REQUIRE(blob.get_objects()[0].name == "start");
+                REQUIRE(blob.get_objects()[0].y == 64);
+                REQUIRE(blob.get_objects()[0].tile_id == 3);
+            }
+
+            THEN("it is fresh for its source") {
+                REQUIRE(blob.is_fresh_for(source));
+            }
+        }
+
+        WHEN("the source changes") {
+            std::ofstream(source, std::ios::app) << "<!-- edited -->";
+
+            THEN("the blob is stale") {
+                REQUIRE(!MapBlob(blob_path).is_fresh_for(source));
+            }
+        }
+
+        WHEN("the blob is truncated") {
+            std::ofstream(blob_path, std::ios::binary | std::ios::trunc) << "PYLMAP";
+
+            THEN("loading it fails") {
+                REQUIRE_THROWS_AS(MapBlob blob(blob_path), MapBlob::LoadException &);
+            }
+        }
+
+        std::remove(blob_path.c_str());
+        std::remove(source.c_str());
+    }
+
+    GIVEN("a compiled map whose layer grids end at odd offsets") {
+        std::string source("test_map_blob_odd.tmx");
+        std::string blob_path(MapBlob::path_for(source));
+        std::ofstream(source) << "<map/>";
+
+        // The name and three tiles leave the tileset indices ending at
+        // an odd offset, so the tile ids need padding to be aligned
+        std::vector<uint8_t>  tileset_indices({1, 0, 1});
+        std::vector<uint16_t> tile_ids({2, 0, 9});
+
+        MapBlob::write(
+            blob_path, source, 3, 1,
+            {{"base", 64, 64, "tiles/base.png"}},
+            {{"Odds", 3, 1, tileset_indices.data(), tile_ids.data()}},
+            {}
+        );
+
+        std::string contents;
+        {
+            std::ifstream file(blob_path, std::ios::binary);
+            contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        size_t indices_end(contents.find("Odds") + 4 + 2 * sizeof(int32_t) + tileset_indices.size());
+
+        THEN("it loads whole") {
+            REQUIRE((indices_end % 2) == 1);
+            MapBlob blob(blob_path);
+            REQUIRE(std::vector<uint16_t>(blob.get_layers()[0].tile_ids, blob.get_layers()[0].tile_ids + 3) == tile_ids);
+        }
+
+        WHEN("it is truncated anywhere") {
+            int failed(0);
+            for (size_t length = 0; length < contents.size(); ++length) {
+                std::ofstream(blob_path, std::ios::binary | std::ios::trunc) << contents.substr(0, length);
+
+                try {
+                    MapBlob blob(blob_path);
+                }
+                catch (MapBlob::LoadException &) {
+                    ++failed;
+                }
+            }
+
+            THEN("loading it always fails") {
+                REQUIRE(size_t(failed) == contents.size());
+            }
+        }
+
+        WHEN("its layer is given a size far past the end") {
+            std::string corrupt(contents);
+            size_t size_at(corrupt.find("Odds") + 4);
+            int32_t huge(INT32_MAX);
+            std::memcpy(&corrupt[size_at],     &huge, sizeof(huge));
+            std::memcpy(&corrupt[size_at + 4], &huge, sizeof(huge));
+            std::ofstream(blob_path, std::ios::binary | std::ios::trunc) << corrupt;
+
+            THEN("loading it fails") {
+                REQUIRE_THROWS_AS(MapBlob blob(blob_path), MapBlob::LoadException &);
+            }
+        }
+
+        std::remove(blob_path.c_str());
+        std::remove(source.c_str());
+    }
+
+    GIVEN("no compiled map") {
+        THEN("loading it fails") {
+            REQUIRE_THROWS_AS(MapBlob blob("no_such_map.tmx.pmap"), MapBlob::LoadException &);
+        }
+    }
+}
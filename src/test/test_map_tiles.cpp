@@ -0,0 +1,44 @@
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+#include "catch.hpp"
+#include "map.hpp"
+
+SCENARIO("Batches of tile updates are checked before any tile changes", "[map]") {
+
+    GIVEN("a batch of tile updates inside a 10 by 4 layer") {
+        std::vector<std::pair<glm::ivec2, std::string>> tiles({
+            std::make_pair(glm::ivec2(0, 0), std::string("test/blank")),
+            std::make_pair(glm::ivec2(9, 3), std::string("test/blank")),
+            std::make_pair(glm::ivec2(4, 2), std::string(""))
+        });
+
+        THEN("it is accepted") {
+            REQUIRE_NOTHROW(Map::check_tile_positions(10, 4, tiles));
+        }
+
+        WHEN("one position after the others is off the layer") {
+            tiles.push_back(std::make_pair(glm::ivec2(10, 0), std::string("test/blank")));
+
+            THEN("the whole batch is rejected") {
+                REQUIRE_THROWS_AS(Map::check_tile_positions(10, 4, tiles), std::runtime_error);
+            }
+        }
+
+        WHEN("one position is negative") {
+            tiles.insert(tiles.begin() + 1, std::make_pair(glm::ivec2(3, -1), std::string("")));
+
+            THEN("the whole batch is rejected") {
+                REQUIRE_THROWS_AS(Map::check_tile_positions(10, 4, tiles), std::runtime_error);
+            }
+        }
+
+        THEN("it is rejected by a smaller layer") {
+            REQUIRE_THROWS_AS(Map::check_tile_positions(10, 3, tiles), std::runtime_error);
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#include <limits>
+#include <tuple>
+
+#include "catch.hpp"
+#include "packed_vertex.hpp"
+
+SCENARIO("Vertices pack into fixed point", "[packed_vertex]") {
+
+    GIVEN("positions in tiles") {
+        THEN("they are scaled and rounded to the nearest unit") {
+            REQUIRE(PackedVertex::pack_position(0.0f,   PackedVertex::tile_units) == 0);
+            REQUIRE(PackedVertex::pack_position(1.0f,   PackedVertex::tile_units) == PackedVertex::tile_units);
+            REQUIRE(PackedVertex::pack_position(-2.5f,  PackedVertex::tile_units) == -2 * PackedVertex::tile_units - PackedVertex::tile_units / 2);
+            REQUIRE(PackedVertex::pack_position(0.499f / float(PackedVertex::tile_units), PackedVertex::tile_units) == 0);
+        }
+
+        THEN("those out of range are clamped") {
+            REQUIRE(PackedVertex::pack_position(1.0e6f,  1) == std::numeric_limits<GLshort>::max());
+            REQUIRE(PackedVertex::pack_position(-1.0e6f, 1) == std::numeric_limits<GLshort>::min());
+        }
+    }
+
+    GIVEN("texture coordinates") {
+        THEN("[0, 1] covers the whole range") {
+            REQUIRE(PackedVertex::pack_tex_coord(0.0f) == 0);
+            REQUIRE(PackedVertex::pack_tex_coord(1.0f) == std::numeric_limits<GLushort>::max());
+            REQUIRE(PackedVertex::pack_tex_coord(0.5f) == 32768);
+        }
+
+        THEN("those outside [0, 1] are clamped") {
+            REQUIRE(PackedVertex::pack_tex_coord(-0.25f) == 0);
+            REQUIRE(PackedVertex::pack_tex_coord(1.25f)  == std::numeric_limits<GLushort>::max());
+        }
+    }
+}
+
+SCENARIO("Quads keep their corners in order", "[packed_vertex]") {
+
+    GIVEN("a quad packed from two triangles of floats") {
+        // Bottom left, top left, bottom right, top left, top right,
+        // bottom right
+        const GLfloat vertices[12] = {
+            10.0f, 20.0f,
+            10.0f, 30.0f,
+            40.0f, 20.0f,
+            10.0f, 30.0f,
+            40.0f, 30.0f,
+            40.0f, 20.0f
+        };
+        const GLfloat tex_coords[12] = {
+            0.0f,  0.0f,
+            0.0f,  0.5f,
+            0.25f, 0.0f,
+            0.0f,  0.5f,
+            0.25f, 0.5f,
+            0.25f, 0.0f
+        };
+
+        PackedQuad quad = PackedQuad();
+        quad.set_from_triangles(vertices, tex_coords, 1);
+
+        THEN("it has the same corners as one set from its bounds") {
+            PackedQuad expected = PackedQuad();
+            expected.set_position(10, 20, 40, 30);
+            expected.set_tex_coords(std::make_tuple(0.0f, 0.25f, 0.0f, 0.5f));
+
+            for (int i = 0; i < PackedQuad::num_vertices; ++i) {
+                REQUIRE(quad.vertices[i].x == expected.vertices[i].x);
+                REQUIRE(quad.vertices[i].y == expected.vertices[i].y);
+                REQUIRE(quad.vertices[i].u == expected.vertices[i].u);
+                REQUIRE(quad.vertices[i].v == expected.vertices[i].v);
+            }
+        }
+
+        THEN("its corners go bottom left, top left, top right, bottom right") {
+            REQUIRE(quad.vertices[0].x == 10);
+            REQUIRE(quad.vertices[0].y == 20);
+            REQUIRE(quad.vertices[1].x == 10);
+            REQUIRE(quad.vertices[1].y == 30);
+            REQUIRE(quad.vertices[2].x == 40);
+            REQUIRE(quad.vertices[2].y == 30);
+            REQUIRE(quad.vertices[3].x == 40);
+            REQUIRE(quad.vertices[3].y == 20);
+        }
+    }
+
+    GIVEN("a packed vertex") {
+        THEN("it is 8 bytes") {
+            REQUIRE(sizeof(PackedVertex) == 8);
+            REQUIRE(sizeof(PackedQuad) == 32);
+        }
+    }
+}
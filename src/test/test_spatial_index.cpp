@@ -0,0 +1,79 @@
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/vec2.hpp>
+
+#include "catch.hpp"
+#include "spatial_index.hpp"
+
+SCENARIO("The spatial index finds objects by position", "[spatial_index]") {
+
+    GIVEN("a 40 by 20 map with objects spread over several cells") {
+        SpatialIndex index(40, 20, 8);
+        index.insert(1, glm::vec2(2.0f, 3.0f));
+        index.insert(2, glm::vec2(2.0f, 3.0f));
+        index.insert(3, glm::vec2(17.0f, 9.0f));
+        index.insert(4, glm::vec2(39.0f, 19.0f));
+        index.insert(5, glm::vec2(3.5f, 3.0f));
+
+        THEN("point queries only find objects exactly there") {
+            REQUIRE(index.query_point(glm::vec2(2.0f, 3.0f)) == std::vector<int>({1, 2}));
+            REQUIRE(index.query_point(glm::vec2(3.0f, 3.0f)).empty());
+            REQUIRE(index.query_point(glm::vec2(39.0f, 19.0f)) == std::vector<int>({4}));
+        }
+
+        THEN("rectangle queries include their edges and span cells") {
+            REQUIRE(index.query_rect(glm::vec2(2.0f, 3.0f), glm::vec2(17.0f, 9.0f)) == std::vector<int>({1, 2, 3, 5}));
+            REQUIRE(index.query_rect(glm::vec2(3.0f, 0.0f), glm::vec2(16.0f, 20.0f)) == std::vector<int>({5}));
+        }
+
+        THEN("radius queries find objects within the circle") {
+            REQUIRE(index.query_radius(glm::vec2(2.0f, 3.0f), 1.5f) == std::vector<int>({1, 2, 5}));
+            REQUIRE(index.query_radius(glm::vec2(2.0f, 3.0f), 1.0f) == std::vector<int>({1, 2}));
+            REQUIRE(index.query_radius(glm::vec2(10.0f, 10.0f), 100.0f) == std::vector<int>({1, 2, 3, 4, 5}));
+        }
+
+        THEN("positions can be looked up") {
+            REQUIRE(index.contains(3));
+            REQUIRE(index.get_position(3) == glm::vec2(17.0f, 9.0f));
+            REQUIRE(!index.contains(6));
+        }
+
+        WHEN("an object moves into another cell") {
+            index.move(1, glm::vec2(30.0f, 15.0f));
+
+            THEN("it is only found at its new position") {
+                REQUIRE(index.query_point(glm::vec2(2.0f, 3.0f)) == std::vector<int>({2}));
+                REQUIRE(index.query_point(glm::vec2(30.0f, 15.0f)) == std::vector<int>({1}));
+                REQUIRE(index.get_position(1) == glm::vec2(30.0f, 15.0f));
+            }
+        }
+
+        WHEN("an object is removed") {
+            index.remove(2);
+
+            THEN("it is no longer found") {
+                REQUIRE(!index.contains(2));
+                REQUIRE(index.query_point(glm::vec2(2.0f, 3.0f)) == std::vector<int>({1}));
+            }
+        }
+
+        WHEN("an object not in the index is moved") {
+            index.move(6, glm::vec2(2.0f, 3.0f));
+
+            THEN("it is still not in the index") {
+                REQUIRE(!index.contains(6));
+                REQUIRE(index.query_point(glm::vec2(2.0f, 3.0f)) == std::vector<int>({1, 2}));
+            }
+        }
+
+        WHEN("an object moves off the map") {
+            index.move(3, glm::vec2(-1.0f, 25.0f));
+
+            THEN("it can still be found") {
+                REQUIRE(index.query_point(glm::vec2(-1.0f, 25.0f)) == std::vector<int>({3}));
+                REQUIRE(index.query_rect(glm::vec2(-2.0f, 24.0f), glm::vec2(0.0f, 26.0f)) == std::vector<int>({3}));
+            }
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#include <tuple>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+#include "catch.hpp"
+#include "packed_vertex.hpp"
+#include "sprite_batch.hpp"
+
+namespace {
+    SpriteBatch::Quad make_quad(glm::vec2 position) {
+        SpriteBatch::Quad quad;
+        quad.draw_layer = 0;
+        quad.texture    = 1;
+        quad.position   = position;
+        quad.quad.set_position(0, 0, GLshort(PackedVertex::tile_units), GLshort(PackedVertex::tile_units));
+        quad.quad.set_tex_coords(std::make_tuple(0.0f, 1.0f, 0.0f, 1.0f));
+        return quad;
+    }
+
+    ///
+    /// Get where a packed vertex is drawn, in tiles
+    ///
+    glm::vec2 drawn_at(const PackedVertex &vertex, const SpriteBatch::Span &span) {
+        return span.origin + glm::vec2(vertex.x, vertex.y) / float(PackedVertex::tile_units);
+    }
+}
+
+SCENARIO("Sprite batches keep quads where they are on large maps", "[sprite_batch]") {
+
+    GIVEN("two quads near each other") {
+        std::vector<SpriteBatch::Quad> quads({make_quad(glm::vec2(3.5f, 2.0f)), make_quad(glm::vec2(10.0f, 7.25f))});
+
+        std::vector<PackedQuad> vertex_data;
+        std::vector<SpriteBatch::Span> spans;
+        SpriteBatch::pack(quads, vertex_data, spans);
+
+        THEN("they share an origin") {
+            REQUIRE(spans.size() == 1);
+            REQUIRE(drawn_at(vertex_data[0].vertices[0], spans[0]) == glm::vec2(3.5f, 2.0f));
+            REQUIRE(drawn_at(vertex_data[1].vertices[2], spans[0]) == glm::vec2(11.0f, 8.25f));
+        }
+    }
+
+    GIVEN("two quads more than 128 tiles apart") {
+        std::vector<SpriteBatch::Quad> quads({make_quad(glm::vec2(2.0f, 140.0f)), make_quad(glm::vec2(135.5f, 3.0f))});
+
+        std::vector<PackedQuad> vertex_data;
+        std::vector<SpriteBatch::Span> spans;
+        SpriteBatch::pack(quads, vertex_data, spans);
+
+        THEN("each is drawn where it is, from its own origin") {
+            REQUIRE(spans.size() == 2);
+            REQUIRE(spans[1].begin == 1);
+
+            REQUIRE(drawn_at(vertex_data[0].vertices[0], spans[0]) == glm::vec2(2.0f, 140.0f));
+            REQUIRE(drawn_at(vertex_data[0].vertices[2], spans[0]) == glm::vec2(3.0f, 141.0f));
+            REQUIRE(drawn_at(vertex_data[1].vertices[0], spans[1]) == glm::vec2(135.5f, 3.0f));
+            REQUIRE(drawn_at(vertex_data[1].vertices[2], spans[1]) == glm::vec2(136.5f, 4.0f));
+        }
+    }
+
+    GIVEN("a quad whose far corner is just out of range of the origin") {
+        // 127 tiles and a half is in range, but the corner a tile
+        // further on isn't
+        std::vector<SpriteBatch::Quad> quads({make_quad(glm::vec2(0.0f, 0.0f)), make_quad(glm::vec2(127.5f, 0.0f))});
+
+        std::vector<PackedQuad> vertex_data;
+        std::vector<SpriteBatch::Span> spans;
+        SpriteBatch::pack(quads, vertex_data, spans);
+
+        THEN("it starts a new origin rather than wrapping") {
+            REQUIRE(spans.size() == 2);
+            REQUIRE(drawn_at(vertex_data[1].vertices[2], spans[1]) == glm::vec2(128.5f, 1.0f));
+        }
+    }
+}
@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "text_layout.hpp"
+
+// Made up metrics: widths vary with the character, some glyphs reach
+// back over the one before, and some pairs are kerned.
+static TextLayout::GlyphMetrics fake_metrics(uint32_t code_point) {
+    TextLayout::GlyphMetrics glyph;
+    glyph.advance = 3 + int(code_point % 7);
+    glyph.min_x   = (code_point % 5 == 0) ? -2 : int(code_point % 2);
+    glyph.max_x   = glyph.advance + int(code_point % 3) - 1;
+    return glyph;
+}
+
+static int fake_kerning(uint32_t left, uint32_t right) {
+    return ((left + right) % 11 == 0) ? -1 : 0;
+}
+
+// Measure as SDL_ttf's TTF_SizeUTF8 does, from the start every time.
+static int fake_size(const char *text) {
+    TextLayout layout(fake_metrics, fake_kerning);
+    return layout.measure(text);
+}
+
+// The word wrapping Text used before TextLayout, kept to check against.
+// It measures every growing prefix of a line, and binary searches for
+// where to cut words too long for a line. Its skipping of multi-byte
+// characters when finding the ends of words is left out, as it changes
+// nothing for valid UTF-8.
+static bool reference_wrap(const std::string &text, int available_width, int border,
+                           std::vector<std::string> &result, int &used_width) {
+    result.clear();
+    used_width = 0;
+
+    int length = (int)text.length();
+    const char* ctext = text.c_str();
+    std::vector<char> line_buffer(size_t(length + 1));
+    char *line = line_buffer.data();
+
+    for (int t = 0; t < length; t++) {
+        int line_width = 0;
+        int w = 0;
+        line[0] = '\0';
+        int ll = 0;
+
+        for (int l = t; l < length; l++) {
+            for (w = l; w < length && (ctext[w] != ' ' && ctext[w] != '\n'); w++);
+            for (; l < w; l++) {
+                line[l - t] = ctext[l];
+            }
+            line[l - t] = '\0';
+            line_width = fake_size(line) + border;
+            if (line_width <= available_width) {
+                if (line_width > used_width) {
+                    used_width = line_width;
+                }
+                ll = l - t;
+                if (ctext[w] == '\n' || ctext[w] == '\0') {
+                    t = l;
+                    break;
+                }
+                else {
+                    line[ll] = ctext[w];
+                }
+            }
+            else {
+                if (ll > 0) {
+                    t += ll;
+                }
+                else {
+                    char c;
+                    int left = 0;
+                    int right = l - t;
+                    int ls;
+                    ll = 0;
+                    for (ls = (right + left) / 2; ls != ll; ls = (right + left) / 2) {
+                        ll = ls;
+                        c = line[ls];
+                        line[ls] = 0;
+                        line_width = fake_size(line) + border;
+                        if (line_width <= available_width) {
+                            if (line_width > used_width) {
+                                used_width = line_width;
+                            }
+                            left = ls;
+                        }
+                        else {
+                            right = ls;
+                        }
+                        line[ls] = c;
+                    }
+                    t += ll - 1;
+                }
+                line[ll] = '\0';
+                break;
+            }
+        }
+
+        result.emplace_back(line);
+        if (line[0] == '\0' && ctext[w] != '\n') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::string random_text(unsigned &seed, int length) {
+    static const char characters[] = "aaabcdeeefghiijklmnooopqrstuuvwxyzAEIOU.,!?  \n";
+    std::string text;
+    for (int i = 0; i < length; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        text += characters[(seed >> 16) % (sizeof(characters) - 1)];
+    }
+    return text;
+}
+
+SCENARIO("Text layout measures as SDL_ttf does", "[text_layout]") {
+
+    GIVEN("a layout with made up metrics") {
+        TextLayout layout(fake_metrics, fake_kerning);
+
+        THEN("nothing has no width") {
+            REQUIRE(layout.measure("") == 0);
+        }
+
+        THEN("a glyph's width is its extent") {
+            TextLayout::GlyphMetrics a(fake_metrics('a'));
+            REQUIRE(layout.measure("a") == std::max(a.max_x, a.advance) - std::min(a.min_x, 0));
+        }
+
+        THEN("glyphs which reach back widen the text") {
+            // 'd' is 100, which has a negative min_x
+            REQUIRE(layout.measure("d") > fake_metrics('d').advance);
+        }
+
+        THEN("kerning moves the pen") {
+            // 'A' and 'C' are 65 and 67, which are kerned
+            TextLayout::GlyphMetrics a(fake_metrics('A'));
+            TextLayout::GlyphMetrics c(fake_metrics('C'));
+            REQUIRE(layout.measure("AC") == a.advance - 1 + std::max(c.max_x, c.advance) - std::min(a.min_x, 0));
+        }
+
+        THEN("byte order marks are skipped") {
+            REQUIRE(layout.measure("ab\xef\xbb\xbf" "c") == layout.measure("abc"));
+        }
+    }
+}
+
+SCENARIO("Text layout wraps as Text used to", "[text_layout]") {
+
+    GIVEN("a layout with made up metrics") {
+        TextLayout layout(fake_metrics, fake_kerning);
+        int border(layout.measure(" ") * 2);
+
+        WHEN("text is wrapped") {
+            std::vector<std::string> lines;
+            int used_width;
+            REQUIRE(layout.wrap("the quick brown fox\njumps over the lazy dog", 80, border, lines, used_width));
+
+            THEN("lines break at spaces and new lines") {
+                REQUIRE(lines.size() >= 3);
+                REQUIRE(lines[0].find('\n') == std::string::npos);
+                for (const std::string &line : lines) {
+                    int width(layout.measure(line) + border);
+                    REQUIRE(width <= 80);
+                    REQUIRE(width <= used_width);
+                }
+            }
+        }
+
+        WHEN("a word is too long for a line") {
+            std::vector<std::string> lines;
+            int used_width;
+            REQUIRE(layout.wrap("supercalifragilisticexpialidocious", 60, border, lines, used_width));
+
+            THEN("it is cut without losing any of it") {
+                REQUIRE(lines.size() > 1);
+                std::string joined;
+                for (const std::string &line : lines) {
+                    joined += line;
+                }
+                REQUIRE(joined == "supercalifragilisticexpialidocious");
+            }
+        }
+
+        WHEN("a character is too wide for any line") {
+            std::vector<std::string> lines;
+            int used_width;
+
+            THEN("wrapping fails") {
+                REQUIRE_FALSE(layout.wrap("W", border + 1, border, lines, used_width));
+            }
+        }
+
+        WHEN("words have several bytes") {
+            std::vector<std::string> lines;
+            int used_width;
+            REQUIRE(layout.wrap("caf\xc3\xa9 na\xc3\xafve \xe2\x82\xac" "5", 45, border, lines, used_width));
+
+            THEN("they are kept whole") {
+                std::vector<std::string> expected;
+                int expected_width;
+                REQUIRE(reference_wrap("caf\xc3\xa9 na\xc3\xafve \xe2\x82\xac" "5", 45, border, expected, expected_width));
+                REQUIRE(lines == expected);
+                REQUIRE(used_width == expected_width);
+            }
+        }
+
+        WHEN("text ends with spaces") {
+            std::vector<std::string> lines;
+            int used_width;
+            REQUIRE(layout.wrap("one two  ", 200, border, lines, used_width));
+
+            THEN("they stay on the last line") {
+                REQUIRE(lines == std::vector<std::string>({"one two  "}));
+            }
+        }
+
+        THEN("random text wraps exactly as before") {
+            unsigned seed(1);
+            for (int i = 0; i < 500; ++i) {
+                std::string text(random_text(seed, int(seed % 200)));
+                // The old wrapping read past the end of its line when the
+                // text ended with a space
+                while (!text.empty() && text.back() == ' ') {
+                    text.pop_back();
+                }
+                int available_width(border + 13 + int(seed % 300));
+
+                std::vector<std::string> expected;
+                int expected_width;
+                bool expected_fits(reference_wrap(text, available_width, border, expected, expected_width));
+
+                std::vector<std::string> lines;
+                int used_width;
+                bool fits(layout.wrap(text, available_width, border, lines, used_width));
+
+                REQUIRE(fits == expected_fits);
+                if (fits) {
+                    REQUIRE(lines == expected);
+                    REQUIRE(used_width == expected_width);
+                }
+            }
+        }
+    }
+}
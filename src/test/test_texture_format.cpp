@@ -0,0 +1,203 @@
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "catch.hpp"
+#include "texture_format.hpp"
+#include "texture_memory.hpp"
+
+namespace {
+    std::vector<uint8_t> random_pixels(size_t count) {
+        std::mt19937 random(1234);
+        std::uniform_int_distribution<int> byte(0, 255);
+
+        std::vector<uint8_t> pixels(count * 4);
+        for (uint8_t &channel : pixels) {
+            channel = uint8_t(byte(random));
+        }
+        return pixels;
+    }
+
+    ///
+    /// Pack pixels one at a time, a channel at a time
+    ///
+    std::vector<uint8_t> reference_convert(TextureFormat::Format format, const std::vector<uint8_t> &rgba) {
+        std::vector<uint8_t> out;
+        for (size_t i = 0; i < rgba.size(); i += 4) {
+            unsigned r(rgba[i]), g(rgba[i + 1]), b(rgba[i + 2]), a(rgba[i + 3]);
+            uint16_t packed(0);
+            switch (format) {
+            case TextureFormat::Format::RGBA4444:
+                packed = uint16_t((r >> 4) << 12 | (g >> 4) << 8 | (b >> 4) << 4 | (a >> 4));
+                break;
+            case TextureFormat::Format::RGBA5551:
+                packed = uint16_t((r >> 3) << 11 | (g >> 3) << 6 | (b >> 3) << 1 | (a >> 7));
+                break;
+            case TextureFormat::Format::RGB565:
+                packed = uint16_t((r >> 3) << 11 | (g >> 2) << 5 | (b >> 3));
+                break;
+            default:
+                break;
+            }
+            uint8_t bytes[2];
+            std::memcpy(bytes, &packed, 2);
+            out.push_back(bytes[0]);
+            out.push_back(bytes[1]);
+        }
+        return out;
+    }
+
+    std::vector<uint8_t> convert(TextureFormat::Format format, const std::vector<uint8_t> &rgba) {
+        return TextureFormat::convert(format, rgba.data(), rgba.size() / 4);
+    }
+
+    TextureFormat::Format choose(const std::vector<uint8_t> &rgba, bool reduced = true) {
+        return TextureFormat::choose(rgba.data(), rgba.size() / 4, reduced);
+    }
+}
+
+SCENARIO("Texture formats are chosen from how images are coloured", "[texture_format]") {
+
+    GIVEN("an opaque image") {
+        std::vector<uint8_t> rgba({10, 20, 30, 255,  40, 50, 60, 255});
+
+        THEN("it needs no alpha") {
+            REQUIRE(choose(rgba) == TextureFormat::Format::RGB565);
+        }
+
+        THEN("it is kept as is without reduced precision") {
+            REQUIRE(choose(rgba, false) == TextureFormat::Format::RGBA8888);
+        }
+    }
+
+    GIVEN("an image with transparent holes") {
+        std::vector<uint8_t> rgba({10, 20, 30, 255,  40, 50, 60, 0});
+
+        THEN("it needs one bit of alpha") {
+            REQUIRE(choose(rgba) == TextureFormat::Format::RGBA5551);
+        }
+    }
+
+    GIVEN("an image with partial alpha") {
+        std::vector<uint8_t> rgba({10, 20, 30, 255,  40, 50, 60, 128});
+
+        THEN("it needs a channel of alpha") {
+            REQUIRE(choose(rgba) == TextureFormat::Format::RGBA4444);
+        }
+    }
+
+    GIVEN("white text on a coloured, transparent background") {
+        std::vector<uint8_t> rgba({255, 255, 255, 200,  200, 200, 200, 255,  255, 0, 0, 0});
+
+        THEN("it loses nothing as luminance and alpha") {
+            REQUIRE(choose(rgba) == TextureFormat::Format::LUMINANCE_ALPHA);
+            REQUIRE(choose(rgba, false) == TextureFormat::Format::LUMINANCE_ALPHA);
+        }
+    }
+
+    GIVEN("black text") {
+        std::vector<uint8_t> rgba({0, 0, 0, 200,  0, 0, 0, 255,  255, 255, 255, 0});
+
+        THEN("it loses nothing as alpha") {
+            REQUIRE(choose(rgba) == TextureFormat::Format::ALPHA);
+        }
+    }
+}
+
+SCENARIO("Images are converted to smaller formats", "[texture_format]") {
+
+    GIVEN("pixels which aren't a multiple of the vector width") {
+        std::vector<uint8_t> rgba(random_pixels(1003));
+
+        THEN("they pack into 16 bits as they would one by one") {
+            for (auto format : {TextureFormat::Format::RGBA4444,
+                                TextureFormat::Format::RGBA5551,
+                                TextureFormat::Format::RGB565}) {
+                REQUIRE(convert(format, rgba) == reference_convert(format, rgba));
+            }
+        }
+
+        THEN("they keep their bytes as RGBA") {
+            REQUIRE(convert(TextureFormat::Format::RGBA8888, rgba) == rgba);
+        }
+    }
+
+    GIVEN("some pixels") {
+        std::vector<uint8_t> rgba({255, 255, 255, 7,  100, 100, 100, 8});
+
+        THEN("luminance is taken from red") {
+            REQUIRE(convert(TextureFormat::Format::LUMINANCE_ALPHA, rgba) == std::vector<uint8_t>({255, 7, 100, 8}));
+        }
+
+        THEN("alpha is taken alone") {
+            REQUIRE(convert(TextureFormat::Format::ALPHA, rgba) == std::vector<uint8_t>({7, 8}));
+        }
+
+        THEN("16 bit formats keep the top bits") {
+            std::vector<uint8_t> packed(convert(TextureFormat::Format::RGBA4444, {0xab, 0xcd, 0xef, 0x12}));
+            uint16_t pixel;
+            std::memcpy(&pixel, packed.data(), 2);
+            REQUIRE(pixel == 0xace1);
+        }
+    }
+}
+
+SCENARIO("Texture memory is counted", "[texture_format]") {
+
+    GIVEN("some recorded textures") {
+        int64_t bytes(TextureMemory::get_bytes());
+        int64_t rgba_bytes(TextureMemory::get_rgba_bytes());
+
+        TextureMemory::record(9001, "test", 64, 32, TextureFormat::Format::RGBA4444);
+        TextureMemory::record(9002, "test", 16, 16, TextureFormat::Format::ALPHA);
+
+        THEN("their memory is counted as uploaded and as RGBA") {
+            int64_t added(TextureMemory::get_bytes() - bytes);
+            int64_t rgba_added(TextureMemory::get_rgba_bytes() - rgba_bytes);
+            REQUIRE(added == 64 * 32 * 2 + 16 * 16);
+            REQUIRE(rgba_added == (64 * 32 + 16 * 16) * 4);
+        }
+
+        WHEN("one is uploaded again") {
+            TextureMemory::record(9001, "test", 64, 32, TextureFormat::Format::RGBA8888);
+
+            THEN("it replaces the first upload") {
+                int64_t added(TextureMemory::get_bytes() - bytes);
+                REQUIRE(added == 64 * 32 * 4 + 16 * 16);
+            }
+        }
+
+        TextureMemory::forget(9001);
+        TextureMemory::forget(9002);
+
+        THEN("forgotten textures aren't counted") {
+            REQUIRE(TextureMemory::get_bytes() == bytes);
+        }
+    }
+}
+
+SCENARIO("Benchmark converting texture formats", "[.][benchmark][texture_format]") {
+    std::vector<uint8_t> rgba(random_pixels(1024 * 1024));
+
+    for (auto format : {TextureFormat::Format::RGBA4444,
+                        TextureFormat::Format::RGBA5551,
+                        TextureFormat::Format::RGB565}) {
+        auto reference_start(std::chrono::steady_clock::now());
+        std::vector<uint8_t> expected(reference_convert(format, rgba));
+        auto reference_end(std::chrono::steady_clock::now());
+
+        auto start(std::chrono::steady_clock::now());
+        std::vector<uint8_t> converted(convert(format, rgba));
+        auto end(std::chrono::steady_clock::now());
+
+        std::cout << TextureFormat::get_name(format) << " of 1024x1024: "
+                  << std::chrono::duration<double, std::milli>(end - start).count() << " ms, one by one "
+                  << std::chrono::duration<double, std::milli>(reference_end - reference_start).count() << " ms; "
+                  << converted.size() / 1024 << " KiB from " << rgba.size() / 1024 << " KiB" << std::endl;
+
+        REQUIRE(converted == expected);
+    }
+}
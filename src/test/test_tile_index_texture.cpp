@@ -0,0 +1,63 @@
+#include <tuple>
+#include <utility>
+
+#include "catch.hpp"
+#include "tile_index_texture.hpp"
+
+SCENARIO("Tiles encode into a texel per tile", "[tile_index_texture]") {
+
+    GIVEN("the texture coordinates of an atlas cell") {
+        // A 4 by 2 atlas; the cell in the 3rd column and 2nd row
+        std::tuple<float, float, float, float> coords(std::make_tuple(0.5f, 0.75f, 0.5f, 1.0f));
+        GLubyte texel[TileIndexTexture::texel_size];
+
+        glm::vec2 unit_size(TileIndexTexture::encode(texel, coords));
+
+        THEN("the cell's size is returned") {
+            REQUIRE(unit_size.x == Approx(0.25f));
+            REQUIRE(unit_size.y == Approx(0.5f));
+        }
+
+        THEN("the cell's column and row are stored") {
+            REQUIRE(TileIndexTexture::decode(texel) == std::make_pair(2, 1));
+        }
+
+        THEN("the texel isn't blank") {
+            REQUIRE(texel[3] != 0);
+        }
+    }
+
+    GIVEN("a cell beyond the first 256 columns and rows") {
+        float unit(1.0f / 1024.0f);
+        std::tuple<float, float, float, float> coords(std::make_tuple(300.0f * unit, 301.0f * unit, 700.0f * unit, 701.0f * unit));
+        GLubyte texel[TileIndexTexture::texel_size];
+
+        TileIndexTexture::encode(texel, coords);
+
+        THEN("the high bytes are kept") {
+            REQUIRE(TileIndexTexture::decode(texel) == std::make_pair(300, 700));
+        }
+    }
+
+    GIVEN("the first cell of the atlas") {
+        std::tuple<float, float, float, float> coords(std::make_tuple(0.0f, 0.5f, 0.0f, 0.5f));
+        GLubyte texel[TileIndexTexture::texel_size];
+
+        TileIndexTexture::encode(texel, coords);
+
+        THEN("it is distinct from a blank tile") {
+            REQUIRE(TileIndexTexture::decode(texel) == std::make_pair(0, 0));
+        }
+    }
+
+    GIVEN("a blank tile") {
+        GLubyte texel[TileIndexTexture::texel_size];
+
+        TileIndexTexture::encode_blank(texel);
+
+        THEN("it decodes as no cell") {
+            REQUIRE(texel[3] == 0);
+            REQUIRE(TileIndexTexture::decode(texel) == std::make_pair(-1, -1));
+        }
+    }
+}
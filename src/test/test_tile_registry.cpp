@@ -0,0 +1,149 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "binary_cache.hpp"
+#include "catch.hpp"
+#include "fml.hpp"
+#include "tile_registry.hpp"
+
+SCENARIO("Tile names are interned into handles", "[tile_registry]") {
+
+    GIVEN("a registry of tiles") {
+        TileRegistry registry;
+        registry.set_tiles({
+            {"sprites/croc/north/walking/0", "../resources/tiles/croc.png"},
+            {"sprites/croc/north/walking/1", "../resources/tiles/croc.png"},
+            {"sprites/croc/south/walking/0", "../resources/tiles/croc.png"},
+            {"sprites/crocodile/0",          "../resources/tiles/crocodile.png"},
+            {"test/blank",                   "../resources/tiles/test.png"},
+        });
+
+        THEN("names are found in order") {
+            REQUIRE(registry.size() == 5);
+            REQUIRE(registry.find("sprites/croc/north/walking/0") == 0);
+            REQUIRE(registry.find("test/blank") == 4);
+            REQUIRE(registry.get_name(3) == "sprites/crocodile/0");
+        }
+
+        THEN("each name knows its tileset") {
+            REQUIRE(registry.get_tileset_name(1) == "../resources/tiles/croc.png");
+            REQUIRE(registry.get_tileset_name(4) == "../resources/tiles/test.png");
+        }
+
+        THEN("missing names aren't found") {
+            REQUIRE(registry.find("test/missing") == TileRegistry::none);
+            REQUIRE_THROWS_AS(registry.get_handle("test/missing"), std::runtime_error);
+        }
+
+        THEN("directories are ranges of handles") {
+            typedef std::pair<TileRegistry::Handle, TileRegistry::Handle> Range;
+            REQUIRE(registry.find_directory("sprites/croc/north/walking") == Range(0, 2));
+            REQUIRE(registry.find_directory("sprites/croc") == Range(0, 3));
+            REQUIRE(registry.find_directory("sprites") == Range(0, 4));
+
+            auto missing(registry.find_directory("sprites/croc/east"));
+            REQUIRE(missing.first == missing.second);
+        }
+    }
+}
+
+SCENARIO("Tile names round trip through the cache", "[tile_registry]") {
+
+    GIVEN("an FML file of tile names") {
+        BinaryCache::set_directory(".");
+
+        std::string path("test_tile_registry.fml");
+        std::remove(TileRegistry::get_cache_path(path).c_str());
+        std::ofstream(path) << "test/blank: ../resources/tiles/test.png\n"
+                            << "gui/status/running: ../resources/tiles/gui.png\n";
+
+        TileRegistry parsed;
+
+        THEN("it isn't cached at first") {
+            REQUIRE_THROWS_AS(parsed.load_cache(path), TileRegistry::LoadException);
+        }
+
+        WHEN("it is loaded") {
+            parsed.load(path);
+
+            THEN("the names are parsed") {
+                REQUIRE(parsed.size() == 2);
+                REQUIRE(parsed.get_tileset_name(parsed.get_handle("gui/status/running"))
+                        == "../resources/tiles/gui.png");
+            }
+
+            THEN("the cache gives the same handles") {
+                TileRegistry cached;
+                cached.load_cache(path);
+
+                REQUIRE(cached.size() == parsed.size());
+                for (TileRegistry::Handle handle = 0; handle < parsed.size(); ++handle) {
+                    REQUIRE(cached.get_name(handle) == parsed.get_name(handle));
+                    REQUIRE(cached.get_tileset_name(handle) == parsed.get_tileset_name(handle));
+                }
+            }
+
+            AND_WHEN("the file changes") {
+                std::ofstream(path, std::ios::app) << "test/more: ../resources/tiles/test.png\n";
+
+                THEN("the cache is stale") {
+                    TileRegistry cached;
+                    REQUIRE_THROWS_AS(cached.load_cache(path), TileRegistry::LoadException);
+
+                    cached.load(path);
+                    REQUIRE(cached.size() == 3);
+                }
+            }
+        }
+
+        std::remove(path.c_str());
+        std::remove(TileRegistry::get_cache_path(path).c_str());
+    }
+}
+
+SCENARIO("Benchmark loading tile names", "[.][benchmark][tile_registry]") {
+    BinaryCache::set_directory(".");
+
+    std::string path("test_tile_registry_benchmark.fml");
+    {
+        std::ofstream file(path);
+        for (int i = 0; i < 2000; ++i) {
+            file << "sprites/benchmark/" << i / 10 << "/" << i % 10 << ": ../resources/tiles/benchmark.png\n";
+        }
+    }
+
+    const int loads(20);
+
+    auto parse_start(std::chrono::steady_clock::now());
+    for (int i = 0; i < loads; ++i) {
+        std::ifstream input(path);
+        std::map<std::string, std::string> names_to_tilesets;
+        fml::from_stream(input, names_to_tilesets);
+    }
+    auto parse_end(std::chrono::steady_clock::now());
+
+    TileRegistry registry;
+    registry.load(path);
+
+    auto cache_start(std::chrono::steady_clock::now());
+    for (int i = 0; i < loads; ++i) {
+        registry.load_cache(path);
+    }
+    auto cache_end(std::chrono::steady_clock::now());
+
+    std::cout << loads << " loads of " << registry.size() << " tile names: "
+              << std::chrono::duration<double, std::milli>(parse_end - parse_start).count() << " ms parsed, "
+              << std::chrono::duration<double, std::milli>(cache_end - cache_start).count() << " ms cached"
+              << std::endl;
+
+    REQUIRE(registry.size() == 2000);
+    std::remove(path.c_str());
+    std::remove(TileRegistry::get_cache_path(path).c_str());
+}
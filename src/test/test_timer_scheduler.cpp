@@ -0,0 +1,265 @@
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+#include "event_manager.hpp"
+#include "event_queue.hpp"
+#include "game_time.hpp"
+#include "timer_scheduler.hpp"
+
+namespace {
+    GameTime::time_point at(double seconds) {
+        return GameTime::time_point(GameTime::duration(seconds));
+    }
+}
+
+SCENARIO("Tweens are stepped in place until they finish", "[timer_scheduler]") {
+
+    GIVEN("a scheduler with a one second tween") {
+        TimerScheduler scheduler;
+        std::vector<float> completions;
+
+        scheduler.add_tween(1, at(10.0), GameTime::duration(1.0), [&] (float completion) {
+            completions.push_back(completion);
+            return true;
+        });
+
+        THEN("it is stepped straight away") {
+            REQUIRE(completions == std::vector<float>({0.0f}));
+            REQUIRE(scheduler.has_tweens());
+        }
+
+        WHEN("time passes") {
+            scheduler.tick(at(10.5));
+            scheduler.tick(at(12.0));
+            scheduler.tick(at(13.0));
+
+            THEN("it is stepped with its completion, and not after it finishes") {
+                REQUIRE(completions == std::vector<float>({0.0f, 0.5f, 1.0f}));
+                REQUIRE_FALSE(scheduler.has_tweens());
+            }
+        }
+
+        WHEN("it is cancelled") {
+            REQUIRE(scheduler.cancel(1));
+            scheduler.tick(at(10.5));
+
+            THEN("it isn't stepped again") {
+                REQUIRE(completions.size() == 1);
+                REQUIRE_FALSE(scheduler.has_tweens());
+                REQUIRE_FALSE(scheduler.cancel(1));
+            }
+        }
+    }
+
+    GIVEN("tweens which stop early or cancel each other") {
+        TimerScheduler scheduler;
+        int first_steps(0);
+        int second_steps(0);
+
+        scheduler.add_tween(1, at(0.0), GameTime::duration(1.0), [&] (float) {
+            ++first_steps;
+            return first_steps < 2;
+        });
+        scheduler.add_tween(2, at(0.0), GameTime::duration(1.0), [&] (float) {
+            ++second_steps;
+            // Cancelling itself while running
+            if (second_steps == 2) { scheduler.cancel(2); }
+            return true;
+        });
+
+        scheduler.tick(at(0.1));
+        scheduler.tick(at(0.2));
+
+        THEN("they stop") {
+            REQUIRE(first_steps == 2);
+            REQUIRE(second_steps == 2);
+            REQUIRE_FALSE(scheduler.has_tweens());
+        }
+    }
+}
+
+SCENARIO("Timers run once when due", "[timer_scheduler]") {
+
+    GIVEN("timers added out of order") {
+        TimerScheduler scheduler;
+        std::vector<int> order;
+
+        for (int i : {5, 1, 4, 2, 3}) {
+            scheduler.add_timer(TimerScheduler::Handle(i), at(double(i)), [&order, i] () { order.push_back(i); });
+        }
+
+        THEN("the earliest is next") {
+            REQUIRE(scheduler.has_timers());
+            REQUIRE(scheduler.get_next_due() == at(1.0));
+            REQUIRE_FALSE(scheduler.has_tweens());
+        }
+
+        WHEN("some fall due") {
+            int runs(scheduler.tick(at(3.0)));
+
+            THEN("they run earliest first") {
+                REQUIRE(runs == 3);
+                REQUIRE(order == std::vector<int>({1, 2, 3}));
+                REQUIRE(scheduler.get_next_due() == at(4.0));
+            }
+        }
+
+        WHEN("one is cancelled") {
+            REQUIRE(scheduler.cancel(2));
+            scheduler.tick(at(10.0));
+
+            THEN("the rest run in order") {
+                REQUIRE(order == std::vector<int>({1, 3, 4, 5}));
+                REQUIRE_FALSE(scheduler.has_timers());
+            }
+        }
+
+        WHEN("they are cleared") {
+            scheduler.clear();
+            scheduler.tick(at(10.0));
+
+            THEN("none run") {
+                REQUIRE(order.empty());
+            }
+        }
+    }
+}
+
+SCENARIO("The event manager runs timed events in game time", "[timer_scheduler]") {
+
+    GIVEN("an empty event manager") {
+        EventManager &em(EventManager::get_instance());
+        em.flush_and_disable();
+        em.reenable();
+        em.process_events();
+
+        float last_completion(-1.0f);
+        int steps(0);
+
+        WHEN("a long timed event is added") {
+            auto handle(em.add_timed_event(GameTime::duration(1000.0), [&] (float completion) {
+                last_completion = completion;
+                ++steps;
+                return true;
+            }));
+            em.process_events();
+
+            THEN("it starts this frame and keeps the manager busy") {
+                REQUIRE(steps == 1);
+                REQUIRE_FALSE(em.is_idle());
+            }
+
+            AND_WHEN("game time is sped up") {
+                em.time.set_game_seconds_per_real_second(1000000.0);
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                em.process_events();
+                em.time.set_game_seconds_per_real_second(1.0);
+
+                THEN("it finishes without being added again") {
+                    REQUIRE(last_completion == 1.0f);
+                    REQUIRE(steps == 2);
+                    REQUIRE(em.is_idle());
+                }
+            }
+
+            AND_WHEN("it is cancelled") {
+                em.cancel_timer(handle);
+                em.process_events();
+                int cancelled_steps(steps);
+                em.process_events();
+
+                THEN("it isn't stepped again") {
+                    REQUIRE(steps == cancelled_steps);
+                    REQUIRE(em.is_idle());
+                }
+            }
+        }
+
+        WHEN("a timer is added") {
+            bool ran(false);
+            auto handle(em.add_timer(GameTime::duration(60.0), [&] () { ran = true; }));
+            em.process_events();
+
+            THEN("the manager can sleep until it is due") {
+                REQUIRE(em.is_idle());
+                auto wake(em.get_next_timer_wake());
+                bool later(wake > std::chrono::steady_clock::now() + std::chrono::seconds(50));
+                REQUIRE(later);
+            }
+
+            AND_WHEN("it is cancelled") {
+                em.cancel_timer(handle);
+                em.process_events();
+
+                THEN("there is nothing to wake for") {
+                    REQUIRE(em.get_next_timer_wake() == std::chrono::steady_clock::time_point::max());
+                    REQUIRE_FALSE(ran);
+                }
+            }
+        }
+
+        em.flush_and_disable();
+        em.reenable();
+    }
+}
+
+SCENARIO("Benchmark ticking tweens", "[.][benchmark][timer_scheduler]") {
+    const int tweens(2000);
+    const int frames(300);
+
+    // As timed events were, bound again into a new function every frame
+    EventQueue queue;
+    std::function<void (GameTime::duration, std::function<bool (float)>, GameTime::time_point)> callback;
+    GameTime::time_point now(at(0.0));
+    int requeued_steps(0);
+
+    callback = [&] (GameTime::duration duration, std::function<bool (float)> func, GameTime::time_point start) {
+        float completion(float((now - start) / duration));
+        if (func(completion)) {
+            queue.push(std::function<void ()>(std::bind(callback, duration, func, start)));
+        }
+    };
+
+    for (int i = 0; i < tweens; ++i) {
+        queue.push(std::function<void ()>(std::bind(callback, GameTime::duration(1000.0),
+                                                    std::function<bool (float)>([&] (float) { ++requeued_steps; return true; }),
+                                                    now)));
+    }
+
+    auto requeue_start(std::chrono::steady_clock::now());
+    for (int frame = 0; frame < frames; ++frame) {
+        now = at(double(frame));
+        EventQueue::Batch batch(queue.take_all());
+        while (!batch.empty()) {
+            batch.pop()();
+        }
+    }
+    auto requeue_end(std::chrono::steady_clock::now());
+
+    TimerScheduler scheduler;
+    int stepped(0);
+    for (int i = 0; i < tweens; ++i) {
+        scheduler.add_tween(TimerScheduler::Handle(i + 1), at(0.0), GameTime::duration(1000.0),
+                            [&] (float) { ++stepped; return true; });
+    }
+
+    auto tick_start(std::chrono::steady_clock::now());
+    for (int frame = 0; frame < frames; ++frame) {
+        scheduler.tick(at(double(frame)));
+    }
+    auto tick_end(std::chrono::steady_clock::now());
+
+    std::cout << tweens << " tweens for " << frames << " frames: "
+              << std::chrono::duration<double, std::milli>(tick_end - tick_start).count() << " ms in place, "
+              << std::chrono::duration<double, std::milli>(requeue_end - requeue_start).count() << " ms re-queued"
+              << std::endl;
+
+    int expected(tweens * frames);
+    REQUIRE(requeued_steps == expected);
+    REQUIRE(stepped == expected + tweens);
+}
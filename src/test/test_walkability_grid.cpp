@@ -0,0 +1,72 @@
+#include "catch.hpp"
+#include "walkability_grid.hpp"
+
+SCENARIO("The walkability grid combines collisions and blockers", "[walkability_grid]") {
+
+    GIVEN("a 70 by 3 grid") {
+        WalkabilityGrid grid(70, 3);
+
+        THEN("every tile on the grid is walkable") {
+            for (int y = 0; y < 3; ++y) {
+                for (int x = 0; x < 70; ++x) {
+                    REQUIRE(grid.is_walkable(x, y));
+                }
+            }
+        }
+
+        THEN("tiles off the grid are not walkable") {
+            REQUIRE(!grid.is_walkable(-1, 0));
+            REQUIRE(!grid.is_walkable(0, -1));
+            REQUIRE(!grid.is_walkable(70, 0));
+            REQUIRE(!grid.is_walkable(0, 3));
+        }
+
+        WHEN("a tile is on the collision layer") {
+            grid.set_collision(65, 1, true);
+
+            THEN("only that tile is not walkable") {
+                REQUIRE(!grid.is_walkable(65, 1));
+                REQUIRE(grid.get_collision(65, 1));
+                REQUIRE(grid.is_walkable(64, 1));
+                REQUIRE(grid.is_walkable(65, 0));
+            }
+
+            THEN("removing it from the collision layer makes it walkable") {
+                grid.set_collision(65, 1, false);
+                REQUIRE(grid.is_walkable(65, 1));
+            }
+
+            THEN("blockers coming and going leave it unwalkable") {
+                grid.block(65, 1);
+                grid.unblock(65, 1);
+                REQUIRE(!grid.is_walkable(65, 1));
+            }
+        }
+
+        WHEN("a tile is blocked twice") {
+            grid.block(3, 2);
+            grid.block(3, 2);
+
+            THEN("it is not walkable until both blockers are removed") {
+                REQUIRE(grid.get_blocker_count(3, 2) == 2);
+                REQUIRE(!grid.is_walkable(3, 2));
+
+                grid.unblock(3, 2);
+                REQUIRE(!grid.is_walkable(3, 2));
+
+                grid.unblock(3, 2);
+                REQUIRE(grid.is_walkable(3, 2));
+            }
+        }
+
+        WHEN("a tile off the grid is blocked") {
+            grid.block(70, 0);
+
+            THEN("the grid is unchanged") {
+                REQUIRE(grid.get_blocker_count(70, 0) == 0);
+                REQUIRE(grid.is_walkable(69, 0));
+                REQUIRE(grid.is_walkable(0, 1));
+            }
+        }
+    }
+}
@@ -0,0 +1,266 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+#include "catch.hpp"
+#include "event_manager.hpp"
+#include "snapshot_buffer.hpp"
+#include "walkability_grid.hpp"
+#include "world_snapshot.hpp"
+
+namespace {
+    void add_object(WorldSnapshot &snapshot, int id, std::string name, glm::vec2 position,
+                    bool sprite, bool findable, std::vector<glm::vec2> positions = {}) {
+        WorldSnapshot::Object &object(snapshot.add_object(id));
+        object.name         = name;
+        object.position     = position;
+        object.sprite       = sprite;
+        object.findable     = findable;
+        object.instructions = sprite ? "instructions for " + name : "";
+        object.positions    = positions;
+    }
+
+    ///
+    /// Fill a snapshot with a sprite whose x position is the value
+    /// given, to check readers never see a snapshot being filled
+    ///
+    void fill_with(WorldSnapshot &snapshot, int value) {
+        snapshot.set_map(WalkabilityGrid(4, 4));
+        add_object(snapshot, 1, std::to_string(value), glm::vec2(float(value), 0.0f), true, true);
+        add_object(snapshot, 2, std::to_string(value), glm::vec2(float(value), 1.0f), true, true);
+        snapshot.finish();
+    }
+}
+
+SCENARIO("World snapshots answer queries as the engine does", "[world_snapshot]") {
+
+    GIVEN("a snapshot of a map") {
+        WalkabilityGrid grid(10, 10);
+        grid.set_collision(3, 4, true);
+        grid.block(5, 5);
+
+        WorldSnapshot snapshot;
+        snapshot.set_map(grid);
+        add_object(snapshot, 7, "croc",   glm::vec2(2.0f, 4.0f), true,  true,
+                   {glm::vec2(2.0f, 2.0f), glm::vec2(2.0f, 3.0f), glm::vec2(2.0f, 4.0f)});
+        add_object(snapshot, 3, "vine",   glm::vec2(2.0f, 6.0f), false, true);
+        add_object(snapshot, 5, "rock",   glm::vec2(2.0f, 5.0f), false, false);
+        add_object(snapshot, 9, "friend", glm::vec2(4.0f, 4.0f), true,  true);
+        add_object(snapshot, 4, "far",    glm::vec2(9.0f, 9.0f), false, true);
+        snapshot.finish();
+
+        THEN("walkability is copied") {
+            REQUIRE(snapshot.has_map());
+            REQUIRE(snapshot.walkable(glm::ivec2(0, 0)));
+            REQUIRE_FALSE(snapshot.walkable(glm::ivec2(3, 4)));
+            REQUIRE_FALSE(snapshot.walkable(glm::ivec2(5, 5)));
+            REQUIRE_FALSE(snapshot.walkable(glm::ivec2(10, 0)));
+        }
+
+        THEN("objects are found by id") {
+            REQUIRE(snapshot.find_object(3)->name == "vine");
+            REQUIRE(snapshot.find_object(9)->position == glm::vec2(4.0f, 4.0f));
+            REQUIRE(snapshot.find_object(6) == nullptr);
+        }
+
+        THEN("looking finds findable map objects and then sprites in range") {
+            auto found(snapshot.look(*snapshot.find_object(7), 2));
+
+            std::vector<std::tuple<std::string, int, int>> expected({
+                std::make_tuple(std::string("vine"),   2, 6),
+                std::make_tuple(std::string("croc"),   2, 4),
+                std::make_tuple(std::string("friend"), 4, 4)
+            });
+            REQUIRE(found == expected);
+        }
+
+        THEN("retrace steps lead back, most recent first") {
+            auto steps(WorldSnapshot::get_retrace_steps(*snapshot.find_object(7)));
+
+            REQUIRE(steps == std::vector<glm::vec2>({glm::vec2(0.0f, -1.0f), glm::vec2(0.0f, -1.0f)}));
+            REQUIRE(WorldSnapshot::get_retrace_steps(*snapshot.find_object(9)).empty());
+        }
+
+        THEN("sprites keep their instructions") {
+            REQUIRE(snapshot.find_object(9)->instructions == "instructions for friend");
+        }
+
+        WHEN("it is refilled with fewer objects") {
+            snapshot.set_map(grid);
+            add_object(snapshot, 9, "friend", glm::vec2(5.0f, 4.0f), true, true);
+            snapshot.finish();
+
+            THEN("only those are in it") {
+                REQUIRE(snapshot.find_object(7) == nullptr);
+                REQUIRE(snapshot.find_object(3) == nullptr);
+                REQUIRE(snapshot.find_object(9)->position == glm::vec2(5.0f, 4.0f));
+            }
+        }
+
+        WHEN("it is cleared") {
+            snapshot.clear();
+
+            THEN("it is empty") {
+                REQUIRE_FALSE(snapshot.has_map());
+                REQUIRE_FALSE(snapshot.walkable(glm::ivec2(0, 0)));
+                REQUIRE(snapshot.find_object(9) == nullptr);
+            }
+        }
+    }
+}
+
+SCENARIO("Snapshot buffers publish snapshots to readers", "[world_snapshot]") {
+
+    GIVEN("a snapshot buffer") {
+        SnapshotBuffer buffer;
+
+        THEN("it starts with an empty snapshot") {
+            REQUIRE(buffer.get_generation() == 0);
+            REQUIRE_FALSE(buffer.read()->has_map());
+        }
+
+        WHEN("a snapshot is published") {
+            buffer.publish([] (WorldSnapshot &snapshot) { fill_with(snapshot, 1); });
+
+            THEN("it is read") {
+                SnapshotBuffer::Reader snapshot(buffer.read());
+                REQUIRE(snapshot.get_generation() == 1);
+                REQUIRE(snapshot->find_object(1)->name == "1");
+            }
+
+            THEN("readers keep theirs while the next is published") {
+                SnapshotBuffer::Reader snapshot(buffer.read());
+                buffer.publish([] (WorldSnapshot &snapshot) { fill_with(snapshot, 2); });
+
+                REQUIRE(snapshot->find_object(1)->name == "1");
+                REQUIRE(buffer.read()->find_object(1)->name == "2");
+            }
+
+            THEN("waiting for it returns straight away") {
+                REQUIRE(buffer.wait_for(1, std::chrono::milliseconds(0)));
+                REQUIRE_FALSE(buffer.wait_for(2, std::chrono::milliseconds(1)));
+            }
+        }
+
+        WHEN("a later snapshot is waited for") {
+            std::thread publisher([&] () {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                buffer.publish([] (WorldSnapshot &snapshot) { fill_with(snapshot, 1); });
+                buffer.publish([] (WorldSnapshot &snapshot) { fill_with(snapshot, 2); });
+            });
+
+            bool published(buffer.wait_for(2, std::chrono::seconds(5)));
+            publisher.join();
+
+            THEN("the wait ends when it is published") {
+                REQUIRE(published);
+                REQUIRE(buffer.read()->find_object(2)->name == "2");
+            }
+        }
+
+        WHEN("threads read while snapshots are published") {
+            std::atomic<bool> done(false);
+            std::atomic<int> torn(0);
+            std::atomic<long> reads(0);
+
+            std::vector<std::thread> readers;
+            for (int r = 0; r < 4; ++r) {
+                readers.emplace_back([&] () {
+                    while (!done) {
+                        SnapshotBuffer::Reader snapshot(buffer.read());
+                        const WorldSnapshot::Object *first(snapshot->find_object(1));
+                        const WorldSnapshot::Object *second(snapshot->find_object(2));
+
+                        if (first && second) {
+                            if (first->name != second->name || first->position.x != second->position.x
+                                || std::to_string(int(first->position.x)) != first->name) {
+                                ++torn;
+                            }
+                        }
+                        ++reads;
+                    }
+                });
+            }
+
+            // Until the readers have had a good go, however they're
+            // scheduled
+            for (int value = 1; value <= 2000 || reads < 1000; ++value) {
+                buffer.publish([value] (WorldSnapshot &snapshot) { fill_with(snapshot, value); });
+                std::this_thread::yield();
+            }
+            done = true;
+            for (auto &reader : readers) {
+                reader.join();
+            }
+
+            THEN("no reader sees a snapshot being filled") {
+                REQUIRE(torn == 0);
+                REQUIRE(buffer.get_generation() >= 2000);
+            }
+        }
+    }
+}
+
+SCENARIO("Benchmark world queries", "[.][benchmark][world_snapshot]") {
+    const int queries(2000);
+
+    SnapshotBuffer buffer;
+    buffer.publish([] (WorldSnapshot &snapshot) { fill_with(snapshot, 1); });
+
+    // As queries were, answered by the main thread between frames. The
+    // main thread here sleeps until events arrive, as FrameScheduler
+    // does, so this is the best case of not waiting for a frame.
+    EventManager &em(EventManager::get_instance());
+    em.flush_and_disable();
+    em.reenable();
+
+    std::atomic<bool> done(false);
+    std::thread main_thread([&] () {
+        while (!done) {
+            if (em.wait_for_event(std::chrono::steady_clock::now() + std::chrono::milliseconds(1))) {
+                em.process_events();
+            }
+        }
+    });
+
+    int queued_walkable(0);
+    auto queued_start(std::chrono::steady_clock::now());
+    for (int i = 0; i < queries; ++i) {
+        auto promise(std::make_shared<std::promise<bool>>());
+        auto future(promise->get_future());
+        em.add_event([&buffer, promise] () {
+            SnapshotBuffer::Reader snapshot(buffer.read());
+            promise->set_value(snapshot->walkable(glm::ivec2(snapshot->find_object(1)->position)));
+        });
+        queued_walkable += future.get();
+    }
+    auto queued_end(std::chrono::steady_clock::now());
+
+    done = true;
+    main_thread.join();
+
+    int read_walkable(0);
+    auto read_start(std::chrono::steady_clock::now());
+    for (int i = 0; i < queries; ++i) {
+        SnapshotBuffer::Reader snapshot(buffer.read());
+        read_walkable += snapshot->walkable(glm::ivec2(snapshot->find_object(1)->position));
+    }
+    auto read_end(std::chrono::steady_clock::now());
+
+    std::cout << queries << " walkable queries: "
+              << std::chrono::duration<double, std::micro>(queued_end - queued_start).count() / queries
+              << " us each through events, "
+              << std::chrono::duration<double, std::micro>(read_end - read_start).count() / queries
+              << " us each from the snapshot" << std::endl;
+
+    REQUIRE(queued_walkable == queries);
+    REQUIRE(read_walkable == queries);
+}
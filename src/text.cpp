@@ -3,17 +3,15 @@
 // //////////////////////////////////////////////////////////////
 // Possible SDL_ttf bug when rendering certain first characters.
 //      Workaround is to append and prepend a space character to lines.
-//      See render(): border, safe, safe_str.
+//      See render(): border, and GlyphAtlas::rasterize.
 //
 
-// Behaviour modifiers (defines):
-//  TEXT_SAFE_SURFACE
-//      Text can be rendered less directly by defining this. This will
-//      copy the surface into another surface of an explicitly defined
-//      format - which is slow, but is safer use. In theory, disabling
-//      this also works perfectly though, giving a performance boost by
-//      directly reading off the text.
+// Text is laid out from glyphs cached in the context's GlyphAtlas for
+// the font. Plain text is drawn as a quad per glyph by the TextBatch;
+// text with bloom is composed into an image, which is bloomed and drawn
+// on its own.
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <functional>
@@ -22,6 +20,8 @@
 #include <memory>
 #include <sstream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #include <glog/logging.h>
 
@@ -42,12 +42,21 @@ extern "C" {
 #endif
 }
 
+#include "bloom.hpp"
 #include "callback.hpp"
+#include "engine.hpp"
+#include "frame_damage.hpp"
 #include "game_window.hpp"
+#include "gl_state.hpp"
+#include "glyph_atlas.hpp"
 #include "image.hpp"
 #include "shader.hpp"
 #include "text.hpp"
+#include "text_batch.hpp"
 #include "text_font.hpp"
+#include "text_layout.hpp"
+#include "texture_format.hpp"
+#include "texture_memory.hpp"
 
 
 
@@ -111,6 +120,8 @@ Text::Text(GameWindow* window, TextFont font, bool smooth):
     y_ratio(0),
     ratio_size(false),
     ratio_position(true),
+    rendered_width(0),
+    rendered_height(0),
     texture(0),
     vbo(0),
     font(font),
@@ -133,8 +144,8 @@ Text::Text(GameWindow* window, TextFont font, bool smooth):
 
 Text::~Text() {
     resize_callback.unregister_everywhere();
-    glDeleteTextures(1, &texture);
-    glDeleteBuffers(1, &vbo);
+    GLState::delete_texture(texture);
+    GLState::delete_buffer(vbo);
 }
 
 
@@ -184,13 +195,12 @@ void Text::render() {
     }
 
     int available_width = width - glow_radius * 2;
+    TextLayout &layout(TextBatch::get_current().get_layout(font));
     // It took a whole day to discover that there was a bug in
     // SDL_ttf. Starting with certain characters on certain
     // fonts seems to break it. :(
     // As a hack, prepend and (for balance) append a space.
-    int border;
-    TTF_SizeUTF8(font.font, " ", &border, NULL);
-    border *= 2;
+    int border = layout.measure(" ") * 2;
     
     // If they are still zero, don't continue.
     if (available_width <= 0) {
@@ -199,235 +209,38 @@ void Text::render() {
     
     // int available_height = height - glow_radius * 2;
     int line_height = TTF_FontHeight(font.font);
-    int line_number = 0;
-    int lost_lines = 0;
-
-    int used_width = 0;
-
-    int length = (int)text.length();
-    // Entire text.
-    const char* ctext = text.c_str();
-
-    // Line of text.
-    char* line = new char[length+1];
-
-    // Null-terminator separated lines of text.
-    // The worst case is a character per line, so we need to do
-    // 2 * length (character, null, character, null, ...).
-    char* lines = new char[2*length+1];
-    // Pointer to within lines.
-    char* lines_scan = lines;
-
-    // Text indexing.
-    for (int t = 0; t < length; t++) {
-        int line_width = 0;
-        // Word indexing.
-        int w = 0;
-        // Stores (from the beginning) a word in ctext (copy).
-        line[0] = '\0';
-        // Points to the end of the last successfully fitting word in
-        // line.
-        int ll = 0;
-
-        // Line indexing.
-        for (int l = t; l < length; l++) {
-            // Find word end.
-            for (w = l; w < length && (ctext[w] != ' ' && ctext[w] != '\n'); w++) {
-                // As we are dealing with UTF-8, we must make sure to
-                // copy an entire character if it is more than one byte.
-                // The bit formats of UTF-8 characters are:
-                // 0xxxxxxx
-                // 110xxxxx 10xxxxxx
-                // 1110xxxx 10xxxxxx 10xxxxxx
-                // 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
-                // 111110xx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
-                // 1111110x 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx 10xxxxxx
-                //
-                // ... Well, actually it's not THAT simple, because
-                // there are these magical characters which modify other
-                // characters... But it's not worth the effort.
-                if (ctext[l] & 0x80) {
-                    // The number of bits in the first byte set to 1
-                    // before the first zero indicate the total number
-                    // of bytes to use for the UTF-8 character.
-                    for (int bits = ctext[w] << 1; w < length && (bits & 0x80); w++, bits <<= 1);
-                }
-            }
-            // Copy word into line.
-            for (; l < w; l++) {
-                line[l - t] = ctext[l];
-            }
-            line[l - t] = '\0';
-            // Test line length.
-            TTF_SizeUTF8(font.font, line, &line_width, NULL);
-            // Part of SDL_ttf bug workaround.
-            line_width+=border;
-            if (line_width <= available_width) {
-                if (line_width > used_width) {
-                    used_width = line_width;
-                }
-                // Mark current position as valid.
-                ll = l - t;
-                // If this is the end of a line, or whole text, stop.
-                if (ctext[w] == '\n' || ctext[w] == '\0') {
-                    t = l;
-                    // Note the string is already null terminated.
-                    break;
-                }
-                else {
-                    // Replace null terminator with word separator.
-                    line[ll] = ctext[w];
-                }
-            }
-            else {
-                if (ll > 0) {
-                    // There are some fittable words.
-                    // As the line overflows with the current l, set the
-                    // text index to the last fit.
-                    t += ll;
-                }
-                else {
-                    // There are no separators to break on.
-                    // We're going to have to cut a word in half.
-
-                    // Swapped-out character
-                    char c;
-                    int left = 0;
-                    int right = l - t;
-                    // Search index within line.
-                    int ls;
-                    ll = 0;
-                    for (ls = (right + left) / 2; ls != ll; ls = (right + left) / 2) {
-                        ll = ls;
-                        c = line[ls];
-                        line[ls] = 0;
-                        TTF_SizeUTF8(font.font, line, &line_width, NULL);
-                        // Part of SDL_ttf bug workaround.
-                        line_width+=border;
-                        if (line_width <= available_width) {
-                            if (line_width > used_width) {
-                                used_width = line_width;
-                            }
-                            left = ls;
-                        }
-                        else {
-                            right = ls;
-                        }
-                        line[ls] = c;
-                    }
-                    // Don't skip the non-separating character.
-                    t += ll - 1;
-                }
-                // Null terminate for rendering.
-                line[ll] = '\0';
-                break;
-            }
-        }
 
-        // Copy the line into lines (using lines_scan).
-        int i;
-        for (i = 0; line[i] != '\0'; ++i) {
-            lines_scan[i] = line[i];
-        }
-        lines_scan[i] = '\0';
-        lines_scan = &lines_scan[i+1];
-
-        ++line_number;
-        if (line[0] == '\0') {
-            // Check that we aren't going to chase our tailes trying to fit an unfittable character.
-            if (ctext[w] != '\n') {
-                LOG(WARNING) << "Cannot render text: character too large.";
-                delete[] line;
-                delete[] lines;
-                throw Text::RenderException("A character is too large");
-            }
-            else {
-                // It's a blank line.
-                continue;
-            }
-        }
+    // Break the text into lines, measuring with the font's metrics.
+    std::vector<std::string> line_texts;
+    int used_width;
+    if (!layout.wrap(text, available_width, border, line_texts, used_width)) {
+        LOG(WARNING) << "Cannot render text: character too large.";
+        throw Text::RenderException("A character is too large");
     }
-    int line_count = line_number;
+    int line_count = int(line_texts.size());
 
     int used_height = line_count * line_height + 2 * glow_radius;
     
     used_width += glow_radius * 2 + border;
 
-    image = Image(used_width, (used_height < height) ? used_height : height, true);
-    uint8_t clear_colour[4] = {rgba[0], rgba[1], rgba[2], 0x00};
-    uint8_t clear_mask[4] = {0xff, 0xff, 0xff, 0xff};
-    image.clear(clear_colour, clear_mask);
-    // image.clear(0xffffff00, 0xffffffff);
-
-    // Render all lines of text.
-    SDL_Color blank;
-    blank.r = blank.g = blank.b = blank.a = 0;
-    SDL_Color colour;
-    colour.r = rgba[0];
-    colour.g = rgba[1];
-    colour.b = rgba[2];
-    colour.a = rgba[3];
-    lines_scan = lines;
+    int rendered_height = (used_height < height) ? used_height : height;
+
+    // Place the glyphs of every line, clipped to the rendered area.
+    GlyphAtlas &atlas(TextBatch::get_current().get_atlas(font, smooth));
+    placed_glyphs.clear();
+
     for (int line_number = 0; line_number < line_count; ++line_number) {
-        // Render line
-        VLOG(2) << "Rendering line of text: \"" << lines_scan << "\".";
-        if (lines_scan[0] == '\0') {
+        const std::string &line_text(line_texts[size_t(line_number)]);
+        VLOG(2) << "Laying out line of text: \"" << line_text << "\".";
+        if (line_text.empty()) {
             // Skip it - it's a new line.
-            lines_scan = &lines_scan[1];
             continue;
         }
 
-        SDL_Surface* rendered_line;
-        {
-            // It took a whole day to discover that there was a bug in
-            // SDL_ttf. Starting with certain characters on certain
-            // fonts seems to break it. :(
-            // As a hack, prepend and (for balance) append a space.
-            std::stringstream safe;
-            safe << " " << lines_scan << " ";
-            std::string safe_str(safe.str());
-            if (smooth) {
-                rendered_line = TTF_RenderUTF8_Shaded(font.font, safe_str.c_str(), colour, blank);
-            }
-            else {
-                rendered_line = TTF_RenderUTF8_Solid(font.font, safe_str.c_str(), colour);
-            }
-        }
-
-        if (rendered_line == nullptr) {
-            LOG(WARNING) << "Cannot render line of text: \"" << lines_scan << "\".";
-            delete[] line;
-            delete[] lines;
-            throw Text::RenderException("Cannot render line of text");
-        }
+        // The width of the line with a space either side, as SDL_ttf
+        // would have rendered it.
+        int line_width = layout.measure(" " + line_text + " ");
 
-#ifdef TEXT_SAFE_SURFACE
-        // This surface has a known format.
-        SDL_Surface* compatible = SDL_CreateRGBSurface(0, // Unsed
-                                                       rendered_line->w,
-                                                       rendered_line->h,
-                                                       32,
-                                                       0x00,
-                                                       0x00,
-                                                       0x00,
-                                                       0xff
-                                                       );
-        SDL_FillRect(compatible, NULL, 0);
-        SDL_SetSurfaceBlendMode(rendered_line, SDL_BLENDMODE_NONE);
-        SDL_BlitSurface(rendered_line, NULL, compatible, NULL);
-        SDL_LockSurface(compatible);
-        // pitch is in bytes, not pixels. RGBA = 4 bytes.
-        int jump = compatible->pitch / 4;
-#else
-        SDL_LockSurface(rendered_line);
-        int jump = rendered_line->pitch;
-#endif
-        // "What is this pointless copy?" you might ask.
-        //   Well, it is a suggestion to the c++ compiler that smooth
-        //   will not change throughout this function, so it can
-        //   optimise the if containing _smooth out of the for loop
-        //   entirely, rather than checking it every single iteration.
-        int _smooth = smooth;
         int x_offset;
         int y_offset;
         switch (alignment_h) {
@@ -436,10 +249,10 @@ void Text::render() {
             x_offset = glow_radius;
             break;
         case Alignment::CENTRE:
-            x_offset = (used_width - rendered_line->w) / 2;
+            x_offset = (used_width - line_width) / 2;
             break;
         case Alignment::RIGHT:
-            x_offset = used_width - rendered_line->w - glow_radius;
+            x_offset = used_width - line_width - glow_radius;
             break;
         }
         switch (alignment_v) {
@@ -448,210 +261,119 @@ void Text::render() {
             y_offset = line_number * line_height;
             break;
         case Alignment::CENTRE:
-            y_offset = line_number * line_height - (used_height - image.height) / 2;
+            y_offset = line_number * line_height - (used_height - rendered_height) / 2;
             break;
         case Alignment::BOTTOM:
-            y_offset = line_number * line_height - (used_height - image.height);
+            y_offset = line_number * line_height - (used_height - rendered_height);
             break;
         }
         y_offset += glow_radius;
-        // x surface
-        int xs;
-        // y surface
-        int ys;
-        for (ys = 0; ys < rendered_line->h; ++ys) {
-            int yi = ys + y_offset;
-            if (yi >= image.height) {
-                lost_lines++;
-                break;
-            }
-            else if (yi < 0) {
+
+        int pen = x_offset + border / 2;
+        for (size_t i = 0; i < line_text.size();) {
+            const GlyphAtlas::Glyph &glyph(atlas.get_glyph(GlyphAtlas::next_code_point(line_text, i)));
+            int glyph_x = pen + glyph.offset_x;
+            pen += glyph.advance;
+
+            int left   = std::max(glyph_x, 0);
+            int top    = std::max(y_offset, 0);
+            int right  = std::min(glyph_x + glyph.width, used_width);
+            int bottom = std::min(y_offset + glyph.height, rendered_height);
+            if (right <= left || bottom <= top) {
                 continue;
             }
-            int begin_xs((x_offset >= 0) ? 0 : -x_offset);
-            int end_xs((rendered_line->w < image.width - x_offset) ? rendered_line->w : image.width - x_offset);
-            for (xs = begin_xs; xs < end_xs; ++xs) {
-#ifdef TEXT_SAFE_SURFACE
-                image.flipped_pixels[yi][xs + x_offset].a = (((Uint32*)compatible->pixels)[(ys*jump + xs)]);
-#else
-                if (_smooth) {
-                    image.flipped_pixels[yi][xs + x_offset].a = (((Uint8*)rendered_line->pixels)[(ys*jump + xs)]);
-                }
-                else {
-                    image.flipped_pixels[yi][xs + x_offset].a = (((Uint8*)rendered_line->pixels)[(ys*jump + xs)]) ? 255 : 0;
-                }
-#endif
-            }
+
+            PlacedGlyph placed;
+            placed.x      = left;
+            placed.y      = top;
+            placed.width  = right - left;
+            placed.height = bottom - top;
+            placed.u      = glyph.x + (left - glyph_x);
+            placed.v      = glyph.y + (top  - y_offset);
+            placed_glyphs.push_back(placed);
         }
-#ifdef TEXT_SAFE_SURFACE
-        SDL_UnlockSurface(compatible);
-        SDL_FreeSurface(compatible);
-#else
-        SDL_UnlockSurface(rendered_line);
-#endif
-        SDL_FreeSurface(rendered_line);
-        if (ys < line_height) {
+
+        if (y_offset + line_height > rendered_height) {
             LOG(WARNING) << "Text overflow.";
             break;
         }
-
-        // Set lines_scan to start next line
-        while (lines_scan[0] != '\0') {
-            lines_scan = &lines_scan[1];
-        }
-        lines_scan = &lines_scan[1];
     }
 
     this->used_width  = used_width;
     this->used_height = used_height;
-    delete[] line;
-    delete[] lines;
+    this->rendered_width  = used_width;
+    this->rendered_height = rendered_height;
+
+    // Bloom spreads over the whole text, so blooming text is drawn from
+    // its own image rather than as separate glyphs.
     if (glow_radius > 0) {
-        apply_newson_bloom();
+        TextBatch &text_batch(TextBatch::get_current());
+        std::string bloom_key(get_bloom_key(atlas));
+
+        const Image *bloomed(text_batch.find_bloom(bloom_key));
+        if (bloomed != nullptr) {
+            image = *bloomed;
+        }
+        else {
+            compose_image(atlas);
+            apply_newson_bloom();
+            text_batch.add_bloom(bloom_key, image);
+        }
+        generate_texture();
     }
-    generate_texture();
     dirty_texture = false;
     dirty_vbo = true;
 }
 
 
-// My own spicy algorithm for creating a cheap bloom effect.
-//
-// Perform a vertical scan, to create a list of vertical distances from
-// seed points.
-// Perform a horizontal scan and calculate a winning radiance from the
-// distances in the vertical scan.
-//
-// We perform vertical scan and then horizontal to enable better
-// optimisation.
-void Text::apply_newson_bloom() {
-    // Stores distance information from the first pass.
-    int* vertical_scan(new int[image.width*image.height]);
-    int width = image.width;
-    int height = image.height;
-    int grpo = glow_radius + 1;
-
-    // Vertical Scan.
-    int i = 0;
-    for (int x = 0; x < width; ++x) {
-        int seed_y = 0;
-        for (; seed_y < height && image[seed_y][x].a == 0; ++seed_y);
-        if (seed_y == height) {
-            // It's a blank line, so move on.
-            for (int y = 0; y < height; ++y) {
-                vertical_scan[i] = 0;
-                i += width;
-            }
-        } else {
-            int seed_y_prev = -1;
-            for (int y = 0; y < height; ++y) {
-                if (y == seed_y) {
-                    // Find the next seed (or go outside of image).
-                    for (++seed_y; seed_y < height && image[seed_y][x].a == 0; ++seed_y);
-                    seed_y_prev = y;
-                }
-            
-                int r(0);
-                if (seed_y_prev != -1) {
-                    // Calculate radius from distance from last seed.
-                    r = glow_radius - (y - seed_y_prev);
-                }
-                if (seed_y != height) {
-                    // Calculate radius from distance from next seed.
-                    int r2(glow_radius - (seed_y - y));
-                    if (r2 > r) {
-                        r = r2;
-                    }
-                }
-                if (r > 0) {
-                    vertical_scan[i] = r;
-                }
-                else {
-                    // If it's too far away, set radiance to 0.
-                    vertical_scan[i] = 0;
-                }
-                i += width;
+void Text::compose_image(GlyphAtlas &atlas) {
+    image = Image(rendered_width, rendered_height, true);
+    uint8_t clear_colour[4] = {rgba[0], rgba[1], rgba[2], 0x00};
+    uint8_t clear_mask[4] = {0xff, 0xff, 0xff, 0xff};
+    image.clear(clear_colour, clear_mask);
+
+    // Glyphs can overlap their neighbours, so keep the greater coverage.
+    for (const PlacedGlyph &placed : placed_glyphs) {
+        for (int y = 0; y < placed.height; ++y) {
+            for (int x = 0; x < placed.width; ++x) {
+                uint8_t &alpha(image.flipped_pixels[placed.y + y][placed.x + x].a);
+                alpha = std::max(alpha, uint8_t(atlas.get_coverage(placed.u + x, placed.v + y)));
             }
         }
-        i += 1 - (width * height);
     }
+}
 
-    // Pre-compute pythagoras's theorem and 0-255 scale strength.
-    int* pythag(new int[(grpo)*(grpo)]);
-    for (int y = 0; y <= glow_radius; ++y) {
-        int ry = glow_radius - y;
-        for (int x = 0; x <= glow_radius; ++x) {
-            int rx = x;
-            int score(int((float(glow_radius) - sqrt(float(rx*rx + ry*ry))) * 255.0f / float(glow_radius)));
-            pythag[x+y*grpo] = (score > 0) ? score*score/255 : 0;
-        }
-    }
+// Bloom finds each transparent pixel's distance to the text with a
+// separable distance transform, so it takes the same time per pixel
+// whatever the radius.
+void Text::apply_newson_bloom() {
+    Bloom bloom(glow_radius, rgba, glow_rgba);
+    bloom.apply(reinterpret_cast<uint8_t *>(image.pixels), image.width, image.height, image.store_width);
+}
 
-    // Pre-compute merge colours.
-    uint8_t merge_rgba[4][256];
-    for (int a = 0; a < 256; ++a) {
-        merge_rgba[0][a] = uint8_t(((255-a) * glow_rgba[0] + a * rgba[0]) / 255);
-        merge_rgba[1][a] = uint8_t(((255-a) * glow_rgba[1] + a * rgba[1]) / 255);
-        merge_rgba[2][a] = uint8_t(((255-a) * glow_rgba[2] + a * rgba[2]) / 255);
-        merge_rgba[3][a] = uint8_t(((255-a) * glow_rgba[3] + a * rgba[3]) / 255);
-    }
 
-    // Pre-compute radiance alpha.
-    uint8_t radiance[256];
-    for (int r = 0; r < 256; ++r) {
-        radiance[r] = uint8_t(int(glow_rgba[3]) * r / 255);
-    }
-    // uint8_t* radiance(new uint8_t[glow_radius+1]);
-    // for (int r = 0; r <= glow_radius; ++r) {
-    //     radiance[r] = uint8_t(int(glow_rgba[3]) * r / glow_radius);
-    // }
-
-    // Horizontal Scan.
-    i = 0;
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            int winner = pythag[vertical_scan[i]*grpo];
-
-            // Don't go over solid text.
-            if (image[y][x].a == 0) {
-                for (int dx = 1; dx < glow_radius; ++dx) {
-                    int candidate(0);
-                    if (x - dx >= 0) {
-                        candidate = pythag[dx+vertical_scan[i - dx]*grpo];
-                    }
-                    if (x + dx < width) {
-                        int candidate2(pythag[dx+vertical_scan[i + dx]*grpo]);
-                        if (candidate2 > candidate) {
-                            candidate = candidate2;
-                        }
-                    }
-                    if (candidate > winner) {
-                        winner = candidate;
-                    }
-                }
-                image[y][x].r = glow_rgba[0];
-                image[y][x].g = glow_rgba[1];
-                image[y][x].b = glow_rgba[2];
-                image[y][x].a = radiance[winner];
-            }
-            else {
-                    image[y][x].r = merge_rgba[0][image[y][x].a];
-                    image[y][x].g = merge_rgba[1][image[y][x].a];
-                    image[y][x].b = merge_rgba[2][image[y][x].a];
-                    image[y][x].a = merge_rgba[3][image[y][x].a];
-            }
-            ++i;
-        }
-    }
+std::string Text::get_bloom_key(const GlyphAtlas &atlas) const {
+    std::string key;
+    auto append([&key] (const void *data, size_t size) {
+        key.append(static_cast<const char *>(data), size);
+    });
+
+    const GlyphAtlas *atlas_pointer(&atlas);
+    append(&atlas_pointer, sizeof(atlas_pointer));
+    append(rgba, sizeof(rgba));
+    append(glow_rgba, sizeof(glow_rgba));
+    append(&glow_radius, sizeof(glow_radius));
+    append(&rendered_width, sizeof(rendered_width));
+    append(&rendered_height, sizeof(rendered_height));
+    append(placed_glyphs.data(), placed_glyphs.size() * sizeof(PlacedGlyph));
 
-    delete[] vertical_scan;
-    delete[] pythag;
+    return key;
 }
 
 
 void Text::generate_texture() {
     if (texture != 0) {
-        glDeleteTextures(1, &texture);
+        GLState::delete_texture(texture);
     }
 
     glGenTextures(1, &texture);
@@ -661,15 +383,20 @@ void Text::generate_texture() {
         throw Text::RenderException("Unable to generate GL texture");
     }
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    // For some STUPID reason, GL ES seems to be forcing me to waster
-    // RGB channels for padding, on a system with little memory.
-    // Look into this later.
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.store_width, image.store_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+    GLState &gl_state(GLState::get_current());
+    gl_state.active_texture(GL_TEXTURE0);
+    gl_state.bind_texture_2d(texture);
+    // Grey text and glow need no more than luminance and alpha, and
+    // black no more than alpha
+    const uint8_t *pixels(reinterpret_cast<const uint8_t *>(image.pixels));
+    TextureFormat::Format format(TextureFormat::choose(pixels, size_t(image.store_width) * size_t(image.store_height),
+                                                       Engine::get_reduced_texture_precision()));
+    TextureFormat::upload(format, image.store_width, image.store_height, pixels);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    gl_state.count_calls(2);
+
+    TextureMemory::record(texture, "text", image.store_width, image.store_height, format);
 }
 
 
@@ -677,6 +404,11 @@ void Text::generate_vbo() {
     if (dirty_texture) {
         return;
     }
+    if (glow_radius == 0) {
+        generate_glyph_quads();
+        dirty_vbo = false;
+        return;
+    }
     if (vbo == 0) {
         // Create VBO.
         glGenBuffers(1, &vbo);
@@ -704,7 +436,8 @@ void Text::generate_vbo() {
     // float tw = 1.0f;
     // float th = 1.0f;
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    GLState &gl_state(GLState::get_current());
+    gl_state.bind_array_buffer(vbo);
     // There are 4 vertices in a rectangle, but we use 6 vertices in 2
     // triangles to make the rectangle.
     // Each vertex has 2 floats for position, and 2 floats for texture
@@ -727,16 +460,37 @@ void Text::generate_vbo() {
         rx + rw, ry - rh, tw  , th  ,
     };
 
+    gl_state.count_calls();
     glBufferData(GL_ARRAY_BUFFER, sizeof(vbo_data), vbo_data, GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     dirty_vbo = false;
 }
 
 
+void Text::generate_glyph_quads() {
+    // Glyphs are placed from the top left, downwards
+    std::pair<int, int> top_left = get_top_left();
+
+    glyph_quads.resize(placed_glyphs.size());
+    for (size_t i = 0; i < placed_glyphs.size(); ++i) {
+        const PlacedGlyph &placed(placed_glyphs[i]);
+        glyph_quads[i].set(top_left.first + placed.x,
+                           top_left.second - placed.y,
+                           placed.width,
+                           placed.height,
+                           placed.u,
+                           placed.v,
+                           rgba);
+    }
+}
+
+
 void Text::set_text(std::string text) {
-    this->text = text;
-    dirty_texture = true;
+    if (text != this->text) {
+        this->text = text;
+        dirty_texture = true;
+        FrameDamage::mark_dirty();
+    }
 }
 
 
@@ -746,7 +500,7 @@ std::pair<int,int> Text::get_rendered_size() {
         render();
     }
 
-    return std::make_pair(image.width, image.height);
+    return std::make_pair(rendered_width, rendered_height);
 }
 
 std::pair<float,float> Text::get_rendered_size_ratio() {
@@ -798,10 +552,10 @@ std::pair<int,int> Text::get_top_left() {
             x_final = x;
             break;
         case Alignment::CENTRE:
-            x_final = x - (image.width / 2);
+            x_final = x - (rendered_width / 2);
             break;
         case Alignment::RIGHT:
-            x_final = x - image.width;
+            x_final = x - rendered_width;
             break;
         }
     } else {
@@ -816,10 +570,10 @@ std::pair<int,int> Text::get_top_left() {
             y_final = y;
             break;
         case Alignment::CENTRE:
-            y_final = y + (image.height / 2);
+            y_final = y + (rendered_height / 2);
             break;
         case Alignment::BOTTOM:
-            y_final = y + image.height;
+            y_final = y + rendered_height;
             break;
         }
     } else {
@@ -838,6 +592,7 @@ void Text::align_left() {
     if (alignment_h != Alignment::LEFT) {
         alignment_h = Alignment::LEFT;
         dirty_texture = true;
+        FrameDamage::mark_dirty();
     }
 }
 
@@ -845,6 +600,7 @@ void Text::align_centre() {
     if (alignment_h != Alignment::CENTRE) {
         alignment_h = Alignment::CENTRE;
         dirty_texture = true;
+        FrameDamage::mark_dirty();
     }
 }
 
@@ -852,6 +608,7 @@ void Text::align_right() {
     if (alignment_h != Alignment::RIGHT) {
         alignment_h = Alignment::RIGHT;
         dirty_texture = true;
+        FrameDamage::mark_dirty();
     }
 }
 
@@ -859,6 +616,7 @@ void Text::vertical_align_top() {
     if (alignment_v != Alignment::TOP) {
         alignment_v = Alignment::TOP;
         dirty_texture = true;
+        FrameDamage::mark_dirty();
     }
 }
 
@@ -866,6 +624,7 @@ void Text::vertical_align_centre() {
     if (alignment_v != Alignment::CENTRE) {
         alignment_v = Alignment::CENTRE;
         dirty_texture = true;
+        FrameDamage::mark_dirty();
     }
 }
 
@@ -873,6 +632,7 @@ void Text::vertical_align_bottom() {
     if (alignment_v != Alignment::BOTTOM) {
         alignment_v = Alignment::BOTTOM;
         dirty_texture = true;
+        FrameDamage::mark_dirty();
     }
 }
 
@@ -881,6 +641,7 @@ void Text::align_at_origin(bool aao) {
     if (aao != position_from_alignment) {
         position_from_alignment = aao;
         dirty_vbo = true;
+        FrameDamage::mark_dirty();
     }
 }
 
@@ -890,13 +651,23 @@ void Text::set_colour(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
     rgba[1] = g;
     rgba[2] = b;
     rgba[3] = a;
-    dirty_texture = true;
+
+    // Glyphs take their colour from their vertices, but bloom is baked
+    // into the image.
+    if (glow_radius > 0) {
+        dirty_texture = true;
+    }
+    else {
+        dirty_vbo = true;
+    }
+    FrameDamage::mark_dirty();
 }
 
 
 void Text::set_bloom_radius(int radius) {
-    glow_radius = (radius >= 0) ? radius : 0;
+    glow_radius = std::max(0, std::min(radius, Bloom::max_radius));
     dirty_texture = true;
+    FrameDamage::mark_dirty();
 }
 
 
@@ -906,6 +677,7 @@ void Text::set_bloom_colour(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
     glow_rgba[2] = b;
     glow_rgba[3] = a;
     dirty_texture = true;
+    FrameDamage::mark_dirty();
 }
 
 
@@ -923,6 +695,7 @@ void Text::resize(int w, int h) {
         height = h;
         dirty_texture = true;
         dirty_vbo = true;
+        FrameDamage::mark_dirty();
     }
 }
 
@@ -946,6 +719,7 @@ void Text::resize_ratio(float w, float h) {
         height = ih;
         dirty_texture = true;
         dirty_vbo = true;
+        FrameDamage::mark_dirty();
     }
 }
 
@@ -955,6 +729,7 @@ void Text::move(int x, int y) {
 
     if (this->x != x || this->y != y) {
         dirty_vbo = true;
+        FrameDamage::mark_dirty();
     }
     this->x = x;
     this->y = y;
@@ -973,6 +748,7 @@ void Text::move_ratio(float x, float y) {
         this->x = ix;
         this->y = iy;
         dirty_vbo = true;
+        FrameDamage::mark_dirty();
     }
 }
 
@@ -986,6 +762,10 @@ void Text::display() {
             LOG(WARNING) << e.what();
             return;
         }
+        catch (GlyphAtlas::RenderException e) {
+            LOG(WARNING) << e.what();
+            return;
+        }
     }
     if (dirty_vbo) {
         try {
@@ -997,6 +777,15 @@ void Text::display() {
         }
     }
 
+    if (glow_radius == 0) {
+        // Drawn with the rest of the text when the batch is flushed.
+        if (!glyph_quads.empty()) {
+            TextBatch &text_batch(TextBatch::get_current());
+            text_batch.add(text_batch.get_atlas(font, smooth), glyph_quads);
+        }
+        return;
+    }
+
     if (shaders.count(window) == 0) {
         load_program(window);
     }
@@ -1006,26 +795,26 @@ void Text::display() {
     }
 
     std::shared_ptr<Shader> shader = shaders.find(window)->second;
-    glUseProgram(shader->get_program());
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glDisable(GL_DEPTH_TEST);
+    GLState &gl_state(GLState::get_current());
+    gl_state.use_program(shader->get_program());
+    gl_state.active_texture(GL_TEXTURE0);
+    gl_state.bind_texture_2d(texture);
+    gl_state.bind_array_buffer(vbo);
+    gl_state.disable(GL_DEPTH_TEST);
 
     // Position data.
+    gl_state.count_calls(2);
     glVertexAttribPointer(SHADER_LOCATION_POSITION, 2, GL_FLOAT, GL_FALSE, 4 * (GLsizei)sizeof(GLfloat), (GLvoid*)(0 * sizeof(GLfloat)));
     // Texture data.
     glVertexAttribPointer(SHADER_LOCATION_TEXTURE, 2, GL_FLOAT, GL_FALSE, 4 * (GLsizei)sizeof(GLfloat), (GLvoid*)(2 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(SHADER_LOCATION_POSITION);
-    glEnableVertexAttribArray(SHADER_LOCATION_TEXTURE);
+    gl_state.enable_vertex_attrib_array(SHADER_LOCATION_POSITION);
+    gl_state.enable_vertex_attrib_array(SHADER_LOCATION_TEXTURE);
 
-    glEnable(GL_BLEND);
+    gl_state.enable(GL_BLEND);
+    gl_state.count_calls();
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    gl_state.draw_arrays(GL_TRIANGLES, 0, 6);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glUseProgram(0);
-    glEnable(GL_DEPTH_TEST);
+    gl_state.enable(GL_DEPTH_TEST);
 }
@@ -19,12 +19,15 @@ extern "C" {
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "text_font.hpp"
+#include "text_batch.hpp"
 #include "image.hpp"
 #include "callback.hpp"
 
 class GameWindow;
+class GlyphAtlas;
 
 
 
@@ -132,7 +135,41 @@ private:
     ///
     bool ratio_position;
     ///
-    /// Image used to store the rendered text
+    /// A glyph placed in the text area.
+    ///
+    struct PlacedGlyph {
+        ///
+        /// The glyph's rectangle, in pixels from the top left of the
+        /// rendered area, clipped to it.
+        ///
+        int x;
+        int y;
+        int width;
+        int height;
+        ///
+        /// The top left of the rectangle in the glyph atlas.
+        ///
+        int u;
+        int v;
+    };
+    ///
+    /// The glyphs of the text, as laid out by render.
+    ///
+    std::vector<PlacedGlyph> placed_glyphs;
+    ///
+    /// The quads drawing the glyphs, when there is no bloom.
+    ///
+    std::vector<TextBatch::GlyphQuad> glyph_quads;
+    ///
+    /// The width of the rendered area.
+    ///
+    int rendered_width;
+    ///
+    /// The height of the rendered area.
+    ///
+    int rendered_height;
+    ///
+    /// Image used to store the rendered text, when it has bloom
     ///
     Image image;
     ///
@@ -170,22 +207,43 @@ private:
     ///
     /// Re-render the text.
     ///
+    /// This lays out the text's glyphs, and renders it to an image when
+    /// it has bloom.
+    ///
     void render();
 
+    ///
+    /// Draw the placed glyphs into the image.
+    ///
+    void compose_image(GlyphAtlas &atlas);
+
     ///
     /// Applies a bloom effect to text.
     ///
     void apply_newson_bloom();
 
+    ///
+    /// Get everything the bloomed image depends on, for finding it in
+    /// the TextBatch's cache: the atlas, the colours, the radius and
+    /// where the glyphs of the text are placed.
+    ///
+    std::string get_bloom_key(const GlyphAtlas &atlas) const;
+
     ///
     /// Create an OpenGL texture from the image.
     ///
     void generate_texture();
 
     ///
-    /// Creates text-specific vertex buffer object.
+    /// Creates text-specific vertex buffer object, or the glyph quads
+    /// when there is no bloom.
     ///
     void generate_vbo();
+
+    ///
+    /// Creates the quads of the placed glyphs, at the text's position.
+    ///
+    void generate_glyph_quads();
 public:
     ///
     /// Represents a failure when rendering or drawing.
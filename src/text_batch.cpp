@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#define GLM_FORCE_RADIANS
+#include <glm/vec2.hpp>
+
+extern "C" {
+#if defined(USE_GL)
+#define GL_GLEXT_PROTOTYPES
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+}
+
+#include "game_window.hpp"
+#include "gl_state.hpp"
+#include "glyph_atlas.hpp"
+#include "graphics_context.hpp"
+#include "image.hpp"
+#include "quad_index_buffer.hpp"
+#include "shader.hpp"
+#include "text_batch.hpp"
+#include "text_font.hpp"
+#include "text_layout.hpp"
+
+#define SHADER_LOCATION_POSITION 0
+#define SHADER_LOCATION_TEXTURE  1
+#define SHADER_LOCATION_COLOUR   2
+
+const size_t TextBatch::max_bloom_bytes;
+
+
+void TextBatch::GlyphQuad::set(int left, int top, int width, int height, int u, int v, const uint8_t rgba[4]) {
+    GLshort x1 = GLshort(left);
+    GLshort x2 = GLshort(left + width);
+    GLshort y1 = GLshort(top - height);
+    GLshort y2 = GLshort(top);
+    GLushort u1 = GLushort(u);
+    GLushort u2 = GLushort(u + width);
+    GLushort v1 = GLushort(v + height);
+    GLushort v2 = GLushort(v);
+
+    vertices[0].x = x1; vertices[0].y = y1; vertices[0].u = u1; vertices[0].v = v1;
+    vertices[1].x = x1; vertices[1].y = y2; vertices[1].u = u1; vertices[1].v = v2;
+    vertices[2].x = x2; vertices[2].y = y2; vertices[2].u = u2; vertices[2].v = v2;
+    vertices[3].x = x2; vertices[3].y = y1; vertices[3].u = u2; vertices[3].v = v1;
+
+    for (GlyphVertex &vertex : vertices) {
+        std::copy(rgba, rgba + 4, vertex.rgba);
+    }
+}
+
+
+TextBatch::TextBatch(GameWindow *window):
+    window(window) {
+}
+
+TextBatch::~TextBatch() {
+    if (vbo != 0) {
+        GLState::delete_buffer(vbo);
+    }
+}
+
+TextBatch &TextBatch::get_current() {
+    return CHECK_NOTNULL(GraphicsContext::get_current())->get_text_batch();
+}
+
+
+GlyphAtlas &TextBatch::get_atlas(const TextFont &font, bool smooth) {
+    std::unique_ptr<GlyphAtlas> &atlas(atlases[std::make_pair(font.font, smooth)]);
+    if (!atlas) {
+        atlas.reset(new GlyphAtlas(font, smooth));
+    }
+
+    return *atlas;
+}
+
+
+TextLayout &TextBatch::get_layout(const TextFont &font) {
+    std::unique_ptr<TextLayout> &layout(layouts[font.font]);
+    if (!layout) {
+        layout.reset(new TextLayout(font));
+    }
+
+    return *layout;
+}
+
+
+void TextBatch::add(GlyphAtlas &atlas, const std::vector<GlyphQuad> &quads) {
+    auto group(std::find_if(std::begin(pending), std::end(pending),
+                            [&atlas] (const std::pair<GlyphAtlas *, std::vector<GlyphQuad>> &group) {
+                                return group.first == &atlas;
+                            }));
+
+    if (group == std::end(pending)) {
+        pending.emplace_back(&atlas, std::vector<GlyphQuad>());
+        group = std::prev(std::end(pending));
+    }
+
+    group->second.insert(std::end(group->second), std::begin(quads), std::end(quads));
+}
+
+
+const Image *TextBatch::find_bloom(const std::string &key) {
+    auto bloom(bloom_index.find(key));
+    if (bloom == std::end(bloom_index)) {
+        return nullptr;
+    }
+
+    blooms.splice(std::begin(blooms), blooms, bloom->second);
+    return &bloom->second->second;
+}
+
+
+void TextBatch::add_bloom(const std::string &key, const Image &image) {
+    if (bloom_index.count(key) != 0) {
+        return;
+    }
+
+    blooms.emplace_front(key, image);
+    bloom_index[key] = std::begin(blooms);
+    bloom_bytes += size_t(image.store_width * image.store_height) * sizeof(Image::Pixel);
+
+    // Keep the newest, even if it is too big on its own
+    while (bloom_bytes > max_bloom_bytes && blooms.size() > 1) {
+        const Image &oldest(blooms.back().second);
+        bloom_bytes -= size_t(oldest.store_width * oldest.store_height) * sizeof(Image::Pixel);
+        bloom_index.erase(blooms.back().first);
+        blooms.pop_back();
+    }
+}
+
+
+void TextBatch::set_attrib_pointers(int first_quad) {
+    GLState &gl_state(GLState::get_current());
+    size_t offset(sizeof(GlyphQuad) * size_t(first_quad));
+
+    // Positions and texture coordinates are in whole pixels, scaled by
+    // the shader; colours are normalised to [0, 1]
+    gl_state.count_calls(3);
+    glVertexAttribPointer(SHADER_LOCATION_POSITION, 2, GL_SHORT, GL_FALSE, sizeof(GlyphVertex),
+                          reinterpret_cast<GLvoid *>(offset + offsetof(GlyphVertex, x)));
+    glVertexAttribPointer(SHADER_LOCATION_TEXTURE, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(GlyphVertex),
+                          reinterpret_cast<GLvoid *>(offset + offsetof(GlyphVertex, u)));
+    glVertexAttribPointer(SHADER_LOCATION_COLOUR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GlyphVertex),
+                          reinterpret_cast<GLvoid *>(offset + offsetof(GlyphVertex, rgba)));
+}
+
+
+void TextBatch::flush() {
+    // Put the groups' glyphs one after another in the buffer
+    std::vector<GlyphQuad> quads;
+    for (auto &group : pending) {
+        quads.insert(std::end(quads), std::begin(group.second), std::end(group.second));
+    }
+
+    if (quads.empty()) {
+        return;
+    }
+
+    GLState &gl_state(GLState::get_current());
+
+    if (!shader) {
+        shader = std::make_shared<Shader>("text_batch_shader");
+        shader->bind_location_to_attribute(SHADER_LOCATION_COLOUR, "a_colour");
+        shader->link();
+    }
+
+    if (vbo == 0) {
+        glGenBuffers(1, &vbo);
+        gl_state.count_calls();
+    }
+
+    // The whole buffer is replaced each flush, so the driver can give
+    // us new storage rather than wait for the last draw
+    gl_state.bind_array_buffer(vbo);
+    gl_state.count_calls();
+    glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(sizeof(GlyphQuad) * quads.size()), quads.data(), GL_STREAM_DRAW);
+
+    std::pair<int, int> window_size(window->get_size());
+
+    gl_state.use_program(shader->get_program());
+    shader->set_uniform("s_texture", 0);
+    shader->set_uniform("window_size", glm::vec2(float(window_size.first), float(window_size.second)));
+
+    gl_state.disable(GL_DEPTH_TEST);
+    gl_state.enable(GL_BLEND);
+    gl_state.count_calls();
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    gl_state.enable_vertex_attrib_array(SHADER_LOCATION_POSITION);
+    gl_state.enable_vertex_attrib_array(SHADER_LOCATION_TEXTURE);
+    gl_state.enable_vertex_attrib_array(SHADER_LOCATION_COLOUR);
+    gl_state.active_texture(GL_TEXTURE0);
+
+    QuadIndexBuffer &quad_index_buffer(QuadIndexBuffer::get_current());
+
+    int first_quad(0);
+    for (auto &group : pending) {
+        int num_quads(int(group.second.size()));
+        if (num_quads == 0) {
+            continue;
+        }
+
+        group.first->bind();
+        shader->set_uniform("atlas_size", glm::vec2(float(GlyphAtlas::width), float(group.first->get_height())));
+
+        // The indices only reach max_quads quads from the attribute
+        // pointers, so larger groups are drawn in parts
+        for (int begin = 0; begin < num_quads; begin += QuadIndexBuffer::max_quads) {
+            int count(std::min(num_quads - begin, QuadIndexBuffer::max_quads));
+
+            set_attrib_pointers(first_quad + begin);
+            quad_index_buffer.bind(count);
+            quad_index_buffer.draw(0, count);
+        }
+
+        first_quad += num_quads;
+
+        // Keep the storage for the next frame
+        group.second.clear();
+    }
+
+    gl_state.disable_vertex_attrib_array(SHADER_LOCATION_COLOUR);
+    gl_state.enable(GL_DEPTH_TEST);
+}
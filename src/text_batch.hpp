@@ -0,0 +1,185 @@
+#ifndef TEXT_BATCH_H
+#define TEXT_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#if defined(USE_GL)
+#define GL_GLEXT_PROTOTYPES
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+}
+
+#include "image.hpp"
+#include "text_font.hpp"
+
+class GameWindow;
+class GlyphAtlas;
+class Shader;
+class TextLayout;
+
+///
+/// Collects the glyphs of the text drawn in a frame, and draws them
+/// with one draw call for each glyph atlas.
+///
+/// There is one for each GraphicsContext, which also owns the context's
+/// glyph atlases and text layouts, and a cache of the images of text
+/// with bloom.
+///
+class TextBatch {
+public:
+    ///
+    /// A corner of a glyph's quad, in 12 bytes. Positions are in pixels
+    /// from the bottom left of the window, and texture coordinates in
+    /// pixels from the top left of the atlas.
+    ///
+    struct GlyphVertex {
+        GLshort x;
+        GLshort y;
+        GLushort u;
+        GLushort v;
+        GLubyte rgba[4];
+    };
+
+    ///
+    /// The quad of a glyph: bottom left, top left, top right and
+    /// bottom right, as drawn by QuadIndexBuffer
+    ///
+    struct GlyphQuad {
+        GlyphVertex vertices[4];
+
+        ///
+        /// Set the quad from a glyph's rectangle in the window and in
+        /// the atlas. Both are top-left based with y growing down the
+        /// atlas and up the window.
+        ///
+        void set(int left, int top, int width, int height, int u, int v, const uint8_t rgba[4]);
+    };
+
+private:
+    ///
+    /// The window the glyphs are drawn on, whose size maps their
+    /// positions to the screen
+    ///
+    GameWindow *window;
+
+    ///
+    /// The glyph atlases of each font and rendering mode
+    ///
+    std::map<std::pair<TTF_Font *, bool>, std::unique_ptr<GlyphAtlas>> atlases;
+
+    ///
+    /// The layouts of each font, which keep the metrics of its glyphs
+    ///
+    std::map<TTF_Font *, std::unique_ptr<TextLayout>> layouts;
+
+    ///
+    /// Bloomed images of text, with the most recently used first, and
+    /// where each is in the list by its key
+    ///
+    std::list<std::pair<std::string, Image>> blooms;
+    std::unordered_map<std::string, std::list<std::pair<std::string, Image>>::iterator> bloom_index;
+
+    ///
+    /// The memory used by the bloomed images, in bytes
+    ///
+    size_t bloom_bytes = 0;
+
+    ///
+    /// The glyphs waiting to be drawn, grouped by atlas in the order the
+    /// atlases were first used this frame
+    ///
+    std::vector<std::pair<GlyphAtlas *, std::vector<GlyphQuad>>> pending;
+
+    ///
+    /// The vertex buffer holding the glyphs being drawn
+    ///
+    GLuint vbo = 0;
+
+    ///
+    /// The shader for drawing glyphs, loaded when first drawn
+    ///
+    std::shared_ptr<Shader> shader;
+
+    ///
+    /// Point the vertex attributes at the glyphs from a quad onwards
+    ///
+    static void set_attrib_pointers(int first_quad);
+
+    TextBatch(const TextBatch &) = delete;
+    TextBatch &operator=(const TextBatch &) = delete;
+
+public:
+    TextBatch(GameWindow *window);
+    ~TextBatch();
+
+    ///
+    /// The most memory the bloomed images are allowed, in bytes
+    ///
+    static const size_t max_bloom_bytes = 8 * 1024 * 1024;
+
+    ///
+    /// Get the batch of the current graphics context
+    ///
+    static TextBatch &get_current();
+
+    ///
+    /// Get the glyph atlas of a font in this context, making it if it
+    /// is new
+    /// @param font the font
+    /// @param smooth if true, the glyphs are anti-aliased
+    ///
+    GlyphAtlas &get_atlas(const TextFont &font, bool smooth);
+
+    ///
+    /// Get the layout of a font in this context, making it if it is new
+    /// @param font the font
+    ///
+    TextLayout &get_layout(const TextFont &font);
+
+    ///
+    /// Queue glyphs to be drawn on the next flush
+    /// @param atlas the atlas the glyphs are in
+    /// @param quads the glyphs
+    ///
+    void add(GlyphAtlas &atlas, const std::vector<GlyphQuad> &quads);
+
+    ///
+    /// Find a bloomed image of text kept by add_bloom
+    /// @param key everything the image depends on
+    /// @return the image, or nullptr if it isn't kept
+    ///
+    const Image *find_bloom(const std::string &key);
+
+    ///
+    /// Keep a bloomed image of text, forgetting the least recently used
+    /// ones when they take too much memory. The image must not be
+    /// changed afterwards, as it shares its pixels.
+    /// @param key everything the image depends on
+    /// @param image the image
+    ///
+    void add_bloom(const std::string &key, const Image &image);
+
+    ///
+    /// Draw the queued glyphs over whatever has been drawn so far
+    ///
+    void flush();
+};
+
+#endif
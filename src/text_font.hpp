@@ -19,7 +19,10 @@ class Typeface;
 ///
 class TextFont {
 private:
+    friend class GlyphAtlas;
     friend class Text;
+    friend class TextBatch;
+    friend class TextLayout;
     ///
     /// Destroy font when there are no more instances left.
     ///
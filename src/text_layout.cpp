@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glog/logging.h>
+
+extern "C" {
+#include <SDL2/SDL_ttf.h>
+}
+
+#include "glyph_atlas.hpp"
+#include "text_font.hpp"
+#include "text_layout.hpp"
+
+
+
+TextLayout::TextLayout(TextFont font):
+    TextLayout(
+        [font] (uint32_t code_point) {
+            // SDL_ttf only measures the basic multilingual plane
+            Uint16 character = Uint16((code_point > 0xffff) ? GlyphAtlas::replacement : code_point);
+
+            GlyphMetrics glyph;
+            glyph.min_x = glyph.max_x = glyph.advance = 0;
+            if (TTF_GlyphMetrics(font.font, character, &glyph.min_x, &glyph.max_x,
+                                 nullptr, nullptr, &glyph.advance) != 0) {
+                LOG(WARNING) << "Cannot get glyph metrics: " << TTF_GetError();
+            }
+            return glyph;
+        },
+        [font] (uint32_t left, uint32_t right) {
+#if SDL_VERSIONNUM(SDL_TTF_MAJOR_VERSION, SDL_TTF_MINOR_VERSION, SDL_TTF_PATCHLEVEL) >= SDL_VERSIONNUM(2, 0, 14)
+            if (TTF_GetFontKerning(font.font) == 0 || left > 0xffff || right > 0xffff) {
+                return 0;
+            }
+            return TTF_GetFontKerningSizeGlyphs(font.font, Uint16(left), Uint16(right));
+#else
+            // There is no way to get the kerning of characters before
+            // SDL_ttf 2.0.14.
+            (void)left;
+            (void)right;
+            return 0;
+#endif
+        })
+{
+}
+
+TextLayout::TextLayout(std::function<GlyphMetrics(uint32_t)> fetch_metrics,
+                       std::function<int(uint32_t, uint32_t)> fetch_kerning):
+    fetch_metrics(fetch_metrics),
+    fetch_kerning(fetch_kerning) {
+}
+
+
+const TextLayout::GlyphMetrics &TextLayout::get_metrics(uint32_t code_point) {
+    auto glyph(metrics.find(code_point));
+    if (glyph != std::end(metrics)) {
+        return glyph->second;
+    }
+
+    return metrics.insert(std::make_pair(code_point, fetch_metrics(code_point))).first->second;
+}
+
+
+int TextLayout::get_kerning(uint32_t left, uint32_t right) {
+    uint64_t pair((uint64_t(left) << 32) | right);
+
+    auto known(kerning.find(pair));
+    if (known != std::end(kerning)) {
+        return known->second;
+    }
+
+    int amount(fetch_kerning(left, right));
+    kerning[pair] = amount;
+    return amount;
+}
+
+
+void TextLayout::advance(Pen &pen, uint32_t code_point) {
+    // SDL_ttf skips byte order marks
+    if (code_point == 0xfeff || code_point == 0xfffe) {
+        return;
+    }
+
+    const GlyphMetrics &glyph(get_metrics(code_point));
+
+    if (pen.previous != 0) {
+        pen.x += get_kerning(pen.previous, code_point);
+    }
+
+    pen.min_x = std::min(pen.min_x, pen.x + glyph.min_x);
+    pen.max_x = std::max(pen.max_x, pen.x + std::max(glyph.max_x, glyph.advance));
+    pen.x += glyph.advance;
+    pen.previous = code_point;
+}
+
+
+int TextLayout::measure(const std::string &text) {
+    Pen pen;
+    for (size_t i = 0; i < text.size();) {
+        advance(pen, GlyphAtlas::next_code_point(text, i));
+    }
+    return pen.get_width();
+}
+
+
+bool TextLayout::wrap(const std::string &text, int available_width, int border,
+                      std::vector<std::string> &lines, int &used_width) {
+    lines.clear();
+    used_width = 0;
+
+    size_t length(text.size());
+    size_t start(0);
+
+    while (start < length) {
+        Pen pen;
+        size_t index(start);
+
+        // The end of the last word which fitted on the line, and of the
+        // longest part of the line which fitted, for when even the
+        // first word doesn't.
+        size_t word_end(start);
+        size_t part_end(start);
+        int part_width(0);
+
+        // Measuring only gets wider, so the line is full as soon as
+        // any character overflows.
+        bool full(false);
+
+        for (;;) {
+            if (index == length || text[index] == ' ' || text[index] == '\n') {
+                int width(pen.get_width() + border);
+                if (width > available_width) {
+                    full = true;
+                    break;
+                }
+
+                used_width = std::max(used_width, width);
+                word_end = index;
+
+                if (index == length || text[index] == '\n') {
+                    lines.push_back(text.substr(start, index - start));
+                    start = index + 1;
+                    break;
+                }
+            }
+
+            advance(pen, GlyphAtlas::next_code_point(text, index));
+
+            int width(pen.get_width() + border);
+            if (width > available_width) {
+                full = true;
+                break;
+            }
+            part_end = index;
+            part_width = width;
+        }
+
+        if (!full) {
+            continue;
+        }
+
+        if (word_end > start) {
+            // Break at the space after the last word that fits
+            lines.push_back(text.substr(start, word_end - start));
+            start = word_end + 1;
+        }
+        else if (part_end > start) {
+            // Cut the word, and carry on from where it was cut
+            lines.push_back(text.substr(start, part_end - start));
+            used_width = std::max(used_width, part_width);
+            start = part_end;
+        }
+        else {
+            return false;
+        }
+    }
+
+    return true;
+}
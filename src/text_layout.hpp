@@ -0,0 +1,122 @@
+#ifndef TEXT_LAYOUT_H
+#define TEXT_LAYOUT_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "text_font.hpp"
+
+///
+/// Measures and word wraps text as SDL_ttf would measure it, from the
+/// metrics and kerning of each glyph, which are looked up once and kept.
+///
+/// Measuring is done with a pen moved along the text, so wrapping a
+/// string takes a single pass over it rather than measuring every
+/// prefix again.
+///
+/// There is one for each font in each GL context; get them from
+/// TextBatch.
+///
+class TextLayout {
+public:
+    ///
+    /// The horizontal metrics of a glyph, as from TTF_GlyphMetrics
+    ///
+    struct GlyphMetrics {
+        int min_x;
+        int max_x;
+        int advance;
+    };
+
+    ///
+    /// The extent of the text measured so far, as TTF_SizeUTF8 finds it
+    ///
+    struct Pen {
+        int x = 0;
+        int min_x = 0;
+        int max_x = 0;
+        ///
+        /// The last code point, for kerning, or 0 for none
+        ///
+        uint32_t previous = 0;
+
+        int get_width() const { return max_x - min_x; }
+    };
+
+private:
+    ///
+    /// Where metrics and kerning come from, for those not yet known
+    ///
+    std::function<GlyphMetrics(uint32_t)> fetch_metrics;
+    std::function<int(uint32_t, uint32_t)> fetch_kerning;
+
+    ///
+    /// The metrics looked up so far, by code point
+    ///
+    std::unordered_map<uint32_t, GlyphMetrics> metrics;
+
+    ///
+    /// The kerning looked up so far, by pair of code points
+    ///
+    std::unordered_map<uint64_t, int> kerning;
+
+public:
+    ///
+    /// Lay out text with the metrics of a font.
+    ///
+    /// Kerning needs SDL_ttf 2.0.14 or later, and is left out before
+    /// that.
+    ///
+    TextLayout(TextFont font);
+
+    ///
+    /// Lay out text with metrics from elsewhere
+    /// @param fetch_metrics gets the metrics of a code point
+    /// @param fetch_kerning gets the kerning between two code points
+    ///
+    TextLayout(std::function<GlyphMetrics(uint32_t)> fetch_metrics,
+               std::function<int(uint32_t, uint32_t)> fetch_kerning);
+
+    ///
+    /// Get the metrics of a code point.
+    ///
+    const GlyphMetrics &get_metrics(uint32_t code_point);
+
+    ///
+    /// Get the kerning between two code points.
+    ///
+    int get_kerning(uint32_t left, uint32_t right);
+
+    ///
+    /// Move a pen past a code point.
+    ///
+    void advance(Pen &pen, uint32_t code_point);
+
+    ///
+    /// Measure UTF-8 text.
+    /// @return The width, as from TTF_SizeUTF8.
+    ///
+    int measure(const std::string &text);
+
+    ///
+    /// Break UTF-8 text into lines at spaces and new lines.
+    ///
+    /// Lines are broken after the last space which leaves them narrow
+    /// enough, and a word too long for a line of its own is cut.
+    ///
+    /// @param text The text.
+    /// @param available_width The widest a line can be, in pixels.
+    /// @param border Space added to the width of every line, in pixels.
+    /// @param lines Filled with the lines, without the spaces and new
+    ///              lines they were broken at.
+    /// @param used_width Set to the widest line, with its border.
+    /// @return False if a character is too wide for a line of its own.
+    ///
+    bool wrap(const std::string &text, int available_width, int border,
+              std::vector<std::string> &lines, int &used_width);
+};
+
+#endif
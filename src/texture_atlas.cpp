@@ -1,12 +1,16 @@
 // Try funky initialization in if.
 
+#include <algorithm>
 #include <exception>
 #include <fstream>
 #include <glog/logging.h>
+#include <iterator>
+#include <map>
 #include <memory>
 #include <set>
 #include <sstream>
 #include <stdexcept>
+#include <string>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -26,22 +30,33 @@ extern "C" {
 #endif
 }
 
+#include "atlas_cache.hpp"
+#include "atlas_layout.hpp"
 #include "cacheable_resource.hpp"
 #include "engine.hpp"
 #include "fml.hpp"
+#include "gl_state.hpp"
 #include "image.hpp"
 #include "resource_cache.hpp"
 #include "texture_atlas.hpp"
+#include "texture_format.hpp"
+#include "texture_memory.hpp"
+#include "tile_registry.hpp"
 
 
 
 bool TextureAtlas::global_name_to_tileset_initialized = false;
 std::map<std::string, std::string> TextureAtlas::global_name_to_tileset;
+std::map<std::string, Image> TextureAtlas::decoded_images;
 
 std::map<std::string, std::string> const &TextureAtlas::names_to_tilesets() {
     if (!global_name_to_tileset_initialized) {
-        std::ifstream input("../resources/tiles/associated_texture_atlas.fml");
-        fml::from_stream(input, global_name_to_tileset);
+        // Built from the registry, so the FML is only parsed once
+        TileRegistry &registry(TileRegistry::get_instance());
+        for (TileRegistry::Handle handle = 0; handle < registry.size(); ++handle) {
+            global_name_to_tileset.emplace_hint(std::end(global_name_to_tileset),
+                                                registry.get_name(handle), registry.get_tileset_name(handle));
+        }
 
         global_name_to_tileset_initialized = true;
     }
@@ -72,6 +87,23 @@ std::shared_ptr<TextureAtlas> TextureAtlas::new_resource(const std::string resou
     return atlas;
 }
 
+std::shared_ptr<TextureAtlas> TextureAtlas::get_shared_decoded(const std::string resource_name, Image image) {
+    decoded_images[resource_name] = image;
+    std::shared_ptr<TextureAtlas> atlas(get_shared(resource_name));
+    decoded_images.erase(resource_name);
+
+    return atlas;
+}
+
+Image TextureAtlas::load_image(const std::string filename) {
+    auto decoded(decoded_images.find(filename));
+    if (decoded != std::end(decoded_images)) {
+        return decoded->second;
+    }
+
+    return Image(filename, true);
+}
+
 
 void TextureAtlas::merge(const std::vector<std::shared_ptr<TextureAtlas>> &atlases_raw) {
     std::set<std::shared_ptr<TextureAtlas>,
@@ -119,7 +151,15 @@ void TextureAtlas::merge(const std::vector<std::shared_ptr<TextureAtlas>> &atlas
         }
     }
     
-    for (auto atlas : atlases) {
+    // Merge in a fixed order, so the layout is the same from run to run
+    // and can be cached.
+    std::vector<std::shared_ptr<TextureAtlas>> ordered_atlases(std::begin(atlases), std::end(atlases));
+    std::stable_sort(std::begin(ordered_atlases), std::end(ordered_atlases),
+                     [] (const std::shared_ptr<TextureAtlas> &a, const std::shared_ptr<TextureAtlas> &b) {
+                         return a->resource_name < b->resource_name;
+                     });
+
+    for (auto atlas : ordered_atlases) {
         // Free up the old textures, reset layout.
         atlas->deinit_texture();
         // Remove old super atlas(es).
@@ -127,84 +167,110 @@ void TextureAtlas::merge(const std::vector<std::shared_ptr<TextureAtlas>> &atlas
         atlas->reset_layout();
     }
     // Create images with allocation.
-    std::shared_ptr<TextureAtlas> super_atlas = std::shared_ptr<TextureAtlas>(new TextureAtlas(atlases));
+    std::shared_ptr<TextureAtlas> super_atlas = std::shared_ptr<TextureAtlas>(new TextureAtlas(ordered_atlases));
 
     // Update references between super and sub atlases.
     int sub_offset = 0;
-    for (auto atlas : atlases) {
+    for (auto atlas : ordered_atlases) {
         atlas->index_offset = sub_offset;
         atlas->super_atlas = super_atlas;
         super_atlas->sub_atlases.push_back(std::weak_ptr<TextureAtlas>(atlas));
         sub_offset += atlas->get_texture_count();
     }
+
+    // Tiles in these atlases have moved
+    TileRegistry::get_instance().forget_resolved();
 }
 
 
 
-TextureAtlas::TextureAtlas(const std::set<std::shared_ptr<TextureAtlas>, std::owner_less<std::shared_ptr<TextureAtlas>>> &atlases):
+TextureAtlas::TextureAtlas(const std::vector<std::shared_ptr<TextureAtlas>> &atlases):
     gl_texture(0),
     reshaped(true),
     unit_w(Engine::get_tile_size()),
     unit_h(Engine::get_tile_size()),
-    sub_atlases(atlases.size()),
+    sub_atlases(),
     super_atlas(),
     names_to_indexes()
 {
     int texture_count = 0;
     // Assume all tiles are the same size. They should be...
+    std::vector<AtlasCache::Source> sources;
+    bool cacheable = true;
     for (auto atlas : atlases) {
         texture_count += atlas->get_texture_count();
+        sources.push_back(AtlasCache::Source{atlas->resource_name, atlas->get_texture_count()});
+        // Only atlases loaded from files can be cached.
+        cacheable = cacheable && !atlas->resource_name.empty();
     }
 
     int max_texture_size;
     glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
-    int max_columns = max_texture_size / unit_w;
 
-    // Naive method for getting a fitting atlas size.
-    if (max_columns >= texture_count) {
-        unit_columns = texture_count;
-        unit_rows    = 1;
-    }
-    else {
-        unit_columns = max_columns;
-        // Round up divide.
-        unit_rows    = (texture_count + max_columns - 1) / max_columns;
+    AtlasCache cache(sources, unit_w, unit_h, max_texture_size);
+    bool cached = false;
+    if (cacheable) {
+        try {
+            AtlasCache::Contents contents(cache.load());
+            unit_columns = contents.columns;
+            unit_rows    = contents.rows;
+            gl_image = image = contents.image;
+            indexes_to_names = contents.names;
+            cached = true;
+
+            LOG(INFO) << "Loaded super atlas: textures: " << texture_count << " = (" << unit_columns << ", " << unit_rows << ") => pixels: (" << gl_image.width << ", " << gl_image.height << ") from " << cache.get_path();
+        }
+        catch (AtlasCache::LoadException &e) {
+            VLOG(1) << "Not using cached super atlas: " << e.what();
+        }
     }
-    gl_image = image = Image(unit_w * unit_columns, unit_h * unit_rows, true);
 
-    indexes_to_names = std::vector<std::string>(unit_columns * unit_rows);
+    if (!cached) {
+        AtlasLayout layout(AtlasLayout::pack(texture_count, unit_w, unit_h, max_texture_size));
+        unit_columns = layout.columns;
+        unit_rows    = layout.rows;
+        gl_image = image = Image(layout.width, layout.height, true);
 
-    LOG(INFO) << "Generating super atlas: textures: " << texture_count << " = (" << unit_columns << ", " << unit_rows << ") => pixels: (" << gl_image.width << ", " << gl_image.height << ")";
+        indexes_to_names = std::vector<std::string>(unit_columns * unit_rows);
 
-    textures = std::vector<std::weak_ptr<Texture>>(unit_columns * unit_rows);
+        LOG(INFO) << "Generating super atlas: textures: " << texture_count << " = (" << unit_columns << ", " << unit_rows << ") => pixels: (" << gl_image.width << ", " << gl_image.height << "), " << layout.texture_bytes() << " bytes";
 
+        int super_i = 0;
+        for (auto atlas : atlases) {
+            VLOG(1) << "Merging: " << this << " << " << atlas;
+            AtlasLayout::blit_units(gl_image, unit_columns, super_i,
+                                    atlas->image, atlas->unit_columns,
+                                    atlas->get_texture_count(), unit_w, unit_h);
 
-    int super_i = 0;
-    for (auto atlas : atlases) {
-        VLOG(1) << "Merging: " << this << " << " << atlas;
-        // Cached dereference.
-        Image* src = &atlas->image;
-        for (int i = 0, end = atlas->get_texture_count(); i < end; ++i, ++super_i) {
-            std::pair<int,int> super_units(index_to_units(super_i));
-            int dst_x_offset = super_units.first  * unit_w;
-            int dst_y_offset = super_units.second * unit_h;
-            std::pair<int,int> units(atlas->index_to_units(i));
-            int src_x_offset = units.first  * unit_w;
-            int src_y_offset = units.second * unit_h;
-            VLOG(2) << "Sub-super mapping: " << i << ": (" << src_x_offset << ", " << src_y_offset << ") -> " << super_i << ": (" << dst_x_offset << ", " << dst_y_offset << ")";
-            for (int y = 0; y < unit_h; ++y) {
-                for (int x = 0; x < unit_w; ++x) {
-                    gl_image.flipped_pixels[dst_y_offset + y][dst_x_offset + x] = src->flipped_pixels[src_y_offset + y][src_x_offset + x];
-                }
+            for (auto &mapping : atlas->names_to_indexes) {
+                indexes_to_names[super_i + mapping.second] = mapping.first;
+            }
+            super_i += atlas->get_texture_count();
+        }
+
+        if (cacheable) {
+            try {
+                cache.save(AtlasCache::Contents{unit_columns, unit_rows, gl_image, indexes_to_names});
+            }
+            catch (AtlasCache::LoadException &e) {
+                LOG(WARNING) << "Unable to cache super atlas: " << e.what();
             }
         }
     }
 
+    for (int i = 0, end = int(indexes_to_names.size()); i < end; ++i) {
+        if (!indexes_to_names[i].empty()) {
+            names_to_indexes[indexes_to_names[i]] = i;
+        }
+    }
+
+    textures = std::vector<std::weak_ptr<Texture>>(unit_columns * unit_rows);
+
     init_texture();
 }
 
 TextureAtlas::TextureAtlas(const std::string image_path):
-    image(image_path, true),
+    image(load_image(image_path)),
     gl_image(image),
     gl_texture(0),
     reshaped(false),
@@ -237,40 +303,19 @@ void TextureAtlas::init_texture() {
     if (image.store_width > max_texture_size || image.store_height > max_texture_size) {
         // Turns out that the atlas is too wide or tall. Reshape it.
 
-        int texture_count = get_texture_count();
-        int max_columns = max_texture_size / unit_w;
-
         int old_unit_columns = unit_columns;
         int old_unit_rows = unit_rows;
 
-        // Naive method for getting a fitting atlas size.
-        if (max_columns >= texture_count) {
-            unit_columns = texture_count;
-            unit_rows    = 1;
-        }
-        else {
-            unit_columns = max_columns;
-            // Round up divide.
-            unit_rows    = (texture_count + max_columns - 1) / max_columns;
-        }
-        gl_image = Image(unit_w * unit_columns, unit_h * unit_rows, true);
-
-        LOG(INFO) << "Reshaping: " << this << ": (" << image.width << ", " << image.height << ") -> (" << gl_image.width << ", " << gl_image.height << ")";;
-        LOG(INFO) << "  (Units): " << this << ": (" << old_unit_columns << ", " << old_unit_rows << ") -> (" << unit_columns << ", " << unit_rows << ")";;
-        for (int i = 0, end = old_unit_columns * old_unit_rows; i < end; ++i) {
-            int dst_x_offset = (i % unit_columns) * unit_w;
-            int dst_y_offset = (i / unit_columns) * unit_h;
-
-            int src_x_offset = (i % old_unit_columns) * unit_w;
-            int src_y_offset = (i / old_unit_columns) * unit_h;
+        AtlasLayout layout(AtlasLayout::pack(get_texture_count(), unit_w, unit_h, max_texture_size));
+        unit_columns = layout.columns;
+        unit_rows    = layout.rows;
+        gl_image = Image(layout.width, layout.height, true);
 
-            VLOG(2) << "Moving: " << i << ": (" << src_x_offset << ", " << src_y_offset << ") -> (" << dst_x_offset << ", " << dst_y_offset << ")";
-            for (int y = 0; y < unit_h; ++y) {
-                for (int x = 0; x < unit_w; ++x) {
-                    gl_image.flipped_pixels[dst_y_offset + y][dst_x_offset + x] = image.flipped_pixels[src_y_offset + y][src_x_offset + x];
-                }
-            }
-        }
+        LOG(INFO) << "Reshaping: " << this << ": (" << image.width << ", " << image.height << ") -> (" << gl_image.width << ", " << gl_image.height << ")";
+        LOG(INFO) << "  (Units): " << this << ": (" << old_unit_columns << ", " << old_unit_rows << ") -> (" << unit_columns << ", " << unit_rows << ")";
+        AtlasLayout::blit_units(gl_image, unit_columns, 0,
+                                image, old_unit_columns,
+                                old_unit_columns * old_unit_rows, unit_w, unit_h);
         textures = std::vector<std::weak_ptr<Texture>>(unit_columns * unit_rows);
         reshaped = true;
     }
@@ -282,24 +327,30 @@ void TextureAtlas::init_texture() {
         throw TextureAtlas::LoadException("Unable to generate GL texture");
     }
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, gl_texture);
+    GLState &gl_state(GLState::get_current());
+    gl_state.active_texture(GL_TEXTURE0);
+    gl_state.bind_texture_2d(gl_texture);
     glGetError();
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, gl_image.store_width, gl_image.store_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, gl_image.pixels);
+    const uint8_t *pixels(reinterpret_cast<const uint8_t *>(gl_image.pixels));
+    TextureFormat::Format format(TextureFormat::choose(pixels, size_t(gl_image.store_width) * size_t(gl_image.store_height),
+                                                       Engine::get_reduced_texture_precision()));
+    TextureFormat::upload(format, gl_image.store_width, gl_image.store_height, pixels);
     if (int e = glGetError()) {
         std::stringstream hex_error_code;
         hex_error_code << std::hex << e;
-        glDeleteTextures(1, &gl_texture);
+        GLState::delete_texture(gl_texture);
         throw TextureAtlas::LoadException("Unable to load texture into GPU: " + hex_error_code.str());
     }
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    gl_state.count_calls(2);
+
+    TextureMemory::record(gl_texture, "atlas", gl_image.store_width, gl_image.store_height, format);
 }
 
 void TextureAtlas::deinit_texture() {
     if (gl_texture != 0) {
-        glDeleteTextures(1, &gl_texture);
+        GLState::delete_texture(gl_texture);
         gl_texture = 0;
     }
 }
@@ -446,9 +497,9 @@ int TextureAtlas::get_name_index(const std::string name) {
 }
 
 std::pair<int, std::string> TextureAtlas::from_name(const std::string tile_name) {
-    auto tileset_name(TextureAtlas::names_to_tilesets().at(tile_name));
-    auto index(TextureAtlas::get_shared(tileset_name)->get_name_index(tile_name));
-    return std::make_pair(index, tileset_name);
+    TileRegistry &registry(TileRegistry::get_instance());
+    TileRegistry::Handle handle(registry.get_handle(tile_name));
+    return std::make_pair(registry.resolve(handle).index, registry.get_tileset_name(handle));
 }
 
 std::map<std::string, int> const &TextureAtlas::get_names_to_indexes() {
@@ -130,9 +130,14 @@ private:
     ///
     /// Creates a new texture atlas from a list of other atlases.
     ///
-    /// Combines image data to form a new super atlas.
+    /// Combines image data to form a new super atlas, laid out to use
+    /// as little texture memory as possible. The result is loaded from
+    /// the AtlasCache when the same atlases have been merged before,
+    /// and saved to it otherwise.
     ///
-    TextureAtlas(const std::set<std::shared_ptr<TextureAtlas>, std::owner_less<std::shared_ptr<TextureAtlas>>> &atlases);
+    /// @param atlases The atlases to combine, in index order.
+    ///
+    TextureAtlas(const std::vector<std::shared_ptr<TextureAtlas>> &atlases);
 
     ///
     /// Allocates the gl texture from the image member.
@@ -165,6 +170,18 @@ private:
     ///
     static bool global_name_to_tileset_initialized;
 
+    ///
+    /// Images which were decoded ahead of time, by filename. Only
+    /// filled for the duration of get_shared_decoded.
+    ///
+    static std::map<std::string, Image> decoded_images;
+
+    ///
+    /// Get the image for an atlas, using one decoded ahead of time if
+    /// there is one.
+    ///
+    static Image load_image(const std::string filename);
+
 public:
     ///
     /// Represents a failure when loading the texture atlas.
@@ -191,12 +208,31 @@ public:
 
     ///
     /// Map of all known tile names to their tileset's name,
-    /// pre-generated from the job files.   
+    /// pre-generated from the job files. Built from TileRegistry, which
+    /// should be used instead where possible.
     ///
     static std::map<std::string, std::string> const &names_to_tilesets();
 
+    ///
+    /// Find the index and tileset of a tile through TileRegistry.
+    /// Throws std::runtime_error if there is no such tile.
+    ///
     static std::pair<int, std::string> from_name(const std::string tile_name);
 
+    ///
+    /// Get a commonly used texture, as get_shared does, from an image
+    /// which has already been decoded.
+    ///
+    /// Decoding an image needs no GL context, so it can be done on
+    /// another thread. If the atlas is already loaded, the image is
+    /// not used.
+    ///
+    /// @param resource_name Path of the texture image file.
+    /// @param image The image decoded from the file.
+    /// @return A shared pointer to the relevant TextureAtlas.
+    ///
+    static std::shared_ptr<TextureAtlas> get_shared_decoded(const std::string resource_name, Image image);
+
     ///
     /// Load a texture from a given file path.
     ///
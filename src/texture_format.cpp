@@ -0,0 +1,321 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+#define TEXTURE_FORMAT_SSE2
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(__ARM_BIG_ENDIAN)
+#define TEXTURE_FORMAT_NEON
+#include <arm_neon.h>
+#endif
+
+#include "gl_state.hpp"
+#include "texture_format.hpp"
+
+#ifdef USE_GL
+#define GL_GLEXT_PROTOTYPES
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+
+
+
+namespace {
+    ///
+    /// How GL is told about a format
+    ///
+    struct GLFormat {
+        GLint internal_format;
+        GLenum format;
+        GLenum type;
+    };
+
+    GLFormat get_gl_format(TextureFormat::Format format) {
+        // GL ES takes the format as the internal format, where desktop
+        // GL needs to be asked for the smaller sizes
+        switch (format) {
+#ifdef USE_GLES
+        case TextureFormat::Format::RGBA4444:
+            return GLFormat{GL_RGBA, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4};
+        case TextureFormat::Format::RGBA5551:
+            return GLFormat{GL_RGBA, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1};
+        case TextureFormat::Format::RGB565:
+            return GLFormat{GL_RGB, GL_RGB, GL_UNSIGNED_SHORT_5_6_5};
+        case TextureFormat::Format::LUMINANCE_ALPHA:
+            return GLFormat{GL_LUMINANCE_ALPHA, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE};
+        case TextureFormat::Format::ALPHA:
+            return GLFormat{GL_ALPHA, GL_ALPHA, GL_UNSIGNED_BYTE};
+        case TextureFormat::Format::RGBA8888:
+            break;
+#else
+        case TextureFormat::Format::RGBA4444:
+            return GLFormat{GL_RGBA4, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4};
+        case TextureFormat::Format::RGBA5551:
+            return GLFormat{GL_RGB5_A1, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1};
+        case TextureFormat::Format::RGB565:
+            return GLFormat{GL_RGB5, GL_RGB, GL_UNSIGNED_SHORT_5_6_5};
+        case TextureFormat::Format::LUMINANCE_ALPHA:
+            return GLFormat{GL_LUMINANCE8_ALPHA8, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE};
+        case TextureFormat::Format::ALPHA:
+            return GLFormat{GL_ALPHA8, GL_ALPHA, GL_UNSIGNED_BYTE};
+        case TextureFormat::Format::RGBA8888:
+            break;
+#endif
+        }
+        return GLFormat{GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE};
+    }
+
+    //
+    // Packers for the 16 bit formats. Each takes a pixel as a little
+    // endian word, with red in the low byte, and gives the packed pixel
+    // in the low half of the word. The vector versions do the same for
+    // four pixels at once.
+    //
+
+    struct Pack4444 {
+        static uint32_t pack(uint32_t pixel) {
+            return ((pixel & 0xf0u) << 8) | ((pixel >> 4) & 0xf00u) | ((pixel >> 16) & 0xf0u) | (pixel >> 28);
+        }
+#if defined(TEXTURE_FORMAT_SSE2)
+        static __m128i pack(__m128i pixels) {
+            return _mm_or_si128(
+                _mm_or_si128(_mm_slli_epi32(_mm_and_si128(pixels, _mm_set1_epi32(0xf0)), 8),
+                             _mm_and_si128(_mm_srli_epi32(pixels, 4), _mm_set1_epi32(0xf00))),
+                _mm_or_si128(_mm_and_si128(_mm_srli_epi32(pixels, 16), _mm_set1_epi32(0xf0)),
+                             _mm_srli_epi32(pixels, 28)));
+        }
+#elif defined(TEXTURE_FORMAT_NEON)
+        static uint32x4_t pack(uint32x4_t pixels) {
+            return vorrq_u32(
+                vorrq_u32(vshlq_n_u32(vandq_u32(pixels, vdupq_n_u32(0xf0u)), 8),
+                          vandq_u32(vshrq_n_u32(pixels, 4), vdupq_n_u32(0xf00u))),
+                vorrq_u32(vandq_u32(vshrq_n_u32(pixels, 16), vdupq_n_u32(0xf0u)),
+                          vshrq_n_u32(pixels, 28)));
+        }
+#endif
+    };
+
+    struct Pack5551 {
+        static uint32_t pack(uint32_t pixel) {
+            return ((pixel & 0xf8u) << 8) | ((pixel >> 5) & 0x7c0u) | ((pixel >> 18) & 0x3eu) | (pixel >> 31);
+        }
+#if defined(TEXTURE_FORMAT_SSE2)
+        static __m128i pack(__m128i pixels) {
+            return _mm_or_si128(
+                _mm_or_si128(_mm_slli_epi32(_mm_and_si128(pixels, _mm_set1_epi32(0xf8)), 8),
+                             _mm_and_si128(_mm_srli_epi32(pixels, 5), _mm_set1_epi32(0x7c0))),
+                _mm_or_si128(_mm_and_si128(_mm_srli_epi32(pixels, 18), _mm_set1_epi32(0x3e)),
+                             _mm_srli_epi32(pixels, 31)));
+        }
+#elif defined(TEXTURE_FORMAT_NEON)
+        static uint32x4_t pack(uint32x4_t pixels) {
+            return vorrq_u32(
+                vorrq_u32(vshlq_n_u32(vandq_u32(pixels, vdupq_n_u32(0xf8u)), 8),
+                          vandq_u32(vshrq_n_u32(pixels, 5), vdupq_n_u32(0x7c0u))),
+                vorrq_u32(vandq_u32(vshrq_n_u32(pixels, 18), vdupq_n_u32(0x3eu)),
+                          vshrq_n_u32(pixels, 31)));
+        }
+#endif
+    };
+
+    struct Pack565 {
+        static uint32_t pack(uint32_t pixel) {
+            return ((pixel & 0xf8u) << 8) | ((pixel >> 5) & 0x7e0u) | ((pixel >> 19) & 0x1fu);
+        }
+#if defined(TEXTURE_FORMAT_SSE2)
+        static __m128i pack(__m128i pixels) {
+            return _mm_or_si128(
+                _mm_or_si128(_mm_slli_epi32(_mm_and_si128(pixels, _mm_set1_epi32(0xf8)), 8),
+                             _mm_and_si128(_mm_srli_epi32(pixels, 5), _mm_set1_epi32(0x7e0))),
+                _mm_and_si128(_mm_srli_epi32(pixels, 19), _mm_set1_epi32(0x1f)));
+        }
+#elif defined(TEXTURE_FORMAT_NEON)
+        static uint32x4_t pack(uint32x4_t pixels) {
+            return vorrq_u32(
+                vorrq_u32(vshlq_n_u32(vandq_u32(pixels, vdupq_n_u32(0xf8u)), 8),
+                          vandq_u32(vshrq_n_u32(pixels, 5), vdupq_n_u32(0x7e0u))),
+                vandq_u32(vshrq_n_u32(pixels, 19), vdupq_n_u32(0x1fu)));
+        }
+#endif
+    };
+
+    ///
+    /// Pack RGBA pixels into 16 bits each, eight at a time where there
+    /// are vector instructions
+    ///
+    template <typename Pack>
+    void pack_16(const uint8_t *rgba, size_t count, uint8_t *out) {
+        size_t i(0);
+
+#if defined(TEXTURE_FORMAT_SSE2)
+        for (; i + 8 <= count; i += 8) {
+            __m128i low (Pack::pack(_mm_loadu_si128(reinterpret_cast<const __m128i *>(rgba + i * 4))));
+            __m128i high(Pack::pack(_mm_loadu_si128(reinterpret_cast<const __m128i *>(rgba + i * 4 + 16))));
+            // The pack saturates signed words, so sign extend the halves
+            // to keep their bits
+            low  = _mm_srai_epi32(_mm_slli_epi32(low,  16), 16);
+            high = _mm_srai_epi32(_mm_slli_epi32(high, 16), 16);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2), _mm_packs_epi32(low, high));
+        }
+#elif defined(TEXTURE_FORMAT_NEON)
+        for (; i + 8 <= count; i += 8) {
+            uint32x4_t low (Pack::pack(vreinterpretq_u32_u8(vld1q_u8(rgba + i * 4))));
+            uint32x4_t high(Pack::pack(vreinterpretq_u32_u8(vld1q_u8(rgba + i * 4 + 16))));
+            vst1q_u8(out + i * 2, vreinterpretq_u8_u16(vcombine_u16(vmovn_u32(low), vmovn_u32(high))));
+        }
+#endif
+
+        for (; i < count; ++i) {
+            const uint8_t *pixel(rgba + i * 4);
+            uint32_t word(pixel[0]
+                          | uint32_t(pixel[1]) << 8
+                          | uint32_t(pixel[2]) << 16
+                          | uint32_t(pixel[3]) << 24);
+            uint16_t packed(uint16_t(Pack::pack(word)));
+            std::memcpy(out + i * 2, &packed, sizeof(packed));
+        }
+    }
+}
+
+
+
+TextureFormat::Format TextureFormat::choose(const uint8_t *rgba, size_t count, bool reduced) {
+    // Flags are gathered without branching, so the loop vectorises.
+    // The colour of fully transparent pixels is never seen, so it is
+    // ignored.
+    uint8_t not_black(0);
+    uint8_t not_grey(0);
+    uint8_t opaque(0xff);
+    uint8_t not_binary(0);
+
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t *pixel(rgba + i * 4);
+        uint8_t visible(uint8_t(-int(pixel[3] != 0)));
+        not_black  |= uint8_t((pixel[0] | pixel[1] | pixel[2]) & visible);
+        not_grey   |= uint8_t(((pixel[0] ^ pixel[1]) | (pixel[0] ^ pixel[2])) & visible);
+        opaque     &= pixel[3];
+        // Alpha of 0 or 255 wraps to 1 or 0
+        not_binary |= uint8_t((pixel[3] + 1) & 0xfe);
+    }
+
+    if (!not_black) {
+        return Format::ALPHA;
+    }
+    if (!not_grey) {
+        return Format::LUMINANCE_ALPHA;
+    }
+    if (!reduced) {
+        return Format::RGBA8888;
+    }
+    if (opaque == 0xff) {
+        return Format::RGB565;
+    }
+    if (!not_binary) {
+        return Format::RGBA5551;
+    }
+    return Format::RGBA4444;
+}
+
+
+int TextureFormat::bytes_per_pixel(Format format) {
+    switch (format) {
+    case Format::RGBA8888:
+        return 4;
+    case Format::RGBA4444:
+    case Format::RGBA5551:
+    case Format::RGB565:
+    case Format::LUMINANCE_ALPHA:
+        return 2;
+    case Format::ALPHA:
+        return 1;
+    }
+    return 4;
+}
+
+
+const char *TextureFormat::get_name(Format format) {
+    switch (format) {
+    case Format::RGBA8888:        return "RGBA8888";
+    case Format::RGBA4444:        return "RGBA4444";
+    case Format::RGBA5551:        return "RGBA5551";
+    case Format::RGB565:          return "RGB565";
+    case Format::LUMINANCE_ALPHA: return "LUMINANCE_ALPHA";
+    case Format::ALPHA:           return "ALPHA";
+    }
+    return "";
+}
+
+
+std::vector<uint8_t> TextureFormat::convert(Format format, const uint8_t *rgba, size_t count) {
+    std::vector<uint8_t> converted(count * size_t(bytes_per_pixel(format)));
+    uint8_t *out(converted.data());
+
+    switch (format) {
+    case Format::RGBA8888:
+        std::memcpy(out, rgba, count * 4);
+        break;
+    case Format::RGBA4444:
+        pack_16<Pack4444>(rgba, count, out);
+        break;
+    case Format::RGBA5551:
+        pack_16<Pack5551>(rgba, count, out);
+        break;
+    case Format::RGB565:
+        pack_16<Pack565>(rgba, count, out);
+        break;
+    case Format::LUMINANCE_ALPHA:
+        for (size_t i = 0; i < count; ++i) {
+            out[i * 2]     = rgba[i * 4];
+            out[i * 2 + 1] = rgba[i * 4 + 3];
+        }
+        break;
+    case Format::ALPHA:
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = rgba[i * 4 + 3];
+        }
+        break;
+    }
+
+    return converted;
+}
+
+
+void TextureFormat::upload(Format format, GLsizei width, GLsizei height, const uint8_t *rgba) {
+    if (format == Format::RGBA8888) {
+        upload_converted(format, width, height, rgba);
+        return;
+    }
+
+    std::vector<uint8_t> converted(convert(format, rgba, size_t(width) * size_t(height)));
+    upload_converted(format, width, height, converted.data());
+}
+
+
+void TextureFormat::upload_converted(Format format, GLsizei width, GLsizei height, const void *pixels) {
+    GLFormat gl_format(get_gl_format(format));
+
+    // Rows of the smaller formats aren't padded to 4 bytes
+    GLState::get_current().count_calls(3);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, gl_format.internal_format, width, height, 0, gl_format.format, gl_format.type, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+
+void TextureFormat::update_converted(Format format, GLint y, GLsizei width, GLsizei height, const void *pixels) {
+    GLFormat gl_format(get_gl_format(format));
+
+    GLState::get_current().count_calls(3);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width, height, gl_format.format, gl_format.type, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
@@ -0,0 +1,120 @@
+#ifndef TEXTURE_FORMAT_H
+#define TEXTURE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+
+#if defined(USE_GL)
+#define GL_GLEXT_PROTOTYPES
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+///
+/// The pixel formats textures can be uploaded in, and the conversions
+/// to them from RGBA images.
+///
+/// Images are kept in main memory as 8 bit RGBA, but most don't need
+/// all of it on the GPU. An image whose colour channels are all equal
+/// loses nothing as luminance and alpha, and one which is all black as
+/// alpha alone. Otherwise, when reduced precision is allowed, a 16 bit
+/// format is chosen from how the image uses alpha.
+///
+class TextureFormat {
+public:
+    enum class Format {
+        ///
+        /// 8 bits for each channel, as the image is stored
+        ///
+        RGBA8888,
+        ///
+        /// 4 bits for each channel, for images with partial alpha
+        ///
+        RGBA4444,
+        ///
+        /// 5 bits for each colour channel and 1 bit of alpha, for images
+        /// which are only ever fully opaque or fully transparent
+        ///
+        RGBA5551,
+        ///
+        /// 5, 6 and 5 bits of colour with no alpha, for opaque images
+        ///
+        RGB565,
+        ///
+        /// 8 bits of luminance, from the red channel, and 8 of alpha
+        ///
+        LUMINANCE_ALPHA,
+        ///
+        /// 8 bits of alpha, read as black
+        ///
+        ALPHA
+    };
+
+    ///
+    /// Choose the format for an image.
+    /// @param rgba the image's pixels, 4 bytes each
+    /// @param count the number of pixels
+    /// @param reduced whether precision can be lost
+    ///
+    static Format choose(const uint8_t *rgba, size_t count, bool reduced);
+
+    ///
+    /// Get the bytes a pixel takes up in a format
+    ///
+    static int bytes_per_pixel(Format format);
+
+    ///
+    /// Get the name of a format, for logging
+    ///
+    static const char *get_name(Format format);
+
+    ///
+    /// Convert RGBA pixels to a format. The 16 bit formats are in the
+    /// machine's byte order, as GL expects them.
+    /// @param format the format to convert to
+    /// @param rgba the pixels, 4 bytes each
+    /// @param count the number of pixels
+    /// @return the converted pixels
+    ///
+    static std::vector<uint8_t> convert(Format format, const uint8_t *rgba, size_t count);
+
+    ///
+    /// Upload RGBA pixels to the bound 2D texture, converting them to a
+    /// format first.
+    /// @param format the format to upload in
+    /// @param width the width of the image in pixels
+    /// @param height the height of the image in pixels
+    /// @param rgba the pixels, 4 bytes each, row by row
+    ///
+    static void upload(Format format, GLsizei width, GLsizei height, const uint8_t *rgba);
+
+    ///
+    /// Upload pixels already in a format to the bound 2D texture.
+    /// @param format the format of the pixels
+    /// @param width the width of the image in pixels
+    /// @param height the height of the image in pixels
+    /// @param pixels the pixels, row by row with no padding
+    ///
+    static void upload_converted(Format format, GLsizei width, GLsizei height, const void *pixels);
+
+    ///
+    /// Update part of the bound 2D texture with pixels already in its
+    /// format.
+    /// @param format the format of the texture and pixels
+    /// @param y the first row to update
+    /// @param width the width of the texture in pixels
+    /// @param height the number of rows to update
+    /// @param pixels the pixels, row by row with no padding
+    ///
+    static void update_converted(Format format, GLint y, GLsizei width, GLsizei height, const void *pixels);
+};
+
+#endif
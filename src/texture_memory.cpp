@@ -0,0 +1,68 @@
+#include <cstdint>
+#include <glog/logging.h>
+#include <map>
+#include <string>
+
+#include "texture_format.hpp"
+#include "texture_memory.hpp"
+
+
+
+std::map<GLuint, TextureMemory::Entry> TextureMemory::textures;
+
+
+void TextureMemory::record(GLuint texture, const std::string &kind, int width, int height, TextureFormat::Format format) {
+    int64_t pixels(int64_t(width) * int64_t(height));
+    textures[texture] = Entry{kind, format, pixels * TextureFormat::bytes_per_pixel(format), pixels * 4};
+
+    VLOG(1) << "Texture " << texture << " (" << kind << "): (" << width << ", " << height << ") as "
+            << TextureFormat::get_name(format);
+}
+
+
+void TextureMemory::forget(GLuint texture) {
+    textures.erase(texture);
+}
+
+
+int64_t TextureMemory::get_bytes() {
+    int64_t bytes(0);
+    for (auto &texture : textures) {
+        bytes += texture.second.bytes;
+    }
+    return bytes;
+}
+
+
+int64_t TextureMemory::get_rgba_bytes() {
+    int64_t bytes(0);
+    for (auto &texture : textures) {
+        bytes += texture.second.rgba_bytes;
+    }
+    return bytes;
+}
+
+
+void TextureMemory::report() {
+    struct Totals {
+        int count = 0;
+        int64_t bytes = 0;
+        int64_t rgba_bytes = 0;
+    };
+
+    std::map<std::string, Totals> kinds;
+    for (auto &texture : textures) {
+        Totals &totals(kinds[texture.second.kind]);
+        ++totals.count;
+        totals.bytes      += texture.second.bytes;
+        totals.rgba_bytes += texture.second.rgba_bytes;
+    }
+
+    LOG(INFO) << "GPU texture memory: " << get_bytes() / 1024 << " KiB, "
+              << get_rgba_bytes() / 1024 << " KiB as RGBA8888";
+    for (auto &kind : kinds) {
+        LOG(INFO) << "  " << kind.first << ": " << kind.second.count << " textures, "
+                  << kind.second.bytes / 1024 << " KiB, "
+                  << kind.second.rgba_bytes / 1024 << " KiB as RGBA8888";
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef TEXTURE_MEMORY_H
+#define TEXTURE_MEMORY_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+
+#if defined(USE_GL)
+#define GL_GLEXT_PROTOTYPES
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+#include "texture_format.hpp"
+
+///
+/// Keeps count of the GPU memory taken by textures, and what they
+/// would take as 8 bit RGBA, so the saving from smaller formats can be
+/// reported.
+///
+/// Textures are recorded when they are uploaded and forgotten when
+/// deleted through GLState.
+///
+class TextureMemory {
+private:
+    struct Entry {
+        ///
+        /// What the texture is used for, to group the report by
+        ///
+        std::string kind;
+        TextureFormat::Format format;
+        int64_t bytes;
+        int64_t rgba_bytes;
+    };
+
+    ///
+    /// The textures uploaded, by GL name
+    ///
+    static std::map<GLuint, Entry> textures;
+
+public:
+    ///
+    /// Record a texture's upload, replacing any earlier one.
+    /// @param texture the texture's GL name
+    /// @param kind what the texture is used for
+    /// @param width the width of the texture in pixels
+    /// @param height the height of the texture in pixels
+    /// @param format the format it was uploaded in
+    ///
+    static void record(GLuint texture, const std::string &kind, int width, int height, TextureFormat::Format format);
+
+    ///
+    /// Forget a deleted texture
+    ///
+    static void forget(GLuint texture);
+
+    ///
+    /// Get the memory taken by the textures, in bytes
+    ///
+    static int64_t get_bytes();
+
+    ///
+    /// Get the memory the textures would take as 8 bit RGBA, in bytes
+    ///
+    static int64_t get_rgba_bytes();
+
+    ///
+    /// Log the memory taken by each kind of texture, as uploaded and as
+    /// 8 bit RGBA
+    ///
+    static void report();
+};
+
+#endif
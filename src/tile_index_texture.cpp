@@ -0,0 +1,125 @@
+#include <cmath>
+#include <glog/logging.h>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/vec2.hpp>
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+
+#if defined(USE_GL)
+#define GL_GLEXT_PROTOTYPES
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+#include "gl_state.hpp"
+#include "texture_format.hpp"
+#include "texture_memory.hpp"
+#include "tile_index_texture.hpp"
+
+const int TileIndexTexture::texel_size;
+
+TileIndexTexture::TileIndexTexture(int width, int height):
+    width(width),
+    height(height),
+    texels(size_t(width * height * texel_size), GLubyte(0)),
+    unit_size(0.0f, 0.0f) {
+}
+
+TileIndexTexture::~TileIndexTexture() {
+    if (texture != 0) {
+        GLState::delete_texture(texture);
+    }
+}
+
+glm::vec2 TileIndexTexture::encode(GLubyte *texel, std::tuple<float, float, float, float> coords) {
+    glm::vec2 unit(std::get<1>(coords) - std::get<0>(coords),
+                   std::get<3>(coords) - std::get<2>(coords));
+
+    // Atlas cells are on a grid, so the cell is the number of cells to
+    // its bottom left corner
+    int column(int(std::round(std::get<0>(coords) / unit.x)));
+    int row   (int(std::round(std::get<2>(coords) / unit.y)));
+    CHECK(column >= 0 && column < 65536 && row >= 0 && row < 255 * 256);
+
+    texel[0] = GLubyte(column & 0xff);
+    texel[1] = GLubyte(column >> 8);
+    texel[2] = GLubyte(row & 0xff);
+    texel[3] = GLubyte((row >> 8) + 1);
+
+    return unit;
+}
+
+void TileIndexTexture::encode_blank(GLubyte *texel) {
+    texel[0] = texel[1] = texel[2] = texel[3] = 0;
+}
+
+std::pair<int, int> TileIndexTexture::decode(const GLubyte *texel) {
+    if (texel[3] == 0) {
+        return std::make_pair(-1, -1);
+    }
+
+    return std::make_pair(int(texel[0]) + (int(texel[1]) << 8),
+                          int(texel[2]) + ((int(texel[3]) - 1) << 8));
+}
+
+void TileIndexTexture::set_tile(int x, int y, std::tuple<float, float, float, float> coords) {
+    CHECK(x >= 0 && x < width && y >= 0 && y < height);
+
+    // All the cells of an atlas are the same size
+    unit_size = encode(&texels[size_t((y * width + x) * texel_size)], coords);
+}
+
+void TileIndexTexture::clear_tile(int x, int y) {
+    CHECK(x >= 0 && x < width && y >= 0 && y < height);
+
+    encode_blank(&texels[size_t((y * width + x) * texel_size)]);
+}
+
+void TileIndexTexture::upload() {
+    GLState &gl_state(GLState::get_current());
+
+    if (texture == 0) {
+        glGenTextures(1, &texture);
+        gl_state.count_calls();
+    }
+
+    gl_state.active_texture(GL_TEXTURE0);
+    gl_state.bind_texture_2d(texture);
+
+    // The texels are looked up exactly, so mustn't be filtered or
+    // wrapped; this also allows textures whose sides aren't powers of
+    // two in GL ES
+    gl_state.count_calls(5);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+
+    TextureMemory::record(texture, "tile index", width, height, TextureFormat::Format::RGBA8888);
+}
+
+void TileIndexTexture::upload_tile(int x, int y) {
+    CHECK(x >= 0 && x < width && y >= 0 && y < height);
+
+    if (texture == 0) {
+        upload();
+        return;
+    }
+
+    GLState &gl_state(GLState::get_current());
+    gl_state.active_texture(GL_TEXTURE0);
+    gl_state.bind_texture_2d(texture);
+
+    gl_state.count_calls();
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &texels[size_t((y * width + x) * texel_size)]);
+}
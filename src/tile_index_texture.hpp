@@ -0,0 +1,131 @@
+#ifndef TILE_INDEX_TEXTURE_H
+#define TILE_INDEX_TEXTURE_H
+
+#include <tuple>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/vec2.hpp>
+
+#ifdef USE_GLES
+#include <GLES2/gl2.h>
+#endif
+
+#if defined(USE_GL)
+#define GL_GLEXT_PROTOTYPES
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+///
+/// A texture with one texel for each tile of a layer, saying which
+/// cell of the atlas the tile shows. Used by the tilemap shader to draw
+/// a whole layer as one quad.
+///
+/// Each texel is 4 bytes: the cell's column as 16 bits in red and
+/// green, and its row as 16 bits in blue and alpha, with the alpha
+/// offset by one so that blank tiles are those with no alpha.
+///
+class TileIndexTexture {
+    ///
+    /// The size of the layer, in tiles
+    ///
+    int width;
+    int height;
+
+    ///
+    /// The texels, row by row from the bottom left
+    ///
+    std::vector<GLubyte> texels;
+
+    ///
+    /// The GL texture
+    ///
+    GLuint texture = 0;
+
+    ///
+    /// The size of an atlas cell in texture coordinates
+    ///
+    glm::vec2 unit_size;
+
+    TileIndexTexture(const TileIndexTexture &) = delete;
+    TileIndexTexture &operator=(const TileIndexTexture &) = delete;
+
+public:
+    ///
+    /// The number of bytes in a texel
+    ///
+    static const int texel_size = 4;
+
+    ///
+    /// Make the texture for a layer, with every tile blank
+    /// @param width the width of the layer in tiles
+    /// @param height the height of the layer in tiles
+    ///
+    TileIndexTexture(int width, int height);
+    ~TileIndexTexture();
+
+    ///
+    /// Write the texel of a tile
+    /// @param texel where to write the texel_size bytes
+    /// @param coords the tile's texture coordinates, as from
+    ///        TextureAtlas::index_to_coords
+    /// @return the size of an atlas cell in texture coordinates
+    ///
+    static glm::vec2 encode(GLubyte *texel, std::tuple<float, float, float, float> coords);
+
+    ///
+    /// Write the texel of a blank tile
+    ///
+    static void encode_blank(GLubyte *texel);
+
+    ///
+    /// Read the atlas cell from a texel, as the shader does
+    /// @return the cell's column and row, counted from the bottom left,
+    ///         or (-1, -1) for a blank tile
+    ///
+    static std::pair<int, int> decode(const GLubyte *texel);
+
+    ///
+    /// Set a tile, without uploading it
+    /// @param x the tile's x position
+    /// @param y the tile's y position
+    /// @param coords the tile's texture coordinates
+    ///
+    void set_tile(int x, int y, std::tuple<float, float, float, float> coords);
+
+    ///
+    /// Make a tile blank, without uploading it
+    ///
+    void clear_tile(int x, int y);
+
+    ///
+    /// Upload all the tiles
+    ///
+    void upload();
+
+    ///
+    /// Upload one tile, as a single texel
+    ///
+    void upload_tile(int x, int y);
+
+    ///
+    /// Get the GL texture
+    ///
+    GLuint get_gl_texture() { return texture; }
+
+    ///
+    /// Get the size of the layer in tiles
+    ///
+    glm::vec2 get_size() { return glm::vec2(float(width), float(height)); }
+
+    ///
+    /// Get the size of an atlas cell in texture coordinates
+    ///
+    glm::vec2 get_unit_size() { return unit_size; }
+};
+
+#endif
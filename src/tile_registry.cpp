@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <glog/logging.h>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "binary_cache.hpp"
+#include "fml.hpp"
+#include "texture_atlas.hpp"
+#include "tile_registry.hpp"
+
+namespace {
+    const std::string magic("PYLTILES");
+}
+
+const TileRegistry::Handle TileRegistry::none;
+const uint32_t TileRegistry::version;
+const std::string TileRegistry::default_filename("../resources/tiles/associated_texture_atlas.fml");
+
+TileRegistry::TileRegistry() {}
+
+TileRegistry &TileRegistry::get_instance() {
+    static TileRegistry global_instance;
+    static bool loaded(false);
+
+    if (!loaded) {
+        global_instance.load(default_filename);
+        loaded = true;
+    }
+
+    return global_instance;
+}
+
+
+std::string TileRegistry::get_cache_key(const std::string &filename) {
+    int64_t mtime(-1);
+    int64_t size(-1);
+
+    struct stat info;
+    if (stat(filename.c_str(), &info) == 0) {
+        mtime = int64_t(info.st_mtime);
+        size  = int64_t(info.st_size);
+    }
+
+    std::stringstream key;
+    key << version << ";" << filename << ":" << mtime << ":" << size;
+    return key.str();
+}
+
+std::string TileRegistry::get_cache_path(const std::string &filename) {
+    return BinaryCache::get_path("tiles", filename, ".ptiles");
+}
+
+
+void TileRegistry::set_tiles(const std::map<std::string, std::string> &names_to_tilesets) {
+    names.clear();
+    tilesets_of.clear();
+    tilesets.clear();
+    handles.clear();
+
+    std::map<std::string, uint32_t> tileset_indexes;
+
+    // The map is ordered, so the handles are too
+    names.reserve(names_to_tilesets.size());
+    tilesets_of.reserve(names_to_tilesets.size());
+    for (auto &name_to_tileset : names_to_tilesets) {
+        auto tileset_index(tileset_indexes.insert(std::make_pair(name_to_tileset.second,
+                                                                 uint32_t(tilesets.size()))));
+        if (tileset_index.second) {
+            tilesets.push_back(name_to_tileset.second);
+        }
+
+        handles[name_to_tileset.first] = Handle(names.size());
+        names.push_back(name_to_tileset.first);
+        tilesets_of.push_back(tileset_index.first->second);
+    }
+
+    forget_resolved();
+}
+
+void TileRegistry::load(const std::string &filename) {
+    try {
+        load_cache(filename);
+        VLOG(1) << "Loaded " << names.size() << " tile names from the cache of " << filename;
+        return;
+    }
+    catch (LoadException &e) {
+        VLOG(1) << "Parsing " << filename << ": " << e.what();
+    }
+
+    std::ifstream input(filename);
+    if (input.fail()) {
+        LOG(ERROR) << "Tile names \"" << filename << "\" could not be opened";
+        set_tiles({});
+        return;
+    }
+
+    std::map<std::string, std::string> names_to_tilesets;
+    fml::from_stream(input, names_to_tilesets);
+    set_tiles(names_to_tilesets);
+
+    try {
+        save_cache(filename);
+    }
+    catch (LoadException &e) {
+        LOG(WARNING) << "Couldn't cache tile names: " << e.what();
+    }
+}
+
+void TileRegistry::load_cache(const std::string &filename) {
+    std::string path(get_cache_path(filename));
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw LoadException("No cached tile names " + path);
+    }
+
+    BinaryCache::read_header(file, magic, version, get_cache_key(filename));
+
+    std::vector<std::string> new_tilesets;
+    uint32_t num_tilesets(BinaryCache::read<uint32_t>(file));
+    for (uint32_t i = 0; i < num_tilesets; ++i) {
+        new_tilesets.push_back(BinaryCache::read_string(file));
+    }
+
+    std::vector<std::string> new_names;
+    std::vector<uint32_t> new_tilesets_of;
+    uint32_t num_names(BinaryCache::read<uint32_t>(file));
+    for (uint32_t i = 0; i < num_names; ++i) {
+        new_names.push_back(BinaryCache::read_string(file));
+        new_tilesets_of.push_back(BinaryCache::read<uint32_t>(file));
+
+        if (new_tilesets_of.back() >= num_tilesets) {
+            throw LoadException("Cached tile names have a missing tileset");
+        }
+        // Handles depend on the names being in order
+        if (i > 0 && !(new_names[i - 1] < new_names[i])) {
+            throw LoadException("Cached tile names are out of order");
+        }
+    }
+
+    names       = std::move(new_names);
+    tilesets_of = std::move(new_tilesets_of);
+    tilesets    = std::move(new_tilesets);
+
+    handles.clear();
+    handles.reserve(names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+        handles[names[i]] = Handle(i);
+    }
+
+    forget_resolved();
+}
+
+void TileRegistry::save_cache(const std::string &filename) const {
+    BinaryCache::save(get_cache_path(filename), magic, version, get_cache_key(filename), [&] (std::ostream &file) {
+        BinaryCache::write(file, uint32_t(tilesets.size()));
+        for (const std::string &tileset : tilesets) {
+            BinaryCache::write_string(file, tileset);
+        }
+
+        BinaryCache::write(file, uint32_t(names.size()));
+        for (size_t i = 0; i < names.size(); ++i) {
+            BinaryCache::write_string(file, names[i]);
+            BinaryCache::write(file, tilesets_of[i]);
+        }
+    });
+}
+
+
+TileRegistry::Handle TileRegistry::find(const std::string &name) const {
+    auto handle(handles.find(name));
+    return handle == std::end(handles) ? none : handle->second;
+}
+
+TileRegistry::Handle TileRegistry::get_handle(const std::string &name) const {
+    Handle handle(find(name));
+    if (handle == none) {
+        throw std::runtime_error("Tile not found: " + name);
+    }
+    return handle;
+}
+
+std::pair<TileRegistry::Handle, TileRegistry::Handle>
+TileRegistry::find_directory(const std::string &directory) const {
+    std::string prefix(directory + "/");
+
+    // Everything starting with the prefix sorts after it and before the
+    // prefix with its last character, '/', bumped to '0'
+    std::string end_prefix(prefix);
+    end_prefix.back() = char('/' + 1);
+
+    auto first(std::lower_bound(std::begin(names), std::end(names), prefix));
+    auto last (std::lower_bound(first,             std::end(names), end_prefix));
+
+    return std::make_pair(Handle(first - std::begin(names)), Handle(last - std::begin(names)));
+}
+
+
+TileRegistry::Tile TileRegistry::resolve(Handle handle) {
+    CHECK(handle >= 0 && handle < size()) << "Tile handle " << handle << " out of range";
+
+    if (resolved.size() != names.size()) {
+        resolved.resize(names.size());
+        atlases.resize(tilesets.size());
+    }
+
+    Resolved &tile(resolved[size_t(handle)]);
+    if (std::shared_ptr<TextureAtlas> atlas = tile.atlas.lock()) {
+        return Tile{atlas, tile.index, tile.coords};
+    }
+
+    // Looked up once per tileset, rather than through the resource cache
+    // for every tile
+    uint32_t tileset(tilesets_of[size_t(handle)]);
+    std::shared_ptr<TextureAtlas> atlas(atlases[tileset].lock());
+    if (!atlas) {
+        atlas = TextureAtlas::get_shared(tilesets[tileset]);
+        atlases[tileset] = atlas;
+    }
+
+    tile.atlas  = atlas;
+    tile.index  = atlas->get_name_index(names[size_t(handle)]);
+    tile.coords = atlas->index_to_coords(tile.index);
+
+    return Tile{atlas, tile.index, tile.coords};
+}
+
+void TileRegistry::forget_resolved() {
+    resolved.clear();
+    atlases.clear();
+}
@@ -0,0 +1,199 @@
+#ifndef TILE_REGISTRY_H
+#define TILE_REGISTRY_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "binary_cache.hpp"
+
+class TextureAtlas;
+
+///
+/// Every known tile name, interned once into an integer handle.
+///
+/// The names and the tilesets holding them come from
+/// associated_texture_atlas.fml, or from a binary cache of it when that
+/// is up to date, as parsing FML is slow. Handles are given out in name
+/// order, so the tiles in a directory have consecutive handles.
+///
+/// A handle resolves to the atlas holding the tile, its index there and
+/// its texture coordinates. These are looked up the first time and kept,
+/// so resolving again is an array lookup. Atlases are held weakly, as
+/// the resource cache holds them, and coordinates are forgotten when
+/// atlases are merged, as that moves them. Only the main thread may
+/// resolve tiles, as loading atlases needs GL.
+///
+class TileRegistry {
+public:
+    using Handle = int32_t;
+
+    ///
+    /// A handle to no tile
+    ///
+    static const Handle none = -1;
+
+    ///
+    /// The version of the cache format. Files of other versions are
+    /// rejected when loading.
+    ///
+    static const uint32_t version = 1;
+
+    ///
+    /// A resolved tile
+    ///
+    struct Tile {
+        std::shared_ptr<TextureAtlas> atlas;
+        int index;
+        ///
+        /// The left, right, bottom and top of the tile in the atlas
+        ///
+        std::tuple<float, float, float, float> coords;
+    };
+
+    ///
+    /// Represents a failure to load a cached registry, because it isn't
+    /// cached or is stale.
+    ///
+    using LoadException = BinaryCache::LoadException;
+
+private:
+    ///
+    /// The names of the tiles, by handle, in order
+    ///
+    std::vector<std::string> names;
+
+    ///
+    /// The tileset of each tile, as an index into tilesets
+    ///
+    std::vector<uint32_t> tilesets_of;
+
+    ///
+    /// The names of the tilesets, which are the atlases' resource names
+    ///
+    std::vector<std::string> tilesets;
+
+    std::unordered_map<std::string, Handle> handles;
+
+    struct Resolved {
+        std::weak_ptr<TextureAtlas> atlas;
+        int index;
+        std::tuple<float, float, float, float> coords;
+    };
+
+    ///
+    /// Tiles resolved so far, by handle
+    ///
+    std::vector<Resolved> resolved;
+
+    ///
+    /// Atlases looked up so far, by tileset
+    ///
+    std::vector<std::weak_ptr<TextureAtlas>> atlases;
+
+    ///
+    /// Get the key the cache of an FML file is stored under, from its
+    /// path, size and modification time.
+    ///
+    static std::string get_cache_key(const std::string &filename);
+
+public:
+    ///
+    /// Get the path of the cache of an FML file.
+    ///
+    static std::string get_cache_path(const std::string &filename);
+
+    ///
+    /// The file the global registry is loaded from
+    ///
+    static const std::string default_filename;
+
+    TileRegistry();
+
+    ///
+    /// Get the global registry, loading it the first time.
+    ///
+    static TileRegistry &get_instance();
+
+    ///
+    /// Replace the tiles in the registry.
+    /// @param names_to_tilesets the tileset of each tile, by name
+    ///
+    void set_tiles(const std::map<std::string, std::string> &names_to_tilesets);
+
+    ///
+    /// Load the tiles from an FML file mapping tile names to tilesets,
+    /// or from its cache if it hasn't changed. A fresh cache is written
+    /// when it had to be parsed.
+    ///
+    void load(const std::string &filename);
+
+    ///
+    /// Load the tiles from the cache of an FML file.
+    /// Throws LoadException if it isn't cached or has changed since.
+    ///
+    void load_cache(const std::string &filename);
+
+    ///
+    /// Save the tiles as the cache of an FML file.
+    /// Throws LoadException if it can't be written.
+    ///
+    void save_cache(const std::string &filename) const;
+
+    ///
+    /// Get the number of tiles
+    ///
+    Handle size() const { return Handle(names.size()); }
+
+    ///
+    /// Find a tile.
+    /// @return its handle, or none if there is no such tile
+    ///
+    Handle find(const std::string &name) const;
+
+    ///
+    /// Get the handle of a tile, throwing std::runtime_error if there is
+    /// no such tile.
+    ///
+    Handle get_handle(const std::string &name) const;
+
+    ///
+    /// Find the tiles in a directory, such as "sprites/croc/north".
+    /// @return the first handle and one past the last
+    ///
+    std::pair<Handle, Handle> find_directory(const std::string &directory) const;
+
+    const std::string &get_name(Handle handle) const { return names[size_t(handle)]; }
+
+    ///
+    /// Get the name of the tileset, and so the atlas, holding a tile.
+    ///
+    const std::string &get_tileset_name(Handle handle) const {
+        return tilesets[tilesets_of[size_t(handle)]];
+    }
+
+    ///
+    /// Resolve a tile to its atlas, index and texture coordinates,
+    /// loading the atlas if needed.
+    ///
+    Tile resolve(Handle handle);
+
+    ///
+    /// Resolve a tile by name, throwing std::runtime_error if there is
+    /// no such tile.
+    ///
+    Tile resolve(const std::string &name) { return resolve(get_handle(name)); }
+
+    ///
+    /// Forget the tiles resolved, for when atlases are merged and their
+    /// texture coordinates move.
+    ///
+    void forget_resolved();
+};
+
+#endif
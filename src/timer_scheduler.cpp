@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "event_task.hpp"
+#include "game_time.hpp"
+#include "timer_scheduler.hpp"
+
+
+TimerScheduler::TimerScheduler():
+    ticking(false) {
+}
+
+bool TimerScheduler::step(Tween &tween, GameTime::time_point now) {
+    auto completion = now - tween.start;
+
+    // Don't allow finite polling speed to allow > 100% completion.
+    float fraction_complete(1.0f);
+    if (tween.duration > GameTime::duration::zero()) {
+        fraction_complete = float(std::max(0.0, std::min(completion / tween.duration, 1.0)));
+    }
+
+    // Stop if the callback wishes or the tween is complete.
+    return tween.func(fraction_complete) && fraction_complete < 1.0f;
+}
+
+void TimerScheduler::add_tween(Handle handle, GameTime::time_point start, GameTime::duration duration,
+                               std::function<bool (float)> func) {
+    Tween tween{handle, start, duration, std::move(func), false};
+
+    if (step(tween, start)) {
+        tweens.push_back(std::move(tween));
+    }
+}
+
+void TimerScheduler::add_timer(Handle handle, GameTime::time_point due, EventTask func) {
+    timers.push_back(Timer{due, handle, std::move(func)});
+    std::push_heap(std::begin(timers), std::end(timers));
+}
+
+bool TimerScheduler::cancel(Handle handle) {
+    for (auto it = std::begin(tweens); it != std::end(tweens); ++it) {
+        if (it->handle == handle && !it->cancelled) {
+            if (ticking) {
+                // The tween may be the one running
+                it->cancelled = true;
+            }
+            else {
+                tweens.erase(it);
+            }
+            return true;
+        }
+    }
+
+    for (auto it = std::begin(timers); it != std::end(timers); ++it) {
+        if (it->handle == handle) {
+            // Removing from the middle would break the heap
+            *it = std::move(timers.back());
+            timers.pop_back();
+            std::make_heap(std::begin(timers), std::end(timers));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int TimerScheduler::tick(GameTime::time_point now) {
+    int runs(0);
+
+    // Timers run after being taken out, so they can change the heap
+    while (!timers.empty() && timers.front().due <= now) {
+        std::pop_heap(std::begin(timers), std::end(timers));
+        EventTask func(std::move(timers.back().func));
+        timers.pop_back();
+
+        if (func) {
+            func();
+            ++runs;
+        }
+    }
+
+    ticking = true;
+
+    // Stepped in place; the size is checked each time round, in case
+    // they're cleared
+    for (size_t i = 0; i < tweens.size(); ++i) {
+        Tween &tween(tweens[i]);
+        if (tween.cancelled) { continue; }
+
+        if (!step(tween, now)) {
+            tween.cancelled = true;
+        }
+        ++runs;
+    }
+
+    ticking = false;
+
+    tweens.erase(std::remove_if(std::begin(tweens), std::end(tweens),
+                                [] (const Tween &tween) { return tween.cancelled; }),
+                 std::end(tweens));
+
+    return runs;
+}
+
+void TimerScheduler::clear() {
+    if (ticking) {
+        for (Tween &tween : tweens) {
+            tween.cancelled = true;
+        }
+    }
+    else {
+        tweens.clear();
+    }
+
+    timers.clear();
+}
+
+bool TimerScheduler::has_tweens() const {
+    return std::any_of(std::begin(tweens), std::end(tweens),
+                       [] (const Tween &tween) { return !tween.cancelled; });
+}
@@ -0,0 +1,137 @@
+#ifndef TIMER_SCHEDULER_H
+#define TIMER_SCHEDULER_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "event_task.hpp"
+#include "game_time.hpp"
+
+///
+/// Keeps timed callbacks resident and runs them against game time.
+///
+/// Tweens are called every tick with how far through their duration
+/// they are, in place, until they finish or ask to stop. Timers are
+/// called once when they fall due, and are kept in a binary heap by due
+/// time, so only the earliest is looked at each tick.
+///
+/// Everything is keyed on GameTime::time_point, so changing the speed
+/// of game time changes when they complete without re-queuing them.
+///
+/// Only the main thread may use a scheduler. Callbacks run during tick
+/// may cancel or clear, but shouldn't add; EventManager defers adding
+/// through its event queue.
+///
+class TimerScheduler {
+public:
+    ///
+    /// Identifies a tween or timer, so it can be cancelled. 0 is never
+    /// used.
+    ///
+    using Handle = uint64_t;
+
+private:
+    struct Tween {
+        Handle handle;
+        GameTime::time_point start;
+        GameTime::duration duration;
+        std::function<bool (float)> func;
+
+        ///
+        /// Cancelled during a tick, to be removed after it
+        ///
+        bool cancelled;
+    };
+
+    struct Timer {
+        GameTime::time_point due;
+        Handle handle;
+        EventTask func;
+
+        ///
+        /// Orders the heap so the earliest is at the front, with ties
+        /// going to whichever was added first
+        ///
+        bool operator<(const Timer &other) const {
+            return due != other.due ? due > other.due : handle > other.handle;
+        }
+    };
+
+    std::vector<Tween> tweens;
+
+    ///
+    /// A binary heap, earliest due first
+    ///
+    std::vector<Timer> timers;
+
+    ///
+    /// Whether tweens are being called, so they mustn't be removed
+    ///
+    bool ticking;
+
+    ///
+    /// Call a tween with its completion.
+    /// @return whether it should be kept
+    ///
+    static bool step(Tween &tween, GameTime::time_point now);
+
+public:
+    TimerScheduler();
+
+    ///
+    /// Add a tween, stepping it once straight away, as happens on the
+    /// frame it is added.
+    /// @param handle the tween's handle
+    /// @param start when it starts, which is also the time now
+    /// @param duration how long it lasts
+    /// @param func called with the fraction of the duration passed, from
+    ///             0.0 to 1.0. Return false to stop early.
+    ///
+    void add_tween(Handle handle, GameTime::time_point start, GameTime::duration duration,
+                   std::function<bool (float)> func);
+
+    ///
+    /// Add a timer.
+    /// @param handle the timer's handle
+    /// @param due when to run it
+    /// @param func called once when due
+    ///
+    void add_timer(Handle handle, GameTime::time_point due, EventTask func);
+
+    ///
+    /// Cancel a tween or timer, so it isn't called again.
+    /// @return whether it was found
+    ///
+    bool cancel(Handle handle);
+
+    ///
+    /// Run the timers which are due, earliest first, and then step the
+    /// tweens.
+    /// @param now the game time now
+    /// @return the number of callbacks run
+    ///
+    int tick(GameTime::time_point now);
+
+    ///
+    /// Cancel everything.
+    ///
+    void clear();
+
+    ///
+    /// Whether any tweens are running, which need ticking every frame
+    ///
+    bool has_tweens() const;
+
+    ///
+    /// Whether any timers are waiting to fall due
+    ///
+    bool has_timers() const { return !timers.empty(); }
+
+    ///
+    /// Get when the earliest timer is due. Only valid if has_timers.
+    ///
+    GameTime::time_point get_next_due() const { return timers.front().due; }
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include <cstdint>
+#include <glog/logging.h>
+#include <vector>
+
+#include "walkability_grid.hpp"
+
+WalkabilityGrid::WalkabilityGrid(int width, int height):
+    width(width),
+    height(height),
+    blocked_bits  (size_t((width * height + 63) / 64), 0),
+    collision_bits(size_t((width * height + 63) / 64), 0),
+    blocker_counts(size_t(width * height), 0) {
+}
+
+void WalkabilityGrid::refresh(int index) {
+    uint64_t bit(uint64_t(1) << (index % 64));
+    size_t word(size_t(index / 64));
+
+    if ((collision_bits[word] & bit) || blocker_counts[size_t(index)] != 0) {
+        blocked_bits[word] |= bit;
+    }
+    else {
+        blocked_bits[word] &= ~bit;
+    }
+}
+
+void WalkabilityGrid::set_collision(int x, int y, bool collides) {
+    if (!in_bounds(x, y)) {
+        return;
+    }
+
+    int index(y * width + x);
+    uint64_t bit(uint64_t(1) << (index % 64));
+
+    if (collides) {
+        collision_bits[size_t(index / 64)] |= bit;
+    }
+    else {
+        collision_bits[size_t(index / 64)] &= ~bit;
+    }
+
+    refresh(index);
+}
+
+bool WalkabilityGrid::get_collision(int x, int y) const {
+    if (!in_bounds(x, y)) {
+        return false;
+    }
+
+    int index(y * width + x);
+    return (collision_bits[size_t(index / 64)] >> (index % 64)) & 1u;
+}
+
+void WalkabilityGrid::block(int x, int y) {
+    if (!in_bounds(x, y)) {
+        return;
+    }
+
+    int index(y * width + x);
+    uint16_t &count(blocker_counts[size_t(index)]);
+    ++count;
+
+    VLOG(2) << "Block level at tile " << x << " " << y
+            << " increased from " << count - 1
+            << " to " << count << ".";
+
+    // Only the first blocker changes the tile's walkability
+    if (count == 1) {
+        refresh(index);
+    }
+}
+
+void WalkabilityGrid::unblock(int x, int y) {
+    if (!in_bounds(x, y)) {
+        return;
+    }
+
+    int index(y * width + x);
+    uint16_t &count(blocker_counts[size_t(index)]);
+    CHECK(count > 0) << "Unblocking tile " << x << ", " << y << " which isn't blocked";
+    --count;
+
+    VLOG(2) << "Block level at tile " << x << " " << y
+            << " decreased from " << count + 1
+            << " to " << count << ".";
+
+    // Only the last blocker changes the tile's walkability
+    if (count == 0) {
+        refresh(index);
+    }
+}
+
+int WalkabilityGrid::get_blocker_count(int x, int y) const {
+    return in_bounds(x, y) ? blocker_counts[size_t(y * width + x)] : 0;
+}
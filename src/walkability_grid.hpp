@@ -0,0 +1,98 @@
+#ifndef WALKABILITY_GRID_H
+#define WALKABILITY_GRID_H
+
+#include <cstdint>
+#include <vector>
+
+///
+/// A packed grid of which tiles on a map can be walked on.
+///
+/// A tile is unwalkable if it is set on the map's collision layer or
+/// if any object is blocking it. The collision and blocker state is
+/// kept separately and folded into one bit per tile whenever it
+/// changes, so checking a tile is a single bit test.
+///
+class WalkabilityGrid {
+    ///
+    /// The width of the grid in tiles
+    ///
+    int width;
+
+    ///
+    /// The height of the grid in tiles
+    ///
+    int height;
+
+    ///
+    /// One bit per tile, row by row from the bottom left, set when the
+    /// tile is not walkable
+    ///
+    std::vector<uint64_t> blocked_bits;
+
+    ///
+    /// One bit per tile, set when the tile is on the collision layer
+    ///
+    std::vector<uint64_t> collision_bits;
+
+    ///
+    /// The number of blockers on each tile
+    ///
+    std::vector<uint16_t> blocker_counts;
+
+    ///
+    /// Recompute a tile's blocked bit from its collision and blockers
+    ///
+    void refresh(int index);
+
+public:
+    ///
+    /// Construct an empty, fully walkable, grid
+    ///
+    WalkabilityGrid(int width = 0, int height = 0);
+
+    ///
+    /// Is the tile within the grid
+    ///
+    bool in_bounds(int x, int y) const {
+        return 0 <= x && x < width && 0 <= y && y < height;
+    }
+
+    ///
+    /// Can the tile be walked on. Tiles outside the grid can't.
+    ///
+    bool is_walkable(int x, int y) const {
+        if (!in_bounds(x, y)) {
+            return false;
+        }
+
+        int index(y * width + x);
+        return !((blocked_bits[size_t(index / 64)] >> (index % 64)) & 1u);
+    }
+
+    ///
+    /// Set whether a tile is on the collision layer
+    ///
+    void set_collision(int x, int y, bool collides);
+
+    ///
+    /// Get whether a tile is on the collision layer
+    ///
+    bool get_collision(int x, int y) const;
+
+    ///
+    /// Add a blocker to a tile. Tiles outside the grid are ignored.
+    ///
+    void block(int x, int y);
+
+    ///
+    /// Remove a blocker from a tile. Tiles outside the grid are ignored.
+    ///
+    void unblock(int x, int y);
+
+    ///
+    /// Get the number of blockers on a tile
+    ///
+    int get_blocker_count(int x, int y) const;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/vec2.hpp>
+
+#include "walkability_grid.hpp"
+#include "world_snapshot.hpp"
+
+WorldSnapshot::WorldSnapshot():
+    map_loaded(false),
+    num_objects(0) {
+}
+
+void WorldSnapshot::clear() {
+    map_loaded = false;
+    walkability_grid = WalkabilityGrid();
+    num_objects = 0;
+}
+
+void WorldSnapshot::set_map(const WalkabilityGrid &walkability_grid) {
+    map_loaded = true;
+    // Copied into the grid's vectors, which are reused
+    this->walkability_grid = walkability_grid;
+    num_objects = 0;
+}
+
+WorldSnapshot::Object &WorldSnapshot::add_object(int id) {
+    if (num_objects == objects.size()) {
+        objects.emplace_back();
+    }
+
+    Object &object(objects[num_objects++]);
+    object.id = id;
+    return object;
+}
+
+void WorldSnapshot::finish() {
+    // Swapping objects swaps their strings and vectors, so this doesn't
+    // allocate
+    std::sort(std::begin(objects), std::begin(objects) + std::ptrdiff_t(num_objects),
+              [] (const Object &a, const Object &b) { return a.id < b.id; });
+}
+
+const WorldSnapshot::Object *WorldSnapshot::find_object(int id) const {
+    auto end(std::begin(objects) + std::ptrdiff_t(num_objects));
+    auto object(std::lower_bound(std::begin(objects), end, id,
+                                 [] (const Object &object, int id) { return object.id < id; }));
+
+    if (object == end || object->id != id) {
+        return nullptr;
+    }
+    return &*object;
+}
+
+std::vector<std::tuple<std::string, int, int>> WorldSnapshot::look(const Object &sprite, int search_range) const {
+    std::vector<std::tuple<std::string, int, int>> found;
+
+    auto end(std::begin(objects) + std::ptrdiff_t(num_objects));
+    auto in_range([&] (const Object &object) {
+        return glm::length(object.position - sprite.position) <= float(search_range);
+    });
+
+    for (auto object = std::begin(objects); object != end; ++object) {
+        if (!object->sprite && object->findable && in_range(*object)) {
+            glm::ivec2 position(object->position);
+            found.push_back(std::make_tuple(object->name, position.x, position.y));
+        }
+    }
+
+    for (auto object = std::begin(objects); object != end; ++object) {
+        if (object->sprite && in_range(*object)) {
+            glm::ivec2 position(object->position);
+            found.push_back(std::make_tuple(object->name, position.x, position.y));
+        }
+    }
+
+    return found;
+}
+
+std::vector<glm::vec2> WorldSnapshot::get_retrace_steps(const Object &sprite) {
+    std::vector<glm::vec2> steps;
+
+    // Each step goes from a position back to the one before it
+    for (size_t i = sprite.positions.size(); i > 1; --i) {
+        steps.push_back(sprite.positions[i - 2] - sprite.positions[i - 1]);
+    }
+
+    return steps;
+}
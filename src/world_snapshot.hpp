@@ -0,0 +1,129 @@
+#ifndef WORLD_SNAPSHOT_H
+#define WORLD_SNAPSHOT_H
+
+#include <cstddef>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+#include "walkability_grid.hpp"
+
+///
+/// A copy of what the Python API can query about the world: which
+/// tiles can be walked on and where objects are, along with sprites'
+/// instructions and the positions they have been on.
+///
+/// Snapshots are filled in on the main thread and only read once
+/// published by SnapshotBuffer, so they can be queried from any thread.
+/// The queries answer as the matching Engine calls do. Refilling a
+/// snapshot reuses its memory, so publishing every frame doesn't
+/// allocate once the world stops growing.
+///
+class WorldSnapshot {
+public:
+    ///
+    /// An object on the map
+    ///
+    struct Object {
+        int id;
+        std::string name;
+        glm::vec2 position;
+
+        ///
+        /// Whether the object is a sprite, rather than a map object
+        ///
+        bool sprite;
+
+        ///
+        /// Whether look can find the object. Sprites always can.
+        ///
+        bool findable;
+
+        ///
+        /// A sprite's instructions
+        ///
+        std::string instructions;
+
+        ///
+        /// The positions a sprite has been on, oldest first
+        ///
+        std::vector<glm::vec2> positions;
+    };
+
+private:
+    ///
+    /// Whether there was a map when the snapshot was taken
+    ///
+    bool map_loaded;
+
+    WalkabilityGrid walkability_grid;
+
+    ///
+    /// The objects, by id. Only the first num_objects are in use; the
+    /// rest are kept to be reused.
+    ///
+    std::vector<Object> objects;
+    size_t num_objects;
+
+public:
+    WorldSnapshot();
+
+    ///
+    /// Empty the snapshot, as when there's no map
+    ///
+    void clear();
+
+    ///
+    /// Start filling the snapshot from a map
+    /// @param walkability_grid the map's walkability
+    ///
+    void set_map(const WalkabilityGrid &walkability_grid);
+
+    ///
+    /// Add an object. Its fields must all be set, as it may hold those
+    /// of an object from an earlier fill.
+    ///
+    Object &add_object(int id);
+
+    ///
+    /// Finish filling the snapshot, once every object is added
+    ///
+    void finish();
+
+    ///
+    /// Whether there was a map when the snapshot was taken
+    ///
+    bool has_map() const { return map_loaded; }
+
+    ///
+    /// Can a tile be walked on, as Engine::walkable
+    ///
+    bool walkable(glm::ivec2 location) const {
+        return walkability_grid.is_walkable(location.x, location.y);
+    }
+
+    ///
+    /// Find an object.
+    /// @return the object, or nullptr if it isn't on the map
+    ///
+    const Object *find_object(int id) const;
+
+    ///
+    /// Get all the objects within a range of a sprite, as Engine::look
+    /// @param sprite the sprite looking
+    /// @param search_range the radius of the circle to search
+    /// @return a vector of (name, x, y) tuples, findable map objects
+    ///         first and then sprites, each in order of id
+    ///
+    std::vector<std::tuple<std::string, int, int>> look(const Object &sprite, int search_range) const;
+
+    ///
+    /// Get the steps which retrace a sprite's path back to where it
+    /// started, most recent first
+    ///
+    static std::vector<glm::vec2> get_retrace_steps(const Object &sprite);
+};
+
+#endif